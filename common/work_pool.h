@@ -0,0 +1,237 @@
+﻿#ifndef WORK_POOL_H_INCLUDED
+    #define WORK_POOL_H_INCLUDED 1
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <type_traits>
+#include <condition_variable>
+
+#include <cstddef>
+#include <cstdint>
+
+// A fixed set of threads that split ranges between them. Each worker owns a queue of ranges; it
+// splits off halves for others to steal from the front and works on its own back.
+struct work_pool {
+    explicit work_pool(unsigned Threads = std::thread::hardware_concurrency()){
+        if(Threads == 0){
+            Threads = 1;
+        }
+
+        Queues = std::make_unique<queue[]>(Threads);
+        QueueCount = Threads;
+
+        // The calling thread is worker 0.
+        for(unsigned i = 1; i < Threads; ++i){
+            Workers.emplace_back([this, i](){ worker(i); });
+        }
+    }
+
+    work_pool(const work_pool&)=delete;
+    work_pool& operator=(const work_pool&)=delete;
+
+    ~work_pool(){
+        {
+            std::lock_guard Lock(Mutex);
+            Stop = true;
+        }
+
+        WakeUp.notify_all();
+
+        for(auto& e:Workers){
+            e.join();
+        }
+    }
+
+    // Number of threads including the caller.
+    unsigned size() const {
+        return QueueCount;
+    }
+
+    // Calls `Fn(Begin, End, Worker)` on disjoint subranges of `[0, Count)` no larger than `Grain`.
+    // `Worker` is in `[0, size())` and unique among concurrent calls. Not reentrant.
+    //
+    // If `Fn` throws, the ranges not yet started are skipped and the first exception is rethrown
+    // once every worker is done with the job.
+    template <typename F>
+    void parallel_for(std::size_t Count, std::size_t Grain, F&& Fn){
+        if(Count == 0){
+            return;
+        }
+
+        if(Grain == 0){
+            Grain = 1;
+        }
+
+        JobGrain = Grain;
+        JobContext = &Fn;
+        JobFunction = [](void* Context, std::size_t Begin, std::size_t End, unsigned Worker){
+            (*static_cast<std::remove_reference_t<F>*>(Context))(Begin, End, Worker);
+        };
+
+        // Hand each worker an equal share up front, they only steal once they run out.
+        auto Share = (Count+QueueCount-1)/QueueCount;
+        for(unsigned i = 0; i < QueueCount; ++i){
+            auto Begin = std::min(Count, i*Share);
+            auto End = std::min(Count, Begin+Share);
+
+            if(Begin < End){
+                std::lock_guard Lock(Queues[i].Mutex);
+                Queues[i].Ranges.push_back({Begin, End});
+            }
+        }
+
+        Remaining.store(Count, std::memory_order_release);
+
+        {
+            std::lock_guard Lock(Mutex);
+            ++Generation;
+        }
+
+        WakeUp.notify_all();
+
+        run(0);
+
+        while(Remaining.load(std::memory_order_acquire) != 0 || Active.load(std::memory_order_acquire) != 0){
+            std::this_thread::yield();
+        }
+
+        JobFunction = nullptr;
+        JobContext = nullptr;
+
+        if(Failed.load(std::memory_order_acquire)){
+            Failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(std::exchange(Error, nullptr));
+        }
+    }
+
+private:
+    struct range {
+        std::size_t Begin, End;
+    };
+
+    struct queue {
+        std::mutex Mutex;
+        std::deque<range> Ranges;
+    };
+
+    bool pop(unsigned Index, range& r){
+        auto& Queue = Queues[Index];
+
+        std::lock_guard Lock(Queue.Mutex);
+        if(Queue.Ranges.empty()){
+            return false;
+        }
+
+        r = Queue.Ranges.back();
+        Queue.Ranges.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned Index, range& r){
+        for(unsigned i = 1; i < QueueCount; ++i){
+            auto& Queue = Queues[(Index+i)%QueueCount];
+
+            std::lock_guard Lock(Queue.Mutex);
+            if(!Queue.Ranges.empty()){
+                r = Queue.Ranges.front();
+                Queue.Ranges.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void run(unsigned Index){
+        Active.fetch_add(1, std::memory_order_acq_rel);
+
+        range r;
+        while(Remaining.load(std::memory_order_acquire) != 0){
+            if(!pop(Index, r) && !steal(Index, r)){
+                std::this_thread::yield();
+                continue;
+            }
+
+            // After a failure the rest is only counted off, so the job still ends.
+            if(Failed.load(std::memory_order_acquire)){
+                Remaining.fetch_sub(r.End-r.Begin, std::memory_order_acq_rel);
+                continue;
+            }
+
+            while(r.End-r.Begin > JobGrain){
+                auto Mid = r.Begin+(r.End-r.Begin)/2;
+
+                {
+                    std::lock_guard Lock(Queues[Index].Mutex);
+                    Queues[Index].Ranges.push_back({Mid, r.End});
+                }
+
+                r.End = Mid;
+            }
+
+            try {
+                JobFunction(JobContext, r.Begin, r.End, Index);
+            }catch(...){
+                std::lock_guard Lock(ErrorMutex);
+                if(!Error){
+                    Error = std::current_exception();
+                    Failed.store(true, std::memory_order_release);
+                }
+            }
+
+            Remaining.fetch_sub(r.End-r.Begin, std::memory_order_acq_rel);
+        }
+
+        Active.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void worker(unsigned Index){
+        std::uint64_t Seen = 0;
+
+        for(;;){
+            {
+                std::unique_lock Lock(Mutex);
+                WakeUp.wait(Lock, [&](){ return Stop || Generation != Seen; });
+
+                if(Stop){
+                    return;
+                }
+
+                Seen = Generation;
+            }
+
+            run(Index);
+        }
+    }
+
+    std::unique_ptr<queue[]> Queues;
+    unsigned QueueCount;
+
+    std::vector<std::thread> Workers;
+
+    std::mutex Mutex;
+    std::condition_variable WakeUp;
+    std::uint64_t Generation = 0;
+    bool Stop = false;
+
+    std::atomic<std::size_t> Remaining = 0;
+    std::atomic<unsigned> Active = 0;
+
+    // The first exception thrown by the current job.
+    std::mutex ErrorMutex;
+    std::exception_ptr Error;
+    std::atomic<bool> Failed = false;
+
+    std::size_t JobGrain = 1;
+    void* JobContext = nullptr;
+    void (*JobFunction)(void*, std::size_t, std::size_t, unsigned) = nullptr;
+};
+
+#endif
@@ -0,0 +1,155 @@
+﻿#include "determinism.h"
+
+#include <memory>
+#include <algorithm>
+
+#include <windows.h>
+
+#include <hash_log.h>
+#include <work_pool.h>
+
+#include "memory.h"
+#include "state.h"
+
+namespace {
+
+struct hash_region {
+    std::string Name;
+    std::uintptr_t Address;
+    std::size_t Size;
+};
+
+std::vector<hash_region> HashRegions;
+bool HashRegionsChanged = true;
+
+std::unique_ptr<mmtl::hash_log_writer> HashLog;
+
+// Frames between flushes of the log. The rest is flushed when the game crashes.
+constexpr std::uint64_t HashLogFlushFrames = 60;
+std::uint64_t HashLogFrames = 0;
+
+LPTOP_LEVEL_EXCEPTION_FILTER PreviousFilter = nullptr;
+bool FilterSet = false;
+
+std::vector<std::string> FrameHashNames;
+std::vector<mmtl::page_hash> FrameHashes;
+
+// Regions at least this large are hashed on all cores.
+constexpr std::size_t ParallelHashSize = std::size_t(4) << 20;
+
+std::unique_ptr<work_pool> HashPool;
+
+LONG WINAPI crash_filter(EXCEPTION_POINTERS* Info){
+    if(HashLog){
+        HashLog->flush();
+    }
+
+    return PreviousFilter?PreviousFilter(Info):EXCEPTION_CONTINUE_SEARCH;
+}
+
+mmtl::page_hash hash_range(const void* Data, std::size_t Size){
+    work_pool* Pool = nullptr;
+
+    if(Size >= ParallelHashSize){
+        if(!HashPool){
+            HashPool = std::make_unique<work_pool>();
+        }
+
+        Pool = HashPool.get();
+    }
+
+    return mmtl::hash_memory(Data, Size, Pool);
+}
+
+}
+
+void hash_frame(){
+    if(!HashLog){
+        return;
+    }
+
+    if(HashRegionsChanged){
+        FrameHashNames = {"pawn.position", "pawn.velocity", "controller.rotation"};
+        for(auto& e:HashRegions){
+            FrameHashNames.push_back(e.Name);
+        }
+
+        HashLog->set_regions(FrameHashNames);
+        HashRegionsChanged = false;
+    }
+
+    FrameHashes.clear();
+
+    // Only the state the inputs act on is built in. The rest of the pawn and controller is mostly
+    // pointers to other objects, which need not be the same in two runs that play out the same, so
+    // hashing them whole would find a difference on the first frame. Anything else can be added
+    // with `set_hash_region`. Missing or unreadable regions hash to 0.
+    auto State = get_game_state();
+    if(State.Pawn){
+        FrameHashes.push_back(hash_range(State.Position, sizeof(vec3)));
+        FrameHashes.push_back(hash_range(State.Velocity, sizeof(vec3)));
+    }else{
+        FrameHashes.insert(FrameHashes.end(), 2, 0);
+    }
+
+    FrameHashes.push_back(State.Controller?hash_range(State.Rotation, sizeof(rot3)):0);
+
+    // User regions may be freed by the game at any time.
+    for(auto& e:HashRegions){
+        auto Readable = is_accessible(e.Address, e.Size);
+        FrameHashes.push_back(Readable?hash_range(reinterpret_cast<const void*>(e.Address), e.Size):0);
+    }
+
+    HashLog->write(FrameCount, FrameHashes);
+
+    if(++HashLogFrames%HashLogFlushFrames == 0){
+        HashLog->flush();
+    }
+}
+
+void start_hash_log(const std::filesystem::path& Path){
+    HashLog = std::make_unique<mmtl::hash_log_writer>(Path);
+    HashRegionsChanged = true;
+    HashLogFrames = 0;
+
+    if(!FilterSet){
+        PreviousFilter = SetUnhandledExceptionFilter(crash_filter);
+        FilterSet = true;
+    }
+}
+
+void stop_hash_log(){
+    HashLog = nullptr;
+}
+
+void set_hash_region(const std::string& Name, std::uintptr_t Address, std::size_t Size){
+    auto it = std::find_if(HashRegions.begin(), HashRegions.end(), [&](auto& e){ return e.Name == Name; });
+    if(it != HashRegions.end()){
+        it->Address = Address;
+        it->Size = Size;
+    }else{
+        HashRegions.push_back({Name, Address, Size});
+    }
+
+    HashRegionsChanged = true;
+}
+
+bool remove_hash_region(const std::string& Name){
+    if(std::erase_if(HashRegions, [&](auto& e){ return e.Name == Name; }) == 0){
+        return false;
+    }
+
+    HashRegionsChanged = true;
+
+    return true;
+}
+
+std::vector<std::pair<std::string, mmtl::page_hash>> get_frame_hashes(){
+    std::vector<std::pair<std::string, mmtl::page_hash>> r;
+
+    for(std::size_t i = 0; i < FrameHashes.size(); ++i){
+        r.push_back({FrameHashNames[i], FrameHashes[i]});
+    }
+
+    return r;
+}
@@ -0,0 +1,26 @@
+﻿#ifndef DETERMINISM_H_INCLUDED
+    #define DETERMINISM_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+
+#include <hash.h>
+
+// Hashes the player's position, velocity and rotation and the regions added with
+// `set_hash_region`, and writes them to the hash log. Called after every game frame, does nothing
+// while there is no log. The log is flushed every second of frames, when it is stopped, and when
+// the game crashes.
+void hash_frame();
+
+void start_hash_log(const std::filesystem::path& Path);
+void stop_hash_log();
+
+void set_hash_region(const std::string& Name, std::uintptr_t Address, std::size_t Size);
+bool remove_hash_region(const std::string& Name);
+
+// The hashes of the last frame that was logged.
+std::vector<std::pair<std::string, mmtl::page_hash>> get_frame_hashes();
+
+#endif
@@ -13,10 +13,20 @@
 #include <hookargs.h>
 
 #include "debug.h"
+#include "determinism.h"
+#include "gamelog.h"
 #include "hooks.h"
+#include "memory.h"
+#include "overlay.h"
+#include "packages.h"
+#include "profiling.h"
 #include "pytas.h"
+#include "reflection.h"
+#include "signatures.h"
 #include "state.h"
 #include "steam.h"
+#include "tracing.h"
+#include "watches.h"
 #include "window.h"
 
 constinit MODULEINFO GameModule = {};
@@ -32,13 +42,16 @@ constinit std::atomic<std::int64_t> Qpc = 0;
 constinit std::uint64_t SystemFileTime = 0;
 
 constinit int FrameTime = QpcFrequency/60;
-constinit bool FrameWait = true;
+constinit std::atomic<bool> FrameWait = true;
+
+constinit std::uint64_t FrameCount = 0;
 
 // Game
 thread_local bool IsBinkThread = false;
 
 constinit bool IsInLoadScreen = false;
 constinit bool IsInMovie = false;
+constinit std::atomic<movie_speed> MovieSpeed = movie_speed::Real;
 
 inline FARPROC get_proc_address(HMODULE Module, const char* Name, bool Follow = true){
     auto r = GetProcAddress(Module, Name);
@@ -92,6 +105,8 @@ inline FARPROC get_proc_address(HMODULE Module, const char* Name, bool Follow =
 #define PREPARE_HOOKS(m, f) f##_Orig.prepare(GET_PROC_ADDRESS(m, f##), f##_Hook),
 
 KERNEL32_HOOKS(DEFINE_HOOKS)
+MEMORY_HOOKS(DEFINE_HOOKS)
+FILE_HOOKS(DEFINE_HOOKS)
 SHELL32_HOOKS(DEFINE_HOOKS)
 WINDOW_HOOKS(DEFINE_HOOKS)
 STEAMAPI_HOOKS(DEFINE_HOOKS)
@@ -100,6 +115,8 @@ INPUT_HOOKS(DEFINE_HOOKS)
 BINKW32_HOOKS(DEFINE_HOOKS)
 
 constinit smhk::unique_buffer HookBuffer = nullptr;
+constinit smhk::unique_buffer MemoryHookBuffer = nullptr;
+constinit smhk::unique_buffer OverlayHookBuffer = nullptr;
 
 HANDLE WINAPI CreateMutexA_Hook(
     SECURITY_ATTRIBUTES* Security, BOOL InitialOwner, const char* Name
@@ -131,6 +148,39 @@ bool in_module(const void* Ptr, const MODULEINFO& ModInfo){
     return Base <= Ptr && Ptr < Base+ModInfo.SizeOfImage;
 }
 
+game_state get_game_state(){
+    char* PlayerPawn;
+    char* PlayerController;
+
+    auto Base = static_cast<char*>(GameModule.lpBaseOfDll);
+
+    switch(GameVersion){
+        case game_version::V12: {
+            PlayerPawn = *reinterpret_cast<char**>(Base+0x1052DE8);
+            PlayerController = *reinterpret_cast<char**>(Base+0x1052DD4);
+
+            break;
+        }
+        case game_version::V14: {
+            PlayerPawn = *reinterpret_cast<char**>(Base+0x1052DE8);
+            PlayerController = *reinterpret_cast<char**>(Base+0x1052DD4);
+
+            break;
+        }
+        default: {
+            std::abort();
+        }
+    }
+
+    return {
+        .Position = reinterpret_cast<vec3*>(PlayerPawn+0xC4),
+        .Velocity = reinterpret_cast<vec3*>(PlayerPawn+0x1B4),
+        .Rotation = reinterpret_cast<rot3*>(PlayerController+0xD0),
+        .Pawn = PlayerPawn,
+        .Controller = PlayerController,
+    };
+}
+
 BOOL WINAPI QueryPerformanceCounter_Hook(LARGE_INTEGER* Counter){
     auto Ret = _ReturnAddress();
 
@@ -226,14 +276,70 @@ HRESULT WINAPI SHGetFolderPathW_Hook(
     return r;
 }
 
+// The movie the Bink thread is playing, it plays one at a time, and whether its sound is off to
+// fast-forward it.
+thread_local void* Movie = nullptr;
+thread_local bool MovieMuted = false;
+
 void* __stdcall BinkOpen_Hook(HANDLE File, std::uint32_t Flags){
     auto r = BinkOpen_Orig(File, Flags);
 
     IsBinkThread = true;
 
+    Movie = r;
+    MovieMuted = false;
+
     return r;
 }
 
+constinit decltype(&BinkSetSoundOnOff) BinkSetSoundOnOff_Ptr = nullptr;
+
+// The sound keeps the video in sync, which only matters while frames are waited for. It is only
+// switched when the mode changes.
+bool is_fast_movie(void* Bink){
+    auto Fast =
+        !FrameWait.load(std::memory_order_relaxed) &&
+        MovieSpeed.load(std::memory_order_relaxed) != movie_speed::Real;
+
+    if(Bink != Movie){
+        Movie = Bink;
+        MovieMuted = false;
+    }
+
+    if(Fast != MovieMuted){
+        BinkSetSoundOnOff_Ptr(Bink, Fast?0:1);
+        MovieMuted = Fast;
+    }
+
+    return Fast;
+}
+
+// The movie player paces frames by this, not by the clock, so every frame is due right away.
+int __stdcall BinkWait_Hook(void* Bink){
+    if(is_fast_movie(Bink)){
+        return 0;
+    }
+
+    return BinkWait_Orig(Bink);
+}
+
+// The frame still advances, it just isn't decoded.
+int __stdcall BinkDoFrame_Hook(void* Bink){
+    if(MovieSpeed.load(std::memory_order_relaxed) == movie_speed::Skip && is_fast_movie(Bink)){
+        return 0;
+    }
+
+    return BinkDoFrame_Orig(Bink);
+}
+
+void __stdcall BinkClose_Hook(void* Bink){
+    if(Bink == Movie){
+        Movie = nullptr;
+    }
+
+    BinkClose_Orig(Bink);
+}
+
 struct game {
     void do_frame_hook();
 };
@@ -260,6 +366,9 @@ void game::do_frame_hook(){
     Qpc += FrameTime;
 
     (this->*DoFrame_Orig)();
+
+    hash_frame();
+    trace_frame();
 }
 
 void message_loop_hook(){
@@ -289,15 +398,26 @@ void message_loop_hook(){
         ++XInputState.dwPacketNumber;
 
         flush_events();
+
+        ++FrameCount;
     }
 }
 
 void init_window_hook(){
     IsInLoadScreen = true;
+    begin_package_load();
+    begin_load_profile();
 
     InitWindow_Orig();
 
+    end_load_profile();
+    end_package_load();
     IsInLoadScreen = false;
+
+    // The first load may have moved objects pointer paths were followed to.
+    invalidate_watches();
+    invalidate_trace();
+    invalidate_reflection();
 }
 
 void unknown1::movie_loop_hook(){
@@ -310,10 +430,19 @@ void unknown1::movie_loop_hook(){
 
 void load_loop_hook(){
     IsInLoadScreen = true;
+    begin_package_load();
+    begin_load_profile();
 
     LoadLoop_Orig();
 
+    end_load_profile();
+    end_package_load();
     IsInLoadScreen = false;
+
+    // The level's objects are all new.
+    invalidate_watches();
+    invalidate_trace();
+    invalidate_reflection();
 }
 
 cmdargs parse_cmdline(int* Argc, wchar_t** Argv){
@@ -329,6 +458,11 @@ cmdargs parse_cmdline(int* Argc, wchar_t** Argv){
     bool Userdata = false;
     bool Scripts = false;
     bool Main = false;
+    bool Overlay = false;
+    bool PackageCache = false;
+    bool MemoryLog = false;
+    bool ProfileLoads = false;
+    bool Savestates = false;
 
     int j = 1;
     for(int i = 1, End = *Argc; i < End; ++i){
@@ -372,6 +506,46 @@ cmdargs parse_cmdline(int* Argc, wchar_t** Argv){
 
                 r.Main = Argv[++i];
             }
+        }else if(std::wcscmp(Argv[i], L"--overlay") == 0){
+            if(Overlay){
+                throw std::runtime_error("`--overlay` encountered twice");
+            }else{
+                Overlay = true;
+
+                r.Overlay = true;
+            }
+        }else if(std::wcscmp(Argv[i], L"--package-cache") == 0){
+            if(PackageCache){
+                throw std::runtime_error("`--package-cache` encountered twice");
+            }else{
+                PackageCache = true;
+
+                r.PackageCache = true;
+            }
+        }else if(std::wcscmp(Argv[i], L"--memory-log") == 0){
+            if(MemoryLog){
+                throw std::runtime_error("`--memory-log` encountered twice");
+            }else{
+                MemoryLog = true;
+
+                r.MemoryLog = true;
+            }
+        }else if(std::wcscmp(Argv[i], L"--profile-loads") == 0){
+            if(ProfileLoads){
+                throw std::runtime_error("`--profile-loads` encountered twice");
+            }else{
+                ProfileLoads = true;
+
+                r.ProfileLoads = true;
+            }
+        }else if(std::wcscmp(Argv[i], L"--savestates") == 0){
+            if(Savestates){
+                throw std::runtime_error("`--savestates` encountered twice");
+            }else{
+                Savestates = true;
+
+                r.Savestates = true;
+            }
         }else{
             Argv[j++] = Argv[i];
         }
@@ -412,6 +586,8 @@ extern "C" void __declspec(dllexport) init(hookargs* HookArgs){
             TerminateProcess(GetCurrentProcess(), __LINE__);
         }
 
+        // The game state is still read at fixed offsets, so other builds are not supported even
+        // if the functions are found by signature.
         switch(GameModule.SizeOfImage){
             case 18219008: {
                 GameVersion = game_version::V12;
@@ -423,10 +599,16 @@ extern "C" void __declspec(dllexport) init(hookargs* HookArgs){
                 break;
             }
             default: {
+                std::fprintf(stderr, "Unknown game version.\n");
                 std::abort();
             }
         }
 
+        hook_targets Targets;
+        if(!find_hook_targets(Targets, GameVersion)){
+            std::abort();
+        }
+
         CmdArgs = parse_cmdline(&HookArgs->Argc, HookArgs->Argv);
 
         pytas_init(HookArgs->Argc, HookArgs->Argv);
@@ -435,42 +617,16 @@ extern "C" void __declspec(dllexport) init(hookargs* HookArgs){
             std::abort();
         }
 
-        void* DoFrameAddress;
-        void* InitWindowAddress;
-        void* MessageLoopAddress;
-        void* MovieLoopAddress;
-        void* LoadLoopAddress;
-
-        auto Base = static_cast<char*>(GameModule.lpBaseOfDll);
-
-        switch(GameVersion){
-            case game_version::V12: {
-                DoFrameAddress = Base+0x5E0010;
-                InitWindowAddress = Base+0x16C90;
-                MessageLoopAddress = Base+0x16C10;
-                MovieLoopAddress = Base+0xDB570;
-                LoadLoopAddress = Base+0x14AE00;
-                break;
-            }
-            case game_version::V14: {
-                DoFrameAddress = Base+0x5E0CB0;
-                InitWindowAddress = Base+0x16D40;
-                MessageLoopAddress = Base+0x16CC0;
-                MovieLoopAddress = Base+0xDB460;
-                LoadLoopAddress = Base+0x14A5F0;
-                break;
-            }
-            default: {
-                std::abort();
-            }
-        }
-
         // 2022-02-22 00:00:00
         std::uint64_t StartTime = 19045*24*3600;
 
         SystemFileTime = 116444736000000000+10000000*StartTime;
 
         load_steam_cloud();
+        init_overlay();
+        init_packages();
+        init_game_log();
+        init_profiling();
 
         auto Kernel32 = GetModuleHandleW(L"kernel32.dll");
         if(!Kernel32){
@@ -482,6 +638,13 @@ extern "C" void __declspec(dllexport) init(hookargs* HookArgs){
             TerminateProcess(GetCurrentProcess(), __LINE__);
         }
 
+        BinkSetSoundOnOff_Ptr = reinterpret_cast<decltype(&BinkSetSoundOnOff)>(
+            GetProcAddress(Binkw32, "_BinkSetSoundOnOff@8")
+        );
+        if(!BinkSetSoundOnOff_Ptr){
+            TerminateProcess(GetCurrentProcess(), __LINE__);
+        }
+
         auto Winmm = GetModuleHandleW(L"winmm.dll");
         if(!Winmm){
             TerminateProcess(GetCurrentProcess(), __LINE__);
@@ -523,27 +686,51 @@ extern "C" void __declspec(dllexport) init(hookargs* HookArgs){
                 reinterpret_cast<decltype(&BinkOpen)>(get_proc_address(Binkw32, "_BinkOpen@8")),
                 BinkOpen_Hook
             ),
+            BinkWait_Orig.prepare(
+                reinterpret_cast<decltype(&BinkWait)>(get_proc_address(Binkw32, "_BinkWait@4")),
+                BinkWait_Hook
+            ),
+            BinkDoFrame_Orig.prepare(
+                reinterpret_cast<decltype(&BinkDoFrame)>(get_proc_address(Binkw32, "_BinkDoFrame@4")),
+                BinkDoFrame_Hook
+            ),
+            BinkClose_Orig.prepare(
+                reinterpret_cast<decltype(&BinkClose)>(get_proc_address(Binkw32, "_BinkClose@4")),
+                BinkClose_Hook
+            ),
             DoFrame_Orig.prepare(
-                smhk::fun_cast<decltype(&game::do_frame_hook)>(DoFrameAddress),
+                smhk::fun_cast<decltype(&game::do_frame_hook)>(Targets.DoFrame),
                 &game::do_frame_hook
             ),
             MessageLoop_Orig.prepare(
-                smhk::fun_cast<decltype(&message_loop_hook)>(MessageLoopAddress),
+                smhk::fun_cast<decltype(&message_loop_hook)>(Targets.MessageLoop),
                 &message_loop_hook
             ),
             InitWindow_Orig.prepare(
-                smhk::fun_cast<decltype(&init_window_hook)>(InitWindowAddress),
+                smhk::fun_cast<decltype(&init_window_hook)>(Targets.InitWindow),
                 &init_window_hook
             ),
             MovieLoop_Orig.prepare(
-                smhk::fun_cast<decltype(&unknown1::movie_loop_hook)>(MovieLoopAddress),
+                smhk::fun_cast<decltype(&unknown1::movie_loop_hook)>(Targets.MovieLoop),
                 &unknown1::movie_loop_hook
             ),
             LoadLoop_Orig.prepare(
-                smhk::fun_cast<decltype(&load_loop_hook)>(LoadLoopAddress),
+                smhk::fun_cast<decltype(&load_loop_hook)>(Targets.LoadLoop),
                 &load_loop_hook
             ),
         });
+
+        if(savestates_enabled()){
+            MemoryHookBuffer = smhk::create_hooks({
+                MEMORY_HOOKS(PREPARE_HOOKS)
+            });
+        }
+
+        if(overlay_enabled() || packages_enabled() || game_log_enabled() || profiling_enabled()){
+            OverlayHookBuffer = smhk::create_hooks({
+                FILE_HOOKS(PREPARE_HOOKS)
+            });
+        }
     }catch(std::exception& e){
         std::fprintf(stderr, "Error: %s\n", e.what());
         TerminateProcess(GetCurrentProcess(), __LINE__);
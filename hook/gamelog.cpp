@@ -0,0 +1,267 @@
+﻿#include "defines.h"
+
+#include "gamelog.h"
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <string_view>
+
+#include <cwchar>
+#include <cstring>
+
+#include <log_ring.h>
+
+#include "hooks.h"
+#include "state.h"
+
+namespace {
+
+// Enough for the last few levels of a long run.
+constexpr std::size_t LogCapacity = 4 << 20;
+
+std::unique_ptr<mmtl::log_ring> Ring;
+
+// Where the log goes on a crash, one file per instance.
+std::wstring CrashPath;
+
+std::mutex LogMutex;
+std::atomic<HANDLE> LogHandle = nullptr;
+std::uint64_t LogSize = 0;
+
+// A log starting with a byte order mark is UTF-16, the ring keeps UTF-8 either way.
+bool Wide = false;
+// The first byte of a character split between writes.
+std::string Pending;
+
+// Open once the game crashed, everything written after that goes straight to it.
+HANDLE CrashFile = INVALID_HANDLE_VALUE;
+
+LPTOP_LEVEL_EXCEPTION_FILTER PreviousFilter = nullptr;
+
+// The engine's own log, in a `Logs` folder somewhere in the documents folder.
+bool is_log_path(const wchar_t* Name){
+    constexpr std::wstring_view LogName = L"Launch.log";
+
+    // Most files aren't, which this finds without asking the file system.
+    std::wstring_view Short(Name);
+    if(Short.size() < LogName.size() || _wcsicmp(Name+Short.size()-LogName.size(), LogName.data()) != 0){
+        return false;
+    }
+
+    std::error_code Error;
+    auto Path = fs::absolute(Name, Error).lexically_normal();
+    if(Error || _wcsicmp(Path.filename().c_str(), LogName.data()) != 0 || _wcsicmp(Path.parent_path().filename().c_str(), L"Logs") != 0){
+        return false;
+    }
+
+    auto& Full = Path.native();
+    auto& Documents = CmdArgs.Documents.native();
+    return Full.size() > Documents.size() && _wcsnicmp(Full.c_str(), Documents.c_str(), Documents.size()) == 0 &&
+        (Full[Documents.size()] == L'\\' || Documents.ends_with(L'\\'));
+}
+
+bool write_all(HANDLE File, std::string_view Data){
+    while(!Data.empty()){
+        auto Size = static_cast<DWORD>(std::min<std::size_t>(Data.size(), 1 << 20));
+
+        DWORD Written;
+        if(!WriteFile_Orig(File, Data.data(), Size, &Written, nullptr) || Written == 0){
+            return false;
+        }
+
+        Data.remove_prefix(Written);
+    }
+
+    return true;
+}
+
+// Around the hooks, so the file may be named like the log. Needs `LogMutex`, or a crash.
+HANDLE write_ring(const wchar_t* Name){
+    auto File = CreateFileW_Orig(Name, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(File == INVALID_HANDLE_VALUE){
+        return File;
+    }
+
+    auto [Old, New] = Ring->view();
+    if(!write_all(File, Old) || !write_all(File, New)){
+        CloseHandle_Orig(File);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return File;
+}
+
+// Needs `LogMutex`, or a crash.
+void dump_crash(){
+    if(CrashFile != INVALID_HANDLE_VALUE){
+        return;
+    }
+
+    CrashFile = write_ring(CrashPath.c_str());
+    if(CrashFile != INVALID_HANDLE_VALUE){
+        std::fprintf(stderr, "Wrote the game log to %ls.\n", CrashPath.c_str());
+    }
+}
+
+LONG WINAPI crash_filter(EXCEPTION_POINTERS* Info){
+    // The crash may have happened with the lock held.
+    std::unique_lock Lock(LogMutex, std::try_to_lock);
+    dump_crash();
+
+    return PreviousFilter?PreviousFilter(Info):EXCEPTION_CONTINUE_SEARCH;
+}
+
+// Needs `LogMutex`.
+void append(std::string_view Bytes){
+    std::string Text;
+    if(Wide){
+        std::string Joined;
+        if(!Pending.empty()){
+            Joined = std::move(Pending);
+            Joined.append(Bytes);
+            Bytes = Joined;
+            Pending.clear();
+        }
+
+        if(Bytes.size()%2 != 0){
+            Pending = Bytes.back();
+            Bytes.remove_suffix(1);
+        }
+
+        std::wstring Units(Bytes.size()/2, L'\0');
+        std::memcpy(Units.data(), Bytes.data(), Bytes.size());
+
+        auto Size = static_cast<int>(Units.size());
+        Text.resize(static_cast<std::size_t>(WideCharToMultiByte(CP_UTF8, 0, Units.data(), Size, nullptr, 0, nullptr, nullptr)));
+        WideCharToMultiByte(CP_UTF8, 0, Units.data(), Size, Text.data(), static_cast<int>(Text.size()), nullptr, nullptr);
+    }else{
+        Text = Bytes;
+    }
+
+    Ring->write(Text.data(), Text.size());
+
+    // The engine logs its own crashes before exiting, with the call stack after this line.
+    if(CrashFile == INVALID_HANDLE_VALUE && Text.find("Critical error") != std::string::npos){
+        dump_crash();
+    }else if(CrashFile != INVALID_HANDLE_VALUE){
+        write_all(CrashFile, Text);
+    }
+}
+
+}
+
+void init_game_log(){
+    if(!CmdArgs.MemoryLog){
+        return;
+    }
+
+    Ring = std::make_unique<mmtl::log_ring>(LogCapacity);
+
+    wchar_t Name[64];
+    std::swprintf(Name, std::size(Name), L"datafiles/Launch-%lu.log", GetCurrentProcessId());
+    CrashPath = fs::absolute(Name).wstring();
+
+    PreviousFilter = SetUnhandledExceptionFilter(crash_filter);
+}
+
+bool game_log_enabled(){
+    return Ring != nullptr;
+}
+
+std::string game_log(){
+    if(!Ring){
+        return {};
+    }
+
+    std::lock_guard Lock(LogMutex);
+    return Ring->text();
+}
+
+bool save_game_log(const wchar_t* Name){
+    if(!Ring){
+        std::fprintf(stderr, "Error: The game log is only kept in memory with `--memory-log`.\n");
+        return false;
+    }
+
+    std::lock_guard Lock(LogMutex);
+
+    auto File = write_ring(Name);
+    if(File == INVALID_HANDLE_VALUE){
+        std::fprintf(stderr, "Error: Can't write the game log to %ls.\n", Name);
+        return false;
+    }
+
+    CloseHandle_Orig(File);
+    return true;
+}
+
+HANDLE open_game_log(const wchar_t* Name, DWORD Access){
+    // Reading the log or checking for it needs the real file.
+    if(!Ring || !Name || (Access&GENERIC_WRITE) == 0 || !is_log_path(Name)){
+        return nullptr;
+    }
+
+    std::lock_guard Lock(LogMutex);
+
+    if(LogHandle){
+        return nullptr;
+    }
+
+    auto Handle = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if(!Handle){
+        return nullptr;
+    }
+
+    LogHandle = Handle;
+    SetLastError(ERROR_SUCCESS);
+
+    return Handle;
+}
+
+bool is_game_log(HANDLE File){
+    auto Handle = LogHandle.load(std::memory_order_relaxed);
+    return Handle && Handle == File;
+}
+
+BOOL write_game_log(HANDLE File, const void* Buffer, DWORD Size, DWORD* Written, OVERLAPPED* Overlapped){
+    std::string_view Bytes(static_cast<const char*>(Buffer), Size);
+
+    {
+        std::lock_guard Lock(LogMutex);
+
+        if(LogSize == 0 && Bytes.starts_with("\xFF\xFE")){
+            Wide = true;
+            Bytes.remove_prefix(2);
+        }
+
+        LogSize += Size;
+        append(Bytes);
+    }
+
+    if(Written){
+        *Written = Size;
+    }
+
+    // Overlapped calls complete right away.
+    if(Overlapped){
+        Overlapped->Internal = 0;
+        Overlapped->InternalHigh = Size;
+        SetEvent(Overlapped->hEvent?Overlapped->hEvent:File);
+    }
+
+    return TRUE;
+}
+
+std::uint64_t game_log_size(){
+    std::lock_guard Lock(LogMutex);
+    return LogSize;
+}
+
+BOOL close_game_log(HANDLE File){
+    std::lock_guard Lock(LogMutex);
+
+    LogHandle = nullptr;
+    return CloseHandle_Orig(File);
+}
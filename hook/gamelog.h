@@ -0,0 +1,38 @@
+﻿#ifndef GAMELOG_H_INCLUDED
+    #define GAMELOG_H_INCLUDED 1
+
+#include <string>
+
+#include <cstdint>
+
+#include <windows.h>
+
+// With `--memory-log`, what the engine writes to `Launch.log` is kept in a ring buffer in memory
+// instead of being written, and flushed, line by line. The log is only written out on a crash or
+// when a script asks for it.
+
+// Called before the hooks are in place.
+void init_game_log();
+bool game_log_enabled();
+
+// The newest part of the log, as UTF-8.
+std::string game_log();
+
+// Writes the newest part of the log to a file. Returns false if it can't.
+bool save_game_log(const wchar_t* Name);
+
+// Called by the file hooks before anything else. Only opens for writing `Launch.log` in the
+// documents folder's `Logs` folder are taken. Returns null for anything else, or if the log is
+// already open, since the engine only opens it once.
+HANDLE open_game_log(const wchar_t* Name, DWORD Access);
+bool is_game_log(HANDLE File);
+
+// Writes always append, and seeks are ignored.
+BOOL write_game_log(HANDLE File, const void* Buffer, DWORD Size, DWORD* Written, OVERLAPPED* Overlapped);
+
+// The size of the log as the engine wrote it.
+std::uint64_t game_log_size();
+
+BOOL close_game_log(HANDLE File);
+
+#endif
@@ -15,6 +15,39 @@
     xx(Kernel32, CreateMutexW)                      \
     xx(Kernel32, GetSystemInfo)                     \
     xx(Kernel32, GetSystemTimeAsFileTime)           \
+    xx(Kernel32, VirtualFree)                       \
+
+// Only with `--savestates`.
+#define MEMORY_HOOKS(xx)                            \
+    xx(Kernel32, VirtualAlloc)                      \
+
+// Only with `--overlay`, `--package-cache`, `--memory-log` or `--profile-loads`.
+#define FILE_HOOKS(xx)                              \
+    xx(Kernel32, CreateFileW)                       \
+    xx(Kernel32, CreateFileA)                       \
+    xx(Kernel32, ReadFile)                          \
+    xx(Kernel32, WriteFile)                         \
+    xx(Kernel32, SetFilePointer)                    \
+    xx(Kernel32, SetFilePointerEx)                  \
+    xx(Kernel32, GetFileSize)                       \
+    xx(Kernel32, GetFileSizeEx)                     \
+    xx(Kernel32, SetEndOfFile)                      \
+    xx(Kernel32, FlushFileBuffers)                  \
+    xx(Kernel32, CloseHandle)                       \
+    xx(Kernel32, GetFileType)                       \
+    xx(Kernel32, GetFileTime)                       \
+    xx(Kernel32, GetFileInformationByHandle)        \
+    xx(Kernel32, GetFileAttributesW)                \
+    xx(Kernel32, GetFileAttributesExW)              \
+    xx(Kernel32, FindFirstFileW)                    \
+    xx(Kernel32, FindFirstFileExW)                  \
+    xx(Kernel32, FindNextFileW)                     \
+    xx(Kernel32, FindClose)                         \
+    xx(Kernel32, DeleteFileW)                       \
+    xx(Kernel32, CreateDirectoryW)                  \
+    xx(Kernel32, RemoveDirectoryW)                  \
+    xx(Kernel32, MoveFileW)                         \
+    xx(Kernel32, MoveFileExW)                       \
 
 #define TIMING_HOOKS(xx)                    \
     xx(Kernel32, QueryPerformanceFrequency) \
@@ -35,6 +68,12 @@
     xx(User32, SetWindowLongW)          \
     xx(User32, GetWindowLongA)          \
     xx(User32, SetWindowLongA)          \
+    xx(User32, PeekMessageW)            \
+    xx(User32, PeekMessageA)            \
+    xx(User32, GetMessageW)             \
+    xx(User32, GetMessageA)             \
+    xx(User32, PostMessageW)            \
+    xx(User32, PostMessageA)            \
     xx(User32, SystemParametersInfoA)   \
     xx(User32, SystemParametersInfoW)   \
 
@@ -82,13 +121,22 @@ extern "C" DWORD WINAPI XInputGetDSoundAudioDeviceGuids(DWORD UserIndex, GUID* R
 
 // https://wiki.multimedia.cx/index.php/RAD_Game_Tools_Bink_API
 extern "C" void* __stdcall BinkOpen(HANDLE File, std::uint32_t Flags);
+extern "C" int __stdcall BinkWait(void* Bink);
+extern "C" int __stdcall BinkDoFrame(void* Bink);
+extern "C" void __stdcall BinkClose(void* Bink);
+extern "C" int __stdcall BinkSetSoundOnOff(void* Bink, int On);
 
-#define BINKW32_HOOKS(xx)   \
-    xx(Binkw32, BinkOpen)   \
+#define BINKW32_HOOKS(xx)       \
+    xx(Binkw32, BinkOpen)       \
+    xx(Binkw32, BinkWait)       \
+    xx(Binkw32, BinkDoFrame)    \
+    xx(Binkw32, BinkClose)      \
 
 #define DECLARE_HOOKS(m, f) extern smhk::unique_hook<decltype(&f)> f##_Orig;
 
 KERNEL32_HOOKS(DECLARE_HOOKS)
+MEMORY_HOOKS(DECLARE_HOOKS)
+FILE_HOOKS(DECLARE_HOOKS)
 SHELL32_HOOKS(DECLARE_HOOKS)
 WINDOW_HOOKS(DECLARE_HOOKS)
 STEAMAPI_HOOKS(DECLARE_HOOKS)
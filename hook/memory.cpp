@@ -0,0 +1,248 @@
+﻿#include "memory.h"
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <intrin.h>
+
+#include "hooks.h"
+#include "state.h"
+#include "steam.h"
+
+namespace {
+
+// Allocations made by the game, by allocation base.
+std::mutex AllocationMutex;
+std::unordered_set<std::uintptr_t> GameAllocations;
+
+struct saved_memory {
+    std::shared_ptr<const mmtl::snapshot> Snapshot;
+
+    std::int64_t Qpc;
+    std::uint64_t FrameCount;
+
+    std::list<std::string>::iterator Recent;
+};
+
+std::map<std::string, saved_memory> SavedMemory;
+
+// Names of the saved snapshots, most recently used first.
+std::list<std::string> RecentMemory;
+
+// Bytes the stored pages may take up, in memory and on disk, before the least recently used
+// snapshots are dropped. 0 for no limit.
+constinit std::size_t MemoryCacheBudget = std::size_t(2) << 30;
+
+mmtl::readable_map ReadableMap;
+
+// Set when memory is freed, from any thread.
+constinit std::atomic<bool> ReadableMapStale = true;
+constinit std::uint64_t ReadableMapFrame = 0;
+
+// Frames a map is used for before it is refreshed anyway, to pick up protection changes and
+// memory freed by other means.
+constexpr std::uint64_t ReadableMapFrames = 60;
+
+void refresh_readable_map(){
+    // Cleared first, so memory freed during the refresh marks it again.
+    ReadableMapStale = false;
+    ReadableMap.refresh();
+    ReadableMapFrame = FrameCount;
+}
+
+mmtl::snapshotter& get_snapshotter(){
+    static mmtl::snapshotter Snapshotter(game_regions, std::make_shared<mmtl::page_store>(
+        mmtl::page_store_options{.SpillDirectory = fs::temp_directory_path()}
+    ));
+
+    return Snapshotter;
+}
+
+void touch_memory(saved_memory& Memory){
+    RecentMemory.splice(RecentMemory.begin(), RecentMemory, Memory.Recent);
+}
+
+void trim_memory(){
+    if(MemoryCacheBudget == 0){
+        return;
+    }
+
+    auto& Store = get_snapshotter().store();
+
+    // Never drops the most recent one.
+    while(RecentMemory.size() > 1){
+        auto Stats = Store.stats();
+        if(Stats.MemoryBytes+Stats.SpillBytes <= MemoryCacheBudget){
+            break;
+        }
+
+        SavedMemory.erase(RecentMemory.back());
+        RecentMemory.pop_back();
+    }
+}
+
+bool is_module(std::uintptr_t Address){
+    HMODULE Module;
+    return GetModuleHandleExW(
+        GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS|GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+        reinterpret_cast<const wchar_t*>(Address), &Module
+    ) != 0;
+}
+
+}
+
+bool savestates_enabled(){
+    return CmdArgs.Savestates;
+}
+
+std::vector<mmtl::region> game_regions(){
+    auto Image = reinterpret_cast<std::uintptr_t>(GameModule.lpBaseOfDll);
+
+    std::vector<mmtl::region> r;
+
+    if(!savestates_enabled()){
+        for(auto& e:mmtl::query_regions()){
+            if(e.AllocationBase == Image || !is_module(e.AllocationBase)){
+                r.push_back(e);
+            }
+        }
+
+        return r;
+    }
+
+    std::lock_guard Lock(AllocationMutex);
+
+    for(auto& e:mmtl::query_regions()){
+        if(GameAllocations.contains(e.AllocationBase)){
+            e.Tracking = mmtl::tracking::WriteWatch;
+            r.push_back(e);
+        }else if(e.AllocationBase == Image){
+            // Write protecting the image would make the game's own system calls into it fail, it is
+            // small enough to compare.
+            e.Tracking = mmtl::tracking::Compare;
+            r.push_back(e);
+        }
+    }
+
+    return r;
+}
+
+void* WINAPI VirtualAlloc_Hook(void* Address, SIZE_T Size, DWORD Type, DWORD Protect){
+    auto Game = in_module(_ReturnAddress(), GameModule);
+
+    // Write watching only works for whole reservations, and not with large pages.
+    if(Game && (Type&MEM_RESERVE) && !(Type&(MEM_LARGE_PAGES|MEM_PHYSICAL))){
+        Type |= MEM_WRITE_WATCH;
+    }
+
+    auto r = VirtualAlloc_Orig(Address, Size, Type, Protect);
+
+    if(r && (Type&MEM_WRITE_WATCH)){
+        std::lock_guard Lock(AllocationMutex);
+        GameAllocations.insert(reinterpret_cast<std::uintptr_t>(r));
+    }
+
+    return r;
+}
+
+BOOL WINAPI VirtualFree_Hook(void* Address, SIZE_T Size, DWORD Type){
+    if((Type&MEM_RELEASE) && savestates_enabled()){
+        std::lock_guard Lock(AllocationMutex);
+        GameAllocations.erase(reinterpret_cast<std::uintptr_t>(Address));
+    }
+
+    auto r = VirtualFree_Orig(Address, Size, Type);
+
+    if(r){
+        ReadableMapStale = true;
+    }
+
+    return r;
+}
+
+mmtl::snapshot_stats save_memory(const std::string& Name){
+    if(!savestates_enabled()){
+        throw std::runtime_error("Saving memory needs `--savestates`.");
+    }
+
+    mmtl::snapshot_stats Stats;
+
+    auto Snapshot = get_snapshotter().save(&Stats);
+
+    auto [it, New] = SavedMemory.try_emplace(Name);
+    if(New){
+        RecentMemory.push_front(Name);
+        it->second.Recent = RecentMemory.begin();
+    }else{
+        touch_memory(it->second);
+    }
+
+    it->second.Snapshot = std::move(Snapshot);
+    it->second.Qpc = Qpc;
+    it->second.FrameCount = FrameCount;
+
+    trim_memory();
+
+    return Stats;
+}
+
+bool load_memory(const std::string& Name, mmtl::snapshot_stats& Stats){
+    if(!savestates_enabled()){
+        throw std::runtime_error("Loading memory needs `--savestates`.");
+    }
+
+    auto it = SavedMemory.find(Name);
+    if(it == SavedMemory.end()){
+        return false;
+    }
+
+    get_snapshotter().restore(it->second.Snapshot, &Stats);
+    touch_memory(it->second);
+
+    clear_call_results();
+
+    Qpc = it->second.Qpc;
+    FrameCount = it->second.FrameCount;
+
+    return true;
+}
+
+bool delete_memory(const std::string& Name){
+    auto it = SavedMemory.find(Name);
+    if(it == SavedMemory.end()){
+        return false;
+    }
+
+    RecentMemory.erase(it->second.Recent);
+    SavedMemory.erase(it);
+
+    return true;
+}
+
+void set_memory_cache(std::size_t Budget, std::size_t MemoryBudget){
+    MemoryCacheBudget = Budget;
+    get_snapshotter().store().set_memory_budget(MemoryBudget);
+
+    trim_memory();
+}
+
+memory_cache_stats get_memory_cache_stats(){
+    return {SavedMemory.size(), get_snapshotter().store().stats()};
+}
+
+bool is_accessible(std::uintptr_t Address, std::size_t Size, bool Writable){
+    // Wraps around after loading an earlier snapshot, which refreshes it too.
+    if(ReadableMapStale || FrameCount-ReadableMapFrame >= ReadableMapFrames){
+        refresh_readable_map();
+    }else if(ReadableMapFrame != FrameCount && !ReadableMap.contains(Address, Size, Writable)){
+        // May have been allocated since.
+        refresh_readable_map();
+    }
+
+    return ReadableMap.contains(Address, Size, Writable);
+}
@@ -0,0 +1,47 @@
+﻿#ifndef MEMORY_H_INCLUDED
+    #define MEMORY_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+
+#include <windows.h>
+
+#include <regions.h>
+#include <snapshot.h>
+#include <page_store.h>
+
+void* WINAPI VirtualAlloc_Hook(void* Address, SIZE_T Size, DWORD Type, DWORD Protect);
+BOOL WINAPI VirtualFree_Hook(void* Address, SIZE_T Size, DWORD Type);
+
+// Whether the game's allocations are write watched for snapshots, with `--savestates`.
+bool savestates_enabled();
+
+// Allocations the game made through `VirtualAlloc`, and the game executable's own data. Without
+// `--savestates` the game's allocations are not tracked, so every private allocation is included.
+std::vector<mmtl::region> game_regions();
+
+// Snapshots of the game's memory, kept by name. Only `game_regions` are included. Saving and
+// loading throw `std::runtime_error` without `--savestates`.
+mmtl::snapshot_stats save_memory(const std::string& Name);
+// Returns false if there is no snapshot called `Name`.
+bool load_memory(const std::string& Name, mmtl::snapshot_stats& Stats);
+bool delete_memory(const std::string& Name);
+
+// The snapshots share pages through a `page_store`, which compresses pages and moves them to disk
+// when it takes up more than `MemoryBudget` bytes of memory. Once the store as a whole exceeds
+// `Budget`, the least recently saved or loaded snapshots are dropped.
+void set_memory_cache(std::size_t Budget, std::size_t MemoryBudget);
+
+struct memory_cache_stats {
+    std::size_t Snapshots;
+    mmtl::page_store_stats Store;
+};
+
+memory_cache_stats get_memory_cache_stats();
+
+// Whether the whole range can be read, and written if `Writable` is set. Checked against a map of
+// the process's memory, which is refreshed every so often, after the game frees memory, and when a
+// range is not in it. Memory freed without `VirtualFree` may still pass until the next refresh.
+bool is_accessible(std::uintptr_t Address, std::size_t Size, bool Writable = false);
+
+#endif
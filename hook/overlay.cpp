@@ -0,0 +1,964 @@
+﻿#include "defines.h"
+
+#include "overlay.h"
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include <cwchar>
+
+#include <overlay_fs.h>
+
+#include "debug.h"
+#include "gamelog.h"
+#include "hooks.h"
+#include "state.h"
+#include "packages.h"
+#include "profiling.h"
+
+namespace {
+
+std::unique_ptr<mmtl::overlay_fs> Overlay;
+
+// Set while the overlay itself reads the base, which goes through the same hooks.
+thread_local bool InOverlay = false;
+
+struct overlay_scope {
+    overlay_scope(){
+        InOverlay = true;
+    }
+
+    ~overlay_scope(){
+        InOverlay = false;
+    }
+};
+
+struct open_file {
+    std::shared_ptr<mmtl::overlay_fs::file> File;
+    std::uint64_t Position;
+    bool Writable;
+};
+
+struct open_find {
+    std::vector<mmtl::overlay_fs::entry> Entries;
+    std::size_t Next;
+};
+
+// Keyed by an event handle made for every open file and search, so the values can't collide with
+// real handles, and waiting on one for overlapped calls works.
+std::mutex HandleMutex;
+std::unordered_map<HANDLE, open_file> Files;
+std::unordered_map<HANDLE, open_find> Finds;
+
+// Most handles the game closes or reads from are real ones, this skips the lookup for them.
+std::atomic<std::size_t> HandleCount = 0;
+
+std::optional<fs::path> overlay_path(const wchar_t* Name){
+    if(!Overlay || InOverlay || !Name){
+        return std::nullopt;
+    }
+
+    return Overlay->relative(Name);
+}
+
+DWORD status_error(mmtl::overlay_fs::status Status){
+    switch(Status){
+        case mmtl::overlay_fs::status::Created:
+        case mmtl::overlay_fs::status::Opened: return ERROR_SUCCESS;
+        case mmtl::overlay_fs::status::NotFound: return ERROR_FILE_NOT_FOUND;
+        case mmtl::overlay_fs::status::PathNotFound: return ERROR_PATH_NOT_FOUND;
+        case mmtl::overlay_fs::status::Exists: return ERROR_ALREADY_EXISTS;
+        case mmtl::overlay_fs::status::IsDirectory: return ERROR_ACCESS_DENIED;
+    }
+
+    return ERROR_INVALID_PARAMETER;
+}
+
+HANDLE add_handle(){
+    auto r = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if(r){
+        ++HandleCount;
+    }
+
+    return r;
+}
+
+void remove_handle(HANDLE Handle){
+    --HandleCount;
+    CloseHandle_Orig(Handle);
+}
+
+// File times are fixed, so they don't differ between runs.
+FILETIME file_time(){
+    ULARGE_INTEGER Time;
+    Time.QuadPart = SystemFileTime;
+
+    return {Time.LowPart, Time.HighPart};
+}
+
+DWORD file_attributes(const mmtl::overlay_fs::entry& Entry){
+    return Entry.Directory?FILE_ATTRIBUTE_DIRECTORY:FILE_ATTRIBUTE_ARCHIVE;
+}
+
+void fill_find_data(const mmtl::overlay_fs::entry& Entry, WIN32_FIND_DATAW* Data){
+    *Data = {};
+    Data->dwFileAttributes = file_attributes(Entry);
+    Data->ftCreationTime = Data->ftLastAccessTime = Data->ftLastWriteTime = file_time();
+    Data->nFileSizeHigh = static_cast<DWORD>(Entry.Size >> 32);
+    Data->nFileSizeLow = static_cast<DWORD>(Entry.Size);
+    std::wcsncpy(Data->cFileName, Entry.Name.c_str(), MAX_PATH-1);
+}
+
+wchar_t fold(wchar_t c){
+    return (c >= L'A' && c <= L'Z')?static_cast<wchar_t>(c-L'A'+L'a'):c;
+}
+
+// `*` and `?` ignoring case, which is all the game uses.
+bool wildcard_match(std::wstring_view Pattern, std::wstring_view Name){
+    std::size_t p = 0, n = 0;
+    auto Star = std::wstring_view::npos;
+    std::size_t Resume = 0;
+
+    while(n < Name.size()){
+        if(p < Pattern.size() && (Pattern[p] == L'?' || fold(Pattern[p]) == fold(Name[n]))){
+            ++p;
+            ++n;
+        }else if(p < Pattern.size() && Pattern[p] == L'*'){
+            Star = p++;
+            Resume = n;
+        }else if(Star != std::wstring_view::npos){
+            p = Star+1;
+            n = ++Resume;
+        }else{
+            return false;
+        }
+    }
+
+    while(p < Pattern.size() && Pattern[p] == L'*'){
+        ++p;
+    }
+
+    return p == Pattern.size();
+}
+
+// Null if the handle isn't one of ours. Needs `HandleMutex`.
+open_file* find_file(HANDLE Handle){
+    auto it = Files.find(Handle);
+    return (it != Files.end())?&it->second:nullptr;
+}
+
+bool seek(open_file& Open, std::int64_t Distance, DWORD Method, std::uint64_t& r){
+    std::int64_t From = 0;
+    switch(Method){
+        case FILE_BEGIN: break;
+        case FILE_CURRENT: From = static_cast<std::int64_t>(Open.Position); break;
+        case FILE_END: From = static_cast<std::int64_t>(Overlay->size(*Open.File)); break;
+        default: {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return false;
+        }
+    }
+
+    if(From+Distance < 0){
+        SetLastError(ERROR_NEGATIVE_SEEK);
+        return false;
+    }
+
+    r = Open.Position = static_cast<std::uint64_t>(From+Distance);
+    return true;
+}
+
+// The size of the game log or an overlay file, nothing if the handle isn't one of ours.
+std::optional<std::uint64_t> handle_size(HANDLE Handle){
+    if(is_game_log(Handle)){
+        return game_log_size();
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return std::nullopt;
+    }
+
+    std::lock_guard Lock(HandleMutex);
+
+    auto Open = find_file(Handle);
+    if(!Open){
+        return std::nullopt;
+    }
+
+    overlay_scope Scope;
+
+    return Overlay->size(*Open->File);
+}
+
+// Overlapped calls complete right away.
+void complete(HANDLE Handle, OVERLAPPED* Overlapped, DWORD Size){
+    Overlapped->Internal = 0;
+    Overlapped->InternalHigh = Size;
+    SetEvent(Overlapped->hEvent?Overlapped->hEvent:Handle);
+}
+
+}
+
+void init_overlay(){
+    if(CmdArgs.Overlay){
+        Overlay = std::make_unique<mmtl::overlay_fs>(CmdArgs.Documents);
+    }
+}
+
+bool overlay_enabled(){
+    return Overlay != nullptr;
+}
+
+bool save_overlay(const wchar_t* Name){
+    if(!Overlay){
+        std::fprintf(stderr, "Error: The documents folder is only kept in memory with `--overlay`.\n");
+        return false;
+    }
+
+    overlay_scope Scope;
+
+    try {
+        Overlay->save(fs::weakly_canonical(Name));
+        return true;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return false;
+    }
+}
+
+namespace {
+
+HANDLE create_file(
+    const wchar_t* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+){
+    if(auto Log = open_game_log(Name, Access)){
+        return Log;
+    }
+
+    auto Path = overlay_path(Name);
+    if(!Path){
+        return package_create_file(Name, Access, Share, Security, Disposition, Flags, Template);
+    }
+
+    overlay_scope Scope;
+
+    mmtl::overlay_fs::disposition Mode;
+    switch(Disposition){
+        case CREATE_NEW: Mode = mmtl::overlay_fs::disposition::CreateNew; break;
+        case CREATE_ALWAYS: Mode = mmtl::overlay_fs::disposition::CreateAlways; break;
+        case OPEN_EXISTING: Mode = mmtl::overlay_fs::disposition::OpenExisting; break;
+        case OPEN_ALWAYS: Mode = mmtl::overlay_fs::disposition::OpenAlways; break;
+        case TRUNCATE_EXISTING: Mode = mmtl::overlay_fs::disposition::TruncateExisting; break;
+        default: {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return INVALID_HANDLE_VALUE;
+        }
+    }
+
+    std::shared_ptr<mmtl::overlay_fs::file> File;
+    mmtl::overlay_fs::status Status;
+    try {
+        Status = Overlay->open(*Path, Mode, File);
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        SetLastError(ERROR_ACCESS_DENIED);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    DLOG("CreateFileW(\"%ls\", %08X, %u): overlay %d\n", Name, Access, Disposition, static_cast<int>(Status));
+
+    if(!File){
+        // Creating a file that exists is an error of its own.
+        SetLastError((Status == mmtl::overlay_fs::status::Exists)?ERROR_FILE_EXISTS:status_error(Status));
+        return INVALID_HANDLE_VALUE;
+    }
+
+    auto Handle = add_handle();
+    if(!Handle){
+        return INVALID_HANDLE_VALUE;
+    }
+
+    {
+        std::lock_guard Lock(HandleMutex);
+        Files[Handle] = {
+            .File = std::move(File),
+            .Position = 0,
+            .Writable = (Access&(GENERIC_WRITE|GENERIC_ALL|FILE_WRITE_DATA|FILE_APPEND_DATA)) != 0,
+        };
+    }
+
+    auto Existed = Status == mmtl::overlay_fs::status::Opened &&
+        (Disposition == CREATE_ALWAYS || Disposition == OPEN_ALWAYS);
+    SetLastError(Existed?ERROR_ALREADY_EXISTS:ERROR_SUCCESS);
+
+    return Handle;
+}
+
+}
+
+HANDLE WINAPI CreateFileW_Hook(
+    const wchar_t* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+){
+    auto Start = profile_start();
+    auto r = create_file(Name, Access, Share, Security, Disposition, Flags, Template);
+    profile_open(Name, r, Start);
+
+    return r;
+}
+
+HANDLE WINAPI CreateFileA_Hook(
+    const char* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+){
+    // Converted so that the overlay and everything else only handle wide names.
+    auto Size = Name?MultiByteToWideChar(CP_ACP, 0, Name, -1, nullptr, 0):0;
+    if(Size <= 0){
+        return CreateFileA_Orig(Name, Access, Share, Security, Disposition, Flags, Template);
+    }
+
+    std::wstring Wide(static_cast<std::size_t>(Size), L'\0');
+    MultiByteToWideChar(CP_ACP, 0, Name, -1, Wide.data(), Size);
+
+    return CreateFileW_Hook(Wide.c_str(), Access, Share, Security, Disposition, Flags, Template);
+}
+
+namespace {
+
+BOOL read_file(HANDLE File, void* Buffer, DWORD Size, DWORD* Read, OVERLAPPED* Overlapped){
+    if(HandleCount == 0 || InOverlay){
+        return package_read_file(File, Buffer, Size, Read, Overlapped);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto Open = find_file(File);
+    if(!Open){
+        Lock.unlock();
+        return package_read_file(File, Buffer, Size, Read, Overlapped);
+    }
+
+    auto Offset = Open->Position;
+    if(Overlapped){
+        Offset = (static_cast<std::uint64_t>(Overlapped->OffsetHigh) << 32)|Overlapped->Offset;
+    }
+
+    overlay_scope Scope;
+
+    auto r = static_cast<DWORD>(Overlay->read(*Open->File, Offset, Buffer, Size));
+    if(!Overlapped){
+        Open->Position = Offset+r;
+    }
+
+    if(Read){
+        *Read = r;
+    }
+
+    if(Overlapped){
+        complete(File, Overlapped, r);
+    }
+
+    return TRUE;
+}
+
+}
+
+BOOL WINAPI ReadFile_Hook(HANDLE File, void* Buffer, DWORD Size, DWORD* Read, OVERLAPPED* Overlapped){
+    auto Start = profile_start();
+    auto r = read_file(File, Buffer, Size, Read, Overlapped);
+    if(Start != 0 && r){
+        profile_read(File, (Read && !Overlapped)?*Read:Size, Start);
+    }
+
+    return r;
+}
+
+BOOL WINAPI WriteFile_Hook(HANDLE File, const void* Buffer, DWORD Size, DWORD* Written, OVERLAPPED* Overlapped){
+    if(is_game_log(File)){
+        return write_game_log(File, Buffer, Size, Written, Overlapped);
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return WriteFile_Orig(File, Buffer, Size, Written, Overlapped);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto Open = find_file(File);
+    if(!Open){
+        Lock.unlock();
+        return WriteFile_Orig(File, Buffer, Size, Written, Overlapped);
+    }
+
+    if(!Open->Writable){
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+
+    auto Offset = Open->Position;
+    if(Overlapped){
+        Offset = (static_cast<std::uint64_t>(Overlapped->OffsetHigh) << 32)|Overlapped->Offset;
+    }
+
+    overlay_scope Scope;
+
+    try {
+        Overlay->write(*Open->File, Offset, Buffer, Size);
+    }catch(std::exception&){
+        SetLastError(ERROR_DISK_FULL);
+        return FALSE;
+    }
+
+    if(!Overlapped){
+        Open->Position = Offset+Size;
+    }
+
+    if(Written){
+        *Written = Size;
+    }
+
+    if(Overlapped){
+        complete(File, Overlapped, Size);
+    }
+
+    return TRUE;
+}
+
+DWORD WINAPI SetFilePointer_Hook(HANDLE File, LONG Distance, LONG* DistanceHigh, DWORD Method){
+    if(is_game_log(File)){
+        auto Size = game_log_size();
+        if(DistanceHigh){
+            *DistanceHigh = static_cast<LONG>(Size >> 32);
+        }
+
+        SetLastError(ERROR_SUCCESS);
+        return static_cast<DWORD>(Size);
+    }
+
+    // Without the high part, the distance is a signed 32-bit one.
+    std::int64_t Full = Distance;
+    if(DistanceHigh){
+        Full = static_cast<std::int64_t>((static_cast<std::uint64_t>(*DistanceHigh) << 32)|static_cast<DWORD>(Distance));
+    }
+
+    std::uint64_t r;
+
+    BOOL Moved;
+    if(!package_set_file_pointer(File, Full, Method, Moved, r)){
+        if(HandleCount == 0 || InOverlay){
+            return SetFilePointer_Orig(File, Distance, DistanceHigh, Method);
+        }
+
+        std::unique_lock Lock(HandleMutex);
+
+        auto Open = find_file(File);
+        if(!Open){
+            Lock.unlock();
+            return SetFilePointer_Orig(File, Distance, DistanceHigh, Method);
+        }
+
+        overlay_scope Scope;
+
+        Moved = seek(*Open, Full, Method, r);
+    }
+
+    if(!Moved){
+        return INVALID_SET_FILE_POINTER;
+    }
+
+    if(DistanceHigh){
+        *DistanceHigh = static_cast<LONG>(r >> 32);
+    }
+
+    // The low part may be `INVALID_SET_FILE_POINTER` too.
+    SetLastError(ERROR_SUCCESS);
+
+    return static_cast<DWORD>(r);
+}
+
+BOOL WINAPI SetFilePointerEx_Hook(HANDLE File, LARGE_INTEGER Distance, LARGE_INTEGER* Position, DWORD Method){
+    if(is_game_log(File)){
+        if(Position){
+            Position->QuadPart = static_cast<LONGLONG>(game_log_size());
+        }
+
+        return TRUE;
+    }
+
+    std::uint64_t r;
+
+    BOOL Moved;
+    if(!package_set_file_pointer(File, Distance.QuadPart, Method, Moved, r)){
+        if(HandleCount == 0 || InOverlay){
+            return SetFilePointerEx_Orig(File, Distance, Position, Method);
+        }
+
+        std::unique_lock Lock(HandleMutex);
+
+        auto Open = find_file(File);
+        if(!Open){
+            Lock.unlock();
+            return SetFilePointerEx_Orig(File, Distance, Position, Method);
+        }
+
+        overlay_scope Scope;
+
+        Moved = seek(*Open, Distance.QuadPart, Method, r);
+    }
+
+    if(!Moved){
+        return FALSE;
+    }
+
+    if(Position){
+        Position->QuadPart = static_cast<LONGLONG>(r);
+    }
+
+    return TRUE;
+}
+
+DWORD WINAPI GetFileSize_Hook(HANDLE File, DWORD* SizeHigh){
+    if(is_game_log(File)){
+        auto Size = game_log_size();
+        if(SizeHigh){
+            *SizeHigh = static_cast<DWORD>(Size >> 32);
+        }
+
+        SetLastError(ERROR_SUCCESS);
+        return static_cast<DWORD>(Size);
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return GetFileSize_Orig(File, SizeHigh);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto Open = find_file(File);
+    if(!Open){
+        Lock.unlock();
+        return GetFileSize_Orig(File, SizeHigh);
+    }
+
+    overlay_scope Scope;
+
+    auto r = Overlay->size(*Open->File);
+    if(SizeHigh){
+        *SizeHigh = static_cast<DWORD>(r >> 32);
+    }
+
+    SetLastError(ERROR_SUCCESS);
+
+    return static_cast<DWORD>(r);
+}
+
+BOOL WINAPI GetFileSizeEx_Hook(HANDLE File, LARGE_INTEGER* Size){
+    if(is_game_log(File)){
+        Size->QuadPart = static_cast<LONGLONG>(game_log_size());
+        return TRUE;
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return GetFileSizeEx_Orig(File, Size);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto Open = find_file(File);
+    if(!Open){
+        Lock.unlock();
+        return GetFileSizeEx_Orig(File, Size);
+    }
+
+    overlay_scope Scope;
+
+    Size->QuadPart = static_cast<LONGLONG>(Overlay->size(*Open->File));
+
+    return TRUE;
+}
+
+BOOL WINAPI SetEndOfFile_Hook(HANDLE File){
+    if(is_game_log(File)){
+        return TRUE;
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return SetEndOfFile_Orig(File);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto Open = find_file(File);
+    if(!Open){
+        Lock.unlock();
+        return SetEndOfFile_Orig(File);
+    }
+
+    if(!Open->Writable){
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+
+    overlay_scope Scope;
+
+    try {
+        Overlay->resize(*Open->File, Open->Position);
+    }catch(std::exception&){
+        SetLastError(ERROR_DISK_FULL);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL WINAPI FlushFileBuffers_Hook(HANDLE File){
+    if(is_game_log(File)){
+        return TRUE;
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return FlushFileBuffers_Orig(File);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    if(!find_file(File)){
+        Lock.unlock();
+        return FlushFileBuffers_Orig(File);
+    }
+
+    return TRUE;
+}
+
+BOOL WINAPI CloseHandle_Hook(HANDLE Handle){
+    profile_close(Handle);
+
+    if(is_game_log(Handle)){
+        return close_game_log(Handle);
+    }
+
+    if(HandleCount == 0 || InOverlay){
+        return package_close_handle(Handle);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    if(Files.erase(Handle) == 0){
+        Lock.unlock();
+        return package_close_handle(Handle);
+    }
+
+    remove_handle(Handle);
+
+    return TRUE;
+}
+
+DWORD WINAPI GetFileType_Hook(HANDLE File){
+    if(!handle_size(File)){
+        return GetFileType_Orig(File);
+    }
+
+    SetLastError(ERROR_SUCCESS);
+    return FILE_TYPE_DISK;
+}
+
+BOOL WINAPI GetFileTime_Hook(HANDLE File, FILETIME* Creation, FILETIME* Access, FILETIME* Write){
+    if(!handle_size(File)){
+        return GetFileTime_Orig(File, Creation, Access, Write);
+    }
+
+    for(auto Time:{Creation, Access, Write}){
+        if(Time){
+            *Time = file_time();
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL WINAPI GetFileInformationByHandle_Hook(HANDLE File, BY_HANDLE_FILE_INFORMATION* Info){
+    auto Size = handle_size(File);
+    if(!Size){
+        return GetFileInformationByHandle_Orig(File, Info);
+    }
+
+    // The handle stands in for the file index, files opened twice look like two files.
+    auto Index = reinterpret_cast<std::uintptr_t>(File);
+
+    *Info = {};
+    Info->dwFileAttributes = FILE_ATTRIBUTE_ARCHIVE;
+    Info->ftCreationTime = Info->ftLastAccessTime = Info->ftLastWriteTime = file_time();
+    Info->nFileSizeHigh = static_cast<DWORD>(*Size >> 32);
+    Info->nFileSizeLow = static_cast<DWORD>(*Size);
+    Info->nNumberOfLinks = 1;
+    Info->nFileIndexLow = static_cast<DWORD>(Index);
+
+    return TRUE;
+}
+
+DWORD WINAPI GetFileAttributesW_Hook(const wchar_t* Name){
+    auto Path = overlay_path(Name);
+    if(!Path){
+        return GetFileAttributesW_Orig(Name);
+    }
+
+    overlay_scope Scope;
+
+    auto Entry = Overlay->stat(*Path);
+    if(!Entry){
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_FILE_ATTRIBUTES;
+    }
+
+    return file_attributes(*Entry);
+}
+
+BOOL WINAPI GetFileAttributesExW_Hook(const wchar_t* Name, GET_FILEEX_INFO_LEVELS Level, void* Info){
+    auto Path = overlay_path(Name);
+    if(!Path || Level != GetFileExInfoStandard){
+        return GetFileAttributesExW_Orig(Name, Level, Info);
+    }
+
+    overlay_scope Scope;
+
+    auto Entry = Overlay->stat(*Path);
+    if(!Entry){
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return FALSE;
+    }
+
+    auto Data = static_cast<WIN32_FILE_ATTRIBUTE_DATA*>(Info);
+    Data->dwFileAttributes = file_attributes(*Entry);
+    Data->ftCreationTime = Data->ftLastAccessTime = Data->ftLastWriteTime = file_time();
+    Data->nFileSizeHigh = static_cast<DWORD>(Entry->Size >> 32);
+    Data->nFileSizeLow = static_cast<DWORD>(Entry->Size);
+
+    return TRUE;
+}
+
+namespace {
+
+// The directory of a search pattern, if it's in the overlay.
+std::optional<fs::path> overlay_pattern(const wchar_t* Pattern){
+    if(!Pattern){
+        return std::nullopt;
+    }
+
+    return overlay_path(fs::path(Pattern).parent_path().c_str());
+}
+
+HANDLE find_first_file(const wchar_t* Pattern, const fs::path& Directory, WIN32_FIND_DATAW* Data){
+    auto Full = fs::path(Pattern);
+
+    overlay_scope Scope;
+
+    std::vector<mmtl::overlay_fs::entry> Entries;
+    if(!Overlay->list(Directory, Entries)){
+        SetLastError(ERROR_PATH_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    auto Spec = Full.filename().wstring();
+    std::erase_if(Entries, [&](auto& e){ return !wildcard_match(Spec, e.Name.wstring()); });
+
+    if(Entries.empty()){
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    auto Handle = add_handle();
+    if(!Handle){
+        return INVALID_HANDLE_VALUE;
+    }
+
+    fill_find_data(Entries[0], Data);
+
+    std::lock_guard Lock(HandleMutex);
+    Finds[Handle] = {std::move(Entries), 1};
+
+    return Handle;
+}
+
+}
+
+HANDLE WINAPI FindFirstFileW_Hook(const wchar_t* Pattern, WIN32_FIND_DATAW* Data){
+    auto Directory = overlay_pattern(Pattern);
+    if(!Directory){
+        return FindFirstFileW_Orig(Pattern, Data);
+    }
+
+    return find_first_file(Pattern, *Directory, Data);
+}
+
+HANDLE WINAPI FindFirstFileExW_Hook(
+    const wchar_t* Pattern, FINDEX_INFO_LEVELS Level, void* Data,
+    FINDEX_SEARCH_OPS Search, void* Filter, DWORD Flags
+){
+    auto Directory = overlay_pattern(Pattern);
+    if(!Directory){
+        return FindFirstFileExW_Orig(Pattern, Level, Data, Search, Filter, Flags);
+    }
+
+    // Limiting the search to directories is only advisory, short names are always empty.
+    if(
+        (Level != FindExInfoStandard && Level != FindExInfoBasic) ||
+        (Search != FindExSearchNameMatch && Search != FindExSearchLimitToDirectories)
+    ){
+        SetLastError(ERROR_NOT_SUPPORTED);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return find_first_file(Pattern, *Directory, static_cast<WIN32_FIND_DATAW*>(Data));
+}
+
+BOOL WINAPI FindNextFileW_Hook(HANDLE Find, WIN32_FIND_DATAW* Data){
+    if(HandleCount == 0 || InOverlay){
+        return FindNextFileW_Orig(Find, Data);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    auto it = Finds.find(Find);
+    if(it == Finds.end()){
+        Lock.unlock();
+        return FindNextFileW_Orig(Find, Data);
+    }
+
+    auto& Open = it->second;
+    if(Open.Next >= Open.Entries.size()){
+        SetLastError(ERROR_NO_MORE_FILES);
+        return FALSE;
+    }
+
+    fill_find_data(Open.Entries[Open.Next++], Data);
+
+    return TRUE;
+}
+
+BOOL WINAPI FindClose_Hook(HANDLE Find){
+    if(HandleCount == 0 || InOverlay){
+        return FindClose_Orig(Find);
+    }
+
+    std::unique_lock Lock(HandleMutex);
+
+    if(Finds.erase(Find) == 0){
+        Lock.unlock();
+        return FindClose_Orig(Find);
+    }
+
+    remove_handle(Find);
+
+    return TRUE;
+}
+
+BOOL WINAPI DeleteFileW_Hook(const wchar_t* Name){
+    auto Path = overlay_path(Name);
+    if(!Path){
+        return DeleteFileW_Orig(Name);
+    }
+
+    overlay_scope Scope;
+
+    auto Status = Overlay->remove(*Path);
+    if(Status != mmtl::overlay_fs::status::Opened){
+        SetLastError(status_error(Status));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL WINAPI CreateDirectoryW_Hook(const wchar_t* Name, SECURITY_ATTRIBUTES* Security){
+    auto Path = overlay_path(Name);
+    if(!Path){
+        return CreateDirectoryW_Orig(Name, Security);
+    }
+
+    overlay_scope Scope;
+
+    auto Status = Overlay->create_directory(*Path);
+    if(Status != mmtl::overlay_fs::status::Created){
+        SetLastError(status_error(Status));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL WINAPI RemoveDirectoryW_Hook(const wchar_t* Name){
+    auto Path = overlay_path(Name);
+    if(!Path){
+        return RemoveDirectoryW_Orig(Name);
+    }
+
+    overlay_scope Scope;
+
+    switch(auto Status = Overlay->remove_directory(*Path)){
+        case mmtl::overlay_fs::status::Opened: return TRUE;
+        case mmtl::overlay_fs::status::Exists: SetLastError(ERROR_DIR_NOT_EMPTY); return FALSE;
+        case mmtl::overlay_fs::status::PathNotFound: SetLastError(ERROR_DIRECTORY); return FALSE;
+        default: SetLastError(status_error(Status)); return FALSE;
+    }
+}
+
+namespace {
+
+// Nothing if neither path is in the overlay. Files can't be moved into or out of it, like between
+// volumes without `MOVEFILE_COPY_ALLOWED`, as that would need the base to be written.
+std::optional<BOOL> move_file(const wchar_t* From, const wchar_t* To, DWORD Flags){
+    auto FromPath = overlay_path(From);
+    auto ToPath = overlay_path(To);
+    if(!FromPath && !ToPath){
+        return std::nullopt;
+    }
+
+    if(!FromPath || !ToPath || (Flags&MOVEFILE_DELAY_UNTIL_REBOOT) != 0){
+        SetLastError(ERROR_NOT_SAME_DEVICE);
+        return FALSE;
+    }
+
+    overlay_scope Scope;
+
+    mmtl::overlay_fs::status Status;
+    try {
+        Status = Overlay->rename(*FromPath, *ToPath, (Flags&MOVEFILE_REPLACE_EXISTING) != 0);
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        SetLastError(ERROR_ACCESS_DENIED);
+        return FALSE;
+    }
+
+    DLOG("MoveFileExW(\"%ls\", \"%ls\", %08X): overlay %d\n", From, To, Flags, static_cast<int>(Status));
+
+    if(Status != mmtl::overlay_fs::status::Opened){
+        SetLastError(status_error(Status));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+}
+
+BOOL WINAPI MoveFileW_Hook(const wchar_t* From, const wchar_t* To){
+    if(auto r = move_file(From, To, 0)){
+        return *r;
+    }
+
+    return MoveFileW_Orig(From, To);
+}
+
+BOOL WINAPI MoveFileExW_Hook(const wchar_t* From, const wchar_t* To, DWORD Flags){
+    if(auto r = move_file(From, To, Flags)){
+        return *r;
+    }
+
+    return MoveFileExW_Orig(From, To, Flags);
+}
@@ -0,0 +1,53 @@
+﻿#ifndef OVERLAY_H_INCLUDED
+    #define OVERLAY_H_INCLUDED 1
+
+#include <windows.h>
+
+// With `--overlay`, the game's file calls for the documents folder go to an in-memory overlay of
+// it instead, so instances can share one folder and never write to it. The hooks are also used by
+// the package cache, which gets every other call, the game log, which comes before both, and the
+// load profiler, which times opens and reads.
+
+// Called before the hooks are in place.
+void init_overlay();
+bool overlay_enabled();
+
+// Writes the documents folder as the game sees it to a folder. Returns false if it can't.
+bool save_overlay(const wchar_t* Name);
+
+HANDLE WINAPI CreateFileW_Hook(
+    const wchar_t* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+);
+HANDLE WINAPI CreateFileA_Hook(
+    const char* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+);
+BOOL WINAPI ReadFile_Hook(HANDLE File, void* Buffer, DWORD Size, DWORD* Read, OVERLAPPED* Overlapped);
+BOOL WINAPI WriteFile_Hook(HANDLE File, const void* Buffer, DWORD Size, DWORD* Written, OVERLAPPED* Overlapped);
+DWORD WINAPI SetFilePointer_Hook(HANDLE File, LONG Distance, LONG* DistanceHigh, DWORD Method);
+BOOL WINAPI SetFilePointerEx_Hook(HANDLE File, LARGE_INTEGER Distance, LARGE_INTEGER* Position, DWORD Method);
+DWORD WINAPI GetFileSize_Hook(HANDLE File, DWORD* SizeHigh);
+BOOL WINAPI GetFileSizeEx_Hook(HANDLE File, LARGE_INTEGER* Size);
+BOOL WINAPI SetEndOfFile_Hook(HANDLE File);
+BOOL WINAPI FlushFileBuffers_Hook(HANDLE File);
+BOOL WINAPI CloseHandle_Hook(HANDLE Handle);
+DWORD WINAPI GetFileType_Hook(HANDLE File);
+BOOL WINAPI GetFileTime_Hook(HANDLE File, FILETIME* Creation, FILETIME* Access, FILETIME* Write);
+BOOL WINAPI GetFileInformationByHandle_Hook(HANDLE File, BY_HANDLE_FILE_INFORMATION* Info);
+DWORD WINAPI GetFileAttributesW_Hook(const wchar_t* Name);
+BOOL WINAPI GetFileAttributesExW_Hook(const wchar_t* Name, GET_FILEEX_INFO_LEVELS Level, void* Info);
+HANDLE WINAPI FindFirstFileW_Hook(const wchar_t* Pattern, WIN32_FIND_DATAW* Data);
+HANDLE WINAPI FindFirstFileExW_Hook(
+    const wchar_t* Pattern, FINDEX_INFO_LEVELS Level, void* Data,
+    FINDEX_SEARCH_OPS Search, void* Filter, DWORD Flags
+);
+BOOL WINAPI FindNextFileW_Hook(HANDLE Find, WIN32_FIND_DATAW* Data);
+BOOL WINAPI FindClose_Hook(HANDLE Find);
+BOOL WINAPI DeleteFileW_Hook(const wchar_t* Name);
+BOOL WINAPI CreateDirectoryW_Hook(const wchar_t* Name, SECURITY_ATTRIBUTES* Security);
+BOOL WINAPI RemoveDirectoryW_Hook(const wchar_t* Name);
+BOOL WINAPI MoveFileW_Hook(const wchar_t* From, const wchar_t* To);
+BOOL WINAPI MoveFileExW_Hook(const wchar_t* From, const wchar_t* To, DWORD Flags);
+
+#endif
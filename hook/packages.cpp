@@ -0,0 +1,302 @@
+﻿#include "defines.h"
+
+#include "packages.h"
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+#include <unordered_map>
+
+#include <cwchar>
+
+#include <file_cache.h>
+
+#include "hooks.h"
+#include "state.h"
+
+namespace {
+
+const fs::path LoadLogPath = "datafiles/package_loads.txt";
+
+std::unique_ptr<mmtl::file_cache> Cache;
+
+// Set while the cache maps a file, which opens it through the same hooks.
+thread_local bool InCache = false;
+
+struct cache_scope {
+    cache_scope(){
+        InCache = true;
+    }
+
+    ~cache_scope(){
+        InCache = false;
+    }
+};
+
+// The game's own handles. Like the real file pointer, the position is not for two threads at once.
+struct package_handle {
+    std::shared_ptr<mmtl::file_cache::file> File;
+    std::uint64_t Position = 0;
+};
+
+std::mutex HandleMutex;
+std::unordered_map<HANDLE, std::shared_ptr<package_handle>> Handles;
+std::atomic<std::size_t> HandleCount = 0;
+
+std::shared_ptr<package_handle> find_handle(HANDLE File){
+    if(HandleCount == 0){
+        return nullptr;
+    }
+
+    std::lock_guard Lock(HandleMutex);
+
+    auto it = Handles.find(File);
+    return (it != Handles.end())?it->second:nullptr;
+}
+
+std::mutex LoadMutex;
+mmtl::load_log Log;
+int LoadDepth = 0;
+std::string Level;
+std::vector<std::string> LoadFiles;
+std::unordered_set<std::string> LoadSeen;
+LARGE_INTEGER LoadStart;
+mmtl::file_cache::counters LoadCounters;
+std::vector<package_load> Loads;
+
+bool is_package(const wchar_t* Name){
+    auto Length = std::wcslen(Name);
+    return Length >= 4 && _wcsicmp(Name+Length-4, L".upk") == 0;
+}
+
+std::string utf8(const fs::path& Path){
+    auto s = Path.u8string();
+    return std::string(reinterpret_cast<const char*>(s.data()), s.size());
+}
+
+fs::path from_utf8(const std::string& s){
+    return fs::path(std::u8string(reinterpret_cast<const char8_t*>(s.data()), s.size()));
+}
+
+// The first package a load reads names the level, and what the last load of it read is read ahead.
+void note_package(const wchar_t* Name){
+    std::vector<std::string> Prefetch;
+
+    {
+        std::lock_guard Lock(LoadMutex);
+
+        if(LoadDepth == 0){
+            return;
+        }
+
+        auto Path = utf8(Name);
+        if(!LoadSeen.insert(Path).second){
+            return;
+        }
+
+        LoadFiles.push_back(Path);
+
+        if(!Level.empty()){
+            return;
+        }
+
+        Level = Path;
+        if(auto Files = Log.find(Level)){
+            Prefetch = *Files;
+        }
+    }
+
+    cache_scope Scope;
+
+    for(auto& e:Prefetch){
+        Cache->prefetch(from_utf8(e));
+    }
+}
+
+}
+
+void init_packages(){
+    if(!CmdArgs.PackageCache){
+        return;
+    }
+
+    Cache = std::make_unique<mmtl::file_cache>();
+    Log.read(LoadLogPath);
+}
+
+bool packages_enabled(){
+    return Cache != nullptr;
+}
+
+void begin_package_load(){
+    if(!Cache){
+        return;
+    }
+
+    std::lock_guard Lock(LoadMutex);
+
+    if(LoadDepth++ > 0){
+        return;
+    }
+
+    Level.clear();
+    LoadFiles.clear();
+    LoadSeen.clear();
+    QueryPerformanceCounter_Orig(&LoadStart);
+    LoadCounters = Cache->count();
+}
+
+void end_package_load(){
+    if(!Cache){
+        return;
+    }
+
+    std::lock_guard Lock(LoadMutex);
+
+    if(LoadDepth == 0 || --LoadDepth > 0){
+        return;
+    }
+
+    LARGE_INTEGER End;
+    QueryPerformanceCounter_Orig(&End);
+
+    auto Counters = Cache->count();
+
+    package_load Load = {
+        .Level = Level,
+        .Seconds = static_cast<double>(End.QuadPart-LoadStart.QuadPart)/QpcFrequency_Orig.QuadPart,
+        .Reads = Counters.Reads-LoadCounters.Reads,
+        .Hits = Counters.Hits-LoadCounters.Hits,
+    };
+
+    // Loads that read no package, like most load screens of a level that is already loaded, have
+    // nothing to log.
+    if(Level.empty()){
+        return;
+    }
+
+    Loads.push_back(Load);
+
+    std::fprintf(stderr, "Loaded %s in %.2f s, %llu of %llu package reads were read ahead.\n",
+        utf8(from_utf8(Level).filename()).c_str(), Load.Seconds,
+        static_cast<unsigned long long>(Load.Hits), static_cast<unsigned long long>(Load.Reads));
+
+    Log.record(Level, std::move(LoadFiles));
+    LoadFiles.clear();
+
+    try {
+        Log.write(LoadLogPath);
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+    }
+}
+
+std::vector<package_load> package_loads(){
+    std::lock_guard Lock(LoadMutex);
+    return Loads;
+}
+
+HANDLE package_create_file(
+    const wchar_t* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+){
+    auto r = CreateFileW_Orig(Name, Access, Share, Security, Disposition, Flags, Template);
+
+    // Overlapped reads and writes go straight to the file.
+    constexpr DWORD Writes = GENERIC_WRITE|GENERIC_ALL|FILE_WRITE_DATA|FILE_APPEND_DATA;
+    if(
+        !Cache || InCache || r == INVALID_HANDLE_VALUE || !Name || !is_package(Name) ||
+        (Access&Writes) != 0 || (Flags&FILE_FLAG_OVERLAPPED) != 0
+    ){
+        return r;
+    }
+
+    auto Error = GetLastError();
+
+    std::shared_ptr<mmtl::file_cache::file> File;
+    {
+        cache_scope Scope;
+        File = Cache->open(Name);
+    }
+
+    if(File){
+        std::lock_guard Lock(HandleMutex);
+        Handles[r] = std::make_shared<package_handle>(std::move(File));
+        ++HandleCount;
+    }
+
+    note_package(Name);
+
+    SetLastError(Error);
+
+    return r;
+}
+
+BOOL package_read_file(HANDLE File, void* Buffer, DWORD Size, DWORD* Read, OVERLAPPED* Overlapped){
+    auto Handle = find_handle(File);
+    if(!Handle){
+        return ReadFile_Orig(File, Buffer, Size, Read, Overlapped);
+    }
+
+    // Reads with an offset go to the file, but still move the position.
+    if(Overlapped){
+        auto r = ReadFile_Orig(File, Buffer, Size, Read, Overlapped);
+        if(r){
+            auto Offset = (static_cast<std::uint64_t>(Overlapped->OffsetHigh) << 32)|Overlapped->Offset;
+            Handle->Position = Offset+Overlapped->InternalHigh;
+        }
+
+        return r;
+    }
+
+    auto Done = Cache->read(*Handle->File, Handle->Position, Buffer, Size);
+    Handle->Position += Done;
+
+    if(Read){
+        *Read = static_cast<DWORD>(Done);
+    }
+
+    return TRUE;
+}
+
+BOOL package_close_handle(HANDLE Handle){
+    if(HandleCount != 0){
+        std::lock_guard Lock(HandleMutex);
+
+        if(Handles.erase(Handle) != 0){
+            --HandleCount;
+        }
+    }
+
+    return CloseHandle_Orig(Handle);
+}
+
+bool package_set_file_pointer(HANDLE File, std::int64_t Distance, DWORD Method, BOOL& Result, std::uint64_t& Position){
+    auto Handle = find_handle(File);
+    if(!Handle){
+        return false;
+    }
+
+    std::int64_t From = 0;
+    switch(Method){
+        case FILE_BEGIN: break;
+        case FILE_CURRENT: From = static_cast<std::int64_t>(Handle->Position); break;
+        case FILE_END: From = static_cast<std::int64_t>(Handle->File->Data->size()); break;
+        default: {
+            SetLastError(ERROR_INVALID_PARAMETER);
+            Result = FALSE;
+            return true;
+        }
+    }
+
+    if(From+Distance < 0){
+        SetLastError(ERROR_NEGATIVE_SEEK);
+        Result = FALSE;
+        return true;
+    }
+
+    Position = Handle->Position = static_cast<std::uint64_t>(From+Distance);
+    Result = TRUE;
+    return true;
+}
@@ -0,0 +1,48 @@
+﻿#ifndef PACKAGES_H_INCLUDED
+    #define PACKAGES_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <windows.h>
+
+// With `--package-cache`, the game's packages are read through a cache of mapped files, and the
+// packages every level's load reads are logged, so they can be read ahead the next time the level
+// loads, in this run or a later one.
+
+// Called before the hooks are in place.
+void init_packages();
+bool packages_enabled();
+
+// Called by the load screen hooks, the outermost call counts.
+void begin_package_load();
+void end_package_load();
+
+struct package_load {
+    // The first package the load read.
+    std::string Level;
+    double Seconds;
+    std::uint64_t Reads;
+    // Reads of pages that had been read ahead.
+    std::uint64_t Hits;
+};
+
+// Every load so far, oldest first.
+std::vector<package_load> package_loads();
+
+// Called by the file hooks for everything that isn't in the documents overlay.
+HANDLE package_create_file(
+    const wchar_t* Name, DWORD Access, DWORD Share, SECURITY_ATTRIBUTES* Security,
+    DWORD Disposition, DWORD Flags, HANDLE Template
+);
+BOOL package_read_file(HANDLE File, void* Buffer, DWORD Size, DWORD* Read, OVERLAPPED* Overlapped);
+BOOL package_close_handle(HANDLE Handle);
+
+// Called by the seek hooks. Cached packages keep their file position with the handle instead of
+// in the file pointer, so reading them needs no system calls. Returns false if `File` isn't one,
+// otherwise `Result` is what the seek returns and `Position` the new position.
+bool package_set_file_pointer(HANDLE File, std::int64_t Distance, DWORD Method, BOOL& Result, std::uint64_t& Position);
+
+#endif
@@ -0,0 +1,276 @@
+﻿#include "defines.h"
+
+#include "profiling.h"
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+#include <cwchar>
+
+#include <load_profile.h>
+
+#include <tlhelp32.h>
+
+#include "hooks.h"
+#include "state.h"
+
+namespace {
+
+const fs::path ProfileDirectory = "datafiles/load_profiles";
+
+bool Enabled = false;
+std::atomic<bool> Profiling = false;
+
+std::mutex ProfileMutex;
+int LoadDepth = 0;
+std::size_t LoadCount = 0;
+mmtl::load_profile Profile;
+std::int64_t RealStart;
+std::int64_t VirtualStart;
+std::unordered_map<DWORD, std::uint64_t> CpuStart;
+
+// Every file handle the game has open, by the file's name.
+std::unordered_map<HANDLE, std::string> Handles;
+
+std::string utf8(const fs::path& Path){
+    auto s = Path.u8string();
+    return std::string(reinterpret_cast<const char*>(s.data()), s.size());
+}
+
+std::int64_t now(){
+    LARGE_INTEGER r;
+    QueryPerformanceCounter_Orig(&r);
+    return r.QuadPart;
+}
+
+// Real counts in the 100 ns ticks of the virtual counter.
+std::uint64_t ticks(std::int64_t Counts){
+    return static_cast<std::uint64_t>(Counts*QpcFrequency/QpcFrequency_Orig.QuadPart);
+}
+
+std::uint64_t file_time(const FILETIME& Time){
+    return (static_cast<std::uint64_t>(Time.dwHighDateTime) << 32)|Time.dwLowDateTime;
+}
+
+// User and kernel time of every thread of the process.
+std::unordered_map<DWORD, std::uint64_t> thread_times(){
+    std::unordered_map<DWORD, std::uint64_t> r;
+
+    auto Snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if(Snapshot == INVALID_HANDLE_VALUE){
+        return r;
+    }
+
+    auto Process = GetCurrentProcessId();
+
+    THREADENTRY32 Entry;
+    Entry.dwSize = sizeof(Entry);
+    for(auto More = Thread32First(Snapshot, &Entry); More; More = Thread32Next(Snapshot, &Entry)){
+        if(Entry.th32OwnerProcessID != Process){
+            continue;
+        }
+
+        auto Thread = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, Entry.th32ThreadID);
+        if(!Thread){
+            continue;
+        }
+
+        FILETIME Creation, Exit, Kernel, User;
+        if(GetThreadTimes(Thread, &Creation, &Exit, &Kernel, &User)){
+            r[Entry.th32ThreadID] = file_time(Kernel)+file_time(User);
+        }
+
+        CloseHandle_Orig(Thread);
+    }
+
+    CloseHandle_Orig(Snapshot);
+
+    return r;
+}
+
+bool is_package(const std::string& Path){
+    return Path.size() >= 4 && _stricmp(Path.c_str()+Path.size()-4, ".upk") == 0;
+}
+
+// Needs `ProfileMutex`.
+void record(mmtl::load_io Kind, const std::string& Path, std::uint64_t Bytes, std::int64_t Start){
+    auto End = now();
+
+    Profile.Events.push_back({
+        .Start = ticks(Start-RealStart),
+        .Duration = ticks(End-Start),
+        .Bytes = Bytes,
+        .File = Profile.file(Path),
+        .Thread = static_cast<std::uint32_t>(GetCurrentThreadId()),
+        .Kind = Kind,
+    });
+}
+
+std::string file_name(const std::string& Path){
+    auto Separator = Path.find_last_of("\\/");
+    return (Separator != std::string::npos)?Path.substr(Separator+1):Path;
+}
+
+void print_summary(const mmtl::load_profile& Profile){
+    std::uint64_t Reads = 0, Bytes = 0, Time = 0;
+    for(auto& e:Profile.Events){
+        Reads += (e.Kind == mmtl::load_io::Read);
+        Bytes += e.Bytes;
+        Time += e.Duration;
+    }
+
+    std::uint64_t Cpu = 0;
+    for(auto& e:Profile.Threads){
+        Cpu += e.CpuTime;
+    }
+
+    std::fprintf(stderr, "Profiled %s: %.2f s real, %.2f s virtual, %.2f s CPU, %llu reads of %.1f MiB taking %.2f s.\n",
+        Profile.Level.empty()?"a load":file_name(Profile.Level).c_str(),
+        Profile.RealTime/1e7, Profile.VirtualTime/1e7, Cpu/1e7,
+        static_cast<unsigned long long>(Reads), Bytes/1048576.0, Time/1e7);
+
+    auto Summary = Profile.summary();
+    for(std::size_t i = 0; i < Summary.size() && i < 5 && Summary[i].Time > 0; ++i){
+        std::fprintf(stderr, "    %.2f s, %llu reads: %s\n", Summary[i].Time/1e7,
+            static_cast<unsigned long long>(Summary[i].Reads), Profile.Files[Summary[i].File].c_str());
+    }
+}
+
+}
+
+void init_profiling(){
+    Enabled = CmdArgs.ProfileLoads;
+}
+
+bool profiling_enabled(){
+    return Enabled;
+}
+
+void begin_load_profile(){
+    if(!Enabled){
+        return;
+    }
+
+    auto Cpu = thread_times();
+
+    std::lock_guard Lock(ProfileMutex);
+
+    if(LoadDepth++ > 0){
+        return;
+    }
+
+    Profile = {};
+    CpuStart = std::move(Cpu);
+    VirtualStart = Qpc;
+    RealStart = now();
+
+    Profiling = true;
+}
+
+void end_load_profile(){
+    if(!Enabled){
+        return;
+    }
+
+    auto Cpu = thread_times();
+
+    mmtl::load_profile Done;
+    std::size_t Count;
+    {
+        std::lock_guard Lock(ProfileMutex);
+
+        if(LoadDepth == 0 || --LoadDepth > 0){
+            return;
+        }
+
+        Profiling = false;
+
+        Done = std::move(Profile);
+        Count = ++LoadCount;
+    }
+
+    Done.RealTime = ticks(now()-RealStart);
+    Done.VirtualTime = static_cast<std::uint64_t>(Qpc-VirtualStart);
+
+    // Threads started during the load count from zero. An ID reused by a new thread may show less
+    // time than the old one had, which counts from zero too.
+    for(auto& [Id, Time]:Cpu){
+        auto it = CpuStart.find(Id);
+        auto Start = (it != CpuStart.end() && it->second <= Time)?it->second:0;
+        if(Time > Start){
+            Done.Threads.push_back({.Id = static_cast<std::uint32_t>(Id), .CpuTime = Time-Start});
+        }
+    }
+
+    print_summary(Done);
+
+    // Written through the file hooks, so not under the lock.
+    wchar_t Name[64];
+    std::swprintf(Name, std::size(Name), L"load-%lu-%zu.bin", GetCurrentProcessId(), Count);
+
+    try {
+        fs::create_directories(ProfileDirectory);
+        Done.write(ProfileDirectory/Name);
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+    }
+}
+
+std::int64_t profile_start(){
+    return Profiling?now():0;
+}
+
+void profile_open(const wchar_t* Name, HANDLE File, std::int64_t Start){
+    if(!Enabled || !Name || File == INVALID_HANDLE_VALUE){
+        return;
+    }
+
+    auto Error = GetLastError();
+    auto Path = utf8(Name);
+
+    {
+        std::lock_guard Lock(ProfileMutex);
+
+        if(Start != 0 && Profiling){
+            record(mmtl::load_io::Open, Path, 0, Start);
+
+            if(Profile.Level.empty() && is_package(Path)){
+                Profile.Level = Path;
+            }
+        }
+
+        Handles[File] = std::move(Path);
+    }
+
+    SetLastError(Error);
+}
+
+void profile_read(HANDLE File, DWORD Bytes, std::int64_t Start){
+    if(Start == 0){
+        return;
+    }
+
+    auto Error = GetLastError();
+
+    {
+        std::lock_guard Lock(ProfileMutex);
+
+        auto it = Handles.find(File);
+        if(Profiling && it != Handles.end()){
+            record(mmtl::load_io::Read, it->second, Bytes, Start);
+        }
+    }
+
+    SetLastError(Error);
+}
+
+void profile_close(HANDLE Handle){
+    if(!Enabled){
+        return;
+    }
+
+    std::lock_guard Lock(ProfileMutex);
+    Handles.erase(Handle);
+}
@@ -0,0 +1,29 @@
+﻿#ifndef PROFILING_H_INCLUDED
+    #define PROFILING_H_INCLUDED 1
+
+#include <cstdint>
+
+#include <windows.h>
+
+// With `--profile-loads`, every load screen is profiled: the files opened and read and how long
+// that took, the CPU time of every thread and how much real and virtual time passed. A summary is
+// printed when the load ends, and the whole profile is written to `datafiles/load_profiles`, to be
+// read with `loaddump`.
+
+// Called before the hooks are in place.
+void init_profiling();
+bool profiling_enabled();
+
+// Called by the load screen hooks, the outermost call counts.
+void begin_load_profile();
+void end_load_profile();
+
+// Called by the file hooks around the calls. `profile_start` returns 0 outside of loads, which the
+// others skip timing for. Handles are tracked all the time, so reads of files opened before a load
+// are named too.
+std::int64_t profile_start();
+void profile_open(const wchar_t* Name, HANDLE File, std::int64_t Start);
+void profile_read(HANDLE File, DWORD Bytes, std::int64_t Start);
+void profile_close(HANDLE Handle);
+
+#endif
@@ -5,59 +5,37 @@
 #include <Python.h>
 
 #include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstring>
+
+#include <pe.h>
+#include <scan.h>
+#include <route.h>
+#include <strafe.h>
+#include <movement.h>
+#include <work_pool.h>
+#include <code_index.h>
 
 #include "state.h"
 #include "steam.h"
 #include "hooks.h"
+#include "determinism.h"
+#include "gamelog.h"
+#include "memory.h"
+#include "overlay.h"
+#include "packages.h"
 #include "window.h"
+#include "watches.h"
+#include "tracing.h"
+#include "reflection.h"
 
 namespace {
 
-struct vec3 {
-    float x, y, z;
-};
-
-struct rot3 {
-    int x, y, z;
-};
-
-struct game_state {
-    vec3* Position;
-    vec3* Velocity;
-    rot3* Rotation;
-};
-
-game_state get_game_state(){
-    char* PlayerPawn;
-    char* PlayerController;
-
-    auto Base = static_cast<char*>(GameModule.lpBaseOfDll);
-
-    switch(GameVersion){
-        case game_version::V12: {
-            PlayerPawn = *reinterpret_cast<char**>(Base+0x1052DE8);
-            PlayerController = *reinterpret_cast<char**>(Base+0x1052DD4);
-
-            break;
-        }
-        case game_version::V14: {
-            PlayerPawn = *reinterpret_cast<char**>(Base+0x1052DE8);
-            PlayerController = *reinterpret_cast<char**>(Base+0x1052DD4);
-
-            break;
-        }
-        default: {
-            std::abort();
-        }
-    }
-
-    return {
-        .Position = reinterpret_cast<vec3*>(PlayerPawn+0xC4),
-        .Velocity = reinterpret_cast<vec3*>(PlayerPawn+0x1B4),
-        .Rotation = reinterpret_cast<rot3*>(PlayerController+0xD0),
-    };
-}
-
 // Python stuff.
 struct py_object_deleter {
     void operator()(PyObject* p){
@@ -136,6 +114,48 @@ PyObject* py_set_frame_wait(PyObject*, PyObject* Args, PyObject *Kwargs){
     return Py_None;
 }
 
+PyObject* py_set_message_interval(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwInterval[] = "interval";
+    char* Kw[] = {KwInterval, nullptr};
+
+    int Interval;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "i:set_message_interval", Kw, &Interval)){
+        return nullptr;
+    }
+
+    if(Interval < 1){
+        PyErr_SetString(PyExc_ValueError, "interval must be at least 1");
+        return nullptr;
+    }
+
+    set_message_interval(Interval);
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_set_movie_speed(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwSpeed[] = "speed";
+    char* Kw[] = {KwSpeed, nullptr};
+
+    const char* Speed;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:set_movie_speed", Kw, &Speed)){
+        return nullptr;
+    }
+
+    if(std::strcmp(Speed, "real") == 0){
+        MovieSpeed = movie_speed::Real;
+    }else if(std::strcmp(Speed, "fast") == 0){
+        MovieSpeed = movie_speed::Fast;
+    }else if(std::strcmp(Speed, "skip") == 0){
+        MovieSpeed = movie_speed::Skip;
+    }else{
+        PyErr_SetString(PyExc_ValueError, "invalid movie speed");
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
 PyObject* py_is_in_movie(PyObject*, PyObject*){
     return PyBool_FromLong(IsInMovie);
 }
@@ -155,8 +175,123 @@ PyObject* py_save_cloud(PyObject*, PyObject* Args, PyObject *Kwargs){
     return PyBool_FromLong(save_steam_cloud(Name.get()));
 }
 
+PyObject* py_save_documents(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    PyObject* NameObj;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "U:save_documents", Kw, &NameObj)){
+        return nullptr;
+    }
+
+    unique_pymem<wchar_t[]> Name(PyUnicode_AsWideCharString(NameObj, nullptr));
+    assert(Name != nullptr);
+
+    return PyBool_FromLong(save_overlay(Name.get()));
+}
+
+PyObject* py_game_log(PyObject*, PyObject*){
+    auto Log = game_log();
+    return PyUnicode_DecodeUTF8(Log.data(), static_cast<Py_ssize_t>(Log.size()), "replace");
+}
+
+PyObject* py_save_game_log(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    PyObject* NameObj;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "U:save_game_log", Kw, &NameObj)){
+        return nullptr;
+    }
+
+    unique_pymem<wchar_t[]> Name(PyUnicode_AsWideCharString(NameObj, nullptr));
+    assert(Name != nullptr);
+
+    return PyBool_FromLong(save_game_log(Name.get()));
+}
+
+PyObject* py_package_loads(PyObject*, PyObject*){
+    auto Loads = package_loads();
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Loads.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Loads.size(); ++i){
+        auto Item = Py_BuildValue(
+            "(sdKK)", Loads[i].Level.c_str(), Loads[i].Seconds,
+            static_cast<unsigned long long>(Loads[i].Reads), static_cast<unsigned long long>(Loads[i].Hits)
+        );
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_flush_cloud(PyObject*, PyObject*){
+    try {
+        flush_steam_cloud();
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_OSError, e.what());
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_save_cloud_snapshot(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:save_cloud_snapshot", Kw, &Name)){
+        return nullptr;
+    }
+
+    save_cloud_snapshot(Name);
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_load_cloud_snapshot(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:load_cloud_snapshot", Kw, &Name)){
+        return nullptr;
+    }
+
+    if(!load_cloud_snapshot(Name)){
+        PyErr_SetString(PyExc_KeyError, Name);
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_delete_cloud_snapshot(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:delete_cloud_snapshot", Kw, &Name)){
+        return nullptr;
+    }
+
+    return PyBool_FromLong(delete_cloud_snapshot(Name));
+}
+
 PyObject* py_save_state(PyObject*, PyObject*){
-    auto [p, v, r] = get_game_state();
+    auto State = get_game_state();
+    auto p = State.Position;
+    auto v = State.Velocity;
+    auto r = State.Rotation;
     auto& Gamepad = XInputState.Gamepad;
     return Py_BuildValue("{s(fff)s(fff)s(iii)s(IIIIIIII)s(ii)s(iiiiiii)}",
         "position", p->x, p->y, p->z,
@@ -197,10 +332,10 @@ PyObject* py_load_state(PyObject*, PyObject* Args, PyObject *Kwargs){
         return nullptr;
     }
 
-    auto [p, v, r] = get_game_state();
-    *p = {px, py, pz};
-    *v = {vx, vy, vz};
-    *r = {rx, ry, rz};
+    auto State = get_game_state();
+    *State.Position = {px, py, pz};
+    *State.Velocity = {vx, vy, vz};
+    *State.Rotation = {rx, ry, rz};
 
     for(int i = 0; auto& Keys:KeyState){
         for(std::uint32_t m = 1; m != 0; m <<= 1, ++i){
@@ -223,6 +358,229 @@ PyObject* py_load_state(PyObject*, PyObject* Args, PyObject *Kwargs){
     return Py_None;
 }
 
+PyObject* build_memory_stats(const mmtl::snapshot_stats& Stats){
+    return Py_BuildValue("{snsnsnsn}",
+        "pages", static_cast<Py_ssize_t>(Stats.Pages),
+        "copied", static_cast<Py_ssize_t>(Stats.Copied),
+        "written", static_cast<Py_ssize_t>(Stats.Written),
+        "missing", static_cast<Py_ssize_t>(Stats.Missing)
+    );
+}
+
+PyObject* py_save_memory(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:save_memory", Kw, &Name)){
+        return nullptr;
+    }
+
+    mmtl::snapshot_stats Stats;
+    try {
+        Stats = save_memory(Name);
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+
+    return build_memory_stats(Stats);
+}
+
+PyObject* py_load_memory(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:load_memory", Kw, &Name)){
+        return nullptr;
+    }
+
+    mmtl::snapshot_stats Stats;
+    try {
+        if(!load_memory(Name, Stats)){
+            PyErr_SetString(PyExc_KeyError, Name);
+            return nullptr;
+        }
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+
+    return build_memory_stats(Stats);
+}
+
+PyObject* py_delete_memory(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:delete_memory", Kw, &Name)){
+        return nullptr;
+    }
+
+    return PyBool_FromLong(delete_memory(Name));
+}
+
+PyObject* py_set_memory_cache(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwBudget[] = "budget";
+    static char KwMemory[] = "memory";
+    char* Kw[] = {KwBudget, KwMemory, nullptr};
+
+    Py_ssize_t Budget;
+    Py_ssize_t Memory = Py_ssize_t(256) << 20;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "n|$n:set_memory_cache", Kw, &Budget, &Memory)){
+        return nullptr;
+    }
+
+    if(Budget < 0 || Memory < 0){
+        PyErr_SetString(PyExc_ValueError, "budgets can not be negative");
+        return nullptr;
+    }
+
+    try {
+        set_memory_cache(static_cast<std::size_t>(Budget), static_cast<std::size_t>(Memory));
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_get_memory_stats(PyObject*, PyObject*){
+    memory_cache_stats Stats;
+    try {
+        Stats = get_memory_cache_stats();
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+
+    return Py_BuildValue("{snsnsnsnsnsnsn}",
+        "snapshots", static_cast<Py_ssize_t>(Stats.Snapshots),
+        "pages", static_cast<Py_ssize_t>(Stats.Store.Pages),
+        "references", static_cast<Py_ssize_t>(Stats.Store.References),
+        "compressed", static_cast<Py_ssize_t>(Stats.Store.Compressed),
+        "spilled", static_cast<Py_ssize_t>(Stats.Store.Spilled),
+        "memory_bytes", static_cast<Py_ssize_t>(Stats.Store.MemoryBytes),
+        "spill_bytes", static_cast<Py_ssize_t>(Stats.Store.SpillBytes)
+    );
+}
+
+PyObject* py_memory_view(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    static char KwSize[] = "size";
+    static char KwWritable[] = "writable";
+    char* Kw[] = {KwAddress, KwSize, KwWritable, nullptr};
+
+    unsigned long long Address;
+    Py_ssize_t Size;
+    int Writable = 0;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "Kn|$p:memory_view", Kw, &Address, &Size, &Writable)){
+        return nullptr;
+    }
+
+    if(Size <= 0 || Address > UINTPTR_MAX || Address+Size-1 > UINTPTR_MAX){
+        PyErr_SetString(PyExc_ValueError, "invalid range");
+        return nullptr;
+    }
+
+    if(!is_accessible(static_cast<std::uintptr_t>(Address), static_cast<std::size_t>(Size), Writable != 0)){
+        char Message[64];
+        std::snprintf(Message, sizeof(Message), "0x%llx-0x%llx is not %s",
+            Address, Address+Size, Writable?"writable":"readable");
+
+        PyErr_SetString(PyExc_ValueError, Message);
+        return nullptr;
+    }
+
+    // Not copied, so the view is only as good as this check. Reads through it after the game frees
+    // the memory fault like the game's own would.
+    return PyMemoryView_FromMemory(reinterpret_cast<char*>(static_cast<std::uintptr_t>(Address)), Size, Writable?PyBUF_WRITE:PyBUF_READ);
+}
+
+PyObject* py_start_hash_log(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPath[] = "path";
+    char* Kw[] = {KwPath, nullptr};
+
+    PyObject* PathObj;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "U:start_hash_log", Kw, &PathObj)){
+        return nullptr;
+    }
+
+    unique_pymem<wchar_t[]> Path(PyUnicode_AsWideCharString(PathObj, nullptr));
+    if(!Path){
+        return nullptr;
+    }
+
+    try {
+        start_hash_log(Path.get());
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_OSError, e.what());
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_stop_hash_log(PyObject*, PyObject*){
+    stop_hash_log();
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_set_hash_region(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    static char KwAddress[] = "address";
+    static char KwSize[] = "size";
+    char* Kw[] = {KwName, KwAddress, KwSize, nullptr};
+
+    const char* Name;
+    unsigned long long Address;
+    Py_ssize_t Size;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "sKn:set_hash_region", Kw, &Name, &Address, &Size)){
+        return nullptr;
+    }
+
+    if(Size <= 0 || Address > UINTPTR_MAX || Address+Size-1 > UINTPTR_MAX){
+        PyErr_SetString(PyExc_ValueError, "invalid range");
+        return nullptr;
+    }
+
+    set_hash_region(Name, static_cast<std::uintptr_t>(Address), static_cast<std::size_t>(Size));
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_remove_hash_region(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:remove_hash_region", Kw, &Name)){
+        return nullptr;
+    }
+
+    return PyBool_FromLong(remove_hash_region(Name));
+}
+
+PyObject* py_get_frame_hashes(PyObject*, PyObject*){
+    py_object r(PyDict_New());
+    if(!r){
+        return nullptr;
+    }
+
+    for(auto& [Name, Hash]:get_frame_hashes()){
+        py_object Value(PyLong_FromUnsignedLongLong(Hash));
+        if(!Value || PyDict_SetItemString(r, Name.c_str(), Value) != 0){
+            return nullptr;
+        }
+    }
+
+    return r.release();
+}
+
 PyObject* py_get_mouse_pos(PyObject*, PyObject*){
     py_object x(PyLong_FromLong(CursorPos.x));
     py_object y(PyLong_FromLong(CursorPos.y));
@@ -501,45 +859,1742 @@ PyObject* py_set_gamepad_button(PyObject*, PyObject* Args, PyObject *Kwargs){
     return Py_None;
 }
 
-PyObject* init_pytas_module(){
-    static PyMethodDef Methods[] = {
-        {
-            "set_frame_time", reinterpret_cast<PyCFunction>(py_set_frame_time), METH_VARARGS|METH_KEYWORDS,
-            "Set the frame time.",
-        },
-        {
-            "get_frame_time", py_get_frame_time, METH_NOARGS,
-            "Get the frame time.",
-        },
-        {
-            "set_frame_wait", reinterpret_cast<PyCFunction>(py_set_frame_wait), METH_VARARGS|METH_KEYWORDS,
-            "Set the frame time.",
-        },
-        {
-            "is_in_movie", py_is_in_movie, METH_NOARGS,
-            "Tell whether the game is in a movie.",
-        },
-        {
-            "save_cloud", reinterpret_cast<PyCFunction>(py_save_cloud), METH_VARARGS|METH_KEYWORDS,
-            "Save the steam cloud to a folder.",
-        },
-        {
-            "save_state", py_save_state, METH_NOARGS,
-            "Save the current state.",
-        },
-        {
-            "load_state", reinterpret_cast<PyCFunction>(py_load_state), METH_VARARGS|METH_KEYWORDS,
-            "Load a previously saved state.",
-        },
-        {
-            "get_mouse_pos", py_get_mouse_pos, METH_NOARGS,
-            "Get the mouse location.",
-        },
-        {
-            "get_key_events", py_get_key_events, METH_NOARGS,
-            "Get key events since last frame.",
-        },
-        {
+PyObject* py_get_frame_count(PyObject*, PyObject*){
+    return PyLong_FromUnsignedLongLong(FrameCount);
+}
+
+// A negative frame means the current one.
+bool get_schedule_time(long long Frame, long long Offset, std::uint64_t* Out){
+    if(Frame < 0){
+        Frame = static_cast<long long>(FrameCount);
+    }
+
+    if(static_cast<std::uint64_t>(Frame) < FrameCount){
+        PyErr_SetString(PyExc_ValueError, "Cannot schedule input for a past frame.");
+        return false;
+    }
+
+    if(Offset < 0){
+        PyErr_SetString(PyExc_ValueError, "Offset must not be negative.");
+        return false;
+    }
+
+    *Out = static_cast<std::uint64_t>(Frame);
+
+    return true;
+}
+
+PyObject* py_schedule_key(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwKey[] = "key";
+    static char KwDown[] = "down";
+    static char KwFrame[] = "frame";
+    static char KwOffset[] = "offset";
+    char* Kw[] = {KwKey, KwDown, KwFrame, KwOffset, nullptr};
+
+    int Key = 0, Down = 0;
+    long long Frame = -1, Offset = 0;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "ip|$LL:schedule_key", Kw,
+            &Key, &Down, &Frame, &Offset)){
+        return nullptr;
+    }
+
+    // Checked now rather than when it is delivered, which may be far into the run.
+    if(Key < 0 || Key >= 256){
+        PyErr_SetString(PyExc_ValueError, "key must be a virtual key code below 256");
+        return nullptr;
+    }
+
+    std::uint64_t At;
+    if(!get_schedule_time(Frame, Offset, &At)){
+        return nullptr;
+    }
+
+    schedule_key(At, Offset, Key, Down != 0);
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_schedule_mouse(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwX[] = "x";
+    static char KwY[] = "y";
+    static char KwFrame[] = "frame";
+    static char KwOffset[] = "offset";
+    char* Kw[] = {KwX, KwY, KwFrame, KwOffset, nullptr};
+
+    int x = 0, y = 0;
+    long long Frame = -1, Offset = 0;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "|ii$LL:schedule_mouse", Kw,
+            &x, &y, &Frame, &Offset)){
+        return nullptr;
+    }
+
+    std::uint64_t At;
+    if(!get_schedule_time(Frame, Offset, &At)){
+        return nullptr;
+    }
+
+    schedule_move(At, Offset, x, y);
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_schedule_scroll(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwValue[] = "value";
+    static char KwFrame[] = "frame";
+    static char KwOffset[] = "offset";
+    char* Kw[] = {KwValue, KwFrame, KwOffset, nullptr};
+
+    double Value = 0.0;
+    long long Frame = -1, Offset = 0;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "d|$LL:schedule_scroll", Kw,
+            &Value, &Frame, &Offset)){
+        return nullptr;
+    }
+
+    std::uint64_t At;
+    if(!get_schedule_time(Frame, Offset, &At)){
+        return nullptr;
+    }
+
+    auto Delta = static_cast<std::int16_t>(
+        std::clamp(std::round(WHEEL_DELTA*Value), -32768.0, 32767.0));
+
+    schedule_scroll(At, Offset, Delta);
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_get_scheduled_count(PyObject*, PyObject*){
+    return PyLong_FromSize_t(scheduled_count());
+}
+
+PyObject* py_clear_schedule(PyObject*, PyObject*){
+    clear_schedule();
+
+    Py_RETURN_NONE;
+}
+
+// Movement simulation.
+bool parse_vec2(PyObject* Object, mvmt::vec2& r){
+    return PyArg_Parse(Object, "(ff)", &r.x, &r.y) != 0;
+}
+
+PyObject* build_state(const mvmt::state& State){
+    return Py_BuildValue("((ff)(ff))",
+        State.Position.x, State.Position.y, State.Velocity.x, State.Velocity.y);
+}
+
+// Parse a sequence of vectors, failing unless it has `Size` elements when `Size` is not 0.
+bool parse_vec2_list(PyObject* Object, std::vector<mvmt::vec2>& r, std::size_t Size = 0){
+    py_object Seq(PySequence_Fast(Object, "expected a sequence of 2D vectors"));
+    if(!Seq){
+        return false;
+    }
+
+    auto Count = static_cast<std::size_t>(PySequence_Fast_GET_SIZE(Seq.get()));
+    if(Size != 0 && Count != Size){
+        PyErr_SetString(PyExc_ValueError, "sequences must have the same length");
+        return false;
+    }
+
+    r.resize(Count);
+    for(std::size_t i = 0; i < Count; ++i){
+        if(!parse_vec2(PySequence_Fast_GET_ITEM(Seq.get(), i), r[i])){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+PyObject* py_simulate_movement(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPosition[] = "position";
+    static char KwVelocity[] = "velocity";
+    static char KwAccelerations[] = "accelerations";
+    static char KwDt[] = "dt";
+    static char KwScale[] = "scale";
+    static char KwFriction[] = "friction";
+    char* Kw[] = {KwPosition, KwVelocity, KwAccelerations, KwDt, KwScale, KwFriction, nullptr};
+
+    PyObject* pPosition;
+    PyObject* pVelocity;
+    PyObject* pAccelerations;
+    mvmt::params Params = {};
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "OOOf|ff:simulate_movement", Kw,
+            &pPosition, &pVelocity, &pAccelerations,
+            &Params.DeltaTime, &Params.SpeedScale, &Params.Friction)){
+        return nullptr;
+    }
+
+    mvmt::state State;
+    std::vector<mvmt::vec2> Accelerations;
+    if(
+        !parse_vec2(pPosition, State.Position) || !parse_vec2(pVelocity, State.Velocity) ||
+        !parse_vec2_list(pAccelerations, Accelerations)
+    ){
+        return nullptr;
+    }
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Accelerations.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Accelerations.size(); ++i){
+        State = mvmt::step(State, Accelerations[i], Params);
+
+        auto Item = build_state(State);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), i, Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_simulate_movement_batch(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPositions[] = "positions";
+    static char KwVelocities[] = "velocities";
+    static char KwAccelerations[] = "accelerations";
+    static char KwDt[] = "dt";
+    static char KwScale[] = "scale";
+    static char KwFriction[] = "friction";
+    static char KwFrames[] = "frames";
+    char* Kw[] = {
+        KwPositions, KwVelocities, KwAccelerations, KwDt, KwScale, KwFriction, KwFrames, nullptr,
+    };
+
+    PyObject* pPositions;
+    PyObject* pVelocities;
+    PyObject* pAccelerations;
+    mvmt::params Params = {};
+    int Frames = 1;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "OOOf|ff$i:simulate_movement_batch", Kw,
+            &pPositions, &pVelocities, &pAccelerations,
+            &Params.DeltaTime, &Params.SpeedScale, &Params.Friction, &Frames)){
+        return nullptr;
+    }
+
+    std::vector<mvmt::vec2> Positions, Velocities, Accelerations;
+    if(!parse_vec2_list(pPositions, Positions)){
+        return nullptr;
+    }
+
+    auto Size = Positions.size();
+    if(Size == 0){
+        return PyList_New(0);
+    }
+
+    if(
+        !parse_vec2_list(pVelocities, Velocities, Size) ||
+        !parse_vec2_list(pAccelerations, Accelerations, Size)
+    ){
+        return nullptr;
+    }
+
+    mvmt::batch Batch(Size);
+    std::vector<float> AccelX(Size), AccelY(Size);
+
+    for(std::size_t i = 0; i < Size; ++i){
+        Batch.set(i, {Positions[i], Velocities[i]});
+
+        AccelX[i] = Accelerations[i].x;
+        AccelY[i] = Accelerations[i].y;
+    }
+
+    for(int n = 0; n < Frames; ++n){
+        mvmt::step(Batch.view(), AccelX.data(), AccelY.data(), Params);
+    }
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Size)));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Size; ++i){
+        auto Item = build_state(Batch.get(i));
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), i, Item);
+    }
+
+    return r.release();
+}
+
+// Parse a sequence of integers.
+bool parse_int_list(PyObject* Object, std::vector<long long>& r){
+    py_object Seq(PySequence_Fast(Object, "expected a sequence of integers"));
+    if(!Seq){
+        return false;
+    }
+
+    auto Count = static_cast<std::size_t>(PySequence_Fast_GET_SIZE(Seq.get()));
+
+    r.resize(Count);
+    for(std::size_t i = 0; i < Count; ++i){
+        r[i] = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(Seq.get(), i));
+        if(r[i] == -1 && PyErr_Occurred()){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// The buffer returned by `get_watches`, kept up to date every frame once it exists.
+constinit py_object WatchArray = nullptr;
+
+bool update_watch_array(){
+    if(!WatchArray){
+        return true;
+    }
+
+    auto Buffer = get_watch_buffer();
+
+    // A script may still hold a memoryview of the old buffer, which can't be resized then. It keeps
+    // the old one, and `get_watches` returns the new one from now on.
+    if(static_cast<std::size_t>(PyByteArray_GET_SIZE(WatchArray.get())) != Buffer.size()){
+        py_object Fresh(PyByteArray_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(Buffer.size())));
+        if(!Fresh){
+            return false;
+        }
+
+        WatchArray = std::move(Fresh);
+    }
+
+    std::copy(Buffer.begin(), Buffer.end(), reinterpret_cast<std::byte*>(PyByteArray_AS_STRING(WatchArray.get())));
+
+    return true;
+}
+
+// `struct` format characters for each `mmtl::value_type`.
+constexpr char WatchFormats[] = "bBhHiIqQfdP";
+
+PyObject* py_add_watch(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    static char KwBase[] = "base";
+    static char KwOffsets[] = "offsets";
+    static char KwType[] = "type";
+    static char KwRelative[] = "relative";
+    char* Kw[] = {KwName, KwBase, KwOffsets, KwType, KwRelative, nullptr};
+
+    const char* Name;
+    unsigned long long Base;
+    PyObject* OffsetsObject;
+    const char* TypeName;
+    int Relative = 1;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "sKOs|$p:add_watch", Kw, &Name, &Base, &OffsetsObject, &TypeName, &Relative)){
+        return nullptr;
+    }
+
+    std::vector<long long> Offsets;
+    if(!parse_int_list(OffsetsObject, Offsets)){
+        return nullptr;
+    }
+
+    if(Offsets.empty()){
+        PyErr_SetString(PyExc_ValueError, "offsets must not be empty");
+        return nullptr;
+    }
+
+    auto Type = mmtl::parse_value_type(TypeName);
+    if(!Type){
+        PyErr_SetString(PyExc_ValueError, "invalid type");
+        return nullptr;
+    }
+
+    if(Relative){
+        Base += reinterpret_cast<std::uintptr_t>(GameModule.lpBaseOfDll);
+    }
+
+    if(Base > UINTPTR_MAX){
+        PyErr_SetString(PyExc_ValueError, "invalid base");
+        return nullptr;
+    }
+
+    add_watch({
+        Name, static_cast<std::uintptr_t>(Base),
+        std::vector<std::ptrdiff_t>(Offsets.begin(), Offsets.end()), *Type,
+    });
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_remove_watch(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:remove_watch", Kw, &Name)){
+        return nullptr;
+    }
+
+    return PyBool_FromLong(remove_watch(Name));
+}
+
+PyObject* py_clear_watches(PyObject*, PyObject*){
+    clear_watches();
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_refresh_watches(PyObject*, PyObject*){
+    invalidate_watches();
+    read_watches();
+
+    if(!update_watch_array()){
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_get_watches(PyObject*, PyObject*){
+    if(!WatchArray){
+        WatchArray = py_object(PyByteArray_FromStringAndSize(nullptr, 0));
+        if(!WatchArray || !update_watch_array()){
+            WatchArray = nullptr;
+            return nullptr;
+        }
+    }
+
+    Py_INCREF(WatchArray.get());
+    return WatchArray.get();
+}
+
+PyObject* py_get_watch_layout(PyObject*, PyObject*){
+    py_object r(PyDict_New());
+    if(!r){
+        return nullptr;
+    }
+
+    auto& Watches = get_watches();
+    auto& Plan = get_watch_plan();
+
+    for(std::size_t i = 0; i < Watches.size(); ++i){
+        char Format[2] = {WatchFormats[static_cast<std::size_t>(Watches[i].Type)], 0};
+
+        py_object Value(Py_BuildValue("(nsn)",
+            static_cast<Py_ssize_t>(Plan.value_offset(i)), Format, static_cast<Py_ssize_t>(Plan.valid_offset(i))
+        ));
+        if(!Value || PyDict_SetItemString(r, Watches[i].Name.c_str(), Value) != 0){
+            return nullptr;
+        }
+    }
+
+    return r.release();
+}
+
+// Converts a value read from memory to a Python int or float.
+PyObject* value_to_python(mmtl::value_type Type, const std::byte* Data){
+    auto get = [&]<typename T>(T Value){
+        std::memcpy(&Value, Data, sizeof(Value));
+        return Value;
+    };
+
+    switch(Type){
+        case mmtl::value_type::I8: {
+            return PyLong_FromLong(get(std::int8_t()));
+        }
+        case mmtl::value_type::U8: {
+            return PyLong_FromUnsignedLong(get(std::uint8_t()));
+        }
+        case mmtl::value_type::I16: {
+            return PyLong_FromLong(get(std::int16_t()));
+        }
+        case mmtl::value_type::U16: {
+            return PyLong_FromUnsignedLong(get(std::uint16_t()));
+        }
+        case mmtl::value_type::I32: {
+            return PyLong_FromLong(get(std::int32_t()));
+        }
+        case mmtl::value_type::U32: {
+            return PyLong_FromUnsignedLong(get(std::uint32_t()));
+        }
+        case mmtl::value_type::I64: {
+            return PyLong_FromLongLong(get(std::int64_t()));
+        }
+        case mmtl::value_type::U64: {
+            return PyLong_FromUnsignedLongLong(get(std::uint64_t()));
+        }
+        case mmtl::value_type::F32: {
+            return PyFloat_FromDouble(get(float()));
+        }
+        case mmtl::value_type::F64: {
+            return PyFloat_FromDouble(get(double()));
+        }
+        case mmtl::value_type::Pointer: {
+            return PyLong_FromUnsignedLongLong(get(std::uintptr_t()));
+        }
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_get_watch(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwName[] = "name";
+    char* Kw[] = {KwName, nullptr};
+
+    const char* Name;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:get_watch", Kw, &Name)){
+        return nullptr;
+    }
+
+    auto& Watches = get_watches();
+
+    auto it = std::find_if(Watches.begin(), Watches.end(), [&](auto& e){ return e.Name == Name; });
+    if(it == Watches.end()){
+        PyErr_SetString(PyExc_KeyError, Name);
+        return nullptr;
+    }
+
+    auto i = static_cast<std::size_t>(it-Watches.begin());
+    auto& Plan = get_watch_plan();
+    auto Buffer = get_watch_buffer();
+
+    if(Buffer[Plan.valid_offset(i)] == std::byte(0)){
+        Py_RETURN_NONE;
+    }
+
+    return value_to_python(it->Type, Buffer.data()+Plan.value_offset(i));
+}
+
+PyObject* py_start_trace(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPath[] = "path";
+    static char KwWatches[] = "watches";
+    char* Kw[] = {KwPath, KwWatches, nullptr};
+
+    PyObject* PathObj;
+    PyObject* WatchesObj = Py_None;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "U|O:start_trace", Kw, &PathObj, &WatchesObj)){
+        return nullptr;
+    }
+
+    unique_pymem<wchar_t[]> Path(PyUnicode_AsWideCharString(PathObj, nullptr));
+    if(!Path){
+        return nullptr;
+    }
+
+    std::vector<std::string> Names;
+    if(WatchesObj != Py_None){
+        py_object Seq(PySequence_Fast(WatchesObj, "expected a sequence of watch names"));
+        if(!Seq){
+            return nullptr;
+        }
+
+        for(Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(Seq.get()); ++i){
+            auto Name = PyUnicode_AsUTF8(PySequence_Fast_GET_ITEM(Seq.get(), i));
+            if(!Name){
+                return nullptr;
+            }
+
+            Names.push_back(Name);
+        }
+
+        if(Names.empty()){
+            PyErr_SetString(PyExc_ValueError, "watches must not be empty");
+            return nullptr;
+        }
+    }
+
+    try {
+        start_trace(Path.get(), Names);
+    }catch(std::invalid_argument& e){
+        PyErr_SetString(PyExc_KeyError, e.what());
+        return nullptr;
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_OSError, e.what());
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_stop_trace(PyObject*, PyObject*){
+    stop_trace();
+
+    Py_RETURN_NONE;
+}
+
+PyObject* py_flush_trace(PyObject*, PyObject*){
+    flush_trace();
+
+    Py_RETURN_NONE;
+}
+
+// Created on first use, scans are split between its threads.
+std::unique_ptr<work_pool> ScanPool = nullptr;
+std::unique_ptr<mmtl::scanner> Scanner = nullptr;
+
+// An unknown first scan copies what it scans, which has to fit next to the game in 32 bits.
+constexpr std::size_t ScanMemoryLimit = 256 << 20;
+
+// Converts a Python int or float to the raw bits of a value.
+bool value_from_python(PyObject* Object, mmtl::value_type Type, std::uint64_t& r){
+    r = 0;
+
+    if(Type == mmtl::value_type::F32 || Type == mmtl::value_type::F64){
+        auto Value = PyFloat_AsDouble(Object);
+        if(Value == -1.0 && PyErr_Occurred()){
+            return false;
+        }
+
+        if(Type == mmtl::value_type::F32){
+            auto Float = static_cast<float>(Value);
+            std::memcpy(&r, &Float, sizeof(Float));
+        }else{
+            std::memcpy(&r, &Value, sizeof(Value));
+        }
+
+        return true;
+    }
+
+    // Negative numbers end up as two's complement, which is what signed values are compared as.
+    r = PyLong_AsUnsignedLongLongMask(Object);
+    if(r == static_cast<std::uint64_t>(-1) && PyErr_Occurred()){
+        return false;
+    }
+
+    return true;
+}
+
+bool parse_scan_compare(const char* Name, mmtl::scan_compare& r){
+    auto Compare = mmtl::parse_scan_compare(Name);
+    if(!Compare){
+        PyErr_SetString(PyExc_ValueError, "invalid comparison");
+        return false;
+    }
+
+    r = *Compare;
+    return true;
+}
+
+PyObject* py_scan_first(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwType[] = "type";
+    static char KwCompare[] = "compare";
+    static char KwValue[] = "value";
+    char* Kw[] = {KwType, KwCompare, KwValue, nullptr};
+
+    const char* TypeName;
+    const char* CompareName = "exact";
+    PyObject* ValueObj = Py_None;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s|sO:scan_first", Kw, &TypeName, &CompareName, &ValueObj)){
+        return nullptr;
+    }
+
+    auto Type = mmtl::parse_value_type(TypeName);
+    if(!Type){
+        PyErr_SetString(PyExc_ValueError, "invalid type");
+        return nullptr;
+    }
+
+    mmtl::scan_compare Compare;
+    if(!parse_scan_compare(CompareName, Compare)){
+        return nullptr;
+    }
+
+    if((Compare == mmtl::scan_compare::Exact) != (ValueObj != Py_None)){
+        PyErr_SetString(PyExc_ValueError, "a value is needed for exact scans, and only for those");
+        return nullptr;
+    }
+
+    std::uint64_t Value = 0;
+    if(ValueObj != Py_None && !value_from_python(ValueObj, *Type, Value)){
+        return nullptr;
+    }
+
+    if(!Scanner){
+        ScanPool = std::make_unique<work_pool>();
+        Scanner = std::make_unique<mmtl::scanner>(ScanPool.get());
+        Scanner->set_memory_limit(ScanMemoryLimit);
+    }
+
+    // Checked like the next scans, in case the game freed memory since the regions were listed.
+    auto Regions = game_regions();
+
+    mmtl::readable_map Map;
+    Map.refresh();
+
+    try {
+        Scanner->first_scan(Regions, *Type, Compare, Value, &Map);
+    }catch(std::length_error& e){
+        PyErr_SetString(PyExc_MemoryError, e.what());
+        return nullptr;
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_ValueError, e.what());
+        return nullptr;
+    }
+
+    return PyLong_FromSize_t(Scanner->count());
+}
+
+PyObject* py_scan_next(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwCompare[] = "compare";
+    static char KwValue[] = "value";
+    char* Kw[] = {KwCompare, KwValue, nullptr};
+
+    const char* CompareName;
+    PyObject* ValueObj = Py_None;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s|O:scan_next", Kw, &CompareName, &ValueObj)){
+        return nullptr;
+    }
+
+    if(!Scanner || !Scanner->started()){
+        PyErr_SetString(PyExc_RuntimeError, "no first scan");
+        return nullptr;
+    }
+
+    mmtl::scan_compare Compare;
+    if(!parse_scan_compare(CompareName, Compare)){
+        return nullptr;
+    }
+
+    if((Compare == mmtl::scan_compare::Exact) != (ValueObj != Py_None)){
+        PyErr_SetString(PyExc_ValueError, "a value is needed for exact scans, and only for those");
+        return nullptr;
+    }
+
+    std::uint64_t Value = 0;
+    if(ValueObj != Py_None && !value_from_python(ValueObj, Scanner->type(), Value)){
+        return nullptr;
+    }
+
+    // The game may have freed some of the memory since the last scan.
+    mmtl::readable_map Map;
+    Map.refresh();
+
+    Scanner->next_scan(Compare, Value, &Map);
+
+    return PyLong_FromSize_t(Scanner->count());
+}
+
+PyObject* py_scan_results(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwMax[] = "max";
+    char* Kw[] = {KwMax, nullptr};
+
+    Py_ssize_t Max = 100;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "|n:scan_results", Kw, &Max)){
+        return nullptr;
+    }
+
+    if(Max < 0){
+        PyErr_SetString(PyExc_ValueError, "max must not be negative");
+        return nullptr;
+    }
+
+    std::vector<mmtl::scan_result> Results;
+    if(Scanner){
+        Results = Scanner->results(static_cast<std::size_t>(Max));
+    }
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Results.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Results.size(); ++i){
+        py_object Value(value_to_python(Scanner->type(), reinterpret_cast<const std::byte*>(&Results[i].Value)));
+        if(!Value){
+            return nullptr;
+        }
+
+        auto Item = Py_BuildValue("(KO)", static_cast<unsigned long long>(Results[i].Address), Value.get());
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_scan_reset(PyObject*, PyObject*){
+    if(Scanner){
+        Scanner->reset();
+    }
+
+    Py_RETURN_NONE;
+}
+
+// Loaded by `load_code_index`. Addresses in it are RVAs, Python sees the game's addresses.
+std::unique_ptr<mmtl::code_index> CodeIndex = nullptr;
+
+std::uintptr_t game_base(){
+    return reinterpret_cast<std::uintptr_t>(GameModule.lpBaseOfDll);
+}
+
+// The RVA of an address in the game, or false with an exception set.
+bool code_rva(unsigned long long Address, std::uint32_t& r){
+    if(!CodeIndex){
+        PyErr_SetString(PyExc_RuntimeError, "no code index loaded");
+        return false;
+    }
+
+    if(Address < game_base() || Address-game_base() >= GameModule.SizeOfImage){
+        PyErr_SetString(PyExc_ValueError, "address is not in the game");
+        return false;
+    }
+
+    r = static_cast<std::uint32_t>(Address-game_base());
+    return true;
+}
+
+PyObject* rvas_to_python(const std::vector<std::uint32_t>& Rvas){
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Rvas.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Rvas.size(); ++i){
+        auto Item = PyLong_FromUnsignedLongLong(game_base()+Rvas[i]);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_load_code_index(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPath[] = "path";
+    char* Kw[] = {KwPath, nullptr};
+
+    PyObject* PathObj;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "U:load_code_index", Kw, &PathObj)){
+        return nullptr;
+    }
+
+    unique_pymem<wchar_t[]> Path(PyUnicode_AsWideCharString(PathObj, nullptr));
+    if(!Path){
+        return nullptr;
+    }
+
+    std::unique_ptr<mmtl::code_index> Index;
+    std::uint32_t TimeDateStamp;
+    try {
+        Index = std::make_unique<mmtl::code_index>(Path.get());
+        TimeDateStamp = mmtl::pe_image(static_cast<const std::byte*>(GameModule.lpBaseOfDll), GameModule.SizeOfImage, true).TimeDateStamp;
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_OSError, e.what());
+        return nullptr;
+    }
+
+    if(Index->timestamp() != TimeDateStamp || Index->image_size() != GameModule.SizeOfImage){
+        PyErr_SetString(PyExc_ValueError, "the index is of another build of the game");
+        return nullptr;
+    }
+
+    CodeIndex = std::move(Index);
+
+    return PyLong_FromSize_t(CodeIndex->functions().size());
+}
+
+PyObject* py_code_function(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    char* Kw[] = {KwAddress, nullptr};
+
+    unsigned long long Address;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "K:code_function", Kw, &Address)){
+        return nullptr;
+    }
+
+    std::uint32_t Rva;
+    if(!code_rva(Address, Rva)){
+        return nullptr;
+    }
+
+    auto Function = CodeIndex->function_at(Rva);
+    if(!Function){
+        Py_RETURN_NONE;
+    }
+
+    return Py_BuildValue("(KK)", static_cast<unsigned long long>(game_base()+Function->Start),
+        static_cast<unsigned long long>(game_base()+Function->End));
+}
+
+PyObject* py_code_callers(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    char* Kw[] = {KwAddress, nullptr};
+
+    unsigned long long Address;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "K:code_callers", Kw, &Address)){
+        return nullptr;
+    }
+
+    std::uint32_t Rva;
+    if(!code_rva(Address, Rva)){
+        return nullptr;
+    }
+
+    return rvas_to_python(CodeIndex->callers(Rva));
+}
+
+PyObject* py_code_references(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    char* Kw[] = {KwAddress, nullptr};
+
+    unsigned long long Address;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "K:code_references", Kw, &Address)){
+        return nullptr;
+    }
+
+    std::uint32_t Rva;
+    if(!code_rva(Address, Rva)){
+        return nullptr;
+    }
+
+    auto References = CodeIndex->references_to(Rva);
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(References.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    constexpr const char* Kinds[] = {"call", "jump", "data"};
+
+    for(std::size_t i = 0; i < References.size(); ++i){
+        auto Item = Py_BuildValue("(Ks)", static_cast<unsigned long long>(game_base()+References[i].From),
+            Kinds[static_cast<std::size_t>(References[i].Kind)]);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_code_string_refs(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwText[] = "text";
+    char* Kw[] = {KwText, nullptr};
+
+    const char* Text;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:code_string_refs", Kw, &Text)){
+        return nullptr;
+    }
+
+    if(!CodeIndex){
+        PyErr_SetString(PyExc_RuntimeError, "no code index loaded");
+        return nullptr;
+    }
+
+    return rvas_to_python(CodeIndex->functions_referencing(Text));
+}
+
+// The reflection, or null with an exception set.
+mmtl::ue3_reflection* reflection(){
+    auto r = get_reflection();
+    if(!r){
+        PyErr_SetString(PyExc_RuntimeError, "ue3_init was not called");
+    }
+
+    return r;
+}
+
+PyObject* py_ue3_init(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwLayout[] = "layout";
+    static char KwObjects[] = "objects";
+    static char KwNames[] = "names";
+    char* Kw[] = {KwLayout, KwObjects, KwNames, nullptr};
+
+    PyObject* LayoutObj;
+    unsigned long long Objects = 0;
+    unsigned long long Names = 0;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "O|KK:ue3_init", Kw, &LayoutObj, &Objects, &Names)){
+        return nullptr;
+    }
+
+    struct field {
+        const char* Name;
+        std::uint32_t mmtl::ue3_layout::* Member;
+    };
+
+    static constexpr field Fields[] = {
+        {"object_index", &mmtl::ue3_layout::ObjectIndex},
+        {"object_outer", &mmtl::ue3_layout::ObjectOuter},
+        {"object_name", &mmtl::ue3_layout::ObjectName},
+        {"object_class", &mmtl::ue3_layout::ObjectClass},
+        {"field_next", &mmtl::ue3_layout::FieldNext},
+        {"struct_super", &mmtl::ue3_layout::StructSuper},
+        {"struct_children", &mmtl::ue3_layout::StructChildren},
+        {"property_array_dim", &mmtl::ue3_layout::PropertyArrayDim},
+        {"property_element_size", &mmtl::ue3_layout::PropertyElementSize},
+        {"property_offset", &mmtl::ue3_layout::PropertyOffset},
+        {"property_extra", &mmtl::ue3_layout::PropertyExtra},
+        {"name_entry_index", &mmtl::ue3_layout::NameEntryIndex},
+        {"name_entry_text", &mmtl::ue3_layout::NameEntryText},
+    };
+
+    // Every offset has to be given, they differ between builds and none are known to be right.
+    if(!PyDict_Check(LayoutObj)){
+        PyErr_SetString(PyExc_TypeError, "layout must be a dict");
+        return nullptr;
+    }
+
+    mmtl::ue3_layout Layout = {};
+    for(auto& e:Fields){
+        auto Value = PyDict_GetItemString(LayoutObj, e.Name);
+        if(!Value){
+            PyErr_Format(PyExc_ValueError, "layout is missing '%s'", e.Name);
+            return nullptr;
+        }
+
+        auto Offset = PyLong_AsUnsignedLong(Value);
+        if(Offset == static_cast<unsigned long>(-1) && PyErr_Occurred()){
+            return nullptr;
+        }
+
+        Layout.*(e.Member) = static_cast<std::uint32_t>(Offset);
+    }
+
+    if(PyDict_Size(LayoutObj) != static_cast<Py_ssize_t>(std::size(Fields))){
+        PyErr_SetString(PyExc_ValueError, "layout has unknown fields");
+        return nullptr;
+    }
+
+    try {
+        init_reflection(static_cast<std::uintptr_t>(Objects), static_cast<std::uintptr_t>(Names), Layout);
+    }catch(std::exception& e){
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return nullptr;
+    }
+
+    return PyLong_FromSize_t(get_reflection()->object_count());
+}
+
+PyObject* py_ue3_find(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPath[] = "path";
+    char* Kw[] = {KwPath, nullptr};
+
+    const char* Path;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:ue3_find", Kw, &Path)){
+        return nullptr;
+    }
+
+    auto Reflection = reflection();
+    if(!Reflection){
+        return nullptr;
+    }
+
+    auto Object = Reflection->find_object(Path);
+    if(Object == 0){
+        Py_RETURN_NONE;
+    }
+
+    return PyLong_FromUnsignedLongLong(Object);
+}
+
+PyObject* py_ue3_instances(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwClassName[] = "class_name";
+    char* Kw[] = {KwClassName, nullptr};
+
+    const char* ClassName;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s:ue3_instances", Kw, &ClassName)){
+        return nullptr;
+    }
+
+    auto Reflection = reflection();
+    if(!Reflection){
+        return nullptr;
+    }
+
+    auto Objects = Reflection->find_instances(ClassName);
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Objects.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Objects.size(); ++i){
+        auto Item = PyLong_FromUnsignedLongLong(Objects[i]);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_ue3_path(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    char* Kw[] = {KwAddress, nullptr};
+
+    unsigned long long Address;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "K:ue3_path", Kw, &Address)){
+        return nullptr;
+    }
+
+    auto Reflection = reflection();
+    if(!Reflection){
+        return nullptr;
+    }
+
+    auto Path = Reflection->path(static_cast<std::uintptr_t>(Address));
+    if(Path.empty()){
+        Py_RETURN_NONE;
+    }
+
+    return PyUnicode_FromStringAndSize(Path.data(), static_cast<Py_ssize_t>(Path.size()));
+}
+
+PyObject* py_ue3_properties(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    char* Kw[] = {KwAddress, nullptr};
+
+    unsigned long long Address;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "K:ue3_properties", Kw, &Address)){
+        return nullptr;
+    }
+
+    auto Reflection = reflection();
+    if(!Reflection){
+        return nullptr;
+    }
+
+    auto Class = Reflection->class_of(static_cast<std::uintptr_t>(Address));
+    if(Class == 0){
+        PyErr_SetString(PyExc_ValueError, "not an object");
+        return nullptr;
+    }
+
+    auto Properties = Reflection->properties(Class);
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Properties.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Properties.size(); ++i){
+        auto& e = Properties[i];
+        auto Item = Py_BuildValue("(ssIII)", e.Name.c_str(), e.Type.c_str(), e.Offset, e.ElementSize, e.ArrayDim);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* property_to_python(mmtl::ue3_reflection& Reflection, const mmtl::ue3_property& Property, std::uintptr_t Address, int Depth);
+
+// One element of a property at `Address`, null with an exception set if it can't be read.
+PyObject* element_to_python(mmtl::ue3_reflection& Reflection, const mmtl::ue3_property& Property, std::uintptr_t Address, int Depth){
+    auto read = [&]<typename T>(T& Value){
+        if(!read_memory(Address, &Value, sizeof(Value))){
+            PyErr_Format(PyExc_ValueError, "%s can not be read", Property.Name.c_str());
+            return false;
+        }
+
+        return true;
+    };
+
+    auto& Type = Property.Type;
+
+    if(Type == "FloatProperty"){
+        float Value;
+        return read(Value)?PyFloat_FromDouble(Value):nullptr;
+    }else if(Type == "IntProperty"){
+        std::int32_t Value;
+        return read(Value)?PyLong_FromLong(Value):nullptr;
+    }else if(Type == "ByteProperty"){
+        std::uint8_t Value;
+        return read(Value)?PyLong_FromUnsignedLong(Value):nullptr;
+    }else if(Type == "BoolProperty"){
+        std::uint32_t Value;
+        return read(Value)?PyBool_FromLong((Value&Property.Extra) != 0):nullptr;
+    }else if(Type == "ObjectProperty" || Type == "ClassProperty" || Type == "ComponentProperty"){
+        std::uintptr_t Value;
+        if(!read(Value)){
+            return nullptr;
+        }
+
+        if(Value == 0){
+            Py_RETURN_NONE;
+        }
+
+        return PyLong_FromUnsignedLongLong(Value);
+    }else if(Type == "NameProperty"){
+        std::int32_t Value[2];
+        if(!read(Value)){
+            return nullptr;
+        }
+
+        std::string Name(Reflection.name(Value[0]));
+        if(Value[1] > 0){
+            Name += "_"+std::to_string(Value[1]-1);
+        }
+
+        return PyUnicode_FromStringAndSize(Name.data(), static_cast<Py_ssize_t>(Name.size()));
+    }else if(Type == "StrProperty"){
+        // An array of UTF-16 characters, with the null terminator counted.
+        struct {
+            std::uintptr_t Data;
+            std::int32_t Count;
+            std::int32_t Max;
+        } Value;
+        if(!read(Value)){
+            return nullptr;
+        }
+
+        if(Value.Count <= 1 || Value.Count > 65536){
+            return PyUnicode_FromString("");
+        }
+
+        std::vector<wchar_t> Text(static_cast<std::size_t>(Value.Count));
+        if(!read_memory(Value.Data, Text.data(), Text.size()*sizeof(wchar_t))){
+            PyErr_Format(PyExc_ValueError, "%s can not be read", Property.Name.c_str());
+            return nullptr;
+        }
+
+        return PyUnicode_FromWideChar(Text.data(), static_cast<Py_ssize_t>(Text.size()-1));
+    }else if(Type == "StructProperty"){
+        // Bounded in case a struct contains itself through a bad offset.
+        if(Depth >= 16){
+            PyErr_SetString(PyExc_ValueError, "structs nested too deep");
+            return nullptr;
+        }
+
+        py_object r(PyDict_New());
+        if(!r){
+            return nullptr;
+        }
+
+        for(auto& e:Reflection.properties(Property.Extra)){
+            py_object Member(property_to_python(Reflection, e, Address, Depth+1));
+            if(!Member || PyDict_SetItemString(r, e.Name.c_str(), Member) != 0){
+                return nullptr;
+            }
+        }
+
+        return r.release();
+    }
+
+    // Anything else comes out as raw bytes.
+    std::vector<char> Bytes(Property.ElementSize);
+    if(!read_memory(Address, Bytes.data(), Bytes.size())){
+        PyErr_Format(PyExc_ValueError, "%s can not be read", Property.Name.c_str());
+        return nullptr;
+    }
+
+    return PyBytes_FromStringAndSize(Bytes.data(), static_cast<Py_ssize_t>(Bytes.size()));
+}
+
+// A property of the object or struct at `Address`, as a list if it's a static array.
+PyObject* property_to_python(mmtl::ue3_reflection& Reflection, const mmtl::ue3_property& Property, std::uintptr_t Address, int Depth){
+    Address += Property.Offset;
+
+    if(Property.ArrayDim <= 1){
+        return element_to_python(Reflection, Property, Address, Depth);
+    }
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Property.ArrayDim)));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::uint32_t i = 0; i < Property.ArrayDim; ++i){
+        auto Item = element_to_python(Reflection, Property, Address+i*Property.ElementSize, Depth);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), static_cast<Py_ssize_t>(i), Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_ue3_get(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwAddress[] = "address";
+    static char KwName[] = "name";
+    char* Kw[] = {KwAddress, KwName, nullptr};
+
+    unsigned long long ObjectAddress;
+    const char* NameStr;
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "Ks:ue3_get", Kw, &ObjectAddress, &NameStr)){
+        return nullptr;
+    }
+
+    auto Reflection = reflection();
+    if(!Reflection){
+        return nullptr;
+    }
+
+    auto Address = static_cast<std::uintptr_t>(ObjectAddress);
+    auto Struct = Reflection->class_of(Address);
+    if(Struct == 0){
+        PyErr_SetString(PyExc_ValueError, "not an object");
+        return nullptr;
+    }
+
+    // Dotted names go into structs and through object references, like `Controller.Pawn.Location.Z`.
+    std::string_view Name(NameStr);
+    for(;;){
+        auto Dot = Name.find('.');
+        auto Property = Reflection->find_property(Struct, Name.substr(0, Dot));
+        if(!Property){
+            PyErr_Format(PyExc_AttributeError, "no property '%s'", std::string(Name.substr(0, Dot)).c_str());
+            return nullptr;
+        }
+
+        if(Dot == std::string_view::npos){
+            return property_to_python(*Reflection, *Property, Address, 0);
+        }
+
+        Name.remove_prefix(Dot+1);
+
+        if(Property->Type == "StructProperty"){
+            Address += Property->Offset;
+            Struct = Property->Extra;
+        }else if(Property->Type == "ObjectProperty"){
+            if(!read_memory(Address+Property->Offset, &Address, sizeof(Address))){
+                PyErr_Format(PyExc_ValueError, "%s can not be read", Property->Name.c_str());
+                return nullptr;
+            }
+
+            if(Address == 0){
+                Py_RETURN_NONE;
+            }
+
+            Struct = Reflection->class_of(Address);
+            if(Struct == 0){
+                PyErr_Format(PyExc_ValueError, "%s is not an object", Property->Name.c_str());
+                return nullptr;
+            }
+        }else{
+            PyErr_Format(PyExc_ValueError, "%s is not a struct or object", Property->Name.c_str());
+            return nullptr;
+        }
+    }
+}
+
+// Created on first use, the search is the only user.
+std::unique_ptr<work_pool> RoutePool = nullptr;
+
+PyObject* py_find_route(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwPosition[] = "position";
+    static char KwVelocity[] = "velocity";
+    static char KwGoal[] = "goal";
+    static char KwRadius[] = "radius";
+    static char KwFrameTimes[] = "frame_times";
+    static char KwHeadings[] = "headings";
+    static char KwScale[] = "scale";
+    static char KwBeamWidth[] = "beam_width";
+    static char KwMaxFrames[] = "max_frames";
+    char* Kw[] = {
+        KwPosition, KwVelocity, KwGoal, KwRadius, KwFrameTimes, KwHeadings,
+        KwScale, KwBeamWidth, KwMaxFrames, nullptr,
+    };
+
+    PyObject* pPosition;
+    PyObject* pVelocity;
+    PyObject* pGoal;
+    PyObject* pFrameTimes;
+    PyObject* pHeadings;
+    mvmt::route_problem Problem = {};
+    Py_ssize_t BeamWidth = static_cast<Py_ssize_t>(Problem.BeamWidth);
+    Py_ssize_t MaxFrames = static_cast<Py_ssize_t>(Problem.MaxFrames);
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "OOOfOO|$fnn:find_route", Kw,
+            &pPosition, &pVelocity, &pGoal, &Problem.GoalRadius, &pFrameTimes, &pHeadings,
+            &Problem.SpeedScale, &BeamWidth, &MaxFrames)){
+        return nullptr;
+    }
+
+    std::vector<long long> FrameTimes, Headings;
+    if(
+        !parse_vec2(pPosition, Problem.Start.Position) || !parse_vec2(pVelocity, Problem.Start.Velocity) ||
+        !parse_vec2(pGoal, Problem.Goal) ||
+        !parse_int_list(pFrameTimes, FrameTimes) || !parse_int_list(pHeadings, Headings)
+    ){
+        return nullptr;
+    }
+
+    if(FrameTimes.empty() || Headings.empty() || BeamWidth <= 0 || MaxFrames < 0){
+        PyErr_SetString(PyExc_ValueError, "need frame times, headings and a positive beam width");
+        return nullptr;
+    }
+
+    for(auto e:FrameTimes){
+        if(e <= 0){
+            PyErr_SetString(PyExc_ValueError, "frame times must be positive");
+            return nullptr;
+        }
+
+        Problem.FrameTimes.push_back(static_cast<float>(static_cast<double>(e)/QpcFrequency));
+    }
+
+    for(auto e:Headings){
+        Problem.Headings.push_back(static_cast<int>(e));
+    }
+
+    Problem.BeamWidth = static_cast<std::size_t>(BeamWidth);
+    Problem.MaxFrames = static_cast<std::size_t>(MaxFrames);
+
+    mvmt::route_result Result;
+    std::string Error;
+
+    Py_BEGIN_ALLOW_THREADS
+
+    try {
+        if(!RoutePool){
+            RoutePool = std::make_unique<work_pool>();
+        }
+
+        Result = mvmt::find_route(Problem, *RoutePool);
+    }catch(std::exception& e){
+        Error = e.what();
+    }
+
+    Py_END_ALLOW_THREADS
+
+    if(!Error.empty()){
+        PyErr_SetString(PyExc_ValueError, Error.c_str());
+        return nullptr;
+    }
+
+    // Frame times are handed back exactly as they were passed in.
+    py_object Steps(PyList_New(static_cast<Py_ssize_t>(Result.Steps.size())));
+    if(!Steps){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Result.Steps.size(); ++i){
+        auto& Step = Result.Steps[i];
+
+        auto k = std::find(Problem.FrameTimes.begin(), Problem.FrameTimes.end(), Step.DeltaTime)-
+            Problem.FrameTimes.begin();
+
+        auto Item = Py_BuildValue("(Li)", FrameTimes[static_cast<std::size_t>(k)], Step.Heading);
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(Steps.get(), i, Item);
+    }
+
+    return Py_BuildValue("{sOsfsOs(ff)s(ff)sK}",
+        "reached", Result.Reached ? Py_True : Py_False,
+        "time", Result.Time,
+        "steps", Steps.get(),
+        "position", Result.Final.Position.x, Result.Final.Position.y,
+        "velocity", Result.Final.Velocity.x, Result.Final.Velocity.y,
+        "nodes", static_cast<unsigned long long>(Result.Nodes)
+    );
+}
+
+PyObject* py_strafe_turn(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwTurn[] = "turn";
+    static char KwDt[] = "dt";
+    static char KwScale[] = "scale";
+    char* Kw[] = {KwTurn, KwDt, KwScale, nullptr};
+
+    PyObject* pTurn;
+    mvmt::strafe_params Params = {};
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "Od|$d:strafe_turn", Kw,
+            &pTurn, &Params.DeltaTime, &Params.SpeedScale)){
+        return nullptr;
+    }
+
+    auto Table = mvmt::get_turn_table(Params);
+
+    if(PyLong_Check(pTurn)){
+        auto Turn = PyLong_AsLong(pTurn);
+        if(Turn == -1 && PyErr_Occurred()){
+            return nullptr;
+        }
+
+        return PyLong_FromLong((*Table)(static_cast<int>(Turn)));
+    }
+
+    std::vector<long long> Turns;
+    if(!parse_int_list(pTurn, Turns)){
+        return nullptr;
+    }
+
+    py_object r(PyList_New(static_cast<Py_ssize_t>(Turns.size())));
+    if(!r){
+        return nullptr;
+    }
+
+    for(std::size_t i = 0; i < Turns.size(); ++i){
+        auto Item = PyLong_FromLong((*Table)(static_cast<int>(Turns[i])));
+        if(!Item){
+            return nullptr;
+        }
+
+        PyList_SET_ITEM(r.get(), i, Item);
+    }
+
+    return r.release();
+}
+
+PyObject* py_strafe_delta(PyObject*, PyObject* Args, PyObject *Kwargs){
+    static char KwVelocity[] = "velocity";
+    static char KwHeading[] = "heading";
+    static char KwYaw[] = "yaw";
+    static char KwDt[] = "dt";
+    static char KwScale[] = "scale";
+    static char KwKeyAngle[] = "key_angle";
+    char* Kw[] = {KwVelocity, KwHeading, KwYaw, KwDt, KwScale, KwKeyAngle, nullptr};
+
+    PyObject* pVelocity;
+    int Heading;
+    int Yaw;
+    int KeyAngle = 0;
+    mvmt::strafe_params Params = {};
+    if(!PyArg_ParseTupleAndKeywords(Args, Kwargs, "Oiid|$di:strafe_delta", Kw,
+            &pVelocity, &Heading, &Yaw, &Params.DeltaTime, &Params.SpeedScale, &KeyAngle)){
+        return nullptr;
+    }
+
+    mvmt::vec2 Velocity;
+    if(!parse_vec2(pVelocity, Velocity)){
+        return nullptr;
+    }
+
+    auto Target = mvmt::heading_accel(Heading, 1.0f);
+    auto Solution = mvmt::solve_strafe(Velocity, Target, Params);
+
+    return Py_BuildValue("(iO)",
+        mvmt::strafe_mouse_delta(Solution, Yaw, KeyAngle),
+        Solution.Reachable ? Py_True : Py_False);
+}
+
+PyObject* init_pytas_module(){
+    static PyMethodDef Methods[] = {
+        {
+            "set_frame_time", reinterpret_cast<PyCFunction>(py_set_frame_time), METH_VARARGS|METH_KEYWORDS,
+            "Set the frame time.",
+        },
+        {
+            "get_frame_time", py_get_frame_time, METH_NOARGS,
+            "Get the frame time.",
+        },
+        {
+            "set_frame_wait", reinterpret_cast<PyCFunction>(py_set_frame_wait), METH_VARARGS|METH_KEYWORDS,
+            "Set the frame time.",
+        },
+        {
+            "set_message_interval", reinterpret_cast<PyCFunction>(py_set_message_interval), METH_VARARGS|METH_KEYWORDS,
+            "Only pump the real message queue every `interval` frames when not waiting.",
+        },
+        {
+            "set_movie_speed", reinterpret_cast<PyCFunction>(py_set_movie_speed), METH_VARARGS|METH_KEYWORDS,
+            "Set how movies play while frames aren't waited for.",
+        },
+        {
+            "is_in_movie", py_is_in_movie, METH_NOARGS,
+            "Tell whether the game is in a movie.",
+        },
+        {
+            "save_cloud", reinterpret_cast<PyCFunction>(py_save_cloud), METH_VARARGS|METH_KEYWORDS,
+            "Start saving the steam cloud to a folder in the background.",
+        },
+        {
+            "save_documents", reinterpret_cast<PyCFunction>(py_save_documents), METH_VARARGS|METH_KEYWORDS,
+            "Save the documents folder kept in memory to a folder.",
+        },
+        {
+            "game_log", py_game_log, METH_NOARGS,
+            "Get the newest part of the game log kept in memory.",
+        },
+        {
+            "save_game_log", reinterpret_cast<PyCFunction>(py_save_game_log), METH_VARARGS|METH_KEYWORDS,
+            "Save the game log kept in memory to a file.",
+        },
+        {
+            "package_loads", py_package_loads, METH_NOARGS,
+            "Get the level, seconds, reads and read ahead hits of every load so far.",
+        },
+        {
+            "flush_cloud", py_flush_cloud, METH_NOARGS,
+            "Wait for cloud saves to be written.",
+        },
+        {
+            "save_cloud_snapshot", reinterpret_cast<PyCFunction>(py_save_cloud_snapshot), METH_VARARGS|METH_KEYWORDS,
+            "Keep the current steam cloud under a name.",
+        },
+        {
+            "load_cloud_snapshot", reinterpret_cast<PyCFunction>(py_load_cloud_snapshot), METH_VARARGS|METH_KEYWORDS,
+            "Make a snapshot of the steam cloud the current one.",
+        },
+        {
+            "delete_cloud_snapshot", reinterpret_cast<PyCFunction>(py_delete_cloud_snapshot), METH_VARARGS|METH_KEYWORDS,
+            "Drop a snapshot of the steam cloud.",
+        },
+        {
+            "save_state", py_save_state, METH_NOARGS,
+            "Save the current state.",
+        },
+        {
+            "load_state", reinterpret_cast<PyCFunction>(py_load_state), METH_VARARGS|METH_KEYWORDS,
+            "Load a previously saved state.",
+        },
+        {
+            "save_memory", reinterpret_cast<PyCFunction>(py_save_memory), METH_VARARGS|METH_KEYWORDS,
+            "Save a snapshot of the game's memory.",
+        },
+        {
+            "load_memory", reinterpret_cast<PyCFunction>(py_load_memory), METH_VARARGS|METH_KEYWORDS,
+            "Restore a snapshot of the game's memory.",
+        },
+        {
+            "delete_memory", reinterpret_cast<PyCFunction>(py_delete_memory), METH_VARARGS|METH_KEYWORDS,
+            "Drop a snapshot of the game's memory.",
+        },
+        {
+            "set_memory_cache", reinterpret_cast<PyCFunction>(py_set_memory_cache), METH_VARARGS|METH_KEYWORDS,
+            "Limit how much space memory snapshots take up.",
+        },
+        {
+            "get_memory_stats", py_get_memory_stats, METH_NOARGS,
+            "Get how much space memory snapshots take up.",
+        },
+        {
+            "memory_view", reinterpret_cast<PyCFunction>(py_memory_view), METH_VARARGS|METH_KEYWORDS,
+            "Get a memoryview of game memory, checking that it is mapped when the view is made, not when it is used.",
+        },
+        {
+            "start_hash_log", reinterpret_cast<PyCFunction>(py_start_hash_log), METH_VARARGS|METH_KEYWORDS,
+            "Start writing per frame hashes of the game state to a file.",
+        },
+        {
+            "stop_hash_log", py_stop_hash_log, METH_NOARGS,
+            "Stop writing per frame hashes.",
+        },
+        {
+            "set_hash_region", reinterpret_cast<PyCFunction>(py_set_hash_region), METH_VARARGS|METH_KEYWORDS,
+            "Add a memory range to the per frame hashes.",
+        },
+        {
+            "remove_hash_region", reinterpret_cast<PyCFunction>(py_remove_hash_region), METH_VARARGS|METH_KEYWORDS,
+            "Remove a memory range from the per frame hashes.",
+        },
+        {
+            "get_frame_hashes", py_get_frame_hashes, METH_NOARGS,
+            "Get the hashes of the last frame.",
+        },
+        {
+            "add_watch", reinterpret_cast<PyCFunction>(py_add_watch), METH_VARARGS|METH_KEYWORDS,
+            "Watch a value at the end of a pointer path.",
+        },
+        {
+            "remove_watch", reinterpret_cast<PyCFunction>(py_remove_watch), METH_VARARGS|METH_KEYWORDS,
+            "Stop watching a value.",
+        },
+        {
+            "clear_watches", py_clear_watches, METH_NOARGS,
+            "Remove all watches.",
+        },
+        {
+            "refresh_watches", py_refresh_watches, METH_NOARGS,
+            "Follow every pointer path again and read the watches.",
+        },
+        {
+            "get_watches", py_get_watches, METH_NOARGS,
+            "Get the buffer the watched values are read into every frame.",
+        },
+        {
+            "get_watch_layout", py_get_watch_layout, METH_NOARGS,
+            "Get the offset, struct format and valid flag offset of each watch.",
+        },
+        {
+            "get_watch", reinterpret_cast<PyCFunction>(py_get_watch), METH_VARARGS|METH_KEYWORDS,
+            "Get the value of a watch, or None if it could not be read.",
+        },
+        {
+            "start_trace", reinterpret_cast<PyCFunction>(py_start_trace), METH_VARARGS|METH_KEYWORDS,
+            "Record watches to a trace file every frame.",
+        },
+        {
+            "stop_trace", py_stop_trace, METH_NOARGS,
+            "Finish the trace file.",
+        },
+        {
+            "flush_trace", py_flush_trace, METH_NOARGS,
+            "Write everything recorded so far to the trace file.",
+        },
+        {
+            "scan_first", reinterpret_cast<PyCFunction>(py_scan_first), METH_VARARGS|METH_KEYWORDS,
+            "Scan game memory for a value.",
+        },
+        {
+            "scan_next", reinterpret_cast<PyCFunction>(py_scan_next), METH_VARARGS|METH_KEYWORDS,
+            "Narrow the candidates of the last scan down.",
+        },
+        {
+            "scan_results", reinterpret_cast<PyCFunction>(py_scan_results), METH_VARARGS|METH_KEYWORDS,
+            "Get the addresses and values of the scan candidates.",
+        },
+        {
+            "scan_reset", py_scan_reset, METH_NOARGS,
+            "Drop the scan candidates.",
+        },
+        {
+            "load_code_index", reinterpret_cast<PyCFunction>(py_load_code_index), METH_VARARGS|METH_KEYWORDS,
+            "Load an index made by peindex for the running game, returns the number of functions.",
+        },
+        {
+            "code_function", reinterpret_cast<PyCFunction>(py_code_function), METH_VARARGS|METH_KEYWORDS,
+            "The start and end of the function containing an address, or None.",
+        },
+        {
+            "code_callers", reinterpret_cast<PyCFunction>(py_code_callers), METH_VARARGS|METH_KEYWORDS,
+            "The functions calling or jumping to an address.",
+        },
+        {
+            "code_references", reinterpret_cast<PyCFunction>(py_code_references), METH_VARARGS|METH_KEYWORDS,
+            "Every instruction referencing an address, and whether it calls, jumps or uses it as data.",
+        },
+        {
+            "code_string_refs", reinterpret_cast<PyCFunction>(py_code_string_refs), METH_VARARGS|METH_KEYWORDS,
+            "The functions referencing a string containing the text.",
+        },
+        {
+            "ue3_init", reinterpret_cast<PyCFunction>(py_ue3_init), METH_VARARGS|METH_KEYWORDS,
+            "Find GObjects and GNames, or use the given addresses, and read every object with the given field offsets. Returns the number of objects.",
+        },
+        {
+            "ue3_find", reinterpret_cast<PyCFunction>(py_ue3_find), METH_VARARGS|METH_KEYWORDS,
+            "The address of the object with a path like Engine.Default__Pawn, or None.",
+        },
+        {
+            "ue3_instances", reinterpret_cast<PyCFunction>(py_ue3_instances), METH_VARARGS|METH_KEYWORDS,
+            "The addresses of the objects of a class, without its defaults.",
+        },
+        {
+            "ue3_path", reinterpret_cast<PyCFunction>(py_ue3_path), METH_VARARGS|METH_KEYWORDS,
+            "The path of an object, or None.",
+        },
+        {
+            "ue3_properties", reinterpret_cast<PyCFunction>(py_ue3_properties), METH_VARARGS|METH_KEYWORDS,
+            "The name, type, offset, size and array length of every property of an object.",
+        },
+        {
+            "ue3_get", reinterpret_cast<PyCFunction>(py_ue3_get), METH_VARARGS|METH_KEYWORDS,
+            "Read a property of an object by name, dots going into structs and referenced objects.",
+        },
+        {
+            "get_mouse_pos", py_get_mouse_pos, METH_NOARGS,
+            "Get the mouse location.",
+        },
+        {
+            "get_key_events", py_get_key_events, METH_NOARGS,
+            "Get key events since last frame.",
+        },
+        {
             "get_move_events", py_get_move_events, METH_NOARGS,
             "Get move events since last frame.",
         },
@@ -591,6 +2646,50 @@ PyObject* init_pytas_module(){
             "set_gamepad_button", reinterpret_cast<PyCFunction>(py_set_gamepad_button), METH_VARARGS|METH_KEYWORDS,
             "Set gamepad button.",
         },
+        {
+            "get_frame_count", py_get_frame_count, METH_NOARGS,
+            "Get the number of frames run so far.",
+        },
+        {
+            "schedule_key", reinterpret_cast<PyCFunction>(py_schedule_key), METH_VARARGS|METH_KEYWORDS,
+            "Set a key at a later time.",
+        },
+        {
+            "schedule_mouse", reinterpret_cast<PyCFunction>(py_schedule_mouse), METH_VARARGS|METH_KEYWORDS,
+            "Move the mouse at a later time.",
+        },
+        {
+            "schedule_scroll", reinterpret_cast<PyCFunction>(py_schedule_scroll), METH_VARARGS|METH_KEYWORDS,
+            "Scroll the wheel at a later time.",
+        },
+        {
+            "get_scheduled_count", py_get_scheduled_count, METH_NOARGS,
+            "Get the number of scheduled inputs.",
+        },
+        {
+            "clear_schedule", py_clear_schedule, METH_NOARGS,
+            "Drop all scheduled inputs.",
+        },
+        {
+            "simulate_movement", reinterpret_cast<PyCFunction>(py_simulate_movement), METH_VARARGS|METH_KEYWORDS,
+            "Simulate the movement model for one acceleration per frame.",
+        },
+        {
+            "simulate_movement_batch", reinterpret_cast<PyCFunction>(py_simulate_movement_batch), METH_VARARGS|METH_KEYWORDS,
+            "Simulate many trajectories at once, each with a constant acceleration.",
+        },
+        {
+            "find_route", reinterpret_cast<PyCFunction>(py_find_route), METH_VARARGS|METH_KEYWORDS,
+            "Search for the fastest frame times and headings to reach a goal.",
+        },
+        {
+            "strafe_turn", reinterpret_cast<PyCFunction>(py_strafe_turn), METH_VARARGS|METH_KEYWORDS,
+            "Native `compute_turn` using a cached table per frame time and speed scale.",
+        },
+        {
+            "strafe_delta", reinterpret_cast<PyCFunction>(py_strafe_delta), METH_VARARGS|METH_KEYWORDS,
+            "Mouse delta needed to move towards a heading at any velocity.",
+        },
         {nullptr, nullptr, 0, nullptr},
     };
 
@@ -780,6 +2879,9 @@ PyObject* init_pytas_module(){
 
 constinit py_object Recipe = nullptr;
 
+// Frames left before the script is resumed, if it yielded a frame count.
+constinit long SkipFrames = 0;
+
 }
 
 // TODO: Call Py_FinalizeEx() somewhere.
@@ -849,10 +2951,32 @@ void pytas_init(int Argc, wchar_t** Argv){
 }
 
 void pytas_next(){
-    if(py_object r(PyIter_Next(Recipe)); !r){
+    if(SkipFrames > 0){
+        --SkipFrames;
+        return;
+    }
+
+    read_watches();
+    if(!update_watch_array()){
+        PyErr_Print();
+        std::abort();
+    }
+
+    py_object r(PyIter_Next(Recipe));
+    if(!r){
         if(PyErr_Occurred()){
             PyErr_Print();
         }
         std::abort();
     }
+
+    if(PyLong_Check(r.get()) && !PyBool_Check(r.get())){
+        auto Count = PyLong_AsLong(r);
+        if(Count == -1 && PyErr_Occurred()){
+            PyErr_Print();
+            std::abort();
+        }
+
+        SkipFrames = std::max(Count-1, 0l);
+    }
 }
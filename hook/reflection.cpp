@@ -0,0 +1,44 @@
+﻿#include "reflection.h"
+
+#include <memory>
+#include <stdexcept>
+
+#include "memory.h"
+#include "watches.h"
+
+namespace {
+
+std::unique_ptr<mmtl::ue3_reflection> Reflection;
+
+// Most loads are never looked at by a script, so the objects are only read when they are.
+bool Stale = false;
+
+}
+
+void init_reflection(std::uintptr_t Objects, std::uintptr_t Names, const mmtl::ue3_layout& Layout){
+    auto New = std::make_unique<mmtl::ue3_reflection>(read_memory, Layout);
+
+    if(Objects != 0 && Names != 0){
+        New->set_tables(Objects, Names);
+    }else if(!New->locate(game_regions())){
+        throw std::runtime_error("GObjects or GNames not found.");
+    }
+
+    New->refresh();
+
+    Reflection = std::move(New);
+    Stale = false;
+}
+
+mmtl::ue3_reflection* get_reflection(){
+    if(Reflection && Stale){
+        Reflection->refresh();
+        Stale = false;
+    }
+
+    return Reflection.get();
+}
+
+void invalidate_reflection(){
+    Stale = true;
+}
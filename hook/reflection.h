@@ -0,0 +1,19 @@
+﻿#ifndef REFLECTION_H_INCLUDED
+    #define REFLECTION_H_INCLUDED 1
+
+#include <ue3.h>
+
+// The game's objects and their properties, found through GObjects and GNames.
+
+// Uses the tables at the given addresses, or looks for them if either is 0, then reads every
+// object. Throws `std::runtime_error` if they were not found.
+void init_reflection(std::uintptr_t Objects, std::uintptr_t Names, const mmtl::ue3_layout& Layout);
+
+// Null before `init_reflection`. Reads the objects that changed first if a level has loaded since
+// the last call.
+mmtl::ue3_reflection* get_reflection();
+
+// Reads the objects that changed on the next `get_reflection`. Called when a level has loaded.
+void invalidate_reflection();
+
+#endif
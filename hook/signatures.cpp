@@ -0,0 +1,220 @@
+﻿#include "signatures.h"
+
+#include <array>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <optional>
+#include <exception>
+#include <string_view>
+
+#include <pe.h>
+#include <hash.h>
+#include <signature.h>
+
+namespace {
+
+const std::filesystem::path SignaturesPath = "datafiles/signatures.txt";
+const std::filesystem::path CachePath = "datafiles/signatures.cache";
+
+constexpr std::array<std::string_view, 5> TargetNames = {
+    "DoFrame", "InitWindow", "MessageLoop", "MovieLoop", "LoadLoop",
+};
+
+using target_rvas = std::array<std::uint32_t, TargetNames.size()>;
+
+std::optional<target_rvas> known_rvas(game_version Version){
+    switch(Version){
+        case game_version::V12: {
+            return target_rvas{0x5E0010, 0x16C90, 0x16C10, 0xDB570, 0x14AE00};
+        }
+        case game_version::V14: {
+            return target_rvas{0x5E0CB0, 0x16D40, 0x16CC0, 0xDB460, 0x14A5F0};
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::string read_text(const std::filesystem::path& Path){
+    std::ifstream File(Path, std::ios::binary);
+    if(!File){
+        return {};
+    }
+
+    std::ostringstream r;
+    r << File.rdbuf();
+    return r.str();
+}
+
+using signature_set = std::array<std::optional<mmtl::signature>, TargetNames.size()>;
+
+// Lines of a name and a pattern, with `#` starting a comment.
+signature_set parse_signatures(const std::string& Text){
+    signature_set r;
+
+    std::istringstream Lines(Text);
+    std::string Line;
+    while(std::getline(Lines, Line)){
+        Line = Line.substr(0, Line.find('#'));
+
+        std::istringstream Fields(Line);
+        std::string Name;
+        if(!(Fields >> Name)){
+            continue;
+        }
+
+        std::string Pattern;
+        std::getline(Fields, Pattern);
+
+        for(std::size_t i = 0; i < TargetNames.size(); ++i){
+            if(Name == TargetNames[i]){
+                try {
+                    r[i] = mmtl::signature::parse(Pattern);
+                }catch(std::exception& e){
+                    std::fprintf(stderr, "Signature for %s: %s\n", Name.c_str(), e.what());
+                }
+            }
+        }
+    }
+
+    return r;
+}
+
+// The cache has the key on the first line, then a line with the name and RVA of every target that
+// was found, both in hex.
+std::optional<target_rvas> read_cache(std::uint64_t Key){
+    std::ifstream File(CachePath);
+
+    unsigned long long CachedKey;
+    if(!(File >> std::hex >> CachedKey) || CachedKey != Key){
+        return std::nullopt;
+    }
+
+    target_rvas r = {};
+
+    std::string Name;
+    std::uint32_t Rva;
+    while(File >> Name >> Rva){
+        for(std::size_t i = 0; i < TargetNames.size(); ++i){
+            if(Name == TargetNames[i]){
+                r[i] = Rva;
+            }
+        }
+    }
+
+    return r;
+}
+
+void write_cache(std::uint64_t Key, const target_rvas& Rvas){
+    std::ofstream File(CachePath, std::ios::trunc);
+
+    File << std::hex << Key << '\n';
+    for(std::size_t i = 0; i < TargetNames.size(); ++i){
+        if(Rvas[i] != 0){
+            File << TargetNames[i] << ' ' << Rvas[i] << '\n';
+        }
+    }
+}
+
+// Where the signatures match in the game's code, 0 for those that don't or that are missing.
+target_rvas search_signatures(const std::string& SignatureText, const signature_set& Signatures){
+    auto Base = static_cast<const std::byte*>(GameModule.lpBaseOfDll);
+
+    target_rvas Rvas = {};
+
+    try {
+        mmtl::pe_image Image(Base, GameModule.SizeOfImage, true);
+
+        auto Text = Image.find_section(".text");
+        if(!Text){
+            throw std::runtime_error("The game has no .text section.");
+        }
+
+        auto Code = Image.data(*Text);
+        auto CodeSize = Image.size(*Text);
+
+        // Relocated addresses are wildcards in the signatures, so the key is only for the code as
+        // loaded at its preferred base.
+        auto Key = mmtl::hash_memory(Code, CodeSize)^mmtl::hash_bytes(SignatureText.data(), SignatureText.size());
+
+        if(auto Cached = read_cache(Key)){
+            Rvas = *Cached;
+        }else{
+            std::vector<mmtl::signature> Search;
+            std::vector<std::size_t> Indices;
+            for(std::size_t i = 0; i < Signatures.size(); ++i){
+                if(Signatures[i]){
+                    Search.push_back(*Signatures[i]);
+                    Indices.push_back(i);
+                }
+            }
+
+            auto Matches = mmtl::find_signatures(Code, CodeSize, Search);
+            for(std::size_t i = 0; i < Matches.size(); ++i){
+                auto Name = TargetNames[Indices[i]];
+
+                if(Matches[i].Count == 1){
+                    Rvas[Indices[i]] = static_cast<std::uint32_t>(Text->Rva+Matches[i].Offset);
+                }else{
+                    std::fprintf(stderr, "Signature for %.*s matched %s.\n", static_cast<int>(Name.size()),
+                        Name.data(), (Matches[i].Count == 0)?"nothing":"more than once");
+                }
+            }
+
+            write_cache(Key, Rvas);
+        }
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Signature search failed: %s\n", e.what());
+    }
+
+    return Rvas;
+}
+
+}
+
+bool find_hook_targets(hook_targets& Targets, game_version Version){
+    auto Base = static_cast<const std::byte*>(GameModule.lpBaseOfDll);
+
+    auto SignatureText = read_text(SignaturesPath);
+    auto Signatures = parse_signatures(SignatureText);
+
+    // None are shipped, and without any there is no point in hashing the code for the cache.
+    target_rvas Rvas = {};
+    if(std::any_of(Signatures.begin(), Signatures.end(), [](auto& e){ return e.has_value(); })){
+        Rvas = search_signatures(SignatureText, Signatures);
+    }
+
+    auto Known = known_rvas(Version);
+
+    bool Found = true;
+    for(std::size_t i = 0; i < Rvas.size(); ++i){
+        if(Rvas[i] == 0 && Known){
+            Rvas[i] = (*Known)[i];
+        }
+
+        if(Rvas[i] == 0){
+            std::fprintf(stderr, "Unable to find %.*s.\n", static_cast<int>(TargetNames[i].size()), TargetNames[i].data());
+            Found = false;
+        }else if(Known && Rvas[i] != (*Known)[i]){
+            std::fprintf(stderr, "%.*s found at 0x%X instead of 0x%X.\n", static_cast<int>(TargetNames[i].size()),
+                TargetNames[i].data(), Rvas[i], (*Known)[i]);
+        }
+    }
+
+    auto Address = [&](std::size_t i){
+        return const_cast<std::byte*>(Base)+Rvas[i];
+    };
+
+    Targets = {
+        .DoFrame = Address(0),
+        .InitWindow = Address(1),
+        .MessageLoop = Address(2),
+        .MovieLoop = Address(3),
+        .LoadLoop = Address(4),
+    };
+
+    return Found;
+}
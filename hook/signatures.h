@@ -0,0 +1,21 @@
+﻿#ifndef SIGNATURES_H_INCLUDED
+    #define SIGNATURES_H_INCLUDED 1
+
+#include "state.h"
+
+// The game functions that are hooked.
+struct hook_targets {
+    void* DoFrame = nullptr;
+    void* InitWindow = nullptr;
+    void* MessageLoop = nullptr;
+    void* MovieLoop = nullptr;
+    void* LoadLoop = nullptr;
+};
+
+// Finds the hook targets in the game's code with the signatures in `datafiles/signatures.txt`, or
+// takes them from `datafiles/signatures.cache` if the code and signatures are the same as when it
+// was written. Targets without a signature, or whose signature did not match exactly once, use
+// the offsets known for `Version`. Returns false if a target is still missing.
+bool find_hook_targets(hook_targets& Targets, game_version Version);
+
+#endif
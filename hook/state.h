@@ -21,10 +21,18 @@ struct cmdargs {
     fs::path Userdata;
     fs::path Scripts;
     std::wstring Main;
+    // Keep changes to `Documents` in memory.
+    bool Overlay = false;
+    bool PackageCache = false;
+    bool MemoryLog = false;
+    bool ProfileLoads = false;
+    bool Savestates = false;
 };
 
 extern MODULEINFO GameModule;
 
+bool in_module(const void* Ptr, const MODULEINFO& ModInfo);
+
 extern game_version GameVersion;
 
 extern cmdargs CmdArgs;
@@ -38,13 +46,46 @@ extern std::atomic<std::int64_t> Qpc;
 extern std::uint64_t SystemFileTime;
 
 extern int FrameTime;
-extern bool FrameWait;
+// Also read by the Bink thread.
+extern std::atomic<bool> FrameWait;
+
+// The number of frames the script has been run for.
+extern std::uint64_t FrameCount;
 
 constexpr auto TickConversion = QpcFrequency/1000;
 
+// Game
+struct vec3 {
+    float x, y, z;
+};
+
+struct rot3 {
+    int x, y, z;
+};
+
+// Pointers into the player's pawn and controller, which are null outside of a level.
+struct game_state {
+    vec3* Position;
+    vec3* Velocity;
+    rot3* Rotation;
+
+    char* Pawn;
+    char* Controller;
+};
+
+game_state get_game_state();
+
 // Windowing
 extern thread_local bool IsBinkThread;
 extern bool IsInLoadScreen;
 extern bool IsInMovie;
 
+// How movies play while frames aren't waited for. `Fast` shows every frame as soon as it is
+// decoded, `Skip` doesn't decode them at all. The sound is off for both. Read by the Bink thread.
+enum class movie_speed {
+    Real, Fast, Skip,
+};
+
+extern std::atomic<movie_speed> MovieSpeed;
+
 #endif
@@ -3,6 +3,8 @@
 #include "steam.h"
 
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <vector>
 #include <unordered_map>
 
@@ -10,23 +12,51 @@
 
 #include <cassert>
 
+#include <cloud_files.h>
+
 #include "debug.h"
 #include "state.h"
 
-std::recursive_mutex CallbackMutex;
-
+// A result waiting for the game to register a callback for it, and then for the next
+// `SteamAPI_RunCallbacks`. The results we make up are small and only a few are in flight at a
+// time, so they live in fixed slots instead of being allocated.
 struct call_result {
-    std::vector<unsigned char> Buffer;
+    static constexpr std::size_t MaxSize = 64;
+
+    // Flags of `State` next to the ID.
+    static constexpr SteamAPICall_t Filling = 1ull << 63;
+    static constexpr SteamAPICall_t Registered = 1ull << 62;
+
+    alignas(8) unsigned char Buffer[MaxSize];
     bool IoFailure;
-};
 
-struct call_result_entry {
-    CCallbackBase* Callback;
     SteamAPICall_t ApiCall;
+    CCallbackBase* Callback;
+    // `CallbackRuns` when it was added.
+    std::uint32_t Added;
+
+    // Next in `PendingCallResults`.
+    call_result* Next;
+
+    // 0 if free, otherwise the ID with `Filling` while `add_call_result` writes it, then without
+    // flags until the game registers a callback, then with `Registered` until the callback has run.
+    std::atomic<SteamAPICall_t> State;
 };
 
-std::unordered_map<SteamAPICall_t, call_result> CallResults = {};
-std::vector<call_result_entry> CallResultEntries = {};
+constexpr std::size_t CallResultSlots = 32;
+
+// Results the game did not register a callback for after this many `SteamAPI_RunCallbacks` are
+// dropped, it never will.
+constexpr std::uint32_t CallResultRuns = 16;
+
+// An ID's slot is `ApiCall%CallResultSlots`, IDs are never reused.
+call_result CallResults[CallResultSlots] = {};
+std::atomic<SteamAPICall_t> NextApiCall = 1;
+
+std::atomic<std::uint32_t> CallbackRuns = 0;
+
+// Registered results, most recent first, pushed without locking. Empty on almost every frame.
+std::atomic<call_result*> PendingCallResults = nullptr;
 
 struct persona {
     const char* Name;
@@ -64,25 +94,38 @@ const persona* get_persona(CSteamID Id){
 }
 
 static SteamAPICall_t add_call_result(const void* Data, std::size_t Size, bool IoFailure){
-    std::lock_guard Lock(CallbackMutex);
+    assert(Size <= call_result::MaxSize);
 
-    SteamAPICall_t r = 1;
+    // Skips IDs whose slot is still taken, there is always a free one unless the game stopped
+    // running callbacks.
+    for(std::size_t i = 0; i < 4*CallResultSlots; ++i){
+        auto r = NextApiCall.fetch_add(1, std::memory_order_relaxed);
+        auto& Result = CallResults[r%CallResultSlots];
 
-    while(CallResults.contains(r)){
-        ++r;
-    }
+        SteamAPICall_t Free = 0;
+        if(!Result.State.compare_exchange_strong(Free, r|call_result::Filling, std::memory_order_acquire)){
+            continue;
+        }
 
-    auto& Result = CallResults[r];
-    Result.Buffer.resize(Size);
-    std::memcpy(Result.Buffer.data(), Data, Size);
+        std::memcpy(Result.Buffer, Data, Size);
+        Result.IoFailure = IoFailure;
+        Result.ApiCall = r;
+        Result.Callback = nullptr;
+        Result.Added = CallbackRuns.load(std::memory_order_relaxed);
 
-    Result.IoFailure = IoFailure;
+        Result.State.store(r, std::memory_order_release);
 
-    return r;
+        return r;
+    }
+
+    std::fprintf(stderr, "Error: Too many call results in flight.\n");
+    TerminateProcess(GetCurrentProcess(), __LINE__);
+    return 0;
 }
 
 template <typename T>
 static SteamAPICall_t add_call_result(const T& t, bool IoFailure = false){
+    static_assert(sizeof(T) <= call_result::MaxSize);
     return add_call_result(&t, sizeof(t), IoFailure);
 }
 
@@ -474,117 +517,98 @@ struct ISteamNetworking {
 
 constexpr std::int32_t TotalCloudQuota = 1024*1024*1024;
 
-struct file_deleter {
-    void operator()(std::FILE* File) const {
-        std::fclose(File);
-    }
-};
-
-using unique_file = std::unique_ptr<std::FILE, file_deleter>;
-
 struct ISteamRemoteStorage {
+    // Taken by everything using `Files`, the game may call in from more than one thread.
     std::mutex FileMutex;
 
-    struct file_entry {
-        std::string Name;
-        std::vector<unsigned char> Buffer;
-        std::int64_t Timestamp;
-    };
-
-    std::vector<file_entry> Files = {};
+    mmtl::cloud_files Files;
     std::int64_t Timestamp = 0;
 
-    using file_it = std::vector<file_entry>::iterator;
-
-    file_it get_file(const char* Name, bool Create = false){
-        for(auto it = Files.begin(), End = Files.end(); it != End; ++it){
-            if(_stricmp(it->Name.data(), Name) == 0){
-                return it;
-            }
-        }
+    // Share their files with `Files` and each other, so they cost little more than the names.
+    std::unordered_map<std::string, mmtl::cloud_files> Snapshots;
 
-        if(Create){
-            Files.push_back({
-                .Name = Name,
-                .Buffer = {},
-                .Timestamp = 0,
-            });
+    // Created by the first save.
+    std::unique_ptr<mmtl::cloud_writer> Writer;
 
-            return Files.end()-1;
-        }else{
-            return Files.end();
-        }
-    }
+    // Set by `load_files`, the files are ready once it is.
+    std::shared_future<void> Loading;
 
+    // Starts loading the userdata folder on a thread of its own, so the game can start in the
+    // meantime. Files are mapped rather than read, and only copied once the game writes them.
     void load_files(){
-        for(auto& Entry:fs::directory_iterator(CmdArgs.Userdata)){
-            if(!Entry.is_regular_file()){
-                continue;
-            }
+        Loading = std::async(std::launch::async, [this]{
+            std::vector<mmtl::cloud_files::file> Loaded;
 
-            unique_file File(_wfopen(Entry.path().c_str(), L"rb"));
-            if(!File){
-                throw std::runtime_error("Unable to open cloud save.");
-            }
+            for(auto& Entry:fs::directory_iterator(CmdArgs.Userdata)){
+                if(!Entry.is_regular_file()){
+                    continue;
+                }
 
-            auto Time = Entry.last_write_time().time_since_epoch().count();
+                auto Time = Entry.last_write_time().time_since_epoch().count();
 
-            auto Name = Entry.path().filename();
+                auto Data = mmtl::cloud_data::map(Entry.path());
+                if(Data->size() > static_cast<std::size_t>(INT32_MAX)){
+                    throw std::runtime_error("Cloud save is too large.");
+                }
 
-            auto Size = static_cast<DWORD>(Entry.file_size());
-            if(Size != Entry.file_size()){
-                throw std::runtime_error("Cloud save is too large.");
+                Loaded.push_back({
+                    .Name = Entry.path().filename().string(),
+                    .Data = std::move(Data),
+                    .Timestamp = Time,
+                });
             }
 
-            file_entry FileEntry = {
-                .Name = Entry.path().filename().string(),
-                .Buffer = std::vector<unsigned char>(Size),
-                .Timestamp = Time,
-            };
+            std::sort(Loaded.begin(), Loaded.end(), [](auto& Lhs, auto& Rhs){
+                if(Lhs.Timestamp == Rhs.Timestamp){
+                    return Lhs.Name < Rhs.Name;
+                }else{
+                    return Lhs.Timestamp < Rhs.Timestamp;
+                }
+            });
+
+            std::lock_guard Lock(FileMutex);
 
-            if(std::fread(FileEntry.Buffer.data(), 1, Size, File.get()) != Size){
-                throw std::runtime_error("Unable to read cloud save.");
+            for(auto& File:Loaded){
+                File.Timestamp = ++Timestamp;
             }
 
-            Files.push_back(std::move(FileEntry));
-        }
+            Files = mmtl::cloud_files(std::move(Loaded));
+        }).share();
+    }
 
-        std::sort(Files.begin(), Files.end(), [](auto& Lhs, auto& Rhs){
-            if(Lhs.Timestamp == Rhs.Timestamp){
-                return Lhs.Name < Rhs.Name;
-            }else{
-                return Lhs.Timestamp < Rhs.Timestamp;
-            }
-        });
+    // Called before anything gets to `Files`. A userdata folder that can't be loaded is fatal,
+    // like it was when it was loaded on startup.
+    void wait_loaded(){
+        if(!Loading.valid()){
+            return;
+        }
 
-        for(auto& File:Files){
-            File.Timestamp = ++Timestamp;
+        try {
+            Loading.get();
+        }catch(std::exception& e){
+            std::fprintf(stderr, "Error: %s\n", e.what());
+            TerminateProcess(GetCurrentProcess(), __LINE__);
         }
     }
 
+    // Only checked here, the files are written on the writer's thread.
     bool save_files(const wchar_t* Name){
+        wait_loaded();
+
         try {
             auto Path = fs::weakly_canonical(Name);
             if(fs::exists(Path) && fs::equivalent(Path, CmdArgs.Userdata)){
                 throw std::runtime_error("Trying to overwrite userdata!\n");
             }
 
-            fs::create_directories(Path);
-
-            for(auto& Data:Files){
-                auto Filepath = Path/Data.Name;
+            std::lock_guard Lock(FileMutex);
 
-                unique_file File(_wfopen(Filepath.c_str(), L"wb"));
-                if(!File){
-                    throw std::runtime_error("Unable to open cloudsave.");
-                }
-
-                auto Size = Data.Buffer.size();
-                if(std::fwrite(Data.Buffer.data(), 1, Size, File.get()) != Size){
-                    throw std::runtime_error("Unable to write cloudsave.");
-                }
+            if(!Writer){
+                Writer = std::make_unique<mmtl::cloud_writer>();
             }
 
+            Writer->write(Path, Files);
+
             return true;
         }catch(std::exception& e){
             std::fprintf(stderr, "Error: %s\n", e.what());
@@ -592,27 +616,70 @@ struct ISteamRemoteStorage {
         }
     }
 
-    virtual bool FileWrite(const char* File, const unsigned char* Buffer, std::int32_t Size){
+    void flush_files(){
+        std::unique_lock Lock(FileMutex);
+        auto Pending = Writer.get();
+        Lock.unlock();
+
+        if(Pending){
+            Pending->flush();
+        }
+    }
+
+    void save_snapshot(const std::string& Name){
+        wait_loaded();
+
         std::lock_guard Lock(FileMutex);
+        Snapshots.insert_or_assign(Name, Files);
+    }
 
-        DLOG("ISteamRemoteStorage::FileWrite(\"%s\", 0x%p, %d)\n", File, Buffer, Size);
+    bool load_snapshot(const std::string& Name){
+        wait_loaded();
+
+        std::lock_guard Lock(FileMutex);
 
-        auto it = get_file(File, true);
-        it->Buffer.assign(Buffer, Buffer+Size);
-        it->Timestamp = ++Timestamp;
+        auto it = Snapshots.find(Name);
+        if(it == Snapshots.end()){
+            return false;
+        }
+
+        Files = it->second;
 
         return true;
     }
 
-    virtual std::int32_t FileRead(const char* File, unsigned char* Buffer, std::int32_t Size){
+    bool delete_snapshot(const std::string& Name){
+        std::lock_guard Lock(FileMutex);
+        return Snapshots.erase(Name) != 0;
+    }
+
+    // The current contents of a file, or null. Stays the same even if the file is written to.
+    mmtl::cloud_files::buffer read_file(const char* File){
         std::lock_guard Lock(FileMutex);
 
+        auto Found = Files.find(File);
+        return Found?Found->Data:nullptr;
+    }
+
+    virtual bool FileWrite(const char* File, const unsigned char* Buffer, std::int32_t Size){
+        DLOG("ISteamRemoteStorage::FileWrite(\"%s\", 0x%p, %d)\n", File, Buffer, Size);
+
+        // Copied before locking, the old contents may still be in use.
+        auto Data = std::make_shared<const mmtl::cloud_data>(std::vector<unsigned char>(Buffer, Buffer+Size));
+
+        std::lock_guard Lock(FileMutex);
+        Files.write(File, std::move(Data), ++Timestamp);
+
+        return true;
+    }
+
+    virtual std::int32_t FileRead(const char* File, unsigned char* Buffer, std::int32_t Size){
         std::int32_t r = 0;
-        if(auto it = get_file(File); it != Files.end()){
-            r = std::min(static_cast<std::int32_t>(it->Buffer.size()), Size);
+        if(auto Data = read_file(File)){
+            r = std::min(static_cast<std::int32_t>(Data->size()), Size);
 
             if(r > 0){
-                std::memcpy(Buffer, it->Buffer.data(), static_cast<std::size_t>(r));
+                std::memcpy(Buffer, Data->data(), static_cast<std::size_t>(r));
             }
         }
 
@@ -627,7 +694,9 @@ struct ISteamRemoteStorage {
     virtual bool SetSyncPlatforms(const char* File, ERemoteStoragePlatform Platform){ NYI("ISteamRemoteStorage::SetSyncPlatforms(\"%s\", %08X)\n", File, Platform); }
 
     virtual bool FileExists(const char* File){
-        auto r = get_file(File) != Files.end();
+        std::lock_guard Lock(FileMutex);
+
+        auto r = Files.find(File) != nullptr;
         DLOG("ISteamRemoteStorage::FileExists(\"%s\"): %d\n", File, r);
         return r;
     }
@@ -638,8 +707,8 @@ struct ISteamRemoteStorage {
         std::lock_guard Lock(FileMutex);
 
         std::int32_t r = 0;
-        if(auto it = get_file(File); it != Files.end()){
-            r = static_cast<std::int32_t>(it->Buffer.size());
+        if(auto Found = Files.find(File)){
+            r = static_cast<std::int32_t>(Found->size());
         }
 
         DLOG("ISteamRemoteStorage::GetFileSize(\"%s\"): %d\n", File, r);
@@ -651,8 +720,8 @@ struct ISteamRemoteStorage {
         std::lock_guard Lock(FileMutex);
 
         std::int64_t r = 0;
-        if(auto it = get_file(File); it != Files.end()){
-            r = it->Timestamp;
+        if(auto Found = Files.find(File)){
+            r = Found->Timestamp;
         }
 
         DLOG("ISteamRemoteStorage::GetFileTimestamp(\"%s\"): %lld\n", File, r);
@@ -673,7 +742,7 @@ struct ISteamRemoteStorage {
 
         auto& File = Files[static_cast<std::size_t>(Index)];
 
-        *Size = static_cast<std::int32_t>(File.Buffer.size());
+        *Size = static_cast<std::int32_t>(File.size());
 
         DLOG("ISteamRemoteStorage::GetFileNameAndSize(%d, *0x%p = %d): \"%s\"\n", Index, Size, *Size, File.Name.data());
 
@@ -684,11 +753,7 @@ struct ISteamRemoteStorage {
         std::lock_guard Lock(FileMutex);
 
         *Total = TotalCloudQuota;
-        *Available = TotalCloudQuota;
-
-        for(auto& File:Files){
-            *Available -= static_cast<std::int32_t>(File.Buffer.size());
-        }
+        *Available = TotalCloudQuota-static_cast<std::int32_t>(Files.total_size());
 
         DLOG("ISteamRemoteStorage::GetQuota(*0x%p = %d, *0x%p = %d)\n", Total, *Total, Available, *Available);
 
@@ -1151,6 +1216,22 @@ bool save_steam_cloud(const wchar_t* Name){
     return SteamRemoteStorage_Instance.save_files(Name);
 }
 
+void flush_steam_cloud(){
+    SteamRemoteStorage_Instance.flush_files();
+}
+
+void save_cloud_snapshot(const std::string& Name){
+    SteamRemoteStorage_Instance.save_snapshot(Name);
+}
+
+bool load_cloud_snapshot(const std::string& Name){
+    return SteamRemoteStorage_Instance.load_snapshot(Name);
+}
+
+bool delete_cloud_snapshot(const std::string& Name){
+    return SteamRemoteStorage_Instance.delete_snapshot(Name);
+}
+
 bool SteamAPI_Init_Hook(){
     auto r = true;
 
@@ -1162,12 +1243,21 @@ bool SteamAPI_Init_Hook(){
 void SteamAPI_RegisterCallResult_Hook(CCallbackBase* Callback, SteamAPICall_t ApiCall){
     DLOG("SteamAPI_RegisterCallResult(0x%p, 0x%016llX)\n", Callback, ApiCall);
 
-    std::lock_guard Lock(CallbackMutex);
+    auto& Result = CallResults[ApiCall%CallResultSlots];
+
+    // Fails if the result was dropped or cleared by a load.
+    auto Expected = ApiCall;
+    if(!Result.State.compare_exchange_strong(Expected, ApiCall|call_result::Registered, std::memory_order_acquire)){
+        std::fprintf(stderr, "Warning: Call result 0x%016llX registered after it was dropped.\n", ApiCall);
+        return;
+    }
+
+    Result.Callback = Callback;
 
-    CallResultEntries.push_back({
-        .Callback = Callback,
-        .ApiCall = ApiCall,
-    });
+    auto Head = PendingCallResults.load(std::memory_order_relaxed);
+    do {
+        Result.Next = Head;
+    }while(!PendingCallResults.compare_exchange_weak(Head, &Result, std::memory_order_release, std::memory_order_relaxed));
 }
 
 void SteamAPI_RegisterCallback_Hook(CCallbackBase* Callback, int Index){
@@ -1192,27 +1282,63 @@ void SteamAPI_RegisterCallback_Hook(CCallbackBase* Callback, int Index){
 }
 
 void SteamAPI_RunCallbacks_Hook(){
-    std::lock_guard Lock(CallbackMutex);
+    // Callbacks can register new results, those are taken by the next round.
+    while(auto Head = PendingCallResults.exchange(nullptr, std::memory_order_acquire)){
+        // Run in the order they were registered.
+        call_result* Ordered = nullptr;
+        while(Head){
+            auto Next = Head->Next;
+            Head->Next = Ordered;
+            Ordered = Head;
+            Head = Next;
+        }
 
-    // `CallResultEntries` can change as a result of a callback.
-    // Hance, we need to use indices and `.size()`.
-    for(std::size_t i = 0; i < CallResultEntries.size(); ++i){
-        auto& Entry = CallResultEntries[i];
-        auto it = CallResults.find(Entry.ApiCall);
-        assert(it != CallResults.end());
+        while(Ordered){
+            auto& Result = *Ordered;
+            Ordered = Result.Next;
 
-        auto& [Buffer, IoFailure] = it->second;
+            Result.Callback->Run(Result.Buffer, Result.IoFailure, Result.ApiCall);
 
-        Entry.Callback->Run(Buffer.data(), IoFailure, Entry.ApiCall);
+            Result.State.store(0, std::memory_order_release);
+        }
+    }
 
-        CallResults.erase(it);
+    auto Runs = CallbackRuns.fetch_add(1, std::memory_order_relaxed)+1;
+
+    for(auto& e:CallResults){
+        auto State = e.State.load(std::memory_order_acquire);
+        if(State != 0 && (State&(call_result::Filling|call_result::Registered)) == 0 && Runs-e.Added > CallResultRuns){
+            e.State.compare_exchange_strong(State, 0, std::memory_order_relaxed);
+        }
     }
+}
 
-    CallResultEntries.clear();
+void clear_call_results(){
+    // Results registered before the load are for callbacks that may not exist anymore.
+    auto Head = PendingCallResults.exchange(nullptr, std::memory_order_acquire);
+    while(Head){
+        auto Next = Head->Next;
+        Head->State.store(0, std::memory_order_release);
+        Head = Next;
+    }
+
+    for(auto& e:CallResults){
+        auto State = e.State.load(std::memory_order_acquire);
+        if(State != 0 && (State&(call_result::Filling|call_result::Registered)) == 0){
+            e.State.compare_exchange_strong(State, 0, std::memory_order_relaxed);
+        }
+    }
 }
 
 void SteamAPI_Shutdown_Hook(){
     DLOG("SteamAPI_Shutdown()\n");
+
+    // The game is about to exit, which would cut saves still being written short.
+    try {
+        flush_steam_cloud();
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+    }
 }
 
 void SteamAPI_UnregisterCallResult_Hook(CCallbackBase* Callback, SteamAPICall_t ApiCall){
@@ -1259,6 +1385,7 @@ ISteamNetworking* SteamNetworking_Hook(){
 
 ISteamRemoteStorage* SteamRemoteStorage_Hook(){
     DLOG("SteamRemoteStorage()\n");
+    SteamRemoteStorage_Instance.wait_loaded();
     return &SteamRemoteStorage_Instance;
 }
 
@@ -1,6 +1,8 @@
 ﻿#ifndef STEAM_H_INCLUDED
     #define STEAM_H_INCLUDED 1
 
+#include <string>
+
 #include "steam_api.h"
 
 bool SteamAPI_Init_Hook();
@@ -22,7 +24,24 @@ ISteamUser* SteamUser_Hook();
 ISteamUserStats* SteamUserStats_Hook();
 ISteamUtils* SteamUtils_Hook();
 
+// Drops every call result the game has not received yet, for when its state is loaded. Called from
+// the thread that runs the callbacks.
+void clear_call_results();
+
+// Starts loading the cloud from the userdata folder in the background. `SteamRemoteStorage()`
+// waits for it to finish.
 void load_steam_cloud();
+
+// Starts writing the cloud to a folder in the background. Returns false if it can't be written
+// there.
 bool save_steam_cloud(const wchar_t* Name);
 
+// Waits for every save to be written. Throws `std::runtime_error` if one failed.
+void flush_steam_cloud();
+
+// Snapshots of the cloud kept by name, they only cost memory for files written since.
+void save_cloud_snapshot(const std::string& Name);
+bool load_cloud_snapshot(const std::string& Name);
+bool delete_cloud_snapshot(const std::string& Name);
+
 #endif
@@ -0,0 +1,89 @@
+﻿#include "tracing.h"
+
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+#include <cstdio>
+
+#include <trace.h>
+
+#include "state.h"
+#include "watches.h"
+
+namespace {
+
+struct trace {
+    mmtl::watch_plan Plan;
+    std::vector<std::byte> Row;
+    std::unique_ptr<mmtl::trace_writer> Writer;
+};
+
+std::unique_ptr<trace> Trace;
+
+}
+
+void start_trace(const std::filesystem::path& Path, const std::vector<std::string>& Names){
+    std::vector<mmtl::watch> Watches;
+
+    if(Names.empty()){
+        Watches = get_watches();
+    }else{
+        for(auto& Name:Names){
+            auto& All = get_watches();
+            auto it = std::find_if(All.begin(), All.end(), [&](auto& e){ return e.Name == Name; });
+            if(it == All.end()){
+                throw std::invalid_argument("No watch named '"+Name+"'.");
+            }
+
+            Watches.push_back(*it);
+        }
+    }
+
+    auto New = std::make_unique<trace>();
+    New->Plan = mmtl::watch_plan(Watches);
+    New->Row.resize(New->Plan.size());
+
+    // Values that can not be read are recorded as 0.
+    std::vector<mmtl::trace_column> Columns;
+    for(std::size_t i = 0; i < Watches.size(); ++i){
+        Columns.push_back({Watches[i].Name, Watches[i].Type, New->Plan.value_offset(i)});
+    }
+
+    // Drop the old one first, so the same path can be used again.
+    Trace = nullptr;
+
+    New->Writer = std::make_unique<mmtl::trace_writer>(Path, std::move(Columns));
+    Trace = std::move(New);
+}
+
+void stop_trace(){
+    Trace = nullptr;
+}
+
+void flush_trace(){
+    if(Trace){
+        Trace->Writer->flush();
+    }
+}
+
+void trace_frame(){
+    if(!Trace){
+        return;
+    }
+
+    Trace->Plan.read(Trace->Row.data(), read_memory);
+
+    try {
+        Trace->Writer->write(FrameCount, Trace->Row.data());
+    }catch(const std::runtime_error& e){
+        std::fprintf(stderr, "Error: Trace stopped: %s\n", e.what());
+        Trace = nullptr;
+    }
+}
+
+void invalidate_trace(){
+    if(Trace){
+        Trace->Plan.invalidate();
+    }
+}
@@ -0,0 +1,27 @@
+﻿#ifndef TRACING_H_INCLUDED
+    #define TRACING_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <filesystem>
+
+// Records watches to a trace after every game frame. The set of watches is fixed when the trace
+// starts, changing them afterwards does not affect it.
+
+// Records every current watch, or only the ones in `Names` if it is not empty. Throws
+// `std::invalid_argument` for a name that is not a watch.
+void start_trace(const std::filesystem::path& Path, const std::vector<std::string>& Names);
+
+// Writes the rest of the trace and closes it.
+void stop_trace();
+
+// Writes everything recorded so far to disk.
+void flush_trace();
+
+// Called after every game frame, does nothing while there is no trace.
+void trace_frame();
+
+// Follows every pointer path again on the next frame. Called when a level has loaded.
+void invalidate_trace();
+
+#endif
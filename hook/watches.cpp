@@ -0,0 +1,90 @@
+﻿#include "watches.h"
+
+#include <algorithm>
+
+#include <cstring>
+
+#include <windows.h>
+
+namespace {
+
+std::vector<mmtl::watch> Watches;
+mmtl::watch_plan Plan;
+bool PlanChanged = false;
+
+std::vector<std::byte> Buffer;
+
+void update_plan(){
+    if(!PlanChanged){
+        return;
+    }
+
+    Plan = mmtl::watch_plan(Watches);
+    Buffer.assign(Plan.size(), std::byte(0));
+
+    PlanChanged = false;
+}
+
+}
+
+// Catching the fault is much cheaper than asking the system about every page first.
+bool read_memory(std::uintptr_t Address, void* Out, std::size_t Size){
+    __try {
+        std::memcpy(Out, reinterpret_cast<const void*>(Address), Size);
+        return true;
+    }__except(GetExceptionCode() == EXCEPTION_ACCESS_VIOLATION?EXCEPTION_EXECUTE_HANDLER:EXCEPTION_CONTINUE_SEARCH){
+        return false;
+    }
+}
+
+void read_watches(){
+    update_plan();
+
+    if(!Watches.empty()){
+        Plan.read(Buffer.data(), read_memory);
+    }
+}
+
+void invalidate_watches(){
+    Plan.invalidate();
+}
+
+void add_watch(mmtl::watch Watch){
+    auto it = std::find_if(Watches.begin(), Watches.end(), [&](auto& e){ return e.Name == Watch.Name; });
+    if(it != Watches.end()){
+        *it = std::move(Watch);
+    }else{
+        Watches.push_back(std::move(Watch));
+    }
+
+    PlanChanged = true;
+}
+
+bool remove_watch(const std::string& Name){
+    if(std::erase_if(Watches, [&](auto& e){ return e.Name == Name; }) == 0){
+        return false;
+    }
+
+    PlanChanged = true;
+
+    return true;
+}
+
+void clear_watches(){
+    Watches.clear();
+    PlanChanged = true;
+}
+
+const std::vector<mmtl::watch>& get_watches(){
+    return Watches;
+}
+
+const mmtl::watch_plan& get_watch_plan(){
+    update_plan();
+    return Plan;
+}
+
+std::span<const std::byte> get_watch_buffer(){
+    update_plan();
+    return Buffer;
+}
@@ -0,0 +1,31 @@
+﻿#ifndef WATCHES_H_INCLUDED
+    #define WATCHES_H_INCLUDED 1
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include <watch.h>
+
+// Copies game memory, returning false instead of crashing if it is not readable. Pointer paths go
+// through game objects that can be freed at any time.
+bool read_memory(std::uintptr_t Address, void* Out, std::size_t Size);
+
+// Reads every watch into the watch buffer in one pass. Called each frame before the script runs.
+void read_watches();
+
+// Follows every pointer path again on the next read. Called when a level has loaded.
+void invalidate_watches();
+
+// Replaces any watch with the same name.
+void add_watch(mmtl::watch Watch);
+bool remove_watch(const std::string& Name);
+void clear_watches();
+
+const std::vector<mmtl::watch>& get_watches();
+const mmtl::watch_plan& get_watch_plan();
+
+// Laid out as described by `get_watch_plan`, holds the values from the last `read_watches`.
+std::span<const std::byte> get_watch_buffer();
+
+#endif
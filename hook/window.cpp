@@ -7,6 +7,11 @@
 #include "state.h"
 #include "hooks.h"
 
+#include <queue>
+#include <deque>
+
+#include <intrin.h>
+
 constexpr int RepeatDelay = QpcFrequency/2;
 constexpr int RepeatFrequency = QpcFrequency/30;
 
@@ -25,6 +30,9 @@ constinit RECT FullScreen = {0, 0, 1920, 1080};
 constinit RECT ClipCursorRect = {0, 0, 1920, 1080};
 
 constinit HWND MainWindow;
+constinit DWORD MainWindowThread = 0;
+
+constinit int MessageInterval = 1;
 
 constinit WNDPROC WndProc_Orig;
 
@@ -38,7 +46,7 @@ struct sys_mouse:IDirectInputDevice8W {
 
     DWORD Sequence = 0;
 
-    void add_object_data(DWORD Offset, int Value){
+    void add_object_data(DWORD Offset, int Value, std::int64_t Time){
         if(DataIndex != 0){
             ObjectData.erase(ObjectData.begin(), ObjectData.begin()+DataIndex);
             DataIndex = 0;
@@ -47,7 +55,7 @@ struct sys_mouse:IDirectInputDevice8W {
         ObjectData.push_back({
             .dwOfs = Offset,
             .dwData = static_cast<DWORD>(Value),
-            .dwTimeStamp = static_cast<DWORD>(Qpc/TickConversion),
+            .dwTimeStamp = static_cast<DWORD>(Time/TickConversion),
             .dwSequence = Sequence++,
             .uAppData = 0xFFFFFFFF,
         });
@@ -570,18 +578,16 @@ LPARAM keyboard_lparam(int Key, bool Down){
     return (Down?1:0xC0000001)|(get_scancode(Key) << 16);
 }
 
-}
-
-void move_mouse(int x, int y){
+void move_mouse_at(int x, int y, std::int64_t Time){
     CursorPos.x = std::clamp(CursorPos.x+x, ClipCursorRect.left, ClipCursorRect.right);
     CursorPos.y = std::clamp(CursorPos.y+y, ClipCursorRect.top, ClipCursorRect.bottom);
 
     if(x != 0){
-        DirectInput.SysMouse.add_object_data(0, x);
+        DirectInput.SysMouse.add_object_data(0, x, Time);
     }
 
     if(y != 0){
-        DirectInput.SysMouse.add_object_data(4, y);
+        DirectInput.SysMouse.add_object_data(4, y, Time);
     }
 
     if(x != 0 || y != 0){
@@ -593,9 +599,9 @@ void move_mouse(int x, int y){
     }
 }
 
-void scroll_wheel(short Delta){
+void scroll_wheel_at(short Delta, std::int64_t Time){
     if(Delta != 0){
-        DirectInput.SysMouse.add_object_data(8, Delta);
+        DirectInput.SysMouse.add_object_data(8, Delta, Time);
 
         WindowEvents.push_back({
             .Message = WM_MOUSEWHEEL,
@@ -605,7 +611,7 @@ void scroll_wheel(short Delta){
     }
 }
 
-bool set_key(int Key, bool Down){
+bool set_key_at(int Key, bool Down, std::int64_t Time){
     switch(Key){
         case VK_CONTROL: Key = VK_LCONTROL; break;
         case VK_SHIFT:   Key = VK_LSHIFT; break;
@@ -621,22 +627,22 @@ bool set_key(int Key, bool Down){
         switch(Key){
             case VK_LBUTTON: {
                 Message = WM_LBUTTONDOWN;
-                DirectInput.SysMouse.add_object_data(12, Down << 7);
+                DirectInput.SysMouse.add_object_data(12, Down << 7, Time);
                 break;
             }
             case VK_RBUTTON: {
                 Message = WM_RBUTTONDOWN;
-                DirectInput.SysMouse.add_object_data(13, Down << 7);
+                DirectInput.SysMouse.add_object_data(13, Down << 7, Time);
                 break;
             }
             case VK_MBUTTON: {
                 Message = WM_MBUTTONDOWN;
-                DirectInput.SysMouse.add_object_data(14, Down << 7);
+                DirectInput.SysMouse.add_object_data(14, Down << 7, Time);
                 break;
             }
             case VK_XBUTTON1: {
                 Message = WM_XBUTTONDOWN;
-                DirectInput.SysMouse.add_object_data(15, Down << 7);
+                DirectInput.SysMouse.add_object_data(15, Down << 7, Time);
                 WParam = XBUTTON1 << 16;
                 break;
             }
@@ -677,7 +683,7 @@ bool set_key(int Key, bool Down){
                 RepeatKey = -1;
             }
 
-            RepeatTime = Qpc.load()+RepeatDelay;
+            RepeatTime = Time+RepeatDelay;
 
             if(Down && !get_key(VK_LCONTROL) && !get_key(VK_RCONTROL)){
                 auto Char = translate_key(Key, get_key(VK_LSHIFT) || get_key(VK_RSHIFT));
@@ -703,7 +709,113 @@ bool set_key(int Key, bool Down){
     }
 }
 
+// Scheduled input
+enum class input_kind {
+    Key, Move, Scroll,
+};
+
+struct scheduled_input {
+    std::uint64_t Frame;
+    std::int64_t Offset;
+    std::uint64_t Sequence;
+
+    input_kind Kind;
+    int a, b;
+
+    // `std::priority_queue` is a max-heap, so this orders the earliest input last.
+    bool operator<(const scheduled_input& Rhs) const {
+        if(Frame != Rhs.Frame){
+            return Frame > Rhs.Frame;
+        }else if(Offset != Rhs.Offset){
+            return Offset > Rhs.Offset;
+        }else{
+            return Sequence > Rhs.Sequence;
+        }
+    }
+};
+
+std::priority_queue<scheduled_input> ScheduledInputs = {};
+constinit std::uint64_t ScheduleSequence = 0;
+
+void push_scheduled(std::uint64_t Frame, std::int64_t Offset, input_kind Kind, int a, int b = 0){
+    assert(Offset >= 0);
+
+    ScheduledInputs.push({
+        .Frame = Frame,
+        .Offset = Offset,
+        .Sequence = ScheduleSequence++,
+        .Kind = Kind,
+        .a = a,
+        .b = b,
+    });
+}
+
+// Releases every input scheduled for the coming frame, stamped with its virtual time. The frame
+// covers `[Qpc, Qpc+FrameTime)`, so anything with a larger offset carries over to the next frame.
+// This is only exact as long as the frame time isn't changed after the input was scheduled.
+void release_scheduled(std::uint64_t Frame){
+    auto Start = Qpc.load();
+
+    while(!ScheduledInputs.empty() && ScheduledInputs.top().Frame <= Frame){
+        auto Input = ScheduledInputs.top();
+        ScheduledInputs.pop();
+
+        if(Input.Frame < Frame){
+            Input.Offset = 0;
+        }else if(Input.Offset >= FrameTime){
+            Input.Frame = Frame+1;
+            Input.Offset -= FrameTime;
+            ScheduledInputs.push(Input);
+            continue;
+        }
+
+        auto Time = Start+Input.Offset;
+
+        switch(Input.Kind){
+            case input_kind::Key: set_key_at(Input.a, Input.b != 0, Time); break;
+            case input_kind::Move: move_mouse_at(Input.a, Input.b, Time); break;
+            case input_kind::Scroll: scroll_wheel_at(static_cast<short>(Input.a), Time); break;
+        }
+    }
+}
+
+}
+
+void move_mouse(int x, int y){
+    move_mouse_at(x, y, Qpc.load());
+}
+
+void scroll_wheel(short Delta){
+    scroll_wheel_at(Delta, Qpc.load());
+}
+
+bool set_key(int Key, bool Down){
+    return set_key_at(Key, Down, Qpc.load());
+}
+
+void schedule_key(std::uint64_t Frame, std::int64_t Offset, int Key, bool Down){
+    push_scheduled(Frame, Offset, input_kind::Key, Key, Down);
+}
+
+void schedule_move(std::uint64_t Frame, std::int64_t Offset, int x, int y){
+    push_scheduled(Frame, Offset, input_kind::Move, x, y);
+}
+
+void schedule_scroll(std::uint64_t Frame, std::int64_t Offset, short Delta){
+    push_scheduled(Frame, Offset, input_kind::Scroll, Delta);
+}
+
+std::size_t scheduled_count(){
+    return ScheduledInputs.size();
+}
+
+void clear_schedule(){
+    ScheduledInputs = {};
+}
+
 void flush_events(){
+    release_scheduled(FrameCount);
+
     for(auto& Event:WindowEvents){
         WndProc_Orig(MainWindow, Event.Message, Event.WParam, Event.LParam);
     }
@@ -921,6 +1033,7 @@ HWND WINAPI CreateWindowExW_Hook(
 
     if(IsMainWindow){
         MainWindow = r;
+        MainWindowThread = GetCurrentThreadId();
     }
 
     if(is_atom(Class)){
@@ -934,6 +1047,153 @@ HWND WINAPI CreateWindowExW_Hook(
     return r;
 }
 
+// Message queue
+namespace {
+
+// Messages the game posted to itself while the real queue was not being pumped.
+std::deque<MSG> VirtualMessages = {};
+
+// `Caller` must be the hook's own `_ReturnAddress()`.
+bool is_virtual_pump(const void* Caller){
+    return GetCurrentThreadId() == MainWindowThread && in_module(Caller, GameModule);
+}
+
+bool message_matches(const MSG& Msg, HWND Window, UINT Min, UINT Max){
+    if(Window == reinterpret_cast<HWND>(-1)){
+        if(Msg.hwnd != nullptr){
+            return false;
+        }
+    }else if(Window != nullptr && Msg.hwnd != Window){
+        return false;
+    }
+
+    return (Min == 0 && Max == 0) || (Min <= Msg.message && Msg.message <= Max);
+}
+
+bool pop_virtual_message(MSG* Msg, HWND Window, UINT Min, UINT Max, bool Remove){
+    for(auto it = VirtualMessages.begin(), End = VirtualMessages.end(); it != End; ++it){
+        if(message_matches(*it, Window, Min, Max)){
+            *Msg = *it;
+            if(Remove){
+                VirtualMessages.erase(it);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// The frame `QueueBusy` was checked on, it is only asked for once a frame.
+constinit std::uint64_t QueueStatusFrame = ~std::uint64_t(0);
+constinit bool QueueBusy = false;
+
+// Whether the game's message loops see the real queue. Input reaches the game through our hooks,
+// so in fast-forward it only has to be drained every so often. Anything sent to the window or
+// needing a repaint (this includes activation) still lets it through on the next frame, since other
+// threads may be waiting on it. The movie and load screen loops pump without a frame, so they
+// always pass.
+bool pass_messages(){
+    if(
+        FrameWait || IsInLoadScreen || IsInMovie ||
+        MessageInterval <= 1 || FrameCount%static_cast<std::uint64_t>(MessageInterval) == 0
+    ){
+        return true;
+    }
+
+    if(QueueStatusFrame != FrameCount){
+        QueueStatusFrame = FrameCount;
+        QueueBusy = HIWORD(GetQueueStatus(QS_PAINT|QS_SENDMESSAGE)) != 0;
+    }
+
+    return QueueBusy;
+}
+
+bool post_virtual_message(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam){
+    if(Window != MainWindow || GetCurrentThreadId() != MainWindowThread || pass_messages()){
+        return false;
+    }
+
+    VirtualMessages.push_back({
+        .hwnd = Window,
+        .message = Message,
+        .wParam = WParam,
+        .lParam = LParam,
+        .time = static_cast<DWORD>(Qpc/TickConversion),
+        .pt = CursorPos,
+    });
+
+    return true;
+}
+
+}
+
+void set_message_interval(int Interval){
+    MessageInterval = std::max(Interval, 1);
+}
+
+BOOL WINAPI PeekMessageW_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max, UINT Remove){
+    if(is_virtual_pump(_ReturnAddress())){
+        if(pop_virtual_message(Msg, Window, Min, Max, (Remove&PM_REMOVE) != 0)){
+            return TRUE;
+        }
+
+        if(!pass_messages()){
+            return FALSE;
+        }
+    }
+
+    return PeekMessageW_Orig(Msg, Window, Min, Max, Remove);
+}
+
+BOOL WINAPI PeekMessageA_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max, UINT Remove){
+    if(is_virtual_pump(_ReturnAddress())){
+        if(pop_virtual_message(Msg, Window, Min, Max, (Remove&PM_REMOVE) != 0)){
+            return TRUE;
+        }
+
+        if(!pass_messages()){
+            return FALSE;
+        }
+    }
+
+    return PeekMessageA_Orig(Msg, Window, Min, Max, Remove);
+}
+
+BOOL WINAPI GetMessageW_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max){
+    // `GetMessage` blocks, so this never withholds the real queue.
+    if(is_virtual_pump(_ReturnAddress()) && pop_virtual_message(Msg, Window, Min, Max, true)){
+        return Msg->message != WM_QUIT;
+    }
+
+    return GetMessageW_Orig(Msg, Window, Min, Max);
+}
+
+BOOL WINAPI GetMessageA_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max){
+    if(is_virtual_pump(_ReturnAddress()) && pop_virtual_message(Msg, Window, Min, Max, true)){
+        return Msg->message != WM_QUIT;
+    }
+
+    return GetMessageA_Orig(Msg, Window, Min, Max);
+}
+
+BOOL WINAPI PostMessageW_Hook(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam){
+    if(post_virtual_message(Window, Message, WParam, LParam)){
+        return TRUE;
+    }
+
+    return PostMessageW_Orig(Window, Message, WParam, LParam);
+}
+
+BOOL WINAPI PostMessageA_Hook(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam){
+    if(post_virtual_message(Window, Message, WParam, LParam)){
+        return TRUE;
+    }
+
+    return PostMessageA_Orig(Window, Message, WParam, LParam);
+}
+
 BOOL WINAPI AdjustWindowRect_Hook(RECT* Rect, DWORD Style, BOOL Menu){
     auto Prev = *Rect;
     BOOL r = TRUE;
@@ -39,6 +39,13 @@ long WINAPI SetWindowLongW_Hook(HWND Window, int Index, long Value);
 long WINAPI GetWindowLongA_Hook(HWND Window, int Index);
 long WINAPI SetWindowLongA_Hook(HWND Window, int Index, long Value);
 
+BOOL WINAPI PeekMessageW_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max, UINT Remove);
+BOOL WINAPI PeekMessageA_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max, UINT Remove);
+BOOL WINAPI GetMessageW_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max);
+BOOL WINAPI GetMessageA_Hook(MSG* Msg, HWND Window, UINT Min, UINT Max);
+BOOL WINAPI PostMessageW_Hook(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam);
+BOOL WINAPI PostMessageA_Hook(HWND Window, UINT Message, WPARAM WParam, LPARAM LParam);
+
 BOOL WINAPI SystemParametersInfoA_Hook(UINT Action, UINT Param, void* Value, UINT WinIni);
 BOOL WINAPI SystemParametersInfoW_Hook(UINT Action, UINT Param, void* Value, UINT WinIni);
 BOOL WINAPI ClipCursor_Hook(const RECT* Rect);
@@ -67,6 +74,16 @@ bool set_key(int Index, bool Down);
 void move_mouse(int x, int y);
 void scroll_wheel(short Delta);
 
+// Queue inputs for a later frame, `Offset` QPC ticks into that frame.
+void schedule_key(std::uint64_t Frame, std::int64_t Offset, int Key, bool Down);
+void schedule_move(std::uint64_t Frame, std::int64_t Offset, int x, int y);
+void schedule_scroll(std::uint64_t Frame, std::int64_t Offset, short Delta);
+std::size_t scheduled_count();
+void clear_schedule();
+
 void clip_cursor(bool Clip);
 
+// Every `Interval` frames, the game's message loops see the real queue.
+void set_message_interval(int Interval);
+
 #endif
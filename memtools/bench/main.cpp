@@ -0,0 +1,593 @@
+﻿#include <hash.h>
+#include <scan.h>
+#include <snapshot.h>
+#include <signature.h>
+#include <work_pool.h>
+#include <page_store.h>
+#include <event_ring.h>
+#include <cloud_files.h>
+
+#include <bit>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace {
+
+std::byte* allocate(std::size_t Size){
+#ifdef _WIN32
+    return static_cast<std::byte*>(VirtualAlloc(nullptr, Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE));
+#else
+    return static_cast<std::byte*>(mmap(nullptr, Size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void release(std::byte* Memory, std::size_t Size){
+#ifdef _WIN32
+    (void)Size;
+    VirtualFree(Memory, 0, MEM_RELEASE);
+#else
+    munmap(Memory, Size);
+#endif
+}
+
+double milliseconds(std::chrono::steady_clock::time_point Begin){
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-Begin).count();
+}
+
+// Save and restore latency for a 256 MiB heap with a varying amount of it written between
+// snapshots, compared to a plain copy of the whole heap.
+void bench_snapshot(mmtl::tracking Tracking, const char* Name){
+    constexpr std::size_t Size = 256 << 20;
+    constexpr std::size_t Pages = Size/mmtl::PageSize;
+
+    auto Memory = allocate(Size);
+    std::memset(Memory, 1, Size);
+
+    auto Base = reinterpret_cast<std::uintptr_t>(Memory);
+
+#ifdef _WIN32
+    std::uint32_t Protect = PAGE_READWRITE;
+#else
+    std::uint32_t Protect = PROT_READ|PROT_WRITE;
+#endif
+
+    mmtl::snapshotter Snapshotter([&]{
+        return std::vector<mmtl::region>{{Base, Size, Base, Protect, Tracking}};
+    });
+
+    auto Begin = std::chrono::steady_clock::now();
+    auto First = Snapshotter.save();
+    std::printf("%-8s first save %8.2f ms\n", Name, milliseconds(Begin));
+
+    std::mt19937 Rng(1);
+    std::uniform_int_distribution<std::size_t> Page(0, Pages-1);
+
+    for(auto Percent:{0.1, 1.0, 5.0, 25.0}){
+        auto Count = static_cast<std::size_t>(Pages*Percent/100);
+
+        for(std::size_t i = 0; i < Count; ++i){
+            Memory[Page(Rng)*mmtl::PageSize] = std::byte(i);
+        }
+
+        mmtl::snapshot_stats SaveStats, RestoreStats;
+
+        Begin = std::chrono::steady_clock::now();
+        auto Snapshot = Snapshotter.save(&SaveStats);
+        auto Save = milliseconds(Begin);
+
+        Begin = std::chrono::steady_clock::now();
+        Snapshotter.restore(First, &RestoreStats);
+        auto Restore = milliseconds(Begin);
+
+        std::printf("%-8s %5.1f%% dirty: save %8.2f ms (%zu pages), restore %8.2f ms (%zu pages)\n",
+            Name, Percent, Save, SaveStats.Copied, Restore, RestoreStats.Written);
+    }
+
+    std::vector<std::byte> Copy(Size);
+
+    Begin = std::chrono::steady_clock::now();
+    std::memcpy(Copy.data(), Memory, Size);
+    std::printf("%-8s full copy  %8.2f ms, checksum %d\n\n", Name, milliseconds(Begin),
+        static_cast<int>(Copy[Size/2]));
+}
+
+// Made up images: a quarter zero pages, a quarter copies of a few common pages, and the rest random,
+// with 2% of the pages changing from one image to the next.
+std::vector<std::vector<std::byte>> synthetic_images(){
+    constexpr std::size_t Pages = (64 << 20)/mmtl::PageSize;
+    constexpr int Count = 8;
+
+    std::mt19937 Rng(1);
+
+    auto random_page = [&](std::byte* Out){
+        for(std::size_t i = 0; i < mmtl::PageSize; i += 4){
+            auto x = static_cast<std::uint32_t>(Rng());
+            std::memcpy(Out+i, &x, 4);
+        }
+    };
+
+    std::vector<std::byte> Common(16*mmtl::PageSize);
+    for(std::size_t i = 0; i < 16; ++i){
+        random_page(Common.data()+i*mmtl::PageSize);
+    }
+
+    std::vector<std::vector<std::byte>> r(1, std::vector<std::byte>(Pages*mmtl::PageSize));
+
+    for(std::size_t i = 0; i < Pages; ++i){
+        auto Page = r[0].data()+i*mmtl::PageSize;
+
+        switch(i%4){
+            case 0: {
+                break;
+            }
+            case 1: {
+                std::memcpy(Page, Common.data()+(Rng()%16)*mmtl::PageSize, mmtl::PageSize);
+                break;
+            }
+            default: {
+                random_page(Page);
+                break;
+            }
+        }
+    }
+
+    for(int n = 1; n < Count; ++n){
+        r.push_back(r.back());
+        for(std::size_t i = 0; i < Pages/50; ++i){
+            r.back()[(Rng()%Pages)*mmtl::PageSize+Rng()%mmtl::PageSize] = std::byte(Rng());
+        }
+    }
+
+    return r;
+}
+
+std::vector<std::byte> read_image(const char* Path){
+    std::ifstream File(Path, std::ios::binary|std::ios::ate);
+
+    std::vector<std::byte> r(static_cast<std::size_t>(File.tellg())/mmtl::PageSize*mmtl::PageSize);
+
+    File.seekg(0);
+    File.read(reinterpret_cast<char*>(r.data()), static_cast<std::streamsize>(r.size()));
+
+    return r;
+}
+
+// Stores every page of a series of memory images, as consecutive snapshots would.
+void bench_page_store(const std::vector<std::vector<std::byte>>& Images){
+    mmtl::page_store Store;
+
+    std::vector<mmtl::page_store::id> Ids;
+
+    std::size_t Bytes = 0;
+    for(auto& e:Images){
+        Bytes += e.size();
+    }
+
+    auto Begin = std::chrono::steady_clock::now();
+    for(auto& e:Images){
+        for(std::size_t i = 0; i < e.size(); i += mmtl::PageSize){
+            Ids.push_back(Store.insert(e.data()+i));
+        }
+    }
+    auto Insert = milliseconds(Begin);
+
+    auto Stats = Store.stats();
+    std::printf("%zu images, %.1f MiB: insert %.0f MiB/s, %zu of %zu pages stored, dedup ratio %.2f\n",
+        Images.size(), Bytes/1048576.0, Bytes/1048576.0/(Insert/1000), Stats.Pages, Stats.References,
+        static_cast<double>(Stats.References)/Stats.Pages);
+
+    Begin = std::chrono::steady_clock::now();
+    Store.trim();
+    Store.trim();
+    auto Trim = milliseconds(Begin);
+
+    Stats = Store.stats();
+    std::printf("compress %.0f MiB/s, %zu pages compressed, %.1f MiB in memory (%.2f of stored)\n",
+        Stats.Pages*mmtl::PageSize/1048576.0/(Trim/1000), Stats.Compressed, Stats.MemoryBytes/1048576.0,
+        static_cast<double>(Stats.MemoryBytes)/(Stats.Pages*mmtl::PageSize));
+
+    mmtl::page Out;
+    std::uint64_t Checksum = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(auto Id:Ids){
+        Store.read(Id, Out.Data);
+        Checksum += static_cast<std::uint8_t>(Out.Data[Id%mmtl::PageSize]);
+    }
+    auto Read = milliseconds(Begin);
+
+    std::printf("read %.0f MiB/s, checksum %llu\n", Bytes/1048576.0/(Read/1000),
+        static_cast<unsigned long long>(Checksum));
+
+    std::uint64_t Hash = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(auto& e:Images){
+        for(std::size_t i = 0; i < e.size(); i += mmtl::PageSize){
+            Hash ^= mmtl::hash_page(e.data()+i);
+        }
+    }
+    auto HashTime = milliseconds(Begin);
+
+    std::printf("hash %.0f MiB/s, checksum %llu\n\n", Bytes/1048576.0/(HashTime/1000),
+        static_cast<unsigned long long>(Hash));
+
+    Store.release(Ids.data(), Ids.size());
+}
+
+// Time to hash regions of various sizes once per frame, against a 60 fps frame.
+void bench_hash_memory(){
+    std::vector<std::byte> Data(std::size_t(64) << 20);
+
+    std::mt19937 Rng(1);
+    for(auto& e:Data){
+        e = std::byte(Rng());
+    }
+
+    work_pool Pool;
+
+    for(std::size_t Size:{std::size_t(4) << 10, std::size_t(1) << 20, std::size_t(16) << 20, std::size_t(64) << 20}){
+        for(auto Threads:{false, true}){
+            constexpr int Repeats = 20;
+
+            std::uint64_t Checksum = 0;
+
+            auto Begin = std::chrono::steady_clock::now();
+            for(int i = 0; i < Repeats; ++i){
+                Checksum += mmtl::hash_memory(Data.data(), Size, Threads?&Pool:nullptr);
+            }
+            auto Time = milliseconds(Begin)/Repeats;
+
+            std::printf("hash %6zu KiB, %2u threads: %8.3f ms, %6.0f MiB/s, %6.2f%% of a frame, checksum %llu\n",
+                Size >> 10, Threads?Pool.size():1, Time, Size/1048576.0/(Time/1000), Time*100/(1000.0/60),
+                static_cast<unsigned long long>(Checksum));
+        }
+    }
+
+    std::printf("\n");
+}
+
+// Scans a 256 MiB heap that looks like a game's, mostly small integers and floats, for a value,
+// then narrows the candidates down the way a search for a variable would.
+void bench_scanner(){
+    constexpr std::size_t Size = 256 << 20;
+
+    auto Memory = allocate(Size);
+    auto Base = reinterpret_cast<std::uintptr_t>(Memory);
+
+    auto Values = reinterpret_cast<std::uint32_t*>(Memory);
+    auto Count = Size/4;
+
+    std::vector<mmtl::region> Regions = {{Base, Size, Base, 0}};
+
+    work_pool Pool;
+
+    auto time = [](const char* Name, mmtl::scanner& Scanner, auto&& Fn){
+        auto Begin = std::chrono::steady_clock::now();
+        Fn();
+        auto Time = milliseconds(Begin);
+
+        std::printf("  %-24s %8.2f ms, %7.0f MiB/s, %9zu candidates, %7.1f MiB\n", Name, Time,
+            Size/1048576.0/(Time/1000), Scanner.count(), Scanner.memory_usage()/1048576.0);
+    };
+
+    for(auto Threads:{false, true}){
+        for(auto Simd:{false, true}){
+            std::printf("scan %s, %2u threads\n", Simd?"avx2  ":"scalar", Threads?Pool.size():1);
+
+            std::mt19937 Rng(1);
+            for(std::size_t i = 0; i < Count; ++i){
+                auto r = Rng();
+                Values[i] = (r%4 == 0)?std::bit_cast<std::uint32_t>(static_cast<float>(r%1000)):(r%256);
+            }
+
+            mmtl::scanner Scanner(Threads?&Pool:nullptr, Simd);
+
+            time("exact u32", Scanner, [&]{
+                Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Exact, 101);
+            });
+
+            time("unknown u32", Scanner, [&]{
+                Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Unknown);
+            });
+
+            time("unchanged", Scanner, [&]{
+                Scanner.next_scan(mmtl::scan_compare::Unchanged);
+            });
+
+            for(std::size_t i = 0; i < Count; i += 16){
+                ++Values[i];
+            }
+
+            time("changed", Scanner, [&]{
+                Scanner.next_scan(mmtl::scan_compare::Changed);
+            });
+
+            for(std::size_t i = 0; i < Count; i += 32){
+                ++Values[i];
+            }
+
+            time("increased", Scanner, [&]{
+                Scanner.next_scan(mmtl::scan_compare::Increased);
+            });
+        }
+    }
+
+    std::printf("\n");
+
+    release(Memory, Size);
+}
+
+// Finds signatures in 18 MiB of made up code, about the size of the game's, in one pass compared
+// to searching for them one at a time.
+void bench_signatures(){
+    constexpr std::size_t Size = 18 << 20;
+
+    // Skewed towards the bytes common in compiled code.
+    constexpr std::uint8_t Common[] = {0x00, 0x8B, 0x89, 0xFF, 0xE8, 0x24, 0x45, 0x4C, 0x83, 0x0F, 0x85, 0xC0, 0x55, 0x50, 0xCC, 0x01};
+
+    std::vector<std::byte> Code(Size);
+
+    std::mt19937 Rng(1);
+    for(auto& e:Code){
+        auto r = Rng();
+        e = std::byte((r%2 == 0)?Common[(r >> 1)%16]:(r >> 8));
+    }
+
+    std::vector<bool> Volatile(Size);
+
+    for(std::size_t Count:{std::size_t(5), std::size_t(64)}){
+        std::vector<mmtl::signature> Signatures;
+        while(Signatures.size() < Count){
+            if(auto Signature = mmtl::make_signature(Code.data(), Size, Rng()%Size, Volatile)){
+                Signatures.push_back(*Signature);
+            }
+        }
+
+        auto Begin = std::chrono::steady_clock::now();
+        std::size_t Matches = 0;
+        for(auto& e:mmtl::find_signatures(Code.data(), Size, Signatures)){
+            Matches += e.Count;
+        }
+        auto Together = milliseconds(Begin);
+
+        std::size_t Found = 0;
+
+        Begin = std::chrono::steady_clock::now();
+        for(auto& e:Signatures){
+            Found += mmtl::find_signatures(Code.data(), Size, {e})[0].Count;
+        }
+        auto Apart = milliseconds(Begin);
+
+        std::size_t Naive = 0;
+
+        Begin = std::chrono::steady_clock::now();
+        for(auto& e:Signatures){
+            for(std::size_t i = 0; i+e.size() <= Size; ++i){
+                Naive += e.matches(Code.data()+i);
+            }
+        }
+        auto Plain = milliseconds(Begin);
+
+        std::printf("%2zu signatures: one pass %8.2f ms (%6.0f MiB/s), one at a time %8.2f ms, naive %8.2f ms, %zu/%zu/%zu found\n",
+            Count, Together, Size/1048576.0/(Together/1000), Apart, Plain, Matches, Found, Naive);
+    }
+
+    std::printf("\n");
+}
+
+// The cost of filtering every call by name, against a standard set. Most lookups miss, as most
+// calls are not filtered.
+void bench_key_set(){
+    std::mt19937 Rng(1);
+
+    std::vector<std::int32_t> Lookups(std::size_t(16) << 20);
+    for(auto& e:Lookups){
+        e = static_cast<std::int32_t>(Rng()%200000);
+    }
+
+    for(std::size_t Count:{std::size_t(16), std::size_t(1024)}){
+        std::vector<std::int32_t> Keys;
+        for(std::size_t i = 0; i < Count; ++i){
+            Keys.push_back(static_cast<std::int32_t>(Rng()%200000));
+        }
+
+        mmtl::key_set Set(Keys);
+        std::unordered_set<std::int32_t> Standard(Keys.begin(), Keys.end());
+
+        std::size_t Hits = 0;
+
+        auto Begin = std::chrono::steady_clock::now();
+        for(auto e:Lookups){
+            Hits += Set.contains(e);
+        }
+        auto Open = milliseconds(Begin);
+
+        std::size_t StandardHits = 0;
+
+        Begin = std::chrono::steady_clock::now();
+        for(auto e:Lookups){
+            StandardHits += Standard.contains(e);
+        }
+        auto Std = milliseconds(Begin);
+
+        std::printf("%4zu keys: key_set %5.2f ns/lookup, unordered_set %5.2f ns/lookup, %zu/%zu hits\n",
+            Count, Open*1e6/Lookups.size(), Std*1e6/Lookups.size(), Hits, StandardHits);
+    }
+
+    mmtl::event_ring Ring(4096);
+    std::vector<mmtl::traced_event> Events;
+
+    auto Begin = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < Lookups.size(); ++i){
+        Ring.push({.Frame = i, .Object = 0, .Function = 0, .Name = Lookups[i]});
+        if(i%1024 == 0){
+            Events.clear();
+            Ring.drain(Events);
+        }
+    }
+    auto Push = milliseconds(Begin);
+
+    std::printf("event_ring: %5.2f ns/push, %llu dropped\n\n", Push*1e6/Lookups.size(),
+        static_cast<unsigned long long>(Ring.dropped()));
+}
+
+// Lookups in a cloud with thousands of files, as every save and checkpoint the game writes stays
+// in it, against comparing every name like the emulated API used to.
+void bench_cloud_files(){
+    constexpr std::size_t Count = 4096;
+
+    std::vector<mmtl::cloud_files::file> Loaded;
+    for(std::size_t i = 0; i < Count; ++i){
+        char Name[32];
+        std::snprintf(Name, sizeof(Name), "Dishonored_Save%04zu.sav", i);
+        Loaded.push_back({
+            .Name = Name,
+            .Data = std::make_shared<const mmtl::cloud_data>(std::vector<unsigned char>(std::size_t(64) << 10)),
+            .Timestamp = static_cast<std::int64_t>(i),
+        });
+    }
+
+    auto Plain = Loaded;
+    mmtl::cloud_files Files(std::move(Loaded));
+
+    // Lower case, as the game asks for names in a different case than they were written in.
+    std::mt19937 Rng(1);
+    std::vector<std::string> Lookups;
+    for(std::size_t i = 0; i < 100000; ++i){
+        char Name[32];
+        std::snprintf(Name, sizeof(Name), "dishonored_save%04zu.sav", static_cast<std::size_t>(Rng()%(Count+Count/8)));
+        Lookups.push_back(Name);
+    }
+
+    auto equal = [](const std::string& a, const std::string& b){
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y){
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    };
+
+    std::size_t Found = 0;
+
+    auto Begin = std::chrono::steady_clock::now();
+    for(auto& e:Lookups){
+        Found += (Files.find(e) != nullptr);
+    }
+    auto Indexed = milliseconds(Begin);
+
+    std::size_t ScanFound = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(auto& e:Lookups){
+        for(auto& File:Plain){
+            if(equal(File.Name, e)){
+                ++ScanFound;
+                break;
+            }
+        }
+    }
+    auto Scan = milliseconds(Begin);
+
+    std::printf("%zu cloud files: index %7.1f ns/lookup, scan %9.1f ns/lookup, %zu/%zu found\n",
+        Count, Indexed*1e6/Lookups.size(), Scan*1e6/Lookups.size(), Found, ScanFound);
+
+    std::uint64_t Quota = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < 1000; ++i){
+        Quota += Files.total_size();
+    }
+    auto Running = milliseconds(Begin);
+
+    std::uint64_t SumQuota = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < 1000; ++i){
+        for(auto& File:Plain){
+            SumQuota += File.size();
+        }
+    }
+    auto Summed = milliseconds(Begin);
+
+    std::printf("quota: running total %7.1f ns, summed %9.1f ns, %s\n\n", Running*1e6/1000, Summed*1e6/1000,
+        (Quota == SumQuota)?"same":"different");
+}
+
+// Loading a userdata folder at startup, reading every file against mapping it. Files are mostly
+// in the page cache after the first pass, so this is the cost of copying them, not of the disk.
+void bench_cloud_load(){
+    constexpr std::size_t Count = 256;
+    constexpr std::size_t Size = std::size_t(256) << 10;
+
+    auto Directory = std::filesystem::temp_directory_path()/"memtools-bench-cloud";
+    std::filesystem::remove_all(Directory);
+    std::filesystem::create_directories(Directory);
+
+    std::vector<char> Contents(Size, 'x');
+    for(std::size_t i = 0; i < Count; ++i){
+        std::ofstream(Directory/("Save"+std::to_string(i)+".sav"), std::ios::binary).write(Contents.data(), Size);
+    }
+
+    std::uint64_t ReadBytes = 0;
+
+    auto Begin = std::chrono::steady_clock::now();
+    for(auto& Entry:std::filesystem::directory_iterator(Directory)){
+        std::ifstream File(Entry.path(), std::ios::binary);
+        std::vector<unsigned char> Buffer(Entry.file_size());
+        File.read(reinterpret_cast<char*>(Buffer.data()), static_cast<std::streamsize>(Buffer.size()));
+        auto Data = std::make_shared<const mmtl::cloud_data>(std::move(Buffer));
+        ReadBytes += Data->size();
+    }
+    auto Read = milliseconds(Begin);
+
+    std::uint64_t MappedBytes = 0;
+
+    Begin = std::chrono::steady_clock::now();
+    for(auto& Entry:std::filesystem::directory_iterator(Directory)){
+        MappedBytes += mmtl::cloud_data::map(Entry.path())->size();
+    }
+    auto Mapped = milliseconds(Begin);
+
+    std::printf("%zu cloud files of %zu KiB: read %7.2f ms, mapped %7.2f ms, %s\n\n", Count, Size >> 10, Read, Mapped,
+        (ReadBytes == MappedBytes)?"same":"different");
+
+    std::filesystem::remove_all(Directory);
+}
+
+}
+
+// Arguments are raw memory images to use for the page store, in the order they were taken.
+int main(int Argc, char** Argv){
+    std::vector<std::vector<std::byte>> Images;
+    for(int i = 1; i < Argc; ++i){
+        Images.push_back(read_image(Argv[i]));
+    }
+
+    if(Images.empty()){
+        Images = synthetic_images();
+    }
+
+    bench_page_store(Images);
+    bench_hash_memory();
+    bench_scanner();
+    bench_signatures();
+    bench_key_set();
+    bench_cloud_files();
+    bench_cloud_load();
+
+    bench_snapshot(mmtl::tracking::Protect, "protect");
+    bench_snapshot(mmtl::tracking::Compare, "compare");
+}
@@ -0,0 +1,200 @@
+﻿#ifndef CLOUD_FILES_H_INCLUDED
+    #define CLOUD_FILES_H_INCLUDED 1
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// The contents of a cloud file, either held in memory or mapped read only from a file, in which
+// case the system only reads the pages that are used. Immutable either way.
+struct cloud_data {
+    explicit cloud_data(std::vector<unsigned char> Bytes = {});
+
+    // All of the file at `Path`. Throws `std::runtime_error` if it can't be opened or mapped.
+    static std::shared_ptr<const cloud_data> map(const std::filesystem::path& Path);
+
+    ~cloud_data();
+
+    cloud_data(const cloud_data&)=delete;
+    cloud_data& operator=(const cloud_data&)=delete;
+
+    const unsigned char* data() const {
+        return Data;
+    }
+
+    std::size_t size() const {
+        return Size;
+    }
+
+    bool mapped() const {
+        return View != nullptr;
+    }
+
+    // Compares the contents.
+    bool operator==(const cloud_data& Other) const;
+
+private:
+    cloud_data(void* View, std::size_t Size);
+
+    std::vector<unsigned char> Bytes;
+    // Null unless mapped.
+    void* View = nullptr;
+
+    const unsigned char* Data;
+    std::size_t Size;
+};
+
+// The files of an emulated Steam cloud. Names are compared ignoring ASCII case, like Steam does
+// on Windows, through a hash index, and the total size is kept up to date as files are written.
+//
+// Copies share everything until one of them is written to, so a copy is a snapshot that costs
+// one reference count, and a write after taking one copies the list of files but not their
+// contents. Contents are immutable: a write replaces a file's buffer instead of changing it, so
+// a buffer handed out stays valid and unchanged for as long as it is held. That also makes mapped
+// files copy on write: they are only read into memory of their own once the game writes them.
+//
+// Not thread safe, but copies can be used on different threads.
+struct cloud_files {
+    using buffer = std::shared_ptr<const cloud_data>;
+
+    struct file {
+        // As first written.
+        std::string Name;
+        // Never null.
+        buffer Data;
+        std::int64_t Timestamp;
+
+        std::size_t size() const {
+            return Data->size();
+        }
+    };
+
+    cloud_files();
+
+    // In this order. Of names that only differ in case, the last one's contents are kept.
+    explicit cloud_files(std::vector<file> Files);
+
+    // Null if there is no such file.
+    const file* find(std::string_view Name) const;
+
+    // Creates the file if it doesn't exist.
+    const file& write(std::string_view Name, buffer Data, std::int64_t Timestamp);
+    const file& write(std::string_view Name, const unsigned char* Data, std::size_t Size, std::int64_t Timestamp);
+
+    // In the order they were created.
+    const file& operator[](std::size_t Index) const {
+        return Contents->Files[Index];
+    }
+
+    std::size_t size() const {
+        return Contents->Files.size();
+    }
+
+    // Of every file together.
+    std::uint64_t total_size() const {
+        return Contents->TotalSize;
+    }
+
+    auto begin() const {
+        return Contents->Files.cbegin();
+    }
+
+    auto end() const {
+        return Contents->Files.cend();
+    }
+
+    // Whether both are the same snapshot, without a write to either since.
+    bool shares(const cloud_files& Other) const {
+        return Contents == Other.Contents;
+    }
+
+private:
+    struct fold_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const;
+    };
+
+    struct fold_equal {
+        using is_transparent = void;
+        bool operator()(std::string_view a, std::string_view b) const;
+    };
+
+    struct contents {
+        std::vector<file> Files;
+        std::unordered_map<std::string, std::size_t, fold_hash, fold_equal> Index;
+        std::uint64_t TotalSize = 0;
+    };
+
+    // Copies the contents first if another snapshot has them too.
+    contents& unshare();
+
+    // Never null.
+    std::shared_ptr<contents> Contents;
+};
+
+// Writes cloud snapshots to directories on a thread of its own, so saving doesn't stall the game.
+// Only files whose contents changed since they were last written to the same directory by this
+// writer are written again, and files it wrote there that are no longer in the cloud are removed.
+// Of several snapshots queued for the same directory, only the last is written.
+struct cloud_writer {
+    cloud_writer();
+
+    // Writes whatever is left.
+    ~cloud_writer();
+
+    cloud_writer(const cloud_writer&)=delete;
+    cloud_writer& operator=(const cloud_writer&)=delete;
+
+    void write(const std::filesystem::path& Directory, cloud_files Files);
+
+    // Waits for everything queued to be on disk. Throws `std::runtime_error` if something could
+    // not be written since the last `flush`.
+    void flush();
+
+    // Files written and skipped as unchanged so far.
+    std::size_t written() const;
+    std::size_t skipped() const;
+
+private:
+    struct job {
+        std::filesystem::path Directory;
+        cloud_files Files;
+    };
+
+    void run();
+    void write_directory(const job& Job);
+
+    mutable std::mutex Mutex;
+    std::condition_variable Wake;
+    std::condition_variable Idle;
+    std::deque<job> Queue;
+    bool Busy = false;
+    bool Stopping = false;
+    std::string Error;
+
+    std::size_t Written = 0;
+    std::size_t Skipped = 0;
+
+    // What this writer last wrote to every directory, by the name it was written with. Only used
+    // by its thread.
+    std::map<std::filesystem::path, std::unordered_map<std::string, cloud_files::buffer>> OnDisk;
+
+    std::thread Thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,112 @@
+﻿#ifndef CODE_INDEX_H_INCLUDED
+    #define CODE_INDEX_H_INCLUDED 1
+
+#include <pe.h>
+
+#include <span>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+struct work_pool;
+
+namespace mmtl {
+
+// Addresses in the index are RVAs.
+struct code_function {
+    std::uint32_t Start;
+    // Past the last instruction found, which may include the code of other functions in between.
+    std::uint32_t End;
+};
+
+enum class xref_kind : std::uint32_t {
+    Call,
+    // A jump to another function, like a tail call or a thunk.
+    Jump,
+    // Anything else using the address, like reading a global or pushing a string.
+    Data,
+};
+
+struct code_xref {
+    // The instruction with the reference.
+    std::uint32_t From;
+    std::uint32_t To;
+    xref_kind Kind;
+};
+
+struct code_index_stats {
+    std::size_t Functions = 0;
+    std::size_t Instructions = 0;
+    std::size_t Xrefs = 0;
+    std::size_t Strings = 0;
+};
+
+// Finds the functions of a 32 bit image by decoding its code recursively from the entry point,
+// the exports and pointers to code elsewhere in the image, like virtual function tables, and
+// records every call and reference between them, then writes it all to `Path` for `code_index`.
+// Functions are decoded on the threads of `Pool`, if there is one.
+//
+// Throws `std::runtime_error` if the image is not 32 bit or the index can't be written.
+code_index_stats build_code_index(const pe_image& Image, const std::filesystem::path& Path, work_pool* Pool = nullptr);
+
+// An index written by `build_code_index`, mapped into memory. Queries are binary searches, except
+// for looking up strings.
+struct code_index {
+    // Throws `std::runtime_error` if the file can't be mapped or is not an index.
+    explicit code_index(const std::filesystem::path& Path);
+    ~code_index();
+
+    code_index(const code_index&)=delete;
+    code_index& operator=(const code_index&)=delete;
+
+    // Of the image the index was built from, to check that it matches.
+    std::uint32_t timestamp() const;
+    std::uint32_t image_size() const;
+
+    // Sorted by start.
+    std::span<const code_function> functions() const;
+
+    // The function starting closest before `Rva`, if it contains `Rva`, or null.
+    const code_function* function_at(std::uint32_t Rva) const;
+
+    // Every reference to exactly `Rva`, sorted by where they are from.
+    std::span<const code_xref> references_to(std::uint32_t Rva) const;
+
+    // Every reference made from `[Begin, End)`.
+    std::vector<code_xref> references_from(std::uint32_t Begin, std::uint32_t End) const;
+
+    // The starts of the functions calling or jumping to `Rva`, sorted.
+    std::vector<std::uint32_t> callers(std::uint32_t Rva) const;
+
+    // The starts of the functions referencing a string that contains `Text`, sorted. Both 8 bit and
+    // UTF-16 strings are found, the latter only if they are ASCII.
+    std::vector<std::uint32_t> functions_referencing(std::string_view Text) const;
+
+    // The referenced string at `Rva`, empty if there is none.
+    std::string_view string_at(std::uint32_t Rva) const;
+
+private:
+    friend code_index_stats build_code_index(const pe_image&, const std::filesystem::path&, work_pool*);
+
+    struct header;
+    struct string_entry;
+
+    const header* Header = nullptr;
+    const code_function* Functions = nullptr;
+    const code_xref* Xrefs = nullptr;
+    // Indices into `Xrefs`, sorted by where the reference is from.
+    const std::uint32_t* XrefsFrom = nullptr;
+    const string_entry* Strings = nullptr;
+    const char* StringData = nullptr;
+
+    void* Mapping = nullptr;
+    std::size_t Size = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+﻿#ifndef DIRTY_H_INCLUDED
+    #define DIRTY_H_INCLUDED 1
+
+#include <regions.h>
+
+#include <memory>
+#include <vector>
+
+namespace mmtl {
+
+// Records which pages of a set of regions have been written to. Regions with `tracking::Protect`
+// are write protected, and the first write to a page is caught by a process wide fault handler,
+// which marks the page and makes it writable again. `tracking::WriteWatch` regions use
+// `GetWriteWatch`. `tracking::Compare` regions are ignored.
+//
+// Only one tracker can exist at a time.
+struct dirty_tracker {
+    dirty_tracker();
+    ~dirty_tracker();
+
+    dirty_tracker(const dirty_tracker&)=delete;
+    dirty_tracker& operator=(const dirty_tracker&)=delete;
+
+    // Starts tracking `Regions`, which must be sorted, replacing the previous set. Every page starts
+    // out clean.
+    void watch(const std::vector<region>& Regions);
+    void unwatch();
+
+    // Appends the pages written to since the last call, or since they started being watched, and
+    // starts watching them again.
+    void collect(std::vector<std::uintptr_t>& Pages);
+
+    // Lets the caller write to `[Begin, End)` without it being recorded. Must be paired with `end_write`.
+    void begin_write(std::uintptr_t Begin, std::uintptr_t End);
+    void end_write(std::uintptr_t Begin, std::uintptr_t End);
+
+    struct table;
+
+private:
+    std::unique_ptr<table> Table;
+
+    // Recent tables the fault handler may still be looking at.
+    std::vector<std::unique_ptr<table>> Retired;
+};
+
+}
+
+#endif
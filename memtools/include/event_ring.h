@@ -0,0 +1,100 @@
+﻿#ifndef EVENT_RING_H_INCLUDED
+    #define EVENT_RING_H_INCLUDED 1
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// A fixed set of 32 bit keys, for filters on hot paths. Open addressing with linear probing at
+// most a quarter full, so a miss usually costs one load and a predictable branch.
+struct key_set {
+    key_set()=default;
+
+    // Throws `std::invalid_argument` for `INT32_MIN`, which marks empty slots.
+    explicit key_set(const std::vector<std::int32_t>& Keys);
+
+    bool contains(std::int32_t Key) const {
+        if(Count == 0){
+            return false;
+        }
+
+        for(auto i = (static_cast<std::uint32_t>(Key)*0x9E3779B9u) >> Shift;; i = (i+1)&Mask){
+            if(Slots[i] == Key){
+                return true;
+            }
+
+            if(Slots[i] == Empty){
+                return false;
+            }
+        }
+    }
+
+    std::size_t size() const {
+        return Count;
+    }
+
+    bool empty() const {
+        return Count == 0;
+    }
+
+private:
+    static constexpr std::int32_t Empty = INT32_MIN;
+
+    std::vector<std::int32_t> Slots;
+    std::uint32_t Shift = 0;
+    std::uint32_t Mask = 0;
+    std::size_t Count = 0;
+};
+
+// A call seen by a hook.
+struct traced_event {
+    std::uint64_t Frame;
+    std::uintptr_t Object;
+    std::uintptr_t Function;
+    std::int32_t Name;
+};
+
+// A bounded queue of events, lock free for any number of threads pushing and one draining. Events
+// pushed while it is full are dropped and counted, the hook must never wait.
+struct event_ring {
+    // `Capacity` is rounded up to a power of two.
+    explicit event_ring(std::size_t Capacity);
+
+    bool push(const traced_event& Event);
+
+    // Appends every event pushed so far to `Out`, oldest first. Returns how many.
+    std::size_t drain(std::vector<traced_event>& Out);
+
+    std::size_t capacity() const {
+        return Mask+1;
+    }
+
+    std::uint64_t dropped() const {
+        return Dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct cell {
+        // The position the cell is next written at, or that plus one once it has been.
+        std::atomic<std::size_t> Sequence;
+        traced_event Event;
+    };
+
+    std::unique_ptr<cell[]> Cells;
+    std::size_t Mask;
+
+    // Apart, so the threads pushing don't slow the one draining.
+    alignas(64) std::atomic<std::size_t> Head = 0;
+    alignas(64) std::size_t Tail = 0;
+
+    std::atomic<std::uint64_t> Dropped = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+﻿#ifndef FILE_CACHE_H_INCLUDED
+    #define FILE_CACHE_H_INCLUDED 1
+
+#include <map>
+#include <list>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <cloud_files.h>
+
+namespace mmtl {
+
+// Read only files kept mapped between opens, so reading them again costs a copy instead of a
+// system call. Mappings of the same file share their pages with every other process that maps it,
+// so instances running side by side warm the cache for each other.
+//
+// A thread of its own touches the pages ahead of every read, and whole files asked for with
+// `prefetch`, so reads find them in memory. Mappings that are no longer open are dropped, least
+// recently opened first, once more than the budget is mapped; the address space of a 32-bit
+// process doesn't fit every package of a game.
+struct file_cache {
+    struct file:std::enable_shared_from_this<file> {
+        std::filesystem::path Path;
+        std::shared_ptr<const cloud_data> Data;
+
+        // How far the pages have been touched, and how far they should be.
+        std::atomic<std::uint64_t> Warmed = 0;
+        std::atomic<std::uint64_t> Wanted = 0;
+        // Whether it is in the queue.
+        bool Queued = false;
+    };
+
+    struct counters {
+        std::uint64_t Reads = 0;
+        // Reads of pages that had been touched ahead of them.
+        std::uint64_t Hits = 0;
+        std::uint64_t Bytes = 0;
+    };
+
+    explicit file_cache(std::uint64_t Budget = std::uint64_t(256) << 20, std::size_t ReadAhead = std::size_t(1) << 20);
+
+    ~file_cache();
+
+    file_cache(const file_cache&)=delete;
+    file_cache& operator=(const file_cache&)=delete;
+
+    // The same object for every open of the same path, while it is kept. Null if the file can't be
+    // mapped or is larger than the budget.
+    std::shared_ptr<file> open(const std::filesystem::path& Path);
+
+    // Returns how much was read, short at the end of the file. Touches pages ahead of it.
+    std::size_t read(file& File, std::uint64_t Offset, void* Data, std::size_t Size);
+
+    // Touches all of a file in the background.
+    void prefetch(const std::filesystem::path& Path);
+
+    // Waits for everything queued to be touched.
+    void wait();
+
+    counters count() const;
+
+    std::uint64_t mapped() const;
+
+private:
+    void want(file& File, std::uint64_t End);
+    void evict();
+    void run();
+
+    std::uint64_t Budget;
+    std::size_t ReadAhead;
+
+    mutable std::mutex Mutex;
+    std::condition_variable Wake;
+    std::condition_variable Idle;
+    std::deque<std::shared_ptr<file>> Queue;
+    bool Busy = false;
+    // Also checked while touching a file, which can take a while.
+    std::atomic<bool> Stopping = false;
+
+    // Most recently opened first.
+    std::list<std::shared_ptr<file>> Recent;
+    std::unordered_map<std::string, std::list<std::shared_ptr<file>>::iterator> Index;
+    std::uint64_t Mapped = 0;
+
+    std::atomic<std::uint64_t> Reads = 0;
+    std::atomic<std::uint64_t> Hits = 0;
+    std::atomic<std::uint64_t> Bytes = 0;
+
+    std::thread Thread;
+};
+
+// The files every level's load read, in the order they were first read. A level is known by the
+// first file its load reads, which for Unreal packages is the map. Kept in a text file between
+// runs, with a line for every level and a tab in front of every file of it.
+struct load_log {
+    // A missing file is an empty log.
+    void read(const std::filesystem::path& Path);
+
+    // Throws `std::runtime_error` if it can't be written.
+    void write(const std::filesystem::path& Path) const;
+
+    // Null if the level wasn't loaded before.
+    const std::vector<std::string>* find(std::string_view Level) const;
+
+    // Replaces what was logged for the level before.
+    void record(const std::string& Level, std::vector<std::string> Files);
+
+    std::size_t size() const {
+        return Loads.size();
+    }
+
+private:
+    std::map<std::string, std::vector<std::string>, std::less<>> Loads;
+};
+
+}
+
+#endif
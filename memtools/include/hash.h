@@ -0,0 +1,28 @@
+﻿#ifndef HASH_H_INCLUDED
+    #define HASH_H_INCLUDED 1
+
+#include <regions.h>
+
+#include <cstddef>
+#include <cstdint>
+
+struct work_pool;
+
+namespace mmtl {
+
+using page_hash = std::uint64_t;
+
+// A 64-bit hash of `Size` bytes, using SSE2 where available. Not meant to resist attacks, only to
+// tell apart memory that differs.
+page_hash hash_bytes(const void* Data, std::size_t Size);
+
+// `hash_bytes` of `PageSize` bytes.
+page_hash hash_page(const void* Data);
+
+// A hash of a large block of memory, split into pieces hashed on `Pool` if given. The result only
+// depends on the data, not on the number of threads.
+page_hash hash_memory(const void* Data, std::size_t Size, work_pool* Pool = nullptr);
+
+}
+
+#endif
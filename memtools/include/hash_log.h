@@ -0,0 +1,69 @@
+﻿#ifndef HASH_LOG_H_INCLUDED
+    #define HASH_LOG_H_INCLUDED 1
+
+#include <hash.h>
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+namespace mmtl {
+
+// A log of per frame hashes of a set of named regions, to find where two runs that should be the
+// same start to differ.
+//
+// The file starts with `DHTASFH1`, followed by records starting with a type byte:
+// - `R`: the region names for the following frames, a 32-bit count, then every name as a 16-bit
+//   length and that many bytes.
+// - `F`: a frame, a 64-bit frame count, then a 64-bit hash for every region.
+//
+// Everything is little endian.
+struct hash_log_writer {
+    // Throws `std::runtime_error` if the file can not be created.
+    explicit hash_log_writer(const std::filesystem::path& Path);
+
+    void set_regions(const std::vector<std::string>& Names);
+
+    // Writes a frame. `Hashes` must match the last `set_regions`.
+    void write(std::uint64_t FrameCount, const std::vector<page_hash>& Hashes);
+
+    // Frames are buffered until this, or until the writer is destroyed.
+    void flush();
+
+private:
+    std::ofstream File;
+    std::size_t RegionCount = 0;
+};
+
+struct hash_log {
+    struct frame {
+        std::uint64_t FrameCount;
+        // Index into `Regions`.
+        std::size_t Table;
+        std::vector<page_hash> Hashes;
+    };
+
+    std::vector<std::vector<std::string>> Regions;
+    std::vector<frame> Frames;
+
+    // Throws `std::runtime_error` if the file can not be read. A truncated last frame is ignored.
+    static hash_log read(const std::filesystem::path& Path);
+};
+
+struct divergence {
+    // Index into `hash_log::Frames`.
+    std::size_t Frame;
+    std::uint64_t FrameCount;
+    std::string Region;
+    page_hash a, b;
+};
+
+// The first frame at which a region present in both logs has a different hash. Frames are matched
+// by their position in the log.
+std::optional<divergence> first_divergence(const hash_log& a, const hash_log& b);
+
+}
+
+#endif
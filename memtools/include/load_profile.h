@@ -0,0 +1,79 @@
+﻿#ifndef LOAD_PROFILE_H_INCLUDED
+    #define LOAD_PROFILE_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include <cstdint>
+
+namespace mmtl {
+
+enum class load_io : std::uint8_t {
+    Open, Read,
+};
+
+// Times are in 100 ns ticks, from the start of the load.
+struct load_event {
+    std::uint64_t Start;
+    std::uint64_t Duration;
+    std::uint64_t Bytes;
+    // An index into `load_profile::Files`.
+    std::uint32_t File;
+    std::uint32_t Thread;
+    load_io Kind;
+};
+
+struct load_thread {
+    std::uint32_t Id;
+    // User and kernel time spent during the load, in 100 ns ticks.
+    std::uint64_t CpuTime;
+};
+
+struct load_file_summary {
+    std::uint32_t File;
+    std::uint64_t Opens;
+    std::uint64_t Reads;
+    std::uint64_t Bytes;
+    // Spent in opens and reads, summed over threads.
+    std::uint64_t Time;
+};
+
+// What a single load did, for finding out why it was slow.
+//
+// The file starts with `DHTASLP1`, then the real and virtual time, the level, the files, the threads
+// and the events. Every number is an unsigned LEB128 varint, strings are their length and that
+// many bytes, lists their length and that many items. An event is the difference of its start to
+// the previous event's start, ZigZag encoded since events are in the order they ended, then its
+// duration, bytes, file, thread and kind.
+struct load_profile {
+    // The first package the load opened.
+    std::string Level;
+    std::uint64_t RealTime = 0;
+    // As the game sees it, which only passes with frames.
+    std::uint64_t VirtualTime = 0;
+    std::vector<std::string> Files;
+    std::vector<load_thread> Threads;
+    std::vector<load_event> Events;
+
+    // Adds a file if it is new. Returns its index.
+    std::uint32_t file(std::string_view Path);
+
+    // Totals per file, the one that took longest first.
+    std::vector<load_file_summary> summary() const;
+
+    // Throws `std::runtime_error` if the file can not be written.
+    void write(const std::filesystem::path& Path) const;
+
+    // Throws `std::runtime_error` if the file can not be read or is not a profile.
+    static load_profile read(const std::filesystem::path& Path);
+
+private:
+    std::unordered_map<std::string, std::uint32_t> Indices;
+};
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+﻿#ifndef LOG_RING_H_INCLUDED
+    #define LOG_RING_H_INCLUDED 1
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// The newest bytes written to a log, for logs that are only read when something went wrong. Older
+// bytes are overwritten once it is full. Not thread safe.
+struct log_ring {
+    // Throws `std::invalid_argument` for a capacity of zero.
+    explicit log_ring(std::size_t Capacity);
+
+    void write(const void* Data, std::size_t Size);
+
+    // What is kept, oldest first, in up to two pieces. Once bytes were overwritten, it starts at
+    // the first whole line.
+    std::pair<std::string_view, std::string_view> view() const;
+    std::string text() const;
+
+    void clear();
+
+    // Everything written so far, kept or not.
+    std::uint64_t size() const {
+        return Written;
+    }
+
+    std::uint64_t dropped() const {
+        return (Written > Capacity)?Written-Capacity:0;
+    }
+
+    std::size_t capacity() const {
+        return Capacity;
+    }
+
+private:
+    std::unique_ptr<char[]> Data;
+    std::size_t Capacity;
+
+    // Where the next byte goes.
+    std::size_t Next = 0;
+    std::uint64_t Written = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+﻿#ifndef OVERLAY_FS_H_INCLUDED
+    #define OVERLAY_FS_H_INCLUDED 1
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+#include <unordered_map>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <cloud_files.h>
+
+namespace mmtl {
+
+// A directory tree seen through an in-memory overlay. Files are read from the base directory until
+// they are written to, and from memory after that; nothing is ever written to the base, so any
+// number of processes can share it. Paths are relative to the base and compared ignoring ASCII
+// case, like on Windows.
+//
+// Only files can be renamed, and only empty directories removed. Thread safe.
+struct overlay_fs {
+    enum class disposition : std::uint8_t {
+        CreateNew,
+        CreateAlways,
+        OpenExisting,
+        OpenAlways,
+        TruncateExisting,
+    };
+
+    enum class status : std::uint8_t {
+        Created,
+        Opened,
+        NotFound,
+        // The parent directory doesn't exist.
+        PathNotFound,
+        Exists,
+        IsDirectory,
+    };
+
+    // The contents of a file, shared by everything that opened it. Stays usable after the file
+    // is removed, like an open file on Linux.
+    struct file;
+
+    struct entry {
+        std::filesystem::path Name;
+        bool Directory;
+        std::uint64_t Size;
+    };
+
+    explicit overlay_fs(std::filesystem::path Base);
+    ~overlay_fs();
+
+    overlay_fs(const overlay_fs&)=delete;
+    overlay_fs& operator=(const overlay_fs&)=delete;
+
+    const std::filesystem::path& base() const {
+        return Base;
+    }
+
+    // `Path` relative to the base, if it's an absolute path inside it.
+    std::optional<std::filesystem::path> relative(const std::filesystem::path& Path) const;
+
+    // Sets `r` if the result is `Created` or `Opened`. Truncates the file for `CreateAlways` and
+    // `TruncateExisting`. Throws `std::runtime_error` if the base file can't be read.
+    status open(const std::filesystem::path& Path, disposition Disposition, std::shared_ptr<file>& r);
+
+    // Returns how much was read, short at the end of the file.
+    std::size_t read(file& File, std::uint64_t Offset, void* Data, std::size_t Size);
+
+    // Extends the file with zeros if `Offset` is past its end.
+    void write(file& File, std::uint64_t Offset, const void* Data, std::size_t Size);
+
+    std::uint64_t size(file& File);
+    void resize(file& File, std::uint64_t Size);
+
+    std::optional<entry> stat(const std::filesystem::path& Path);
+
+    // Sorted by name ignoring case, false if `Directory` isn't one.
+    bool list(const std::filesystem::path& Directory, std::vector<entry>& r);
+
+    // `Opened` if the file was removed.
+    status remove(const std::filesystem::path& Path);
+
+    // `Opened` if the file was moved, or `Exists` if `To` exists and `Replace` isn't set. Files
+    // opened under the old name stay open. Throws `std::runtime_error` if the base file can't be
+    // read.
+    status rename(const std::filesystem::path& From, const std::filesystem::path& To, bool Replace);
+
+    // `Opened` if the directory was removed, or `Exists` if it isn't empty.
+    status remove_directory(const std::filesystem::path& Path);
+
+    // `Created` if the directory was created.
+    status create_directory(const std::filesystem::path& Path);
+
+    // Writes the whole tree as it is seen through the overlay to `Directory`. Throws
+    // `std::runtime_error` if it can't.
+    void save(const std::filesystem::path& Directory);
+
+private:
+    enum class kind : std::uint8_t {
+        Missing,
+        File,
+        Directory,
+    };
+
+    struct node {
+        // As created, or as in the base.
+        std::filesystem::path Name;
+        bool Directory = false;
+        bool Removed = false;
+        // Null for directories, and for base files that haven't been opened yet.
+        std::shared_ptr<file> File;
+    };
+
+    // Where `Path` is in the base, matching names ignoring case even if the file system doesn't.
+    std::filesystem::path resolve(const std::filesystem::path& Path) const;
+
+    kind find(const std::string& Key, const std::filesystem::path& Path) const;
+    std::uint64_t file_size(const std::string& Key, const std::filesystem::path& Path) const;
+    void list_locked(const std::string& Key, const std::filesystem::path& Directory, std::vector<entry>& r) const;
+
+    std::filesystem::path Base;
+
+    mutable std::mutex Mutex;
+
+    // By case folded, `/` separated path.
+    std::unordered_map<std::string, node> Nodes;
+};
+
+}
+
+#endif
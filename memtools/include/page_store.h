@@ -0,0 +1,130 @@
+﻿#ifndef PAGE_STORE_H_INCLUDED
+    #define PAGE_STORE_H_INCLUDED 1
+
+#include <hash.h>
+#include <regions.h>
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <condition_variable>
+
+namespace mmtl {
+
+struct page {
+    alignas(64) std::byte Data[PageSize];
+};
+
+struct page_store_options {
+    // Bytes of page data kept in memory. Above this, pages that have not been used for a while are
+    // moved to the spill file.
+    std::size_t MemoryBudget = std::size_t(256) << 20;
+
+    // Compress pages that have not been used for a while, in a background thread.
+    bool Compress = true;
+
+    // Where to create the spill file, which is deleted again when the store is destroyed. Empty
+    // keeps everything in memory, regardless of the budget.
+    std::filesystem::path SpillDirectory;
+};
+
+struct page_store_stats {
+    // Distinct pages stored.
+    std::size_t Pages = 0;
+    // References to them, the number of pages stored without deduplication.
+    std::size_t References = 0;
+    std::size_t Compressed = 0;
+    std::size_t Spilled = 0;
+
+    // Bytes of page data in memory and in the spill file.
+    std::size_t MemoryBytes = 0;
+    std::size_t SpillBytes = 0;
+};
+
+// Stores pages by content. Inserting a page that is already stored returns the existing one, so
+// identical pages in different snapshots take up space once. Pages are reference counted.
+//
+// All members can be called from any thread.
+struct page_store {
+    using id = std::uint32_t;
+
+    static constexpr id None = ~id(0);
+
+    explicit page_store(page_store_options Options = {});
+    ~page_store();
+
+    page_store(const page_store&)=delete;
+    page_store& operator=(const page_store&)=delete;
+
+    // Returns a page with the same content as the `PageSize` bytes at `Data`, holding a reference to it.
+    id insert(const void* Data);
+
+    void retain(const id* Ids, std::size_t Count);
+    void release(const id* Ids, std::size_t Count);
+
+    void read(id Id, void* Out);
+    bool equal(id Id, const void* Data);
+
+    void set_memory_budget(std::size_t Budget);
+
+    page_store_stats stats() const;
+
+    // Runs a pass of the background thread right away.
+    void trim();
+
+private:
+    enum class storage : std::uint8_t {
+        Free, Raw, Compressed, Spilled,
+    };
+
+    struct slot {
+        page_hash Hash = 0;
+        std::uint32_t References = 0;
+
+        storage Storage = storage::Free;
+
+        // Cleared by the background thread, set when the page is used.
+        bool Used = false;
+
+        std::uint16_t CompressedSize = 0;
+
+        // The next slot with the same hash.
+        id Next = None;
+
+        std::unique_ptr<page> Raw;
+        std::unique_ptr<std::byte[]> Compressed;
+        std::size_t SpillSlot = 0;
+    };
+
+    struct spill_file;
+
+    void load(slot& Slot, void* Out);
+    void free(id Id);
+    void sweep(std::unique_lock<std::mutex>& Lock);
+    void run();
+
+    page_store_options Options;
+
+    mutable std::mutex Mutex;
+
+    std::vector<slot> Slots;
+    std::vector<id> FreeSlots;
+    std::unordered_map<page_hash, id> Index;
+
+    std::unique_ptr<spill_file> Spill;
+
+    page_store_stats Stats;
+
+    id ClockHand = 0;
+
+    std::condition_variable Wake;
+    bool Stopping = false;
+    std::thread Thread;
+};
+
+}
+
+#endif
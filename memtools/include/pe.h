@@ -0,0 +1,74 @@
+﻿#ifndef PE_H_INCLUDED
+    #define PE_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+struct pe_section {
+    std::string Name;
+    std::uint32_t Rva;
+    std::uint32_t VirtualSize;
+    std::uint32_t RawOffset;
+    std::uint32_t RawSize;
+    std::uint32_t Characteristics;
+
+    bool executable() const {
+        return (Characteristics&0x20000000) != 0;
+    }
+};
+
+// An entry of the optional header's data directory, like the export or relocation table.
+struct pe_directory {
+    std::uint32_t Rva;
+    std::uint32_t Size;
+};
+
+// The headers of a PE image, either a file as read from disk or a module as loaded into memory.
+// Only refers to the data, which must outlive it.
+struct pe_image {
+    // Throws `std::runtime_error` if the data is not a PE image.
+    pe_image(const std::byte* Data, std::size_t Size, bool Mapped);
+
+    std::uint64_t ImageBase = 0;
+    std::uint32_t TimeDateStamp = 0;
+    std::uint32_t EntryPoint = 0;
+    std::uint32_t SizeOfImage = 0;
+    bool Is64 = false;
+    std::vector<pe_section> Sections;
+    std::vector<pe_directory> Directories;
+
+    static constexpr std::size_t ExportDirectory = 0;
+    static constexpr std::size_t RelocationDirectory = 5;
+
+    const pe_section* find_section(std::string_view Name) const;
+
+    // The section containing `Rva`, or null.
+    const pe_section* section_at(std::uint32_t Rva) const;
+
+    // The data at `Rva` if all `Size` bytes of it are present, null otherwise. Uninitialized parts
+    // of sections are not present in files.
+    const std::byte* at(std::uint32_t Rva, std::size_t Size) const;
+
+    // The present data of a section.
+    const std::byte* data(const pe_section& Section) const;
+    std::size_t size(const pe_section& Section) const;
+
+    // The range of every address the loader patches when the image is not at its preferred base,
+    // sorted. Empty if the image has no relocations.
+    std::vector<pe_directory> relocations() const;
+
+private:
+    const std::byte* Data;
+    std::size_t Size;
+    bool Mapped;
+};
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+﻿#ifndef REGIONS_H_INCLUDED
+    #define REGIONS_H_INCLUDED 1
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+constexpr std::size_t PageSize = 4096;
+
+inline std::uintptr_t page_floor(std::uintptr_t Address){
+    return Address & ~(PageSize-1);
+}
+
+inline std::uintptr_t page_ceil(std::uintptr_t Address){
+    return (Address+PageSize-1) & ~(PageSize-1);
+}
+
+// How changes to a region are detected between snapshots.
+enum class tracking : std::uint8_t {
+    // Compare every page with the previous snapshot. Always works, but costs time proportional to
+    // the size of the region.
+    Compare,
+    // Write protect the region and record the first write to every page.
+    Protect,
+    // Ask the OS. Only for Windows allocations made with `MEM_WRITE_WATCH`.
+    WriteWatch,
+};
+
+struct region {
+    std::uintptr_t Base;
+    std::size_t Size;
+
+    // The start of the allocation the region is part of, on Windows. Equal to `Base` elsewhere.
+    std::uintptr_t AllocationBase;
+
+    // The original protection, in the platform's own flags.
+    std::uint32_t Protect;
+
+    tracking Tracking = tracking::Compare;
+
+    std::uintptr_t end() const {
+        return Base+Size;
+    }
+};
+
+// Committed, writable, private memory of the current process, sorted by address. Includes image
+// sections, but not file mappings or guard pages.
+std::vector<region> query_regions();
+
+// Every committed, readable range of the current process, for checking addresses without asking
+// the system every time. Only as current as the last `refresh`, so anything freed since then is
+// still in it.
+struct readable_map {
+    void refresh();
+
+    // Whether all of `[Address, Address+Size)` was readable, and writable if `Writable` is set.
+    bool contains(std::uintptr_t Address, std::size_t Size, bool Writable = false) const;
+
+    std::size_t size() const {
+        return Ranges.size();
+    }
+
+private:
+    struct range {
+        std::uintptr_t Begin;
+        std::uintptr_t End;
+        bool Writable;
+    };
+
+    // Sorted, with adjacent ranges that have the same access merged.
+    std::vector<range> Ranges;
+};
+
+}
+
+#endif
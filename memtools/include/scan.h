@@ -0,0 +1,114 @@
+﻿#ifndef SCAN_H_INCLUDED
+    #define SCAN_H_INCLUDED 1
+
+#include <watch.h>
+#include <regions.h>
+
+#include <vector>
+#include <optional>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+struct work_pool;
+
+namespace mmtl {
+
+enum class scan_compare : std::uint8_t {
+    // Equal to the given value, bit for bit.
+    Exact,
+    // Anything, only for the first scan.
+    Unknown,
+    // Compared to the value at the previous scan.
+    Changed,
+    Unchanged,
+    Increased,
+    Decreased,
+};
+
+// Parses `exact`, `unknown`, `changed`, `unchanged`, `increased` and `decreased`.
+std::optional<scan_compare> parse_scan_compare(std::string_view Name);
+
+struct scan_result {
+    std::uintptr_t Address;
+    // As read by the last scan, in the low `value_size` bytes.
+    std::uint64_t Value;
+};
+
+// Finds the addresses of a value by scanning memory for it, then narrowing the candidates down
+// with further scans as the value changes. Values are only looked for at addresses that are a
+// multiple of their size.
+//
+// Candidates are kept per block of memory, as a bitmap with the previous value of every candidate
+// next to it, so even an unknown first scan only costs about as much memory as it scanned.
+struct scanner {
+    // Blocks are split between the threads of `Pool`, if there is one. `Simd` is only there to
+    // compare the kernels.
+    explicit scanner(work_pool* Pool = nullptr, bool Simd = true);
+
+    // Parts of `Regions` that are not in `Map` are skipped, if it is given. Throws
+    // `std::invalid_argument` for a comparison that needs a previous value, and
+    // `std::length_error` for an unknown scan that would use more than the memory limit, in which
+    // case the candidates of the last scan are kept.
+    void first_scan(const std::vector<region>& Regions, value_type Type, scan_compare Compare, std::uint64_t Value = 0,
+        const readable_map* Map = nullptr);
+
+    // Candidates that are no longer in `Map` are dropped, if it is given. Throws `std::logic_error`
+    // before a first scan.
+    void next_scan(scan_compare Compare, std::uint64_t Value = 0, const readable_map* Map = nullptr);
+
+    void reset();
+
+    // An unknown first scan keeps a copy of all the memory it scans. No limit by default.
+    void set_memory_limit(std::size_t Bytes){
+        MemoryLimit = Bytes;
+    }
+
+    bool started() const {
+        return Started;
+    }
+
+    value_type type() const {
+        return Type;
+    }
+
+    std::size_t count() const;
+
+    // The first `Max` candidates, by address.
+    std::vector<scan_result> results(std::size_t Max) const;
+
+    // Bytes used by bitmaps and previous values.
+    std::size_t memory_usage() const;
+
+    static constexpr std::size_t BlockSize = 64 << 10;
+
+private:
+    struct block {
+        std::uintptr_t Base;
+        std::size_t Size;
+        std::vector<std::uint64_t> Bits;
+        // The value of every candidate, in address order.
+        std::vector<std::byte> Values;
+        std::size_t Count;
+    };
+
+    void first_scan_block(block& Block, scan_compare Compare, std::uint64_t Value) const;
+    void next_scan_block(block& Block, scan_compare Compare, std::uint64_t Value) const;
+
+    // Calls `Fn(i)` for every block, in parallel if there is a pool.
+    template <typename F>
+    void for_each_block(F&& Fn);
+
+    work_pool* Pool;
+    bool Simd;
+    std::size_t MemoryLimit = SIZE_MAX;
+
+    bool Started = false;
+    value_type Type = value_type::U32;
+    std::vector<block> Blocks;
+};
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+﻿#ifndef SIGNATURE_H_INCLUDED
+    #define SIGNATURE_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// A byte pattern with wildcards, written as hex bytes with `??` for any byte, like `55 8B EC ?? E8`.
+// It needs two fixed bytes in a row somewhere, which the search looks for first.
+struct signature {
+    std::vector<std::uint8_t> Bytes;
+    // 0xFF for fixed bytes, 0 for wildcards.
+    std::vector<std::uint8_t> Mask;
+
+    // Throws `std::invalid_argument` if `Text` is not a valid pattern.
+    static signature parse(std::string_view Text);
+
+    std::string to_string() const;
+
+    bool matches(const std::byte* Data) const;
+
+    std::size_t size() const {
+        return Bytes.size();
+    }
+};
+
+struct signature_match {
+    // Matches found, counting stops at 2 as a signature should only match once.
+    std::size_t Count = 0;
+    // Of the first match.
+    std::size_t Offset = 0;
+};
+
+// Finds every signature in one pass over the data.
+std::vector<signature_match> find_signatures(const std::byte* Data, std::size_t Size, const std::vector<signature>& Signatures);
+
+// The shortest signature starting at `Offset` that only matches there, with the bytes for which
+// `Volatile` is set wildcarded, or nothing if there is none up to `MaxLength` bytes. `Volatile`
+// should cover whatever may change between builds, like relocated addresses and relative
+// displacements.
+std::optional<signature> make_signature(const std::byte* Data, std::size_t Size, std::size_t Offset,
+    const std::vector<bool>& Volatile, std::size_t MaxLength = 64);
+
+}
+
+#endif
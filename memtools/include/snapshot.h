@@ -0,0 +1,89 @@
+﻿#ifndef SNAPSHOT_H_INCLUDED
+    #define SNAPSHOT_H_INCLUDED 1
+
+#include <dirty.h>
+#include <regions.h>
+#include <page_store.h>
+
+#include <map>
+#include <array>
+#include <memory>
+#include <functional>
+
+namespace mmtl {
+
+// An immutable copy of memory. Pages live in a `page_store`, so a snapshot only costs the pages
+// that are not already stored for another snapshot.
+struct snapshot {
+    static constexpr std::size_t ChunkPages = 512;
+    static constexpr std::size_t ChunkSize = ChunkPages*PageSize;
+
+    // Holds a reference to each of its pages.
+    struct chunk {
+        explicit chunk(std::shared_ptr<page_store> Store);
+        chunk(const chunk& Rhs);
+        ~chunk();
+
+        chunk& operator=(const chunk&)=delete;
+
+        std::shared_ptr<page_store> Store;
+        std::array<page_store::id, ChunkPages> Pages;
+    };
+
+    // Keyed by the address of the chunk, `page_store::None` pages were not captured.
+    std::map<std::uintptr_t, std::shared_ptr<const chunk>> Chunks;
+
+    std::size_t PageCount = 0;
+
+    page_store::id find(std::uintptr_t Address) const;
+};
+
+struct snapshot_stats {
+    // Pages in the snapshot.
+    std::size_t Pages = 0;
+    // Pages copied by `save`.
+    std::size_t Copied = 0;
+    // Pages written by `restore`.
+    std::size_t Written = 0;
+    // Pages in the snapshot that are no longer mapped, and can not be restored.
+    std::size_t Missing = 0;
+};
+
+// Takes and restores snapshots of the regions returned by a callback. After the first snapshot
+// only pages written since the previous `save` or `restore` are copied, so both cost time
+// proportional to what changed, except for `tracking::Compare` regions.
+//
+// Our own allocations, including the snapshots themselves, must not be part of the regions.
+struct snapshotter {
+    using region_source = std::function<std::vector<region>()>;
+
+    explicit snapshotter(region_source Source, std::shared_ptr<page_store> Store = nullptr);
+
+    std::shared_ptr<const snapshot> save(snapshot_stats* Stats = nullptr);
+    void restore(const std::shared_ptr<const snapshot>& Snapshot, snapshot_stats* Stats = nullptr);
+
+    // Stops tracking, the next `save` copies everything again.
+    void reset();
+
+    page_store& store(){
+        return *Store;
+    }
+
+private:
+    region_source Source;
+    std::shared_ptr<page_store> Store;
+    dirty_tracker Tracker;
+
+    // The regions being tracked, and the snapshot they match apart from tracked writes.
+    std::vector<region> Regions;
+    std::shared_ptr<const snapshot> Base;
+
+    // Set after a restore, when `Base` may contain pages outside of `Regions`.
+    bool Stale = false;
+
+    std::vector<std::uintptr_t> Dirty;
+};
+
+}
+
+#endif
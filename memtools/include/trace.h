@@ -0,0 +1,141 @@
+﻿#ifndef TRACE_H_INCLUDED
+    #define TRACE_H_INCLUDED 1
+
+#include <watch.h>
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <optional>
+#include <filesystem>
+#include <stdexcept>
+#include <condition_variable>
+
+#include <cstring>
+
+namespace mmtl {
+
+// A columnar log of per frame values, for analysing a whole run.
+//
+// The file starts with `DHTASTR2`, the writer's pointer size as a byte, since the 32-bit hook and a
+// 64-bit reader differ, a 32-bit column count, then every column's type as a byte and its name as a
+// 16-bit length and that many bytes. Blocks of frames follow, each one starting with
+// its 32-bit frame count and the 32-bit encoded sizes of its frame numbers and of every column, then
+// the encoded frame numbers and columns one after another, so a column can be found without
+// decoding the others.
+//
+// Frame numbers are encoded as the difference to the previous one, and values XORed with the
+// previous one, both starting from 0 in every block. The bytes of these are stored transposed, with
+// byte 0 of every frame first, and then runs of zero bytes replaced by their length.
+//
+// Everything is little endian.
+struct trace_column {
+    std::string Name;
+    value_type Type;
+    // Where the value is in the rows passed to `trace_writer::write`, not stored.
+    std::size_t Offset = 0;
+};
+
+// Encodes and writes blocks on a background thread, so `write` only copies the values.
+struct trace_writer {
+    // Throws `std::runtime_error` if the file can not be created.
+    trace_writer(const std::filesystem::path& Path, std::vector<trace_column> Columns, std::size_t BlockFrames = 1024);
+
+    // Writes whatever is left.
+    ~trace_writer();
+
+    trace_writer(const trace_writer&)=delete;
+    trace_writer& operator=(const trace_writer&)=delete;
+
+    // Throws `std::runtime_error` if an earlier block could not be written.
+    void write(std::uint64_t Frame, const std::byte* Row);
+
+    // Writes everything so far and waits for it to be on disk. A block is only complete once
+    // written, so frames since the last `flush` are lost if the game crashes.
+    void flush();
+
+private:
+    struct block {
+        std::vector<std::uint64_t> Frames;
+        // The raw values of every column, one after another.
+        std::vector<std::vector<std::byte>> Values;
+    };
+
+    void submit();
+    void run();
+
+    std::ofstream File;
+    std::vector<trace_column> Columns;
+    std::size_t BlockFrames;
+
+    block Current;
+
+    std::mutex Mutex;
+    std::condition_variable Wake;
+    std::condition_variable Idle;
+    std::deque<block> Queue;
+    bool Busy = false;
+    bool Stopping = false;
+    std::atomic<bool> Failed = false;
+    std::thread Thread;
+};
+
+// Reads the block headers up front, then decodes columns on request.
+struct trace_reader {
+    // Throws `std::runtime_error` if the file can not be read. A truncated last block is ignored.
+    explicit trace_reader(const std::filesystem::path& Path);
+
+    const std::vector<trace_column>& columns() const {
+        return Columns;
+    }
+
+    std::optional<std::size_t> find(std::string_view Name) const;
+
+    std::size_t frame_count() const {
+        return FrameCount;
+    }
+
+    std::vector<std::uint64_t> frames();
+
+    // The size of a value of the column, which for pointers is the writer's.
+    std::size_t column_size(std::size_t Index) const;
+
+    // `column_size(Index)` bytes per frame.
+    std::vector<std::byte> column(std::size_t Index);
+
+    template <typename T>
+    std::vector<T> column_as(std::size_t Index){
+        auto Raw = column(Index);
+        if(sizeof(T) != column_size(Index)){
+            throw std::invalid_argument("Wrong type for column.");
+        }
+
+        std::vector<T> r(FrameCount);
+        std::memcpy(r.data(), Raw.data(), Raw.size());
+        return r;
+    }
+
+private:
+    struct block {
+        std::size_t Frames;
+        // Encoded frame numbers, then every column.
+        std::vector<std::uint64_t> Offsets;
+        std::vector<std::uint32_t> Sizes;
+    };
+
+    std::vector<std::byte> load(const block& Block, std::size_t Index);
+
+    std::ifstream File;
+    std::vector<trace_column> Columns;
+    std::size_t PointerSize = sizeof(std::uintptr_t);
+    std::vector<block> Blocks;
+    std::size_t FrameCount = 0;
+};
+
+}
+
+#endif
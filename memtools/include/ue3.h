@@ -0,0 +1,171 @@
+﻿#ifndef UE3_H_INCLUDED
+    #define UE3_H_INCLUDED 1
+
+#include <watch.h>
+#include <regions.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// Where the fields used are in Unreal Engine 3's objects, which moves around between engine
+// versions and builds. There are no defaults, as nothing checks them against the game; take them
+// from an SDK dump of the build being read.
+struct ue3_layout {
+    // UObject
+    std::uint32_t ObjectIndex;
+    std::uint32_t ObjectOuter;
+    std::uint32_t ObjectName;
+    std::uint32_t ObjectClass;
+    // UField
+    std::uint32_t FieldNext;
+    // UStruct
+    std::uint32_t StructSuper;
+    std::uint32_t StructChildren;
+    // UProperty
+    std::uint32_t PropertyArrayDim;
+    std::uint32_t PropertyElementSize;
+    std::uint32_t PropertyOffset;
+    // UBoolProperty's mask, UStructProperty's struct and UObjectProperty's class.
+    std::uint32_t PropertyExtra;
+    // FNameEntry, where the lowest bit of the index is set for UTF-16 names.
+    std::uint32_t NameEntryIndex;
+    std::uint32_t NameEntryText;
+};
+
+struct ue3_property {
+    std::string Name;
+    // The name of the property's class, like `FloatProperty`.
+    std::string Type;
+    std::uint32_t Offset;
+    std::uint32_t ElementSize;
+    std::uint32_t ArrayDim;
+    // `PropertyExtra`, meaning depends on the type.
+    std::uintptr_t Extra;
+};
+
+// Reflection over the objects of an Unreal Engine 3 game, through its global object and name
+// arrays, GObjects and GNames. Objects are indexed by path, like `Engine.Default__Pawn`, and
+// property lookups are cached per class, so reading a property by name costs a few hash lookups
+// on top of reading it.
+//
+// Nothing is read outside of `locate`, `refresh` and the lookups, all through `Reader`, so objects
+// freed by the game only make lookups fail.
+struct ue3_reflection {
+    ue3_reflection(memory_reader Reader, const ue3_layout& Layout);
+
+    // Looks for GObjects and GNames in `Regions` by what they contain: the first names are always
+    // `None` and `ByteProperty`, and objects know their own index. Returns false if either was not
+    // found.
+    bool locate(const std::vector<region>& Regions);
+
+    // The addresses of the arrays themselves, not of their data.
+    void set_tables(std::uintptr_t Objects, std::uintptr_t Names);
+
+    std::uintptr_t objects_table() const {
+        return ObjectsTable;
+    }
+
+    std::uintptr_t names_table() const {
+        return NamesTable;
+    }
+
+    const ue3_layout& layout() const {
+        return Layout;
+    }
+
+    // Reads the object array again and resolves the objects in slots that changed since the last
+    // time, which after a level load are only the level's. Returns the number of changed slots.
+    std::size_t refresh();
+
+    std::size_t object_count() const {
+        return Slots.size();
+    }
+
+    // Empty if there is no such name.
+    std::string_view name(std::int32_t Index) const;
+
+    // The index of a name, or -1. Names added since the last call are read first.
+    std::int32_t find_name(std::string_view Name) const;
+
+    // The object's name with the names of its outers before it, separated by dots. Empty if it's
+    // not an object as of the last `refresh`.
+    std::string path(std::uintptr_t Object) const;
+
+    // 0 if the object is unknown.
+    std::uintptr_t class_of(std::uintptr_t Object) const;
+    std::uintptr_t find_object(std::string_view Path) const;
+
+    // Objects whose class has this name, without the class defaults.
+    std::vector<std::uintptr_t> find_instances(std::string_view ClassName) const;
+
+    // A property of a class or struct, including inherited ones, or null.
+    const ue3_property* find_property(std::uintptr_t Struct, std::string_view Name);
+
+    // Every property of a class or struct, inherited ones last.
+    std::vector<ue3_property> properties(std::uintptr_t Struct);
+
+private:
+    struct slot {
+        std::uintptr_t Object = 0;
+        std::uintptr_t Outer = 0;
+        std::uintptr_t Class = 0;
+        std::int32_t Name = 0;
+        std::int32_t Number = 0;
+    };
+
+    struct array {
+        std::uintptr_t Data;
+        std::int32_t Count;
+        std::int32_t Max;
+    };
+
+    template <typename T>
+    bool read(std::uintptr_t Address, T& Out) const {
+        return Reader(Address, &Out, sizeof(T));
+    }
+
+    bool read_object(std::uintptr_t Object, slot& Out) const;
+    std::string object_name(const slot& Slot) const;
+
+    bool is_names(const array& Array) const;
+    bool is_objects(const array& Array) const;
+
+    struct struct_info {
+        std::vector<ue3_property> Properties;
+        std::unordered_map<std::string, std::size_t> ByName;
+    };
+
+    // Built on first use.
+    const struct_info& struct_properties(std::uintptr_t Struct);
+
+    memory_reader Reader;
+    ue3_layout Layout;
+
+    std::uintptr_t ObjectsTable = 0;
+    std::uintptr_t NamesTable = 0;
+
+    std::vector<slot> Slots;
+    std::unordered_map<std::uintptr_t, std::uint32_t> SlotOf;
+    std::unordered_map<std::string, std::uintptr_t> ByPath;
+
+    // Names are never removed, so each is only read once. Lookups read them, so they are mutable.
+    mutable array NamesArray = {};
+    mutable std::deque<std::string> Names;
+    mutable std::vector<bool> NameRead;
+    mutable std::unordered_map<std::string_view, std::int32_t> NameIndex;
+    mutable std::int32_t NamesIndexed = 0;
+
+    std::unordered_map<std::uintptr_t, struct_info> Structs;
+};
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+﻿#ifndef WATCH_H_INCLUDED
+    #define WATCH_H_INCLUDED 1
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+enum class value_type : std::uint8_t {
+    I8, U8, I16, U16, I32, U32, I64, U64, F32, F64, Pointer,
+};
+
+std::size_t value_size(value_type Type);
+
+// Parses `i8`, `u8`, ..., `u64`, `f32`, `f64` and `ptr`.
+std::optional<value_type> parse_value_type(std::string_view Name);
+
+// A value at the end of a pointer path. Every offset but the last is added to the address so far,
+// and the pointer stored there followed. The last one is added to get the address of the value.
+struct watch {
+    std::string Name;
+    std::uintptr_t Base;
+    std::vector<std::ptrdiff_t> Offsets;
+    value_type Type;
+};
+
+// Copies `Size` bytes from `Address` to `Out`, returning false if the memory can not be read.
+using memory_reader = std::function<bool(std::uintptr_t Address, void* Out, std::size_t Size)>;
+
+// A set of watches compiled into a list of pointers to follow and values to read. Paths that start
+// the same share the pointers they have in common, and the pointers are only followed again after
+// `invalidate`.
+//
+// Values are read into a buffer of `size()` bytes. Every value is at its own naturally aligned
+// offset, with a byte after all the values for each watch that is 1 if it could be read.
+struct watch_plan {
+    watch_plan()=default;
+    explicit watch_plan(const std::vector<watch>& Watches);
+
+    std::size_t size() const {
+        return Size;
+    }
+
+    std::size_t value_offset(std::size_t Watch) const {
+        return Values[Watch].Out;
+    }
+
+    std::size_t valid_offset(std::size_t Watch) const {
+        return ValidOffset+Watch;
+    }
+
+    // Distinct pointers followed to resolve every path.
+    std::size_t pointer_count() const {
+        return PointerCount;
+    }
+
+    void read(std::byte* Out, const memory_reader& Reader);
+
+    // Follows every pointer again on the next read.
+    void invalidate(){
+        Resolved = false;
+    }
+
+private:
+    static constexpr std::size_t None = ~std::size_t(0);
+
+    // An address, either a base or a pointer read from `Parent`'s address plus `Offset`.
+    struct node {
+        std::size_t Parent;
+        std::uintptr_t Base;
+        std::ptrdiff_t Offset;
+    };
+
+    // The value at `Node`'s address plus `Offset`, read to `Out`.
+    struct value {
+        std::size_t Node;
+        std::ptrdiff_t Offset;
+        value_type Type;
+        std::size_t Out;
+    };
+
+    std::vector<node> Nodes;
+    std::vector<value> Values;
+
+    std::size_t PointerCount = 0;
+
+    // Resolved addresses, 0 where a pointer could not be followed yet. Those are tried again on
+    // every read, as the object they point to may not exist until a while after a level loads.
+    std::vector<std::uintptr_t> Addresses;
+    bool Resolved = false;
+    bool Pending = false;
+
+    std::size_t ValidOffset = 0;
+    std::size_t Size = 0;
+};
+
+}
+
+#endif
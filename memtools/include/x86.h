@@ -0,0 +1,53 @@
+﻿#ifndef X86_H_INCLUDED
+    #define X86_H_INCLUDED 1
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mmtl {
+
+// What an instruction does to the flow of execution.
+enum class x86_flow : std::uint8_t {
+    // Continues with the next instruction.
+    None,
+    Call,
+    Jump,
+    // A conditional jump.
+    Branch,
+    Return,
+    // Through a register or memory, the target is not known.
+    IndirectCall,
+    IndirectJump,
+    // Does not continue, like `int3`, `hlt` and `ud2`.
+    Stop,
+};
+
+struct x86_instruction {
+    // 0 if the bytes are not a valid instruction.
+    std::uint8_t Length = 0;
+    x86_flow Flow = x86_flow::None;
+
+    // For relative calls and jumps, the address of the target.
+    std::uint32_t Target = 0;
+
+    // Absolute 32 bit displacements and immediates, any of which may be the address of something
+    // like a global or a string. `Displacement` is only set for memory operands without a base
+    // register and with one, which covers both `[global]` and `[table+reg*4]`.
+    bool HasDisplacement = false;
+    bool HasImmediate = false;
+    std::uint32_t Displacement = 0;
+    std::uint32_t Immediate = 0;
+
+    // For memory operands, whether there is a base register and the index register's scale, or 0
+    // without an index.
+    bool HasBase = false;
+    std::uint8_t Scale = 0;
+};
+
+// Decodes one 32 bit x86 instruction at `Address`. Only lengths, control flow and operands that
+// may be addresses are decoded, which is what finding functions and references needs.
+x86_instruction decode_x86(const std::byte* Code, std::size_t Size, std::uint32_t Address);
+
+}
+
+#endif
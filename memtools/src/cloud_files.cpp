@@ -0,0 +1,317 @@
+﻿#include <cloud_files.h>
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace mmtl {
+
+namespace {
+
+char fold(char c){
+    return (c >= 'A' && c <= 'Z')?static_cast<char>(c-'A'+'a'):c;
+}
+
+}
+
+cloud_data::cloud_data(std::vector<unsigned char> Bytes):
+    Bytes(std::move(Bytes)), Data(this->Bytes.data()), Size(this->Bytes.size()) {}
+
+cloud_data::cloud_data(void* View, std::size_t Size):
+    View(View), Data(static_cast<const unsigned char*>(View)), Size(Size) {}
+
+bool cloud_data::operator==(const cloud_data& Other) const {
+    return Size == Other.Size && (Size == 0 || std::memcmp(Data, Other.Data, Size) == 0);
+}
+
+#ifdef _WIN32
+
+std::shared_ptr<const cloud_data> cloud_data::map(const std::filesystem::path& Path){
+    // Not shared for writing, so nothing can change the contents under the mapping.
+    auto File = CreateFileW(
+        Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if(File == INVALID_HANDLE_VALUE){
+        throw std::runtime_error("Unable to open "+Path.string()+".");
+    }
+
+    LARGE_INTEGER FileSize;
+    if(!GetFileSizeEx(File, &FileSize) || static_cast<std::uint64_t>(FileSize.QuadPart) > SIZE_MAX){
+        CloseHandle(File);
+        throw std::runtime_error("Unable to map "+Path.string()+".");
+    }
+
+    // Empty files can't be mapped.
+    if(FileSize.QuadPart == 0){
+        CloseHandle(File);
+        return std::make_shared<const cloud_data>();
+    }
+
+    // The view keeps the mapping and the file open.
+    auto Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(File);
+    if(!Mapping){
+        throw std::runtime_error("Unable to map "+Path.string()+".");
+    }
+
+    auto View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(Mapping);
+    if(!View){
+        throw std::runtime_error("Unable to map "+Path.string()+".");
+    }
+
+    return std::shared_ptr<const cloud_data>(new cloud_data(View, static_cast<std::size_t>(FileSize.QuadPart)));
+}
+
+cloud_data::~cloud_data(){
+    if(View){
+        UnmapViewOfFile(View);
+    }
+}
+
+#else
+
+std::shared_ptr<const cloud_data> cloud_data::map(const std::filesystem::path& Path){
+    auto File = open(Path.c_str(), O_RDONLY|O_CLOEXEC);
+    if(File < 0){
+        throw std::runtime_error("Unable to open "+Path.string()+".");
+    }
+
+    struct stat Stat;
+    if(fstat(File, &Stat) != 0 || static_cast<std::uint64_t>(Stat.st_size) > SIZE_MAX){
+        close(File);
+        throw std::runtime_error("Unable to map "+Path.string()+".");
+    }
+
+    if(Stat.st_size == 0){
+        close(File);
+        return std::make_shared<const cloud_data>();
+    }
+
+    auto Size = static_cast<std::size_t>(Stat.st_size);
+    auto View = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);
+    if(View == MAP_FAILED){
+        throw std::runtime_error("Unable to map "+Path.string()+".");
+    }
+
+    return std::shared_ptr<const cloud_data>(new cloud_data(View, Size));
+}
+
+cloud_data::~cloud_data(){
+    if(View){
+        munmap(View, Size);
+    }
+}
+
+#endif
+
+std::size_t cloud_files::fold_hash::operator()(std::string_view s) const {
+    // FNV-1a, names are short.
+    std::uint64_t r = 0xCBF29CE484222325;
+    for(auto c:s){
+        r = (r^static_cast<unsigned char>(fold(c)))*0x100000001B3;
+    }
+
+    return static_cast<std::size_t>(r);
+}
+
+bool cloud_files::fold_equal::operator()(std::string_view a, std::string_view b) const {
+    if(a.size() != b.size()){
+        return false;
+    }
+
+    for(std::size_t i = 0; i < a.size(); ++i){
+        if(fold(a[i]) != fold(b[i])){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+cloud_files::cloud_files():Contents(std::make_shared<contents>()) {}
+
+cloud_files::cloud_files(std::vector<file> Files):cloud_files(){
+    for(auto& e:Files){
+        write(e.Name, std::move(e.Data), e.Timestamp);
+    }
+}
+
+cloud_files::contents& cloud_files::unshare(){
+    // Copies only ever add owners, and only through this object, so a count of 1 can't change
+    // under us.
+    if(Contents.use_count() > 1){
+        Contents = std::make_shared<contents>(*Contents);
+    }
+
+    return *Contents;
+}
+
+const cloud_files::file* cloud_files::find(std::string_view Name) const {
+    auto it = Contents->Index.find(Name);
+    return (it != Contents->Index.end())?&Contents->Files[it->second]:nullptr;
+}
+
+const cloud_files::file& cloud_files::write(std::string_view Name, buffer Data, std::int64_t Timestamp){
+    auto& c = unshare();
+
+    auto [it, New] = c.Index.try_emplace(std::string(Name), c.Files.size());
+    if(New){
+        c.Files.push_back({
+            .Name = std::string(Name),
+            .Data = std::make_shared<const cloud_data>(),
+            .Timestamp = 0,
+        });
+    }
+
+    auto& File = c.Files[it->second];
+
+    c.TotalSize += Data->size();
+    c.TotalSize -= File.Data->size();
+
+    File.Data = std::move(Data);
+    File.Timestamp = Timestamp;
+
+    return File;
+}
+
+const cloud_files::file& cloud_files::write(std::string_view Name, const unsigned char* Data, std::size_t Size, std::int64_t Timestamp){
+    return write(Name, std::make_shared<const cloud_data>(std::vector<unsigned char>(Data, Data+Size)), Timestamp);
+}
+
+cloud_writer::cloud_writer(){
+    Thread = std::thread(&cloud_writer::run, this);
+}
+
+cloud_writer::~cloud_writer(){
+    {
+        std::lock_guard Lock(Mutex);
+        Stopping = true;
+    }
+
+    Wake.notify_all();
+    Thread.join();
+}
+
+void cloud_writer::write(const std::filesystem::path& Directory, cloud_files Files){
+    {
+        std::lock_guard Lock(Mutex);
+
+        // A snapshot still waiting for the same directory would only be overwritten.
+        std::erase_if(Queue, [&](auto& e){ return e.Directory == Directory; });
+        Queue.push_back({Directory, std::move(Files)});
+    }
+
+    Wake.notify_one();
+}
+
+void cloud_writer::flush(){
+    std::unique_lock Lock(Mutex);
+    Idle.wait(Lock, [&]{ return Queue.empty() && !Busy; });
+
+    if(!Error.empty()){
+        throw std::runtime_error(std::exchange(Error, {}));
+    }
+}
+
+std::size_t cloud_writer::written() const {
+    std::lock_guard Lock(Mutex);
+    return Written;
+}
+
+std::size_t cloud_writer::skipped() const {
+    std::lock_guard Lock(Mutex);
+    return Skipped;
+}
+
+void cloud_writer::write_directory(const job& Job){
+    std::filesystem::create_directories(Job.Directory);
+
+    auto& Previous = OnDisk[Job.Directory];
+
+    std::unordered_map<std::string, cloud_files::buffer> Current;
+    std::size_t Changed = 0;
+
+    for(auto& e:Job.Files){
+        Current.emplace(e.Name, e.Data);
+
+        if(auto it = Previous.find(e.Name); it != Previous.end() && it->second == e.Data){
+            continue;
+        }
+
+        // Forgotten first, so a failed write is retried next time.
+        Previous.erase(e.Name);
+
+        std::ofstream File(Job.Directory/e.Name, std::ios::binary|std::ios::trunc);
+        File.write(reinterpret_cast<const char*>(e.Data->data()), static_cast<std::streamsize>(e.size()));
+        if(!File.flush()){
+            throw std::runtime_error("Unable to write "+e.Name+".");
+        }
+
+        Previous[e.Name] = e.Data;
+        ++Changed;
+    }
+
+    for(auto it = Previous.begin(); it != Previous.end();){
+        if(Current.contains(it->first)){
+            ++it;
+            continue;
+        }
+
+        std::error_code Ignored;
+        std::filesystem::remove(Job.Directory/it->first, Ignored);
+        it = Previous.erase(it);
+    }
+
+    std::lock_guard Lock(Mutex);
+    Written += Changed;
+    Skipped += Job.Files.size()-Changed;
+}
+
+void cloud_writer::run(){
+    std::unique_lock Lock(Mutex);
+
+    while(true){
+        Wake.wait(Lock, [&]{ return Stopping || !Queue.empty(); });
+
+        if(Queue.empty()){
+            break;
+        }
+
+        auto Job = std::move(Queue.front());
+        Queue.pop_front();
+        Busy = true;
+
+        Lock.unlock();
+
+        std::string Failure;
+        try {
+            write_directory(Job);
+        }catch(std::exception& e){
+            Failure = e.what();
+        }
+
+        Lock.lock();
+
+        if(!Failure.empty() && Error.empty()){
+            Error = std::move(Failure);
+        }
+
+        Busy = false;
+        Idle.notify_all();
+    }
+}
+
+}
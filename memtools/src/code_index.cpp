@@ -0,0 +1,642 @@
+﻿#include <x86.h>
+#include <code_index.h>
+#include <work_pool.h>
+
+#include <bit>
+#include <tuple>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace mmtl {
+
+static_assert(std::endian::native == std::endian::little, "The index is mapped as is.");
+
+// The file is the header followed by the arrays it counts, in the order of its fields, then the
+// text of the strings.
+struct code_index::header {
+    char Magic[8];
+    std::uint32_t Timestamp;
+    std::uint32_t ImageSize;
+    std::uint32_t FunctionCount;
+    std::uint32_t XrefCount;
+    std::uint32_t StringCount;
+    std::uint32_t StringBytes;
+};
+
+struct code_index::string_entry {
+    std::uint32_t Rva;
+    std::uint32_t Offset;
+    std::uint32_t Length;
+};
+
+namespace {
+
+constexpr char Magic[8] = {'D', 'H', 'T', 'A', 'S', 'I', 'X', '1'};
+
+// Strings shorter than this are more likely to be other data.
+constexpr std::size_t MinStringLength = 4;
+constexpr std::size_t MaxStringLength = 1024;
+
+struct decoded_function {
+    std::uint32_t End = 0;
+    std::size_t Instructions = 0;
+    std::vector<code_xref> Xrefs;
+    // Code that is called or has its address taken, which may be other functions.
+    std::vector<std::uint32_t> Candidates;
+};
+
+struct analysis {
+    const pe_image& Image;
+    std::uint32_t Base;
+    // Sorted, of 32 bit addresses only.
+    std::vector<std::uint32_t> Relocations;
+    // Every function found so far, sorted.
+    std::vector<std::uint32_t> Known;
+
+    bool is_code(std::uint32_t Rva) const {
+        auto Section = Image.section_at(Rva);
+        return Section && Section->executable() && Rva-Section->Rva < Image.size(*Section);
+    }
+
+    bool is_relocated(std::uint32_t Rva) const {
+        return std::binary_search(Relocations.begin(), Relocations.end(), Rva);
+    }
+
+    bool is_known(std::uint32_t Rva) const {
+        return std::binary_search(Known.begin(), Known.end(), Rva);
+    }
+
+    // The RVA an address in the image refers to, or nothing for anything outside of it.
+    std::optional<std::uint32_t> to_rva(std::uint32_t Address) const {
+        if(Address < Base || Address-Base >= Image.SizeOfImage){
+            return std::nullopt;
+        }
+
+        return Address-Base;
+    }
+
+    std::optional<std::uint32_t> read_pointer(std::uint32_t Rva) const {
+        auto Data = Image.at(Rva, 4);
+        if(!Data){
+            return std::nullopt;
+        }
+
+        std::uint32_t r;
+        std::memcpy(&r, Data, 4);
+        return to_rva(r);
+    }
+};
+
+// Follows every branch from `Start` until returns, jumps to other functions and anything that
+// does not decode. Jumps to a known function or to before `Start`, and a jump as the very first
+// instruction, are taken to be tail calls.
+decoded_function decode_function(const analysis& Analysis, std::uint32_t Start){
+    decoded_function r;
+    r.End = Start;
+
+    std::vector<std::uint32_t> Blocks = {Start};
+    std::unordered_set<std::uint32_t> Seen;
+
+    while(!Blocks.empty()){
+        auto Rva = Blocks.back();
+        Blocks.pop_back();
+
+        while(!Seen.contains(Rva) && (Rva == Start || !Analysis.is_known(Rva))){
+            auto Section = Analysis.Image.section_at(Rva);
+            if(!Section || !Section->executable()){
+                break;
+            }
+
+            auto Offset = Rva-Section->Rva;
+            auto Size = Analysis.Image.size(*Section);
+            if(Offset >= Size){
+                break;
+            }
+
+            auto Instruction = decode_x86(Analysis.Image.data(*Section)+Offset, Size-Offset, Analysis.Base+Rva);
+            if(Instruction.Length == 0){
+                break;
+            }
+
+            Seen.insert(Rva);
+            ++r.Instructions;
+            r.End = std::max(r.End, Rva+Instruction.Length);
+
+            auto Next = Rva+Instruction.Length;
+
+            // A switch, jumping through a table of relocated pointers to code.
+            auto Table = Instruction.HasDisplacement?Analysis.to_rva(Instruction.Displacement):std::nullopt;
+            if(Table && Instruction.Flow == x86_flow::IndirectJump && !Instruction.HasBase && Instruction.Scale == 4){
+                r.Xrefs.push_back({Rva, *Table, xref_kind::Data});
+
+                for(auto Entry = *Table; Analysis.is_relocated(Entry); Entry += 4){
+                    auto Target = Analysis.read_pointer(Entry);
+                    if(!Target || !Analysis.is_code(*Target)){
+                        break;
+                    }
+
+                    Blocks.push_back(*Target);
+                }
+
+                break;
+            }
+
+            if(Table){
+                r.Xrefs.push_back({Rva, *Table, xref_kind::Data});
+            }
+
+            if(auto Value = Instruction.HasImmediate?Analysis.to_rva(Instruction.Immediate):std::nullopt){
+                r.Xrefs.push_back({Rva, *Value, xref_kind::Data});
+
+                if(Analysis.is_code(*Value)){
+                    r.Candidates.push_back(*Value);
+                }
+            }
+
+            auto Target = Analysis.to_rva(Instruction.Target);
+
+            switch(Instruction.Flow){
+                case x86_flow::None:
+                case x86_flow::IndirectCall: {
+                    Rva = Next;
+                    continue;
+                }
+                case x86_flow::Call: {
+                    if(Target && Analysis.is_code(*Target)){
+                        r.Xrefs.push_back({Rva, *Target, xref_kind::Call});
+                        r.Candidates.push_back(*Target);
+                    }
+
+                    Rva = Next;
+                    continue;
+                }
+                case x86_flow::Branch: {
+                    if(Target){
+                        Blocks.push_back(*Target);
+                    }
+
+                    Rva = Next;
+                    continue;
+                }
+                case x86_flow::Jump: {
+                    if(Target && Analysis.is_code(*Target)){
+                        if(Rva == Start || *Target < Start || Analysis.is_known(*Target)){
+                            r.Xrefs.push_back({Rva, *Target, xref_kind::Jump});
+                            r.Candidates.push_back(*Target);
+                        }else{
+                            Blocks.push_back(*Target);
+                        }
+                    }
+
+                    break;
+                }
+                case x86_flow::Return:
+                case x86_flow::IndirectJump:
+                case x86_flow::Stop: {
+                    break;
+                }
+            }
+
+            break;
+        }
+    }
+
+    return r;
+}
+
+// Functions known without decoding anything: the entry point, the exports, and pointers to code
+// outside of code sections, which are mostly virtual function tables.
+std::vector<std::uint32_t> find_roots(const analysis& Analysis){
+    auto& Image = Analysis.Image;
+
+    std::vector<std::uint32_t> r;
+
+    if(Analysis.is_code(Image.EntryPoint)){
+        r.push_back(Image.EntryPoint);
+    }
+
+    if(Image.Directories.size() > pe_image::ExportDirectory){
+        auto& Directory = Image.Directories[pe_image::ExportDirectory];
+
+        std::uint32_t Count = 0;
+        std::uint32_t Functions = 0;
+
+        if(auto Exports = Image.at(Directory.Rva, 40)){
+            std::memcpy(&Count, Exports+20, 4);
+            std::memcpy(&Functions, Exports+28, 4);
+        }
+
+        for(std::uint32_t i = 0; i < Count; ++i){
+            auto Entry = Image.at(Functions+i*4, 4);
+            if(!Entry){
+                break;
+            }
+
+            std::uint32_t Rva;
+            std::memcpy(&Rva, Entry, 4);
+
+            // Forwarded exports point to a name in the export directory instead.
+            if(Analysis.is_code(Rva)){
+                r.push_back(Rva);
+            }
+        }
+    }
+
+    for(auto Rva:Analysis.Relocations){
+        if(Analysis.is_code(Rva)){
+            continue;
+        }
+
+        if(auto Target = Analysis.read_pointer(Rva); Target && Analysis.is_code(*Target)){
+            r.push_back(*Target);
+        }
+    }
+
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+
+    return r;
+}
+
+// The text of the string at `Rva`, as 8 bit characters or UTF-16 limited to ASCII, if it looks like
+// one.
+std::optional<std::string> read_string(const pe_image& Image, std::uint32_t Rva){
+    auto Section = Image.section_at(Rva);
+    if(!Section || Section->executable() || Rva-Section->Rva >= Image.size(*Section)){
+        return std::nullopt;
+    }
+
+    auto Data = Image.data(*Section)+(Rva-Section->Rva);
+    auto Size = std::min(Image.size(*Section)-(Rva-Section->Rva), MaxStringLength*2+2);
+
+    auto printable = [](std::uint8_t c){
+        return (c >= 0x20 && c < 0x7F) || c == '\t' || c == '\n' || c == '\r';
+    };
+
+    for(std::size_t Width:{1, 2}){
+        std::string r;
+
+        for(std::size_t i = 0; i+Width <= Size; i += Width){
+            auto c = std::to_integer<std::uint8_t>(Data[i]);
+            if(Width == 2 && Data[i+1] != std::byte(0)){
+                break;
+            }
+
+            if(c == 0){
+                if(r.size() >= MinStringLength){
+                    return r;
+                }
+
+                break;
+            }
+
+            if(!printable(c) || r.size() >= MaxStringLength){
+                break;
+            }
+
+            r += static_cast<char>(c);
+        }
+    }
+
+    return std::nullopt;
+}
+
+void unmap(void* Mapping, std::size_t Size){
+#ifdef _WIN32
+    (void)Size;
+    UnmapViewOfFile(Mapping);
+#else
+    munmap(Mapping, Size);
+#endif
+}
+
+template <typename T>
+void write_array(std::ofstream& File, const std::vector<T>& Data){
+    File.write(reinterpret_cast<const char*>(Data.data()), static_cast<std::streamsize>(Data.size()*sizeof(T)));
+}
+
+}
+
+code_index_stats build_code_index(const pe_image& Image, const std::filesystem::path& Path, work_pool* Pool){
+    if(Image.Is64){
+        throw std::runtime_error("Only 32 bit images are supported.");
+    }
+
+    code_index_stats Stats;
+
+    analysis Analysis = {
+        .Image = Image,
+        .Base = static_cast<std::uint32_t>(Image.ImageBase),
+        .Relocations = {},
+        .Known = {},
+    };
+
+    for(auto& e:Image.relocations()){
+        if(e.Size == 4){
+            Analysis.Relocations.push_back(e.Rva);
+        }
+    }
+
+    std::vector<code_function> Functions;
+    std::vector<code_xref> Xrefs;
+
+    // Decodes every function found so far in parallel, then the ones those led to, and so on.
+    auto Frontier = find_roots(Analysis);
+    while(!Frontier.empty()){
+        auto Middle = Analysis.Known.insert(Analysis.Known.end(), Frontier.begin(), Frontier.end());
+        std::inplace_merge(Analysis.Known.begin(), Middle, Analysis.Known.end());
+
+        std::vector<decoded_function> Decoded(Frontier.size());
+
+        auto decode = [&](std::size_t Begin, std::size_t End, unsigned){
+            for(auto i = Begin; i < End; ++i){
+                Decoded[i] = decode_function(Analysis, Frontier[i]);
+            }
+        };
+
+        if(Pool){
+            Pool->parallel_for(Frontier.size(), 16, decode);
+        }else{
+            decode(0, Frontier.size(), 0);
+        }
+
+        std::vector<std::uint32_t> Next;
+        for(std::size_t i = 0; i < Frontier.size(); ++i){
+            auto& e = Decoded[i];
+
+            Functions.push_back({Frontier[i], e.End});
+            Xrefs.insert(Xrefs.end(), e.Xrefs.begin(), e.Xrefs.end());
+            Stats.Instructions += e.Instructions;
+
+            for(auto Candidate:e.Candidates){
+                if(!Analysis.is_known(Candidate)){
+                    Next.push_back(Candidate);
+                }
+            }
+        }
+
+        std::sort(Next.begin(), Next.end());
+        Next.erase(std::unique(Next.begin(), Next.end()), Next.end());
+
+        Frontier = std::move(Next);
+    }
+
+    std::sort(Functions.begin(), Functions.end(), [](auto& a, auto& b){ return a.Start < b.Start; });
+
+    auto by_target = [](const code_xref& a, const code_xref& b){
+        return std::tie(a.To, a.From, a.Kind) < std::tie(b.To, b.From, b.Kind);
+    };
+
+    std::sort(Xrefs.begin(), Xrefs.end(), by_target);
+    Xrefs.erase(std::unique(Xrefs.begin(), Xrefs.end(), [](auto& a, auto& b){
+        return a.To == b.To && a.From == b.From && a.Kind == b.Kind;
+    }), Xrefs.end());
+
+    std::vector<std::uint32_t> XrefsFrom(Xrefs.size());
+    for(std::size_t i = 0; i < Xrefs.size(); ++i){
+        XrefsFrom[i] = static_cast<std::uint32_t>(i);
+    }
+
+    std::stable_sort(XrefsFrom.begin(), XrefsFrom.end(), [&](auto a, auto b){ return Xrefs[a].From < Xrefs[b].From; });
+
+    std::vector<code_index::string_entry> Strings;
+    std::string StringData;
+
+    for(std::size_t i = 0; i < Xrefs.size(); ++i){
+        if(Xrefs[i].Kind != xref_kind::Data || (i > 0 && Xrefs[i-1].To == Xrefs[i].To)){
+            continue;
+        }
+
+        if(auto Text = read_string(Image, Xrefs[i].To)){
+            Strings.push_back({Xrefs[i].To, static_cast<std::uint32_t>(StringData.size()), static_cast<std::uint32_t>(Text->size())});
+            StringData += *Text;
+        }
+    }
+
+    std::ofstream File(Path, std::ios::binary|std::ios::trunc);
+    if(!File){
+        throw std::runtime_error("Unable to create code index.");
+    }
+
+    code_index::header Header = {};
+    std::memcpy(Header.Magic, Magic, sizeof(Magic));
+    Header.Timestamp = Image.TimeDateStamp;
+    Header.ImageSize = Image.SizeOfImage;
+    Header.FunctionCount = static_cast<std::uint32_t>(Functions.size());
+    Header.XrefCount = static_cast<std::uint32_t>(Xrefs.size());
+    Header.StringCount = static_cast<std::uint32_t>(Strings.size());
+    Header.StringBytes = static_cast<std::uint32_t>(StringData.size());
+
+    File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+    write_array(File, Functions);
+    write_array(File, Xrefs);
+    write_array(File, XrefsFrom);
+    write_array(File, Strings);
+    File.write(StringData.data(), static_cast<std::streamsize>(StringData.size()));
+
+    if(!File){
+        throw std::runtime_error("Unable to write code index.");
+    }
+
+    Stats.Functions = Functions.size();
+    Stats.Xrefs = Xrefs.size();
+    Stats.Strings = Strings.size();
+
+    return Stats;
+}
+
+code_index::code_index(const std::filesystem::path& Path){
+#ifdef _WIN32
+    auto File = CreateFileW(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(File == INVALID_HANDLE_VALUE){
+        throw std::runtime_error("Unable to open code index.");
+    }
+
+    LARGE_INTEGER FileSize;
+    if(!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart < static_cast<LONGLONG>(sizeof(header))){
+        CloseHandle(File);
+        throw std::runtime_error("Not a code index.");
+    }
+
+    Size = static_cast<std::size_t>(FileSize.QuadPart);
+
+    auto FileMapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(File);
+
+    if(!FileMapping){
+        throw std::runtime_error("Unable to map code index.");
+    }
+
+    // The view keeps the mapping alive.
+    Mapping = MapViewOfFile(FileMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(FileMapping);
+
+    if(!Mapping){
+        throw std::runtime_error("Unable to map code index.");
+    }
+#else
+    auto File = open(Path.c_str(), O_RDONLY);
+    if(File < 0){
+        throw std::runtime_error("Unable to open code index.");
+    }
+
+    struct stat Stat;
+    if(fstat(File, &Stat) != 0 || static_cast<std::size_t>(Stat.st_size) < sizeof(header)){
+        close(File);
+        throw std::runtime_error("Not a code index.");
+    }
+
+    Size = static_cast<std::size_t>(Stat.st_size);
+
+    auto r = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File);
+
+    if(r == MAP_FAILED){
+        throw std::runtime_error("Unable to map code index.");
+    }
+
+    Mapping = r;
+#endif
+
+    auto Data = static_cast<const char*>(Mapping);
+
+    Header = reinterpret_cast<const header*>(Data);
+
+    auto Expected = sizeof(header)+std::size_t(Header->FunctionCount)*sizeof(code_function)+
+        std::size_t(Header->XrefCount)*(sizeof(code_xref)+4)+std::size_t(Header->StringCount)*sizeof(string_entry)+
+        Header->StringBytes;
+
+    if(std::memcmp(Header->Magic, Magic, sizeof(Magic)) != 0 || Size != Expected){
+        unmap(Mapping, Size);
+        throw std::runtime_error("Not a code index.");
+    }
+
+    Data += sizeof(header);
+    Functions = reinterpret_cast<const code_function*>(Data);
+    Data += Header->FunctionCount*sizeof(code_function);
+    Xrefs = reinterpret_cast<const code_xref*>(Data);
+    Data += Header->XrefCount*sizeof(code_xref);
+    XrefsFrom = reinterpret_cast<const std::uint32_t*>(Data);
+    Data += Header->XrefCount*4;
+    Strings = reinterpret_cast<const string_entry*>(Data);
+    Data += Header->StringCount*sizeof(string_entry);
+    StringData = Data;
+}
+
+code_index::~code_index(){
+    unmap(Mapping, Size);
+}
+
+std::uint32_t code_index::timestamp() const {
+    return Header->Timestamp;
+}
+
+std::uint32_t code_index::image_size() const {
+    return Header->ImageSize;
+}
+
+std::span<const code_function> code_index::functions() const {
+    return {Functions, Header->FunctionCount};
+}
+
+const code_function* code_index::function_at(std::uint32_t Rva) const {
+    auto All = functions();
+
+    auto it = std::upper_bound(All.begin(), All.end(), Rva, [](std::uint32_t a, const code_function& b){ return a < b.Start; });
+    if(it == All.begin()){
+        return nullptr;
+    }
+
+    --it;
+    return (Rva < it->End)?&*it:nullptr;
+}
+
+std::span<const code_xref> code_index::references_to(std::uint32_t Rva) const {
+    std::span<const code_xref> All(Xrefs, Header->XrefCount);
+
+    auto Begin = std::lower_bound(All.begin(), All.end(), Rva, [](const code_xref& a, std::uint32_t b){ return a.To < b; });
+    auto End = std::upper_bound(Begin, All.end(), Rva, [](std::uint32_t a, const code_xref& b){ return a < b.To; });
+
+    return {Begin, End};
+}
+
+std::vector<code_xref> code_index::references_from(std::uint32_t Begin, std::uint32_t End) const {
+    std::span<const std::uint32_t> All(XrefsFrom, Header->XrefCount);
+
+    auto it = std::lower_bound(All.begin(), All.end(), Begin, [&](std::uint32_t a, std::uint32_t b){ return Xrefs[a].From < b; });
+
+    std::vector<code_xref> r;
+    for(; it != All.end() && Xrefs[*it].From < End; ++it){
+        r.push_back(Xrefs[*it]);
+    }
+
+    return r;
+}
+
+std::vector<std::uint32_t> code_index::callers(std::uint32_t Rva) const {
+    std::vector<std::uint32_t> r;
+
+    for(auto& e:references_to(Rva)){
+        if(e.Kind == xref_kind::Data){
+            continue;
+        }
+
+        if(auto Function = function_at(e.From)){
+            r.push_back(Function->Start);
+        }
+    }
+
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+
+    return r;
+}
+
+std::vector<std::uint32_t> code_index::functions_referencing(std::string_view Text) const {
+    std::vector<std::uint32_t> r;
+
+    for(std::size_t i = 0; i < Header->StringCount; ++i){
+        std::string_view String(StringData+Strings[i].Offset, Strings[i].Length);
+        if(String.find(Text) == std::string_view::npos){
+            continue;
+        }
+
+        for(auto& e:references_to(Strings[i].Rva)){
+            if(auto Function = function_at(e.From)){
+                r.push_back(Function->Start);
+            }
+        }
+    }
+
+    std::sort(r.begin(), r.end());
+    r.erase(std::unique(r.begin(), r.end()), r.end());
+
+    return r;
+}
+
+std::string_view code_index::string_at(std::uint32_t Rva) const {
+    std::span<const string_entry> All(Strings, Header->StringCount);
+
+    auto it = std::lower_bound(All.begin(), All.end(), Rva, [](const string_entry& a, std::uint32_t b){ return a.Rva < b; });
+    if(it == All.end() || it->Rva != Rva){
+        return {};
+    }
+
+    return {StringData+it->Offset, it->Length};
+}
+
+}
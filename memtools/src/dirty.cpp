@@ -0,0 +1,355 @@
+﻿#include <dirty.h>
+
+#include <bit>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <csignal>
+
+    #include <sys/mman.h>
+#endif
+
+namespace mmtl {
+
+struct dirty_tracker::table {
+    struct entry {
+        region Region;
+
+        // One bit per page, only used for `tracking::Protect`.
+        std::unique_ptr<std::atomic<std::uint64_t>[]> Bits;
+    };
+
+    // Sorted by address.
+    std::vector<entry> Entries;
+
+    // Entries overlapping `[Begin, End)`.
+    template <typename F>
+    void for_each(std::uintptr_t Begin, std::uintptr_t End, F&& Fn){
+        auto it = std::upper_bound(Entries.begin(), Entries.end(), Begin,
+            [](std::uintptr_t a, const entry& b){ return a < b.Region.Base; });
+
+        if(it != Entries.begin() && Begin < std::prev(it)->Region.end()){
+            --it;
+        }
+
+        for(; it != Entries.end() && it->Region.Base < End; ++it){
+            Fn(*it, std::max(Begin, it->Region.Base), std::min(End, it->Region.end()));
+        }
+    }
+
+    const entry* find(std::uintptr_t Address) const {
+        auto it = std::upper_bound(Entries.begin(), Entries.end(), Address,
+            [](std::uintptr_t a, const entry& b){ return a < b.Region.Base; });
+
+        if(it == Entries.begin()){
+            return nullptr;
+        }
+
+        --it;
+        return (Address < it->Region.end())?&*it:nullptr;
+    }
+};
+
+namespace {
+
+constinit std::atomic<dirty_tracker::table*> CurrentTable = nullptr;
+constinit std::atomic<bool> TrackerExists = false;
+
+void set_protection(const region& Region, std::uintptr_t Begin, std::uintptr_t End, bool ReadOnly){
+    if(Begin >= End){
+        return;
+    }
+
+#ifdef _WIN32
+    DWORD Protect = Region.Protect;
+    if(ReadOnly){
+        auto Flags = Protect&~0xFF;
+        switch(Protect&0xFF){
+            case PAGE_READWRITE:
+            case PAGE_WRITECOPY: {
+                Protect = Flags|PAGE_READONLY;
+                break;
+            }
+            case PAGE_EXECUTE_READWRITE:
+            case PAGE_EXECUTE_WRITECOPY: {
+                Protect = Flags|PAGE_EXECUTE_READ;
+                break;
+            }
+        }
+    }
+
+    DWORD Old;
+    VirtualProtect(reinterpret_cast<void*>(Begin), End-Begin, Protect, &Old);
+#else
+    auto Protect = static_cast<int>(Region.Protect);
+    if(ReadOnly){
+        Protect &= ~PROT_WRITE;
+    }
+
+    mprotect(reinterpret_cast<void*>(Begin), End-Begin, Protect);
+#endif
+}
+
+// Called from the fault handler, so it must not allocate or take locks.
+bool on_write_fault(std::uintptr_t Address){
+    auto Table = CurrentTable.load(std::memory_order_acquire);
+    if(!Table){
+        return false;
+    }
+
+    auto Entry = Table->find(Address);
+    if(!Entry || Entry->Region.Tracking != tracking::Protect){
+        return false;
+    }
+
+    auto Page = page_floor(Address);
+    auto Index = (Page-Entry->Region.Base)/PageSize;
+
+    Entry->Bits[Index/64].fetch_or(std::uint64_t(1) << (Index%64), std::memory_order_acq_rel);
+
+    set_protection(Entry->Region, Page, Page+PageSize, false);
+
+    return true;
+}
+
+#ifdef _WIN32
+
+constinit void* FaultHandler = nullptr;
+
+LONG CALLBACK vectored_handler(EXCEPTION_POINTERS* Info){
+    auto Record = Info->ExceptionRecord;
+
+    if(
+        Record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && Record->NumberParameters >= 2 &&
+        Record->ExceptionInformation[0] == 1 && on_write_fault(Record->ExceptionInformation[1])
+    ){
+        return EXCEPTION_CONTINUE_EXECUTION;
+    }
+
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void install_handler(){
+    FaultHandler = AddVectoredExceptionHandler(1, vectored_handler);
+    if(!FaultHandler){
+        throw std::runtime_error("Unable to install exception handler.");
+    }
+}
+
+void remove_handler(){
+    RemoveVectoredExceptionHandler(FaultHandler);
+    FaultHandler = nullptr;
+}
+
+#else
+
+struct sigaction PreviousAction = {};
+
+void signal_handler(int Signal, siginfo_t* Info, void* Context){
+    if(on_write_fault(reinterpret_cast<std::uintptr_t>(Info->si_addr))){
+        return;
+    }
+
+    // Not ours, let whoever was there before handle it.
+    if(PreviousAction.sa_flags&SA_SIGINFO){
+        PreviousAction.sa_sigaction(Signal, Info, Context);
+    }else if(PreviousAction.sa_handler == SIG_DFL){
+        // Returning retries the access, which then crashes as usual.
+        sigaction(SIGSEGV, &PreviousAction, nullptr);
+    }else if(PreviousAction.sa_handler != SIG_IGN){
+        PreviousAction.sa_handler(Signal);
+    }
+}
+
+void install_handler(){
+    struct sigaction Action = {};
+    Action.sa_sigaction = signal_handler;
+    Action.sa_flags = SA_SIGINFO|SA_NODEFER;
+    sigemptyset(&Action.sa_mask);
+
+    if(sigaction(SIGSEGV, &Action, &PreviousAction) != 0){
+        throw std::runtime_error("Unable to install signal handler.");
+    }
+}
+
+void remove_handler(){
+    sigaction(SIGSEGV, &PreviousAction, nullptr);
+}
+
+#endif
+
+}
+
+dirty_tracker::dirty_tracker(){
+    if(TrackerExists.exchange(true)){
+        throw std::logic_error("Only one dirty_tracker can exist at a time.");
+    }
+
+    try {
+        install_handler();
+    }catch(...){
+        TrackerExists = false;
+        throw;
+    }
+}
+
+dirty_tracker::~dirty_tracker(){
+    unwatch();
+
+    remove_handler();
+
+    TrackerExists = false;
+}
+
+void dirty_tracker::watch(const std::vector<region>& Regions){
+    unwatch();
+
+    auto New = std::make_unique<table>();
+
+    for(auto& e:Regions){
+        if(e.Tracking == tracking::Compare){
+            continue;
+        }
+
+        table::entry Entry = {e, nullptr};
+
+        if(e.Tracking == tracking::Protect){
+            auto Words = (e.Size/PageSize+63)/64;
+            Entry.Bits = std::make_unique<std::atomic<std::uint64_t>[]>(Words);
+            for(std::size_t i = 0; i < Words; ++i){
+                Entry.Bits[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        New->Entries.push_back(std::move(Entry));
+    }
+
+    // Publish before protecting, so the handler knows about every page that can fault.
+    CurrentTable.store(New.get(), std::memory_order_release);
+
+    for(auto& e:New->Entries){
+        switch(e.Region.Tracking){
+            case tracking::Protect: {
+                set_protection(e.Region, e.Region.Base, e.Region.end(), true);
+                break;
+            }
+            case tracking::WriteWatch: {
+#ifdef _WIN32
+                ResetWriteWatch(reinterpret_cast<void*>(e.Region.Base), e.Region.Size);
+#endif
+                break;
+            }
+            case tracking::Compare: {
+                break;
+            }
+        }
+    }
+
+    Table = std::move(New);
+}
+
+void dirty_tracker::unwatch(){
+    if(!Table){
+        return;
+    }
+
+    for(auto& e:Table->Entries){
+        if(e.Region.Tracking == tracking::Protect){
+            set_protection(e.Region, e.Region.Base, e.Region.end(), false);
+        }
+    }
+
+    CurrentTable.store(nullptr, std::memory_order_release);
+
+    // A handler that was already running might still be using the table for a moment.
+    Retired.push_back(std::move(Table));
+    if(Retired.size() > 4){
+        Retired.erase(Retired.begin());
+    }
+}
+
+void dirty_tracker::collect(std::vector<std::uintptr_t>& Pages){
+    if(!Table){
+        return;
+    }
+
+    for(auto& e:Table->Entries){
+        auto& Region = e.Region;
+
+        if(Region.Tracking == tracking::Protect){
+            auto Count = Region.Size/PageSize;
+
+            // Clear the bits before protecting, so a write in between is either seen by the caller's
+            // copy or faults again.
+            std::uintptr_t RunBegin = 0, RunEnd = 0;
+            for(std::size_t w = 0; w*64 < Count; ++w){
+                auto Bits = e.Bits[w].exchange(0, std::memory_order_acq_rel);
+
+                while(Bits != 0){
+                    auto b = static_cast<std::size_t>(std::countr_zero(Bits));
+                    Bits &= Bits-1;
+
+                    auto Page = Region.Base+(w*64+b)*PageSize;
+                    Pages.push_back(Page);
+
+                    if(Page == RunEnd){
+                        RunEnd += PageSize;
+                    }else{
+                        set_protection(Region, RunBegin, RunEnd, true);
+                        RunBegin = Page;
+                        RunEnd = Page+PageSize;
+                    }
+                }
+            }
+
+            set_protection(Region, RunBegin, RunEnd, true);
+        }else if(Region.Tracking == tracking::WriteWatch){
+#ifdef _WIN32
+            std::vector<void*> Addresses(Region.Size/PageSize);
+
+            ULONG_PTR Count = Addresses.size();
+            ULONG Granularity;
+            if(GetWriteWatch(WRITE_WATCH_FLAG_RESET, reinterpret_cast<void*>(Region.Base), Region.Size,
+                    Addresses.data(), &Count, &Granularity) == 0){
+                for(ULONG_PTR i = 0; i < Count; ++i){
+                    Pages.push_back(reinterpret_cast<std::uintptr_t>(Addresses[i]));
+                }
+            }
+#endif
+        }
+    }
+}
+
+void dirty_tracker::begin_write(std::uintptr_t Begin, std::uintptr_t End){
+    if(!Table){
+        return;
+    }
+
+    Table->for_each(Begin, End, [](table::entry& e, std::uintptr_t First, std::uintptr_t Last){
+        if(e.Region.Tracking == tracking::Protect){
+            set_protection(e.Region, First, Last, false);
+        }
+    });
+}
+
+void dirty_tracker::end_write(std::uintptr_t Begin, std::uintptr_t End){
+    if(!Table){
+        return;
+    }
+
+    Table->for_each(Begin, End, [](table::entry& e, std::uintptr_t First, std::uintptr_t Last){
+        if(e.Region.Tracking == tracking::Protect){
+            set_protection(e.Region, First, Last, true);
+        }else if(e.Region.Tracking == tracking::WriteWatch){
+#ifdef _WIN32
+            ResetWriteWatch(reinterpret_cast<void*>(First), Last-First);
+#endif
+        }
+    });
+}
+
+}
@@ -0,0 +1,85 @@
+﻿#include <event_ring.h>
+
+#include <bit>
+#include <cstddef>
+#include <stdexcept>
+#include <algorithm>
+
+namespace mmtl {
+
+key_set::key_set(const std::vector<std::int32_t>& Keys){
+    std::size_t Size = 64;
+    while(Size < Keys.size()*4){
+        Size *= 2;
+    }
+
+    Slots.assign(Size, Empty);
+    Shift = static_cast<std::uint32_t>(32-std::countr_zero(Size));
+    Mask = static_cast<std::uint32_t>(Size-1);
+
+    for(auto Key:Keys){
+        if(Key == Empty){
+            throw std::invalid_argument("Key out of range.");
+        }
+
+        auto i = (static_cast<std::uint32_t>(Key)*0x9E3779B9u) >> Shift;
+        while(Slots[i] != Empty && Slots[i] != Key){
+            i = (i+1)&Mask;
+        }
+
+        if(Slots[i] == Empty){
+            Slots[i] = Key;
+            ++Count;
+        }
+    }
+}
+
+event_ring::event_ring(std::size_t Capacity):Mask(std::bit_ceil(std::max<std::size_t>(Capacity, 2))-1){
+    Cells = std::make_unique<cell[]>(Mask+1);
+    for(std::size_t i = 0; i <= Mask; ++i){
+        Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool event_ring::push(const traced_event& Event){
+    auto Position = Head.load(std::memory_order_relaxed);
+
+    for(;;){
+        auto& Cell = Cells[Position&Mask];
+        auto Sequence = Cell.Sequence.load(std::memory_order_acquire);
+
+        if(Sequence == Position){
+            // Claim the cell, or retry with whatever position another thread moved to.
+            if(Head.compare_exchange_weak(Position, Position+1, std::memory_order_relaxed)){
+                Cell.Event = Event;
+                Cell.Sequence.store(Position+1, std::memory_order_release);
+                return true;
+            }
+        }else if(static_cast<std::ptrdiff_t>(Sequence-Position) < 0){
+            // Not drained since the last time around. Compared as a difference, so it still
+            // holds once the counters wrap.
+            Dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }else{
+            Position = Head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::size_t event_ring::drain(std::vector<traced_event>& Out){
+    std::size_t r = 0;
+
+    for(;; ++r, ++Tail){
+        auto& Cell = Cells[Tail&Mask];
+        if(Cell.Sequence.load(std::memory_order_acquire) != Tail+1){
+            break;
+        }
+
+        Out.push_back(Cell.Event);
+        Cell.Sequence.store(Tail+Mask+1, std::memory_order_release);
+    }
+
+    return r;
+}
+
+}
@@ -0,0 +1,280 @@
+﻿#include <file_cache.h>
+
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace mmtl {
+
+namespace {
+
+// Touched at a time, between checks for more to do.
+constexpr std::uint64_t TouchChunk = 256 << 10;
+
+constexpr std::uint64_t Page = 4096;
+
+// Case folded, so the same file opened with different case is only mapped once.
+std::string file_key(const std::filesystem::path& Path){
+    auto Name = Path.lexically_normal().generic_u8string();
+
+    std::string r(reinterpret_cast<const char*>(Name.data()), Name.size());
+    for(auto& c:r){
+        if(c >= 'A' && c <= 'Z'){
+            c = static_cast<char>(c-'A'+'a');
+        }
+    }
+
+    return r;
+}
+
+}
+
+file_cache::file_cache(std::uint64_t Budget, std::size_t ReadAhead):Budget(Budget), ReadAhead(ReadAhead){
+    Thread = std::thread(&file_cache::run, this);
+}
+
+file_cache::~file_cache(){
+    {
+        std::lock_guard Lock(Mutex);
+        Stopping = true;
+    }
+
+    Wake.notify_all();
+    Thread.join();
+}
+
+std::shared_ptr<file_cache::file> file_cache::open(const std::filesystem::path& Path){
+    auto Key = file_key(Path);
+
+    {
+        std::lock_guard Lock(Mutex);
+
+        if(auto it = Index.find(Key); it != Index.end()){
+            Recent.splice(Recent.begin(), Recent, it->second);
+            return *it->second;
+        }
+    }
+
+    // Mapped without the lock, it may have to wait for the disk.
+    std::shared_ptr<const cloud_data> Data;
+    try {
+        Data = cloud_data::map(Path);
+    }catch(std::runtime_error&){
+        return nullptr;
+    }
+
+    if(Data->size() > Budget){
+        return nullptr;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    // Opened on another thread in the meantime.
+    if(auto it = Index.find(Key); it != Index.end()){
+        Recent.splice(Recent.begin(), Recent, it->second);
+        return *it->second;
+    }
+
+    auto File = std::make_shared<file>();
+    File->Path = Path;
+    File->Data = std::move(Data);
+
+    Recent.push_front(File);
+    Index.emplace(std::move(Key), Recent.begin());
+    Mapped += File->Data->size();
+
+    evict();
+
+    return File;
+}
+
+void file_cache::evict(){
+    for(auto it = Recent.end(); Mapped > Budget && it != Recent.begin();){
+        --it;
+
+        // Open, or waiting to be touched.
+        if(it->use_count() > 1){
+            continue;
+        }
+
+        Mapped -= (*it)->Data->size();
+        Index.erase(file_key((*it)->Path));
+        it = Recent.erase(it);
+    }
+}
+
+std::size_t file_cache::read(file& File, std::uint64_t Offset, void* Data, std::size_t Size){
+    auto FileSize = File.Data->size();
+    if(Offset >= FileSize){
+        return 0;
+    }
+
+    auto Begin = static_cast<std::size_t>(Offset);
+    auto r = std::min(Size, FileSize-Begin);
+
+    Reads.fetch_add(1, std::memory_order_relaxed);
+    Bytes.fetch_add(r, std::memory_order_relaxed);
+    if(Begin+r <= File.Warmed.load(std::memory_order_acquire)){
+        Hits.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::memcpy(Data, File.Data->data()+Begin, r);
+
+    // Only asks for more once half of what was asked for before has been read.
+    if(File.Wanted.load(std::memory_order_relaxed) < Begin+r+ReadAhead/2){
+        want(File, Begin+r+ReadAhead);
+    }
+
+    return r;
+}
+
+void file_cache::prefetch(const std::filesystem::path& Path){
+    if(auto File = open(Path)){
+        want(*File, File->Data->size());
+    }
+}
+
+void file_cache::want(file& File, std::uint64_t End){
+    End = std::min<std::uint64_t>(End, File.Data->size());
+
+    {
+        std::lock_guard Lock(Mutex);
+
+        if(File.Wanted >= End){
+            return;
+        }
+
+        File.Wanted = End;
+
+        if(File.Queued || File.Warmed >= End){
+            return;
+        }
+
+        File.Queued = true;
+        Queue.push_back(File.shared_from_this());
+    }
+
+    Wake.notify_one();
+}
+
+void file_cache::wait(){
+    std::unique_lock Lock(Mutex);
+    Idle.wait(Lock, [&]{ return Queue.empty() && !Busy; });
+}
+
+file_cache::counters file_cache::count() const {
+    return {
+        .Reads = Reads.load(std::memory_order_relaxed),
+        .Hits = Hits.load(std::memory_order_relaxed),
+        .Bytes = Bytes.load(std::memory_order_relaxed),
+    };
+}
+
+std::uint64_t file_cache::mapped() const {
+    std::lock_guard Lock(Mutex);
+    return Mapped;
+}
+
+void file_cache::run(){
+    std::unique_lock Lock(Mutex);
+
+    while(true){
+        Wake.wait(Lock, [&]{ return Stopping || !Queue.empty(); });
+
+        if(Stopping){
+            break;
+        }
+
+        auto File = std::move(Queue.front());
+        Queue.pop_front();
+        Busy = true;
+
+        Lock.unlock();
+
+        // Reading a byte of every page is enough for the system to bring it in.
+        auto Data = File->Data->data();
+        unsigned char Sum = 0;
+
+        while(!Stopping){
+            auto From = File->Warmed.load(std::memory_order_relaxed);
+            auto To = std::min(File->Wanted.load(std::memory_order_relaxed), From+TouchChunk);
+            if(From >= To){
+                break;
+            }
+
+            for(auto i = From/Page*Page; i < To; i += Page){
+                Sum += Data[i];
+            }
+
+            File->Warmed.store(To, std::memory_order_release);
+        }
+
+        // Keeps the reads from being optimised away.
+        static_cast<void>(*static_cast<volatile unsigned char*>(&Sum));
+
+        Lock.lock();
+
+        // More may have been asked for after the loop looked.
+        if(!Stopping && File->Warmed < File->Wanted){
+            Queue.push_back(std::move(File));
+        }else{
+            File->Queued = false;
+        }
+
+        Busy = false;
+        Idle.notify_all();
+    }
+}
+
+void load_log::read(const std::filesystem::path& Path){
+    Loads.clear();
+
+    std::ifstream File(Path, std::ios::binary);
+
+    std::vector<std::string>* Level = nullptr;
+
+    std::string Line;
+    while(std::getline(File, Line)){
+        if(!Line.empty() && Line.back() == '\r'){
+            Line.pop_back();
+        }
+
+        if(Line.empty()){
+            continue;
+        }
+
+        if(Line[0] != '\t'){
+            Level = &Loads[Line];
+            Level->clear();
+        }else if(Level){
+            Level->push_back(Line.substr(1));
+        }
+    }
+}
+
+void load_log::write(const std::filesystem::path& Path) const {
+    std::ofstream File(Path, std::ios::binary|std::ios::trunc);
+
+    for(auto& [Level, Files]:Loads){
+        File << Level << '\n';
+        for(auto& e:Files){
+            File << '\t' << e << '\n';
+        }
+    }
+
+    if(!File.flush()){
+        throw std::runtime_error("Unable to write the load log.");
+    }
+}
+
+const std::vector<std::string>* load_log::find(std::string_view Level) const {
+    auto it = Loads.find(Level);
+    return (it != Loads.end())?&it->second:nullptr;
+}
+
+void load_log::record(const std::string& Level, std::vector<std::string> Files){
+    Loads.insert_or_assign(Level, std::move(Files));
+}
+
+}
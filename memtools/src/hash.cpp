@@ -0,0 +1,152 @@
+﻿#include <hash.h>
+#include <work_pool.h>
+
+#include <bit>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MMTL_SSE2 1
+
+    #include <emmintrin.h>
+#endif
+
+namespace mmtl {
+
+namespace {
+
+constexpr std::uint64_t Prime1 = 0x9E3779B185EBCA87;
+constexpr std::uint64_t Prime2 = 0xC2B2AE3D27D4EB4F;
+
+// Sixteen keys, followed by the first eight again, so two consecutive keys can always be loaded at once.
+constexpr std::array<std::uint64_t, 24> Keys = [](){
+    std::array<std::uint64_t, 24> r = {};
+
+    // SplitMix64.
+    std::uint64_t x = 0x6D656D746F6F6C73;
+    for(std::size_t i = 0; i < 16; ++i){
+        x += Prime1;
+        auto z = x;
+        z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9;
+        z = (z ^ (z >> 27))*0x94D049BB133111EB;
+        r[i] = z ^ (z >> 31);
+    }
+
+    for(std::size_t i = 16; i < 24; ++i){
+        r[i] = r[i-16];
+    }
+
+    return r;
+}();
+
+std::uint64_t avalanche(std::uint64_t h){
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCD;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53;
+    h ^= h >> 33;
+    return h;
+}
+
+// Stripes `[First, Last)` of 64 bytes, starting at `Data`. Every 64-bit lane accumulates the product of its halves, mixed with a key, plus its neighbour.
+// The same as XXH3's inner loop, without the scrambling.
+void accumulate(std::uint64_t (&Acc)[8], const std::byte* Data, std::size_t First, std::size_t Last){
+#ifdef MMTL_SSE2
+    __m128i a[4];
+    for(int i = 0; i < 4; ++i){
+        a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Acc+2*i));
+    }
+
+    for(auto s = First; s < Last; ++s){
+        auto Stripe = reinterpret_cast<const __m128i*>(Data+(s-First)*64);
+
+        for(std::size_t i = 0; i < 4; ++i){
+            auto d = _mm_loadu_si128(Stripe+i);
+            auto k = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i*>(&Keys[(2*i+s)%16])));
+
+            auto Product = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(3, 3, 1, 1)));
+            auto Swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(Product, Swapped));
+        }
+    }
+
+    for(int i = 0; i < 4; ++i){
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(Acc+2*i), a[i]);
+    }
+#else
+    for(auto s = First; s < Last; ++s){
+        for(std::size_t j = 0; j < 8; ++j){
+            std::uint64_t d;
+            std::memcpy(&d, Data+(s-First)*64+j*8, sizeof(d));
+
+            auto k = d ^ Keys[(j+s)%16];
+
+            Acc[j^1] += d;
+            Acc[j] += (k & 0xFFFFFFFF)*(k >> 32);
+        }
+    }
+#endif
+}
+
+constexpr std::size_t BlockSize = std::size_t(256) << 10;
+
+}
+
+page_hash hash_bytes(const void* Data, std::size_t Size){
+    std::uint64_t Acc[8] = {
+        Prime2, Prime1, Prime2^Prime1, Prime1*3, Prime2*5, Prime1^0x27D4EB2F165667C5, Prime2*7, Prime1*9,
+    };
+
+    auto Bytes = static_cast<const std::byte*>(Data);
+    auto Stripes = Size/64;
+
+    accumulate(Acc, Bytes, 0, Stripes);
+
+    if(Size%64 != 0){
+        std::byte Tail[64] = {};
+        std::memcpy(Tail, Bytes+Stripes*64, Size%64);
+
+        accumulate(Acc, Tail, Stripes, Stripes+1);
+    }
+
+    std::uint64_t h = Size*Prime1;
+    for(auto a:Acc){
+        h = std::rotl((h ^ avalanche(a))*Prime1, 31)+Prime2;
+    }
+
+    return avalanche(h);
+}
+
+page_hash hash_page(const void* Data){
+    return hash_bytes(Data, PageSize);
+}
+
+page_hash hash_memory(const void* Data, std::size_t Size, work_pool* Pool){
+    if(Size <= BlockSize){
+        return hash_bytes(Data, Size);
+    }
+
+    auto Bytes = static_cast<const std::byte*>(Data);
+
+    std::vector<page_hash> Hashes((Size+BlockSize-1)/BlockSize);
+
+    auto hash_blocks = [&](std::size_t Begin, std::size_t End, unsigned){
+        for(auto i = Begin; i < End; ++i){
+            auto Offset = i*BlockSize;
+            Hashes[i] = hash_bytes(Bytes+Offset, std::min(BlockSize, Size-Offset));
+        }
+    };
+
+    if(Pool){
+        Pool->parallel_for(Hashes.size(), 1, hash_blocks);
+    }else{
+        hash_blocks(0, Hashes.size(), 0);
+    }
+
+    return hash_bytes(Hashes.data(), Hashes.size()*sizeof(page_hash));
+}
+
+}
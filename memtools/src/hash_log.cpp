@@ -0,0 +1,166 @@
+﻿#include <hash_log.h>
+
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mmtl {
+
+static_assert(std::endian::native == std::endian::little, "The log is written as is.");
+
+namespace {
+
+constexpr char Magic[8] = {'D', 'H', 'T', 'A', 'S', 'F', 'H', '1'};
+
+template <typename T>
+void put(std::ofstream& File, const T& Value){
+    File.write(reinterpret_cast<const char*>(&Value), sizeof(Value));
+}
+
+template <typename T>
+bool get(std::ifstream& File, T& Value){
+    return static_cast<bool>(File.read(reinterpret_cast<char*>(&Value), sizeof(Value)));
+}
+
+}
+
+hash_log_writer::hash_log_writer(const std::filesystem::path& Path):File(Path, std::ios::binary) {
+    if(!File){
+        throw std::runtime_error("Unable to create hash log.");
+    }
+
+    File.write(Magic, sizeof(Magic));
+}
+
+void hash_log_writer::set_regions(const std::vector<std::string>& Names){
+    File.put('R');
+    put(File, static_cast<std::uint32_t>(Names.size()));
+
+    for(auto& e:Names){
+        put(File, static_cast<std::uint16_t>(e.size()));
+        File.write(e.data(), static_cast<std::streamsize>(e.size()));
+    }
+
+    RegionCount = Names.size();
+}
+
+void hash_log_writer::write(std::uint64_t FrameCount, const std::vector<page_hash>& Hashes){
+    if(Hashes.size() != RegionCount){
+        throw std::invalid_argument("Wrong number of hashes.");
+    }
+
+    File.put('F');
+    put(File, FrameCount);
+    File.write(reinterpret_cast<const char*>(Hashes.data()), static_cast<std::streamsize>(Hashes.size()*sizeof(page_hash)));
+}
+
+void hash_log_writer::flush(){
+    File.flush();
+}
+
+hash_log hash_log::read(const std::filesystem::path& Path){
+    std::ifstream File(Path, std::ios::binary);
+    if(!File){
+        throw std::runtime_error("Unable to open hash log.");
+    }
+
+    char Header[sizeof(Magic)];
+    if(!File.read(Header, sizeof(Header)) || !std::equal(Header, Header+sizeof(Header), Magic)){
+        throw std::runtime_error("Not a hash log.");
+    }
+
+    hash_log r;
+
+    char Type;
+    while(File.get(Type)){
+        if(Type == 'R'){
+            std::uint32_t Count;
+            if(!get(File, Count)){
+                break;
+            }
+
+            std::vector<std::string> Names;
+            for(std::uint32_t i = 0; i < Count; ++i){
+                std::uint16_t Size;
+                if(!get(File, Size)){
+                    break;
+                }
+
+                std::string Name(Size, '\0');
+                if(!File.read(Name.data(), Size)){
+                    break;
+                }
+
+                Names.push_back(std::move(Name));
+            }
+
+            if(Names.size() != Count){
+                break;
+            }
+
+            r.Regions.push_back(std::move(Names));
+        }else if(Type == 'F'){
+            if(r.Regions.empty()){
+                throw std::runtime_error("Frame before region names.");
+            }
+
+            frame Frame;
+            Frame.Table = r.Regions.size()-1;
+            Frame.Hashes.resize(r.Regions.back().size());
+
+            if(
+                !get(File, Frame.FrameCount) ||
+                !File.read(reinterpret_cast<char*>(Frame.Hashes.data()),
+                    static_cast<std::streamsize>(Frame.Hashes.size()*sizeof(page_hash)))
+            ){
+                break;
+            }
+
+            r.Frames.push_back(std::move(Frame));
+        }else{
+            throw std::runtime_error("Corrupt hash log.");
+        }
+    }
+
+    return r;
+}
+
+std::optional<divergence> first_divergence(const hash_log& a, const hash_log& b){
+    auto Count = std::min(a.Frames.size(), b.Frames.size());
+
+    // Where each of `a`'s regions is in `b`, for the current pair of tables.
+    std::vector<std::size_t> Mapping;
+    std::size_t TableA = ~std::size_t(0), TableB = ~std::size_t(0);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        auto& Fa = a.Frames[i];
+        auto& Fb = b.Frames[i];
+
+        if(Fa.Table != TableA || Fb.Table != TableB){
+            TableA = Fa.Table;
+            TableB = Fb.Table;
+
+            std::unordered_map<std::string, std::size_t> Names;
+            for(std::size_t j = 0; j < b.Regions[TableB].size(); ++j){
+                Names.emplace(b.Regions[TableB][j], j);
+            }
+
+            Mapping.clear();
+            for(auto& e:a.Regions[TableA]){
+                auto it = Names.find(e);
+                Mapping.push_back((it != Names.end())?it->second:~std::size_t(0));
+            }
+        }
+
+        for(std::size_t j = 0; j < Mapping.size(); ++j){
+            if(Mapping[j] != ~std::size_t(0) && Fa.Hashes[j] != Fb.Hashes[Mapping[j]]){
+                return divergence{i, Fa.FrameCount, a.Regions[TableA][j], Fa.Hashes[j], Fb.Hashes[Mapping[j]]};
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+}
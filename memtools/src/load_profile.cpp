@@ -0,0 +1,207 @@
+﻿#include <load_profile.h>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <algorithm>
+
+#include <cstring>
+
+namespace mmtl {
+
+namespace {
+
+constexpr char Magic[] = "DHTASLP1";
+
+void put(std::string& Out, std::uint64_t Value){
+    while(Value >= 0x80){
+        Out.push_back(static_cast<char>((Value&0x7F)|0x80));
+        Value >>= 7;
+    }
+
+    Out.push_back(static_cast<char>(Value));
+}
+
+void put(std::string& Out, std::string_view Value){
+    put(Out, Value.size());
+    Out.append(Value);
+}
+
+struct input {
+    std::string_view Data;
+
+    std::uint64_t get(){
+        std::uint64_t r = 0;
+        for(unsigned Shift = 0; Shift < 64; Shift += 7){
+            if(Data.empty()){
+                throw std::runtime_error("Truncated load profile.");
+            }
+
+            auto Byte = static_cast<std::uint8_t>(Data.front());
+            Data.remove_prefix(1);
+
+            r |= static_cast<std::uint64_t>(Byte&0x7F) << Shift;
+            if((Byte&0x80) == 0){
+                return r;
+            }
+        }
+
+        throw std::runtime_error("Invalid number in load profile.");
+    }
+
+    std::uint32_t get32(){
+        auto r = get();
+        if(r > UINT32_MAX){
+            throw std::runtime_error("Invalid number in load profile.");
+        }
+
+        return static_cast<std::uint32_t>(r);
+    }
+
+    // A count of items that take at least a byte each.
+    std::size_t count(){
+        auto r = get();
+        if(r > Data.size()){
+            throw std::runtime_error("Truncated load profile.");
+        }
+
+        return static_cast<std::size_t>(r);
+    }
+
+    std::string string(){
+        auto Size = count();
+        std::string r(Data.substr(0, Size));
+        Data.remove_prefix(Size);
+        return r;
+    }
+};
+
+}
+
+std::uint32_t load_profile::file(std::string_view Path){
+    auto [it, Added] = Indices.try_emplace(std::string(Path), static_cast<std::uint32_t>(Files.size()));
+    if(Added){
+        Files.emplace_back(Path);
+    }
+
+    return it->second;
+}
+
+std::vector<load_file_summary> load_profile::summary() const {
+    std::vector<load_file_summary> r(Files.size());
+    for(std::uint32_t i = 0; i < r.size(); ++i){
+        r[i].File = i;
+    }
+
+    for(auto& e:Events){
+        auto& File = r[e.File];
+        if(e.Kind == load_io::Open){
+            ++File.Opens;
+        }else{
+            ++File.Reads;
+        }
+
+        File.Bytes += e.Bytes;
+        File.Time += e.Duration;
+    }
+
+    std::stable_sort(r.begin(), r.end(), [](auto& a, auto& b){ return a.Time > b.Time; });
+
+    return r;
+}
+
+void load_profile::write(const std::filesystem::path& Path) const {
+    std::string Out(Magic, 8);
+
+    put(Out, RealTime);
+    put(Out, VirtualTime);
+    put(Out, Level);
+
+    put(Out, Files.size());
+    for(auto& e:Files){
+        put(Out, e);
+    }
+
+    put(Out, Threads.size());
+    for(auto& e:Threads){
+        put(Out, e.Id);
+        put(Out, e.CpuTime);
+    }
+
+    put(Out, Events.size());
+    std::uint64_t Previous = 0;
+    for(auto& e:Events){
+        auto Delta = static_cast<std::int64_t>(e.Start-Previous);
+        put(Out, (static_cast<std::uint64_t>(Delta) << 1)^static_cast<std::uint64_t>(Delta >> 63));
+        put(Out, e.Duration);
+        put(Out, e.Bytes);
+        put(Out, e.File);
+        put(Out, e.Thread);
+        put(Out, static_cast<std::uint64_t>(e.Kind));
+
+        Previous = e.Start;
+    }
+
+    std::ofstream File(Path, std::ios::binary);
+    if(!File.write(Out.data(), static_cast<std::streamsize>(Out.size()))){
+        throw std::runtime_error("Unable to write "+Path.string()+".");
+    }
+}
+
+load_profile load_profile::read(const std::filesystem::path& Path){
+    std::ifstream File(Path, std::ios::binary);
+    if(!File){
+        throw std::runtime_error("Unable to open "+Path.string()+".");
+    }
+
+    std::string Data(std::istreambuf_iterator<char>(File), {});
+    if(Data.size() < 8 || std::memcmp(Data.data(), Magic, 8) != 0){
+        throw std::runtime_error(Path.string()+" is not a load profile.");
+    }
+
+    input In{std::string_view(Data).substr(8)};
+
+    load_profile r;
+    r.RealTime = In.get();
+    r.VirtualTime = In.get();
+    r.Level = In.string();
+
+    auto FileCount = In.count();
+    for(std::size_t i = 0; i < FileCount; ++i){
+        r.file(In.string());
+    }
+
+    // Names are unique when written.
+    if(r.Files.size() != FileCount){
+        throw std::runtime_error("Invalid file list in load profile.");
+    }
+
+    r.Threads.resize(In.count());
+    for(auto& e:r.Threads){
+        e.Id = In.get32();
+        e.CpuTime = In.get();
+    }
+
+    r.Events.resize(In.count());
+    std::uint64_t Previous = 0;
+    for(auto& e:r.Events){
+        auto Delta = In.get();
+        e.Start = Previous+((Delta >> 1)^(0-(Delta&1)));
+        e.Duration = In.get();
+        e.Bytes = In.get();
+        e.File = In.get32();
+        e.Thread = In.get32();
+
+        auto Kind = In.get();
+        if(e.File >= FileCount || Kind > static_cast<std::uint64_t>(load_io::Read)){
+            throw std::runtime_error("Invalid event in load profile.");
+        }
+
+        e.Kind = static_cast<load_io>(Kind);
+        Previous = e.Start;
+    }
+
+    return r;
+}
+
+}
@@ -0,0 +1,77 @@
+﻿#include <log_ring.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace mmtl {
+
+log_ring::log_ring(std::size_t Capacity):Capacity(Capacity){
+    if(Capacity == 0){
+        throw std::invalid_argument("Log ring without capacity.");
+    }
+
+    Data = std::make_unique<char[]>(Capacity);
+}
+
+void log_ring::write(const void* Data, std::size_t Size){
+    auto Bytes = static_cast<const char*>(Data);
+    Written += Size;
+
+    // Only the end of a write longer than the ring is kept.
+    if(Size >= Capacity){
+        std::memcpy(this->Data.get(), Bytes+Size-Capacity, Capacity);
+        Next = 0;
+        return;
+    }
+
+    auto First = std::min(Size, Capacity-Next);
+    std::memcpy(this->Data.get()+Next, Bytes, First);
+    std::memcpy(this->Data.get(), Bytes+First, Size-First);
+
+    Next = (Next+Size)%Capacity;
+}
+
+std::pair<std::string_view, std::string_view> log_ring::view() const {
+    if(Written < Capacity){
+        return {std::string_view(Data.get(), Next), {}};
+    }
+
+    std::string_view Old(Data.get()+Next, Capacity-Next);
+    std::string_view New(Data.get(), Next);
+
+    // Exactly full, nothing was overwritten yet.
+    if(Written == Capacity){
+        return {Old, New};
+    }
+
+    // The oldest line is cut off, unless it is the only one.
+    if(auto Line = Old.find('\n'); Line != std::string_view::npos){
+        if(Line+1 < Old.size() || !New.empty()){
+            Old.remove_prefix(Line+1);
+        }
+    }else if(auto Line = New.find('\n'); Line != std::string_view::npos && Line+1 < New.size()){
+        Old = {};
+        New.remove_prefix(Line+1);
+    }
+
+    return {Old, New};
+}
+
+std::string log_ring::text() const {
+    auto [Old, New] = view();
+
+    std::string r;
+    r.reserve(Old.size()+New.size());
+    r.append(Old);
+    r.append(New);
+
+    return r;
+}
+
+void log_ring::clear(){
+    Next = 0;
+    Written = 0;
+}
+
+}
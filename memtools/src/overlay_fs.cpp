@@ -0,0 +1,583 @@
+﻿#include <overlay_fs.h>
+
+#include <map>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace mmtl {
+
+struct overlay_fs::file {
+    // Read from until the first write, which copies it to `Data`.
+    std::shared_ptr<const cloud_data> Original;
+    std::vector<unsigned char> Data;
+    bool Copied = false;
+
+    const unsigned char* data() const {
+        return Copied?Data.data():Original->data();
+    }
+
+    std::size_t size() const {
+        return Copied?Data.size():Original->size();
+    }
+
+    void copy(){
+        if(!Copied){
+            Data.assign(Original->data(), Original->data()+Original->size());
+            Original.reset();
+            Copied = true;
+        }
+    }
+};
+
+namespace {
+
+std::string utf8(const std::filesystem::path& Path){
+    auto s = Path.generic_u8string();
+    return std::string(reinterpret_cast<const char*>(s.data()), s.size());
+}
+
+std::string fold(std::string s){
+    for(auto& c:s){
+        if(c >= 'A' && c <= 'Z'){
+            c = static_cast<char>(c-'A'+'a');
+        }
+    }
+
+    return s;
+}
+
+// Case folded, `/` separated and without `.` parts. Nothing if the path is absolute or leaves the
+// base.
+std::optional<std::string> make_key(const std::filesystem::path& Path){
+    if(Path.has_root_path()){
+        return std::nullopt;
+    }
+
+    std::string r;
+    for(auto& e:Path){
+        auto Part = utf8(e);
+        if(Part.empty() || Part == "."){
+            continue;
+        }
+
+        if(Part == ".."){
+            return std::nullopt;
+        }
+
+        if(!r.empty()){
+            r += '/';
+        }
+
+        r += fold(std::move(Part));
+    }
+
+    return r;
+}
+
+std::string parent_key(const std::string& Key){
+    auto Slash = Key.rfind('/');
+    return (Slash == std::string::npos)?std::string():Key.substr(0, Slash);
+}
+
+}
+
+overlay_fs::overlay_fs(std::filesystem::path Base):Base(std::filesystem::absolute(Base).lexically_normal()) {}
+
+overlay_fs::~overlay_fs()=default;
+
+std::optional<std::filesystem::path> overlay_fs::relative(const std::filesystem::path& Path) const {
+    if(!Path.is_absolute()){
+        return std::nullopt;
+    }
+
+    auto Normal = Path.lexically_normal();
+
+    auto it = Normal.begin();
+    for(auto& e:Base){
+        if(e.empty()){
+            continue;
+        }
+
+        while(it != Normal.end() && it->empty()){
+            ++it;
+        }
+
+        if(it == Normal.end() || fold(utf8(*it)) != fold(utf8(e))){
+            return std::nullopt;
+        }
+
+        ++it;
+    }
+
+    std::filesystem::path r;
+    for(; it != Normal.end(); ++it){
+        if(!it->empty()){
+            r /= *it;
+        }
+    }
+
+    return r;
+}
+
+std::filesystem::path overlay_fs::resolve(const std::filesystem::path& Path) const {
+    auto r = Base;
+
+    for(auto& e:Path){
+        if(e.empty() || e == "."){
+            continue;
+        }
+
+        std::error_code Error;
+        if(std::filesystem::exists(r/e, Error)){
+            r /= e;
+            continue;
+        }
+
+        // Only on case sensitive file systems.
+        auto Folded = fold(utf8(e));
+        auto Found = false;
+        for(std::filesystem::directory_iterator it(r, Error), End; !Error && it != End; it.increment(Error)){
+            if(fold(utf8(it->path().filename())) == Folded){
+                r = it->path();
+                Found = true;
+                break;
+            }
+        }
+
+        if(!Found){
+            r /= e;
+        }
+    }
+
+    return r;
+}
+
+overlay_fs::kind overlay_fs::find(const std::string& Key, const std::filesystem::path& Path) const {
+    if(Key.empty()){
+        return kind::Directory;
+    }
+
+    if(auto it = Nodes.find(Key); it != Nodes.end()){
+        if(it->second.Removed){
+            return kind::Missing;
+        }
+
+        return it->second.Directory?kind::Directory:kind::File;
+    }
+
+    std::error_code Error;
+    auto Status = std::filesystem::status(resolve(Path), Error);
+    if(std::filesystem::is_directory(Status)){
+        return kind::Directory;
+    }else if(std::filesystem::is_regular_file(Status)){
+        return kind::File;
+    }
+
+    return kind::Missing;
+}
+
+overlay_fs::status overlay_fs::open(const std::filesystem::path& Path, disposition Disposition, std::shared_ptr<file>& r){
+    auto Normal = Path.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return status::PathNotFound;
+    }else if(Key->empty()){
+        return status::IsDirectory;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    if(find(parent_key(*Key), Normal.parent_path()) != kind::Directory){
+        return status::PathNotFound;
+    }
+
+    auto Kind = find(*Key, Normal);
+    if(Kind == kind::Directory){
+        return status::IsDirectory;
+    }
+
+    if(Kind == kind::Missing){
+        if(Disposition == disposition::OpenExisting || Disposition == disposition::TruncateExisting){
+            return status::NotFound;
+        }
+
+        auto File = std::make_shared<file>();
+        File->Copied = true;
+
+        Nodes[*Key] = {.Name = Normal.filename(), .File = File};
+
+        r = std::move(File);
+        return status::Created;
+    }
+
+    if(Disposition == disposition::CreateNew){
+        return status::Exists;
+    }
+
+    auto& Node = Nodes[*Key];
+    if(!Node.File){
+        auto File = std::make_shared<file>();
+        File->Original = cloud_data::map(resolve(Normal));
+
+        Node.Name = Normal.filename();
+        Node.File = std::move(File);
+    }
+
+    if(Disposition == disposition::CreateAlways || Disposition == disposition::TruncateExisting){
+        Node.File->Original.reset();
+        Node.File->Data.clear();
+        Node.File->Copied = true;
+    }
+
+    r = Node.File;
+    return status::Opened;
+}
+
+std::size_t overlay_fs::read(file& File, std::uint64_t Offset, void* Data, std::size_t Size){
+    std::lock_guard Lock(Mutex);
+
+    if(Offset >= File.size()){
+        return 0;
+    }
+
+    auto Begin = static_cast<std::size_t>(Offset);
+    auto r = std::min(Size, File.size()-Begin);
+    std::memcpy(Data, File.data()+Begin, r);
+
+    return r;
+}
+
+void overlay_fs::write(file& File, std::uint64_t Offset, const void* Data, std::size_t Size){
+    if(Offset > SIZE_MAX-Size){
+        throw std::invalid_argument("Write past the largest possible file.");
+    }
+
+    auto Begin = static_cast<std::size_t>(Offset);
+
+    std::lock_guard Lock(Mutex);
+
+    File.copy();
+
+    if(File.Data.size() < Begin+Size){
+        File.Data.resize(Begin+Size);
+    }
+
+    if(Size > 0){
+        std::memcpy(File.Data.data()+Begin, Data, Size);
+    }
+}
+
+std::uint64_t overlay_fs::size(file& File){
+    std::lock_guard Lock(Mutex);
+    return File.size();
+}
+
+void overlay_fs::resize(file& File, std::uint64_t Size){
+    if(Size > SIZE_MAX){
+        throw std::invalid_argument("Larger than the largest possible file.");
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    File.copy();
+    File.Data.resize(static_cast<std::size_t>(Size));
+}
+
+std::uint64_t overlay_fs::file_size(const std::string& Key, const std::filesystem::path& Path) const {
+    if(auto it = Nodes.find(Key); it != Nodes.end() && it->second.File){
+        return it->second.File->size();
+    }
+
+    std::error_code Error;
+    auto r = std::filesystem::file_size(resolve(Path), Error);
+    return Error?0:r;
+}
+
+std::optional<overlay_fs::entry> overlay_fs::stat(const std::filesystem::path& Path){
+    auto Normal = Path.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return std::nullopt;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    switch(find(*Key, Normal)){
+        case kind::Missing: {
+            return std::nullopt;
+        }
+        case kind::Directory: {
+            return entry{Normal.filename(), true, 0};
+        }
+        case kind::File: {
+            return entry{Normal.filename(), false, file_size(*Key, Normal)};
+        }
+    }
+
+    return std::nullopt;
+}
+
+void overlay_fs::list_locked(const std::string& Key, const std::filesystem::path& Directory, std::vector<entry>& r) const {
+    auto Prefix = Key.empty()?std::string():Key+"/";
+
+    std::map<std::string, entry> Found;
+
+    // What is in the overlay takes the place of what is in the base.
+    std::error_code Error;
+    for(std::filesystem::directory_iterator it(resolve(Directory), Error), End; !Error && it != End; it.increment(Error)){
+        auto Name = it->path().filename();
+        auto Folded = fold(utf8(Name));
+        if(Nodes.contains(Prefix+Folded)){
+            continue;
+        }
+
+        std::error_code Ignored;
+        if(it->is_directory(Ignored)){
+            Found.emplace(std::move(Folded), entry{std::move(Name), true, 0});
+        }else if(it->is_regular_file(Ignored)){
+            auto Size = it->file_size(Ignored);
+            Found.emplace(std::move(Folded), entry{std::move(Name), false, Ignored?0:Size});
+        }
+    }
+
+    for(auto& [NodeKey, Node]:Nodes){
+        if(
+            Node.Removed || NodeKey.size() <= Prefix.size() || NodeKey.compare(0, Prefix.size(), Prefix) != 0 ||
+            NodeKey.find('/', Prefix.size()) != std::string::npos
+        ){
+            continue;
+        }
+
+        auto Size = Node.Directory?0:file_size(NodeKey, Directory/Node.Name);
+        Found.insert_or_assign(NodeKey.substr(Prefix.size()), entry{Node.Name, Node.Directory, Size});
+    }
+
+    r.clear();
+    for(auto& [Name, Entry]:Found){
+        r.push_back(std::move(Entry));
+    }
+}
+
+bool overlay_fs::list(const std::filesystem::path& Directory, std::vector<entry>& r){
+    auto Normal = Directory.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return false;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    if(find(*Key, Normal) != kind::Directory){
+        return false;
+    }
+
+    list_locked(*Key, Normal, r);
+    return true;
+}
+
+overlay_fs::status overlay_fs::remove(const std::filesystem::path& Path){
+    auto Normal = Path.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return status::PathNotFound;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    if(!Key->empty() && find(parent_key(*Key), Normal.parent_path()) != kind::Directory){
+        return status::PathNotFound;
+    }
+
+    switch(find(*Key, Normal)){
+        case kind::Missing: {
+            return status::NotFound;
+        }
+        case kind::Directory: {
+            return status::IsDirectory;
+        }
+        case kind::File: {
+            break;
+        }
+    }
+
+    Nodes[*Key] = {.Name = Normal.filename(), .Removed = true, .File = nullptr};
+
+    return status::Opened;
+}
+
+overlay_fs::status overlay_fs::rename(const std::filesystem::path& From, const std::filesystem::path& To, bool Replace){
+    auto NormalFrom = From.lexically_normal();
+    auto NormalTo = To.lexically_normal();
+
+    auto FromKey = make_key(NormalFrom);
+    auto ToKey = make_key(NormalTo);
+    if(!FromKey || !ToKey){
+        return status::PathNotFound;
+    }else if(FromKey->empty() || ToKey->empty()){
+        return status::IsDirectory;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    switch(find(*FromKey, NormalFrom)){
+        case kind::Missing: {
+            return (find(parent_key(*FromKey), NormalFrom.parent_path()) == kind::Directory)?status::NotFound:status::PathNotFound;
+        }
+        case kind::Directory: {
+            return status::IsDirectory;
+        }
+        case kind::File: {
+            break;
+        }
+    }
+
+    if(find(parent_key(*ToKey), NormalTo.parent_path()) != kind::Directory){
+        return status::PathNotFound;
+    }
+
+    if(*FromKey == *ToKey){
+        Nodes[*ToKey].Name = NormalTo.filename();
+        return status::Opened;
+    }
+
+    switch(find(*ToKey, NormalTo)){
+        case kind::Missing: {
+            break;
+        }
+        case kind::Directory: {
+            return status::IsDirectory;
+        }
+        case kind::File: {
+            if(!Replace){
+                return status::Exists;
+            }
+
+            break;
+        }
+    }
+
+    auto& Node = Nodes[*FromKey];
+    if(!Node.File){
+        auto File = std::make_shared<file>();
+        File->Original = cloud_data::map(resolve(NormalFrom));
+        Node.File = std::move(File);
+    }
+
+    auto File = std::move(Node.File);
+    Node = {.Name = NormalFrom.filename(), .Directory = false, .Removed = true, .File = nullptr};
+    Nodes[*ToKey] = {.Name = NormalTo.filename(), .Directory = false, .Removed = false, .File = std::move(File)};
+
+    return status::Opened;
+}
+
+overlay_fs::status overlay_fs::remove_directory(const std::filesystem::path& Path){
+    auto Normal = Path.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return status::PathNotFound;
+    }else if(Key->empty()){
+        return status::IsDirectory;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    switch(find(*Key, Normal)){
+        case kind::Missing: {
+            return status::NotFound;
+        }
+        case kind::File: {
+            return status::PathNotFound;
+        }
+        case kind::Directory: {
+            break;
+        }
+    }
+
+    // Removed files in it stay removed, so creating it again doesn't bring back the base's.
+    std::vector<entry> Entries;
+    list_locked(*Key, Normal, Entries);
+    if(!Entries.empty()){
+        return status::Exists;
+    }
+
+    Nodes[*Key] = {.Name = Normal.filename(), .Directory = true, .Removed = true, .File = nullptr};
+
+    return status::Opened;
+}
+
+overlay_fs::status overlay_fs::create_directory(const std::filesystem::path& Path){
+    auto Normal = Path.lexically_normal();
+
+    auto Key = make_key(Normal);
+    if(!Key){
+        return status::PathNotFound;
+    }else if(Key->empty()){
+        return status::Exists;
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    if(find(parent_key(*Key), Normal.parent_path()) != kind::Directory){
+        return status::PathNotFound;
+    }
+
+    if(find(*Key, Normal) != kind::Missing){
+        return status::Exists;
+    }
+
+    Nodes[*Key] = {.Name = Normal.filename(), .Directory = true, .File = nullptr};
+
+    return status::Created;
+}
+
+void overlay_fs::save(const std::filesystem::path& Directory){
+    if(std::filesystem::exists(Directory) && std::filesystem::equivalent(Directory, Base)){
+        throw std::runtime_error("Trying to overwrite the base directory.");
+    }
+
+    std::lock_guard Lock(Mutex);
+
+    std::vector<std::pair<std::string, std::filesystem::path>> Pending = {{std::string(), std::filesystem::path()}};
+    std::vector<entry> Entries;
+
+    while(!Pending.empty()){
+        auto [Key, Relative] = std::move(Pending.back());
+        Pending.pop_back();
+
+        std::filesystem::create_directories(Directory/Relative);
+
+        list_locked(Key, Relative, Entries);
+
+        for(auto& e:Entries){
+            auto EntryKey = (Key.empty()?std::string():Key+"/")+fold(utf8(e.Name));
+            auto EntryPath = Relative/e.Name;
+
+            if(e.Directory){
+                Pending.emplace_back(std::move(EntryKey), std::move(EntryPath));
+                continue;
+            }
+
+            std::shared_ptr<file> File;
+            if(auto it = Nodes.find(EntryKey); it != Nodes.end() && it->second.File){
+                File = it->second.File;
+            }else{
+                File = std::make_shared<file>();
+                File->Original = cloud_data::map(resolve(EntryPath));
+            }
+
+            std::ofstream Out(Directory/EntryPath, std::ios::binary|std::ios::trunc);
+            Out.write(reinterpret_cast<const char*>(File->data()), static_cast<std::streamsize>(File->size()));
+            if(!Out.flush()){
+                throw std::runtime_error("Unable to write "+utf8(EntryPath)+".");
+            }
+        }
+    }
+}
+
+}
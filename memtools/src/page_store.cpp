@@ -0,0 +1,576 @@
+﻿#include <page_store.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+
+    #include <sys/mman.h>
+#endif
+
+namespace mmtl {
+
+namespace {
+
+// Compresses a page as runs of repeated 32-bit words and literal words. Returns 0 if the result
+// would not be smaller than `Limit`.
+//
+// Every run starts with a 16-bit header: the top bit set for a repeated word followed by the word,
+// or clear for that many literal words.
+constexpr std::size_t Words = PageSize/4;
+constexpr std::size_t CompressLimit = PageSize*3/4;
+
+std::size_t compress(const std::byte* Data, std::byte* Out){
+    std::uint32_t w[Words];
+    std::memcpy(w, Data, PageSize);
+
+    std::size_t Size = 0;
+
+    auto put = [&](const void* p, std::size_t n){
+        if(Size+n > CompressLimit){
+            return false;
+        }
+
+        std::memcpy(Out+Size, p, n);
+        Size += n;
+        return true;
+    };
+
+    auto is_run = [&](std::size_t i){
+        return i+2 < Words && w[i] == w[i+1] && w[i] == w[i+2];
+    };
+
+    for(std::size_t i = 0; i < Words;){
+        std::uint16_t Header;
+
+        if(is_run(i)){
+            auto j = i+3;
+            while(j < Words && w[j] == w[i]){
+                ++j;
+            }
+
+            Header = static_cast<std::uint16_t>(0x8000 | (j-i));
+            if(!put(&Header, sizeof(Header)) || !put(&w[i], 4)){
+                return 0;
+            }
+
+            i = j;
+        }else{
+            auto j = i+1;
+            while(j < Words && !is_run(j)){
+                ++j;
+            }
+
+            Header = static_cast<std::uint16_t>(j-i);
+            if(!put(&Header, sizeof(Header)) || !put(&w[i], (j-i)*4)){
+                return 0;
+            }
+
+            i = j;
+        }
+    }
+
+    return Size;
+}
+
+void decompress(const std::byte* Data, std::size_t Size, std::byte* Out){
+    for(std::size_t i = 0; i < Size;){
+        std::uint16_t Header;
+        std::memcpy(&Header, Data+i, sizeof(Header));
+        i += sizeof(Header);
+
+        std::size_t Count = Header & 0x7FFF;
+
+        if(Header & 0x8000){
+            for(std::size_t j = 0; j < Count; ++j){
+                std::memcpy(Out+j*4, Data+i, 4);
+            }
+
+            i += 4;
+        }else{
+            std::memcpy(Out, Data+i, Count*4);
+            i += Count*4;
+        }
+
+        Out += Count*4;
+    }
+}
+
+}
+
+// A file of page sized slots, mapped a few segments at a time so it does not use up the address
+// space of a 32-bit process.
+struct page_store::spill_file {
+    static constexpr std::size_t SegmentPages = 4096;
+    static constexpr std::size_t SegmentSize = SegmentPages*PageSize;
+    static constexpr std::size_t MaxViews = 4;
+
+    explicit spill_file(const std::filesystem::path& Directory){
+        static std::atomic<unsigned> Counter = 0;
+
+#ifdef _WIN32
+        auto Pid = GetCurrentProcessId();
+#else
+        auto Pid = getpid();
+#endif
+
+        auto Path = Directory/(
+            "memtools-"+std::to_string(Pid)+"-"+std::to_string(Counter++)+".spill"
+        );
+
+#ifdef _WIN32
+        File = CreateFileW(Path.c_str(), GENERIC_READ|GENERIC_WRITE, 0, nullptr, CREATE_NEW,
+            FILE_ATTRIBUTE_TEMPORARY|FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        if(File == INVALID_HANDLE_VALUE){
+            throw std::runtime_error("Unable to create spill file.");
+        }
+#else
+        File = open(Path.c_str(), O_RDWR|O_CREAT|O_EXCL|O_CLOEXEC, 0600);
+        if(File < 0){
+            throw std::runtime_error("Unable to create spill file.");
+        }
+
+        unlink(Path.c_str());
+#endif
+    }
+
+    ~spill_file(){
+        for(auto& e:Views){
+            unmap(e.Data);
+        }
+
+#ifdef _WIN32
+        CloseHandle(File);
+#else
+        close(File);
+#endif
+    }
+
+    std::size_t allocate(){
+        if(!Free.empty()){
+            auto r = Free.back();
+            Free.pop_back();
+            return r;
+        }
+
+        return SlotCount++;
+    }
+
+    void free(std::size_t Slot){
+        Free.push_back(Slot);
+    }
+
+    std::byte* get(std::size_t Slot){
+        auto Segment = Slot/SegmentPages;
+        auto Offset = (Slot%SegmentPages)*PageSize;
+
+        ++Clock;
+
+        for(auto& e:Views){
+            if(e.Segment == Segment){
+                e.LastUse = Clock;
+                return e.Data+Offset;
+            }
+        }
+
+        if(Views.size() == MaxViews){
+            auto Oldest = std::min_element(Views.begin(), Views.end(),
+                [](const view& a, const view& b){ return a.LastUse < b.LastUse; });
+
+            unmap(Oldest->Data);
+            Views.erase(Oldest);
+        }
+
+        Views.push_back({Segment, map(Segment), Clock});
+
+        return Views.back().Data+Offset;
+    }
+
+private:
+    struct view {
+        std::size_t Segment;
+        std::byte* Data;
+        std::uint64_t LastUse;
+    };
+
+    std::byte* map(std::size_t Segment){
+        auto Begin = static_cast<std::uint64_t>(Segment)*SegmentSize;
+        auto End = Begin+SegmentSize;
+
+#ifdef _WIN32
+        // Creating a mapping larger than the file grows it.
+        auto Mapping = CreateFileMappingW(File, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(End >> 32), static_cast<DWORD>(End), nullptr);
+        if(!Mapping){
+            throw std::runtime_error("Unable to map spill file.");
+        }
+
+        auto r = MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS,
+            static_cast<DWORD>(Begin >> 32), static_cast<DWORD>(Begin), SegmentSize);
+
+        // The view keeps the mapping alive.
+        CloseHandle(Mapping);
+
+        if(!r){
+            throw std::runtime_error("Unable to map spill file.");
+        }
+#else
+        if(Segment >= Segments){
+            if(ftruncate(File, static_cast<off_t>(End)) != 0){
+                throw std::runtime_error("Unable to grow spill file.");
+            }
+
+            Segments = Segment+1;
+        }
+
+        auto r = mmap(nullptr, SegmentSize, PROT_READ|PROT_WRITE, MAP_SHARED, File, static_cast<off_t>(Begin));
+        if(r == MAP_FAILED){
+            throw std::runtime_error("Unable to map spill file.");
+        }
+#endif
+
+        return static_cast<std::byte*>(r);
+    }
+
+    static void unmap(std::byte* Data){
+#ifdef _WIN32
+        UnmapViewOfFile(Data);
+#else
+        munmap(Data, SegmentSize);
+#endif
+    }
+
+#ifdef _WIN32
+    HANDLE File;
+#else
+    int File;
+    std::size_t Segments = 0;
+#endif
+
+    std::vector<view> Views;
+    std::uint64_t Clock = 0;
+
+    std::size_t SlotCount = 0;
+    std::vector<std::size_t> Free;
+};
+
+page_store::page_store(page_store_options Options):Options(std::move(Options)) {
+    if(!this->Options.SpillDirectory.empty()){
+        Spill = std::make_unique<spill_file>(this->Options.SpillDirectory);
+    }
+
+    if(this->Options.Compress || Spill){
+        Thread = std::thread(&page_store::run, this);
+    }
+}
+
+page_store::~page_store(){
+    {
+        std::lock_guard Lock(Mutex);
+        Stopping = true;
+    }
+
+    Wake.notify_all();
+
+    if(Thread.joinable()){
+        Thread.join();
+    }
+}
+
+page_store::id page_store::insert(const void* Data){
+    auto Hash = hash_page(Data);
+
+    std::lock_guard Lock(Mutex);
+
+    auto it = Index.find(Hash);
+    if(it != Index.end()){
+        for(auto i = it->second; i != None; i = Slots[i].Next){
+            auto& Slot = Slots[i];
+
+            if(Slot.Storage == storage::Raw){
+                if(std::memcmp(Slot.Raw->Data, Data, PageSize) != 0){
+                    continue;
+                }
+            }else{
+                page Page;
+                load(Slot, Page.Data);
+                if(std::memcmp(Page.Data, Data, PageSize) != 0){
+                    continue;
+                }
+            }
+
+            ++Slot.References;
+            Slot.Used = true;
+
+            ++Stats.References;
+
+            return i;
+        }
+    }
+
+    id Id;
+    if(!FreeSlots.empty()){
+        Id = FreeSlots.back();
+        FreeSlots.pop_back();
+    }else{
+        if(Slots.size() >= None){
+            throw std::length_error("Too many pages.");
+        }
+
+        Id = static_cast<id>(Slots.size());
+        Slots.emplace_back();
+    }
+
+    auto& Slot = Slots[Id];
+    Slot.Hash = Hash;
+    Slot.References = 1;
+    Slot.Storage = storage::Raw;
+    Slot.Used = true;
+
+    Slot.Raw = std::make_unique<page>();
+    std::memcpy(Slot.Raw->Data, Data, PageSize);
+
+    if(it != Index.end()){
+        Slot.Next = it->second;
+        it->second = Id;
+    }else{
+        Slot.Next = None;
+        Index.emplace(Hash, Id);
+    }
+
+    ++Stats.Pages;
+    ++Stats.References;
+    Stats.MemoryBytes += PageSize;
+
+    if(Spill && Stats.MemoryBytes > Options.MemoryBudget){
+        Wake.notify_one();
+    }
+
+    return Id;
+}
+
+void page_store::retain(const id* Ids, std::size_t Count){
+    std::lock_guard Lock(Mutex);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        if(Ids[i] != None){
+            ++Slots[Ids[i]].References;
+            ++Stats.References;
+        }
+    }
+}
+
+void page_store::release(const id* Ids, std::size_t Count){
+    std::lock_guard Lock(Mutex);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        if(Ids[i] != None){
+            --Stats.References;
+
+            if(--Slots[Ids[i]].References == 0){
+                free(Ids[i]);
+            }
+        }
+    }
+}
+
+void page_store::read(id Id, void* Out){
+    std::lock_guard Lock(Mutex);
+
+    auto& Slot = Slots[Id];
+    Slot.Used = true;
+
+    load(Slot, Out);
+}
+
+bool page_store::equal(id Id, const void* Data){
+    std::lock_guard Lock(Mutex);
+
+    auto& Slot = Slots[Id];
+    Slot.Used = true;
+
+    if(Slot.Storage == storage::Raw){
+        return std::memcmp(Slot.Raw->Data, Data, PageSize) == 0;
+    }
+
+    page Page;
+    load(Slot, Page.Data);
+
+    return std::memcmp(Page.Data, Data, PageSize) == 0;
+}
+
+void page_store::set_memory_budget(std::size_t Budget){
+    {
+        std::lock_guard Lock(Mutex);
+        Options.MemoryBudget = Budget;
+    }
+
+    Wake.notify_one();
+}
+
+page_store_stats page_store::stats() const {
+    std::lock_guard Lock(Mutex);
+    return Stats;
+}
+
+void page_store::trim(){
+    std::unique_lock Lock(Mutex);
+    sweep(Lock);
+}
+
+void page_store::load(slot& Slot, void* Out){
+    switch(Slot.Storage){
+        case storage::Raw: {
+            std::memcpy(Out, Slot.Raw->Data, PageSize);
+            break;
+        }
+        case storage::Compressed: {
+            decompress(Slot.Compressed.get(), Slot.CompressedSize, static_cast<std::byte*>(Out));
+            break;
+        }
+        case storage::Spilled: {
+            std::memcpy(Out, Spill->get(Slot.SpillSlot), PageSize);
+            break;
+        }
+        case storage::Free: {
+            throw std::logic_error("Page has been freed.");
+        }
+    }
+}
+
+void page_store::free(id Id){
+    auto& Slot = Slots[Id];
+
+    auto it = Index.find(Slot.Hash);
+    if(it->second == Id){
+        if(Slot.Next == None){
+            Index.erase(it);
+        }else{
+            it->second = Slot.Next;
+        }
+    }else{
+        auto Previous = it->second;
+        while(Slots[Previous].Next != Id){
+            Previous = Slots[Previous].Next;
+        }
+
+        Slots[Previous].Next = Slot.Next;
+    }
+
+    switch(Slot.Storage){
+        case storage::Raw: {
+            Stats.MemoryBytes -= PageSize;
+            break;
+        }
+        case storage::Compressed: {
+            Stats.MemoryBytes -= Slot.CompressedSize;
+            --Stats.Compressed;
+            break;
+        }
+        case storage::Spilled: {
+            Spill->free(Slot.SpillSlot);
+            Stats.SpillBytes -= PageSize;
+            --Stats.Spilled;
+            break;
+        }
+        case storage::Free: {
+            break;
+        }
+    }
+
+    --Stats.Pages;
+
+    Slot = {};
+    FreeSlots.push_back(Id);
+}
+
+// Visits every page once, clock style: pages used since the last pass get another chance, the
+// rest are compressed, and moved to the spill file while memory is over budget.
+void page_store::sweep(std::unique_lock<std::mutex>& Lock){
+    auto Count = Slots.size();
+
+    for(std::size_t n = 0; n < Count && !Stopping; ++n){
+        // Let other threads in now and then.
+        if(n%256 == 255){
+            Lock.unlock();
+            Lock.lock();
+        }
+
+        if(Slots.empty()){
+            break;
+        }
+
+        if(ClockHand >= Slots.size()){
+            ClockHand = 0;
+        }
+
+        auto& Slot = Slots[ClockHand++];
+
+        if(Slot.Storage == storage::Free || Slot.Storage == storage::Spilled){
+            continue;
+        }
+
+        if(Slot.Used){
+            Slot.Used = false;
+            continue;
+        }
+
+        if(Slot.Storage == storage::Raw && Options.Compress){
+            std::byte Buffer[CompressLimit];
+            auto Size = compress(Slot.Raw->Data, Buffer);
+
+            if(Size != 0){
+                Slot.Compressed = std::make_unique<std::byte[]>(Size);
+                std::memcpy(Slot.Compressed.get(), Buffer, Size);
+                Slot.CompressedSize = static_cast<std::uint16_t>(Size);
+                Slot.Raw = nullptr;
+                Slot.Storage = storage::Compressed;
+
+                Stats.MemoryBytes -= PageSize-Size;
+                ++Stats.Compressed;
+            }
+        }
+
+        if(Spill && Stats.MemoryBytes > Options.MemoryBudget){
+            auto SpillSlot = Spill->allocate();
+            load(Slot, Spill->get(SpillSlot));
+
+            if(Slot.Storage == storage::Compressed){
+                Stats.MemoryBytes -= Slot.CompressedSize;
+                --Stats.Compressed;
+            }else{
+                Stats.MemoryBytes -= PageSize;
+            }
+
+            Slot.Raw = nullptr;
+            Slot.Compressed = nullptr;
+            Slot.SpillSlot = SpillSlot;
+            Slot.Storage = storage::Spilled;
+
+            Stats.SpillBytes += PageSize;
+            ++Stats.Spilled;
+        }
+    }
+}
+
+void page_store::run(){
+    std::unique_lock Lock(Mutex);
+
+    while(!Stopping){
+        Wake.wait_for(Lock, std::chrono::seconds(1));
+
+        if(!Stopping){
+            sweep(Lock);
+        }
+    }
+}
+
+}
@@ -0,0 +1,177 @@
+﻿#include <pe.h>
+
+#include <bit>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+namespace mmtl {
+
+static_assert(std::endian::native == std::endian::little, "Headers are read as is.");
+
+namespace {
+
+template <typename T>
+T read(const std::byte* Data, std::size_t Size, std::size_t Offset){
+    if(Offset > Size || Size-Offset < sizeof(T)){
+        throw std::runtime_error("Truncated PE image.");
+    }
+
+    T r;
+    std::memcpy(&r, Data+Offset, sizeof(T));
+    return r;
+}
+
+}
+
+pe_image::pe_image(const std::byte* Data, std::size_t Size, bool Mapped):Data(Data), Size(Size), Mapped(Mapped) {
+    if(read<std::uint16_t>(Data, Size, 0) != 0x5A4D){
+        throw std::runtime_error("Not a PE image.");
+    }
+
+    auto Pe = read<std::uint32_t>(Data, Size, 0x3C);
+    if(read<std::uint32_t>(Data, Size, Pe) != 0x4550){
+        throw std::runtime_error("Not a PE image.");
+    }
+
+    auto FileHeader = std::size_t(Pe)+4;
+    auto SectionCount = read<std::uint16_t>(Data, Size, FileHeader+2);
+    TimeDateStamp = read<std::uint32_t>(Data, Size, FileHeader+4);
+    auto OptionalSize = read<std::uint16_t>(Data, Size, FileHeader+16);
+
+    auto Optional = FileHeader+20;
+    auto Magic = read<std::uint16_t>(Data, Size, Optional);
+    if(Magic != 0x10B && Magic != 0x20B){
+        throw std::runtime_error("Unknown PE optional header.");
+    }
+
+    Is64 = (Magic == 0x20B);
+    EntryPoint = read<std::uint32_t>(Data, Size, Optional+16);
+    ImageBase = Is64?read<std::uint64_t>(Data, Size, Optional+24):read<std::uint32_t>(Data, Size, Optional+28);
+    SizeOfImage = read<std::uint32_t>(Data, Size, Optional+56);
+
+    auto Directory = Optional+(Is64?112:96);
+    auto DirectoryCount = std::min<std::uint32_t>(read<std::uint32_t>(Data, Size, Directory-4), 16);
+    for(std::size_t i = 0; i < DirectoryCount; ++i){
+        Directories.push_back({
+            .Rva = read<std::uint32_t>(Data, Size, Directory+i*8),
+            .Size = read<std::uint32_t>(Data, Size, Directory+i*8+4),
+        });
+    }
+
+    auto Headers = Optional+OptionalSize;
+    for(std::size_t i = 0; i < SectionCount; ++i){
+        auto Header = Headers+i*40;
+
+        if(Header > Size || Size-Header < 40){
+            throw std::runtime_error("Truncated PE image.");
+        }
+
+        char Name[9] = {};
+        std::memcpy(Name, Data+Header, 8);
+
+        Sections.push_back({
+            .Name = Name,
+            .Rva = read<std::uint32_t>(Data, Size, Header+12),
+            .VirtualSize = read<std::uint32_t>(Data, Size, Header+8),
+            .RawOffset = read<std::uint32_t>(Data, Size, Header+20),
+            .RawSize = read<std::uint32_t>(Data, Size, Header+16),
+            .Characteristics = read<std::uint32_t>(Data, Size, Header+36),
+        });
+    }
+}
+
+const pe_section* pe_image::find_section(std::string_view Name) const {
+    auto it = std::find_if(Sections.begin(), Sections.end(), [&](auto& e){ return e.Name == Name; });
+    return (it != Sections.end())?&*it:nullptr;
+}
+
+const pe_section* pe_image::section_at(std::uint32_t Rva) const {
+    for(auto& e:Sections){
+        if(Rva >= e.Rva && Rva-e.Rva < std::max(e.VirtualSize, e.RawSize)){
+            return &e;
+        }
+    }
+
+    return nullptr;
+}
+
+const std::byte* pe_image::at(std::uint32_t Rva, std::size_t Count) const {
+    auto Section = section_at(Rva);
+    if(!Section){
+        return nullptr;
+    }
+
+    auto Offset = Rva-Section->Rva;
+    if(Offset > size(*Section) || size(*Section)-Offset < Count){
+        return nullptr;
+    }
+
+    return data(*Section)+Offset;
+}
+
+const std::byte* pe_image::data(const pe_section& Section) const {
+    return Data+(Mapped?Section.Rva:Section.RawOffset);
+}
+
+std::size_t pe_image::size(const pe_section& Section) const {
+    auto Begin = std::size_t(Mapped?Section.Rva:Section.RawOffset);
+    auto Length = std::size_t(Mapped?Section.VirtualSize:std::min(Section.RawSize, Section.VirtualSize?Section.VirtualSize:Section.RawSize));
+
+    if(Begin >= Size){
+        return 0;
+    }
+
+    return std::min(Length, Size-Begin);
+}
+
+std::vector<pe_directory> pe_image::relocations() const {
+    std::vector<pe_directory> r;
+
+    if(Directories.size() <= RelocationDirectory || Directories[RelocationDirectory].Size == 0){
+        return r;
+    }
+
+    auto& Directory = Directories[RelocationDirectory];
+
+    auto Table = at(Directory.Rva, Directory.Size);
+    if(!Table){
+        throw std::runtime_error("Truncated PE relocations.");
+    }
+
+    // Blocks of a page address, the block size, then 16 bit entries of a type and page offset.
+    std::size_t Offset = 0;
+    while(Directory.Size-Offset >= 8){
+        auto Page = read<std::uint32_t>(Table, Directory.Size, Offset);
+        auto BlockSize = read<std::uint32_t>(Table, Directory.Size, Offset+4);
+        if(BlockSize < 8 || BlockSize > Directory.Size-Offset){
+            break;
+        }
+
+        for(std::size_t i = Offset+8; i+2 <= Offset+BlockSize; i += 2){
+            auto Entry = read<std::uint16_t>(Table, Directory.Size, i);
+
+            switch(Entry >> 12){
+                case 3: {
+                    r.push_back({Page+(Entry&0xFFF), 4});
+                    break;
+                }
+                case 10: {
+                    r.push_back({Page+(Entry&0xFFF), 8});
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+        }
+
+        Offset += BlockSize;
+    }
+
+    std::sort(r.begin(), r.end(), [](const pe_directory& a, const pe_directory& b){ return a.Rva < b.Rva; });
+
+    return r;
+}
+
+}
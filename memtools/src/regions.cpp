@@ -0,0 +1,190 @@
+﻿#include <regions.h>
+
+#include <algorithm>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <cstdio>
+    #include <cinttypes>
+
+    #include <sys/mman.h>
+#endif
+
+namespace mmtl {
+
+#ifdef _WIN32
+
+std::vector<region> query_regions(){
+    std::vector<region> r;
+
+    SYSTEM_INFO Info;
+    GetNativeSystemInfo(&Info);
+
+    auto Address = static_cast<const char*>(Info.lpMinimumApplicationAddress);
+    auto End = static_cast<const char*>(Info.lpMaximumApplicationAddress);
+
+    constexpr DWORD Writable =
+        PAGE_READWRITE|PAGE_WRITECOPY|PAGE_EXECUTE_READWRITE|PAGE_EXECUTE_WRITECOPY;
+
+    MEMORY_BASIC_INFORMATION Mbi;
+    while(Address < End && VirtualQuery(Address, &Mbi, sizeof(Mbi)) == sizeof(Mbi)){
+        if(
+            Mbi.State == MEM_COMMIT && (Mbi.Type == MEM_PRIVATE || Mbi.Type == MEM_IMAGE) &&
+            (Mbi.Protect&Writable) != 0 && (Mbi.Protect&(PAGE_GUARD|PAGE_NOACCESS)) == 0
+        ){
+            r.push_back({
+                .Base = reinterpret_cast<std::uintptr_t>(Mbi.BaseAddress),
+                .Size = Mbi.RegionSize,
+                .AllocationBase = reinterpret_cast<std::uintptr_t>(Mbi.AllocationBase),
+                .Protect = Mbi.Protect,
+            });
+        }
+
+        Address = static_cast<const char*>(Mbi.BaseAddress)+Mbi.RegionSize;
+    }
+
+    return r;
+}
+
+void readable_map::refresh(){
+    Ranges.clear();
+
+    SYSTEM_INFO Info;
+    GetNativeSystemInfo(&Info);
+
+    auto Address = static_cast<const char*>(Info.lpMinimumApplicationAddress);
+    auto End = static_cast<const char*>(Info.lpMaximumApplicationAddress);
+
+    constexpr DWORD Readable =
+        PAGE_READONLY|PAGE_READWRITE|PAGE_WRITECOPY|
+        PAGE_EXECUTE_READ|PAGE_EXECUTE_READWRITE|PAGE_EXECUTE_WRITECOPY;
+    constexpr DWORD Writable =
+        PAGE_READWRITE|PAGE_WRITECOPY|PAGE_EXECUTE_READWRITE|PAGE_EXECUTE_WRITECOPY;
+
+    MEMORY_BASIC_INFORMATION Mbi;
+    while(Address < End && VirtualQuery(Address, &Mbi, sizeof(Mbi)) == sizeof(Mbi)){
+        if(Mbi.State == MEM_COMMIT && (Mbi.Protect&Readable) != 0 && (Mbi.Protect&PAGE_GUARD) == 0){
+            auto Begin = reinterpret_cast<std::uintptr_t>(Mbi.BaseAddress);
+            auto IsWritable = (Mbi.Protect&Writable) != 0;
+
+            if(!Ranges.empty() && Ranges.back().End == Begin && Ranges.back().Writable == IsWritable){
+                Ranges.back().End += Mbi.RegionSize;
+            }else{
+                Ranges.push_back({Begin, Begin+Mbi.RegionSize, IsWritable});
+            }
+        }
+
+        Address = static_cast<const char*>(Mbi.BaseAddress)+Mbi.RegionSize;
+    }
+}
+
+#else
+
+std::vector<region> query_regions(){
+    std::vector<region> r;
+
+    auto File = std::fopen("/proc/self/maps", "r");
+    if(!File){
+        return r;
+    }
+
+    char Line[512];
+    while(std::fgets(Line, sizeof(Line), File)){
+        std::uintptr_t Begin, End;
+        char Perms[5] = {};
+
+        if(std::sscanf(Line, "%" SCNxPTR "-%" SCNxPTR " %4s", &Begin, &End, Perms) != 3){
+            continue;
+        }
+
+        // Private and writable, skipping the vsyscall page and similar.
+        if(Perms[0] != 'r' || Perms[1] != 'w' || Perms[3] != 'p'){
+            continue;
+        }
+
+        std::uint32_t Protect = PROT_READ|PROT_WRITE;
+        if(Perms[2] == 'x'){
+            Protect |= PROT_EXEC;
+        }
+
+        // `/proc/self/maps` splits adjacent mappings with the same permissions, merge them back.
+        if(!r.empty() && r.back().end() == Begin && r.back().Protect == Protect){
+            r.back().Size += End-Begin;
+        }else{
+            r.push_back({
+                .Base = Begin,
+                .Size = End-Begin,
+                .AllocationBase = Begin,
+                .Protect = Protect,
+            });
+        }
+    }
+
+    std::fclose(File);
+
+    return r;
+}
+
+void readable_map::refresh(){
+    Ranges.clear();
+
+    auto File = std::fopen("/proc/self/maps", "r");
+    if(!File){
+        return;
+    }
+
+    char Line[512];
+    while(std::fgets(Line, sizeof(Line), File)){
+        std::uintptr_t Begin, End;
+        char Perms[5] = {};
+
+        if(std::sscanf(Line, "%" SCNxPTR "-%" SCNxPTR " %4s", &Begin, &End, Perms) != 3 || Perms[0] != 'r'){
+            continue;
+        }
+
+        auto IsWritable = (Perms[1] == 'w');
+
+        if(!Ranges.empty() && Ranges.back().End == Begin && Ranges.back().Writable == IsWritable){
+            Ranges.back().End = End;
+        }else{
+            Ranges.push_back({Begin, End, IsWritable});
+        }
+    }
+
+    std::fclose(File);
+}
+
+#endif
+
+bool readable_map::contains(std::uintptr_t Address, std::size_t Size, bool Writable) const {
+    if(Size == 0 || Address+Size < Address){
+        return false;
+    }
+
+    auto End = Address+Size;
+
+    auto it = std::upper_bound(Ranges.begin(), Ranges.end(), Address,
+        [](std::uintptr_t a, const range& b){ return a < b.Begin; });
+
+    if(it == Ranges.begin()){
+        return false;
+    }
+
+    // Ranges only differing in access are not merged, so the range may continue in the next one.
+    for(--it; it != Ranges.end() && it->Begin <= Address; ++it){
+        if(Writable && !it->Writable){
+            return false;
+        }
+
+        if(End <= it->End){
+            return true;
+        }
+
+        Address = it->End;
+    }
+
+    return false;
+}
+
+}
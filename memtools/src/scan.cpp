@@ -0,0 +1,384 @@
+﻿#include <scan.h>
+#include <work_pool.h>
+
+#include "scan_kernels.h"
+
+#include <bit>
+#include <string>
+#include <cstring>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+
+#if MMTL_X86 && defined(_MSC_VER)
+    #include <intrin.h>
+    #include <immintrin.h>
+#endif
+
+namespace mmtl {
+
+static_assert(std::endian::native == std::endian::little, "Values are compared as raw bytes.");
+
+namespace {
+
+bool detect_avx2(){
+#if MMTL_X86
+    #ifdef _MSC_VER
+        int Info[4];
+        __cpuid(Info, 0);
+        if(Info[0] < 7){
+            return false;
+        }
+
+        __cpuid(Info, 1);
+        constexpr int OsXSave = 1 << 27;
+        if(!(Info[2]&OsXSave) || (_xgetbv(0)&6) != 6){
+            return false;
+        }
+
+        __cpuidex(Info, 7, 0);
+        constexpr int Avx2 = 1 << 5;
+        return (Info[1]&Avx2) != 0;
+    #else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    #endif
+#else
+    return false;
+#endif
+}
+
+bool has_avx2(){
+    static const bool r = detect_avx2();
+    return r;
+}
+
+void match_equal_scalar(const std::byte* Data, const std::byte* Other, std::uint64_t Value,
+        std::size_t Size, std::size_t Bytes, std::uint64_t* Bits){
+    auto Count = Bytes/Size;
+
+    for(std::size_t i = 0; i < Count; ++i){
+        auto b = Other?Other+i*Size:reinterpret_cast<const std::byte*>(&Value);
+        if(std::memcmp(Data+i*Size, b, Size) == 0){
+            Bits[i/64] |= std::uint64_t(1) << (i%64);
+        }
+    }
+}
+
+template <typename T>
+bool compare_as(const std::byte* Current, const std::byte* Previous, scan_compare Compare){
+    T a, b;
+    std::memcpy(&a, Current, sizeof(T));
+    std::memcpy(&b, Previous, sizeof(T));
+
+    return (Compare == scan_compare::Increased)?(a > b):(a < b);
+}
+
+// Whether `Current` passes `Compare` against `Previous`. Everything but the ordered comparisons
+// is done on the raw bytes, the same as the kernels.
+bool compare(value_type Type, const std::byte* Current, const std::byte* Previous, scan_compare Compare){
+    switch(Compare){
+        case scan_compare::Exact:
+        case scan_compare::Unchanged: {
+            return std::memcmp(Current, Previous, value_size(Type)) == 0;
+        }
+        case scan_compare::Changed: {
+            return std::memcmp(Current, Previous, value_size(Type)) != 0;
+        }
+        case scan_compare::Unknown: {
+            return true;
+        }
+        case scan_compare::Increased:
+        case scan_compare::Decreased: {
+            break;
+        }
+    }
+
+    switch(Type){
+        case value_type::I8: {
+            return compare_as<std::int8_t>(Current, Previous, Compare);
+        }
+        case value_type::U8: {
+            return compare_as<std::uint8_t>(Current, Previous, Compare);
+        }
+        case value_type::I16: {
+            return compare_as<std::int16_t>(Current, Previous, Compare);
+        }
+        case value_type::U16: {
+            return compare_as<std::uint16_t>(Current, Previous, Compare);
+        }
+        case value_type::I32: {
+            return compare_as<std::int32_t>(Current, Previous, Compare);
+        }
+        case value_type::U32: {
+            return compare_as<std::uint32_t>(Current, Previous, Compare);
+        }
+        case value_type::I64: {
+            return compare_as<std::int64_t>(Current, Previous, Compare);
+        }
+        case value_type::U64: {
+            return compare_as<std::uint64_t>(Current, Previous, Compare);
+        }
+        case value_type::F32: {
+            return compare_as<float>(Current, Previous, Compare);
+        }
+        case value_type::F64: {
+            return compare_as<double>(Current, Previous, Compare);
+        }
+        case value_type::Pointer: {
+            return compare_as<std::uintptr_t>(Current, Previous, Compare);
+        }
+    }
+
+    return false;
+}
+
+}
+
+std::optional<scan_compare> parse_scan_compare(std::string_view Name){
+    static constexpr std::pair<std::string_view, scan_compare> Names[] = {
+        {"exact", scan_compare::Exact}, {"unknown", scan_compare::Unknown},
+        {"changed", scan_compare::Changed}, {"unchanged", scan_compare::Unchanged},
+        {"increased", scan_compare::Increased}, {"decreased", scan_compare::Decreased},
+    };
+
+    for(auto& [Key, Compare]:Names){
+        if(Key == Name){
+            return Compare;
+        }
+    }
+
+    return std::nullopt;
+}
+
+scanner::scanner(work_pool* Pool, bool Simd):Pool(Pool), Simd(Simd && has_avx2()) {}
+
+template <typename F>
+void scanner::for_each_block(F&& Fn){
+    if(Pool){
+        Pool->parallel_for(Blocks.size(), 1, [&](std::size_t Begin, std::size_t End, unsigned){
+            for(auto i = Begin; i < End; ++i){
+                Fn(Blocks[i]);
+            }
+        });
+    }else{
+        for(auto& e:Blocks){
+            Fn(e);
+        }
+    }
+
+    std::erase_if(Blocks, [](const block& e){ return e.Count == 0; });
+}
+
+void scanner::first_scan(const std::vector<region>& Regions, value_type NewType, scan_compare Compare, std::uint64_t Value,
+        const readable_map* Map){
+    if(Compare != scan_compare::Exact && Compare != scan_compare::Unknown){
+        throw std::invalid_argument("The first scan has nothing to compare with.");
+    }
+
+    std::vector<block> NewBlocks;
+    std::size_t Usage = 0;
+
+    for(auto& e:Regions){
+        for(std::size_t Offset = 0; Offset < e.Size; Offset += BlockSize){
+            auto Size = std::min(BlockSize, e.Size-Offset);
+            if(!Map || Map->contains(e.Base+Offset, Size)){
+                NewBlocks.push_back({e.Base+Offset, Size, {}, {}, 0});
+
+                auto Slots = Size/value_size(NewType);
+                Usage += Slots*value_size(NewType)+(Slots+63)/64*sizeof(std::uint64_t);
+            }
+        }
+    }
+
+    // Checked before anything is allocated, exact scans only keep what matched.
+    if(Compare == scan_compare::Unknown && Usage > MemoryLimit){
+        throw std::length_error("An unknown scan of " + std::to_string(Usage >> 20) + " MiB is over the limit of "
+            + std::to_string(MemoryLimit >> 20) + " MiB.");
+    }
+
+    reset();
+    Type = NewType;
+    Blocks = std::move(NewBlocks);
+
+    std::sort(Blocks.begin(), Blocks.end(), [](const block& a, const block& b){ return a.Base < b.Base; });
+
+    for_each_block([&](block& Block){
+        first_scan_block(Block, Compare, Value);
+    });
+
+    Started = true;
+}
+
+void scanner::next_scan(scan_compare Compare, std::uint64_t Value, const readable_map* Map){
+    if(!Started){
+        throw std::logic_error("No first scan.");
+    }
+
+    if(Compare == scan_compare::Unknown){
+        return;
+    }
+
+    if(Map){
+        std::erase_if(Blocks, [&](const block& e){ return !Map->contains(e.Base, e.Size); });
+    }
+
+    for_each_block([&](block& Block){
+        next_scan_block(Block, Compare, Value);
+    });
+}
+
+void scanner::reset(){
+    Blocks.clear();
+    Started = false;
+}
+
+std::size_t scanner::count() const {
+    std::size_t r = 0;
+    for(auto& e:Blocks){
+        r += e.Count;
+    }
+
+    return r;
+}
+
+std::vector<scan_result> scanner::results(std::size_t Max) const {
+    std::vector<scan_result> r;
+
+    auto Size = value_size(Type);
+
+    for(auto& e:Blocks){
+        std::size_t j = 0;
+
+        for(std::size_t w = 0; w < e.Bits.size(); ++w){
+            for(auto Bits = e.Bits[w]; Bits != 0; Bits &= Bits-1){
+                if(r.size() >= Max){
+                    return r;
+                }
+
+                auto i = w*64+static_cast<std::size_t>(std::countr_zero(Bits));
+
+                scan_result Result = {e.Base+i*Size, 0};
+                std::memcpy(&Result.Value, e.Values.data()+j*Size, Size);
+                r.push_back(Result);
+
+                ++j;
+            }
+        }
+    }
+
+    return r;
+}
+
+std::size_t scanner::memory_usage() const {
+    std::size_t r = 0;
+    for(auto& e:Blocks){
+        r += e.Bits.size()*sizeof(std::uint64_t)+e.Values.size();
+    }
+
+    return r;
+}
+
+void scanner::first_scan_block(block& Block, scan_compare Compare, std::uint64_t Value) const {
+    auto Size = value_size(Type);
+    auto Slots = Block.Size/Size;
+    auto Data = reinterpret_cast<const std::byte*>(Block.Base);
+
+    if(Compare == scan_compare::Unknown){
+        Block.Bits.assign((Slots+63)/64, ~std::uint64_t(0));
+        Block.Values.assign(Data, Data+Slots*Size);
+        Block.Count = Slots;
+        return;
+    }
+
+    Block.Bits.assign((Slots+63)/64, 0);
+
+#if MMTL_X86
+    if(Simd){
+        match_equal_avx2(Data, nullptr, Value, Size, Block.Size, Block.Bits.data());
+    }else
+#endif
+    {
+        match_equal_scalar(Data, nullptr, Value, Size, Block.Size, Block.Bits.data());
+    }
+
+    Block.Count = 0;
+    for(auto w:Block.Bits){
+        Block.Count += static_cast<std::size_t>(std::popcount(w));
+    }
+
+    Block.Values.resize(Block.Count*Size);
+    for(std::size_t w = 0, j = 0; w < Block.Bits.size(); ++w){
+        for(auto Bits = Block.Bits[w]; Bits != 0; Bits &= Bits-1, ++j){
+            std::memcpy(Block.Values.data()+j*Size, reinterpret_cast<const std::byte*>(&Value), Size);
+        }
+    }
+}
+
+void scanner::next_scan_block(block& Block, scan_compare Compare, std::uint64_t Value) const {
+    auto Size = value_size(Type);
+    auto Slots = Block.Size/Size;
+    auto Data = reinterpret_cast<const std::byte*>(Block.Base);
+
+    std::vector<std::uint64_t> Bits(Block.Bits.size(), 0);
+
+    auto Ordered = (Compare == scan_compare::Increased || Compare == scan_compare::Decreased);
+
+    if(Block.Count == Slots && !Ordered){
+        // Every value is a candidate, so the previous values line up with memory.
+        auto Other = (Compare == scan_compare::Exact)?nullptr:Block.Values.data();
+
+#if MMTL_X86
+        if(Simd){
+            match_equal_avx2(Data, Other, Value, Size, Block.Size, Bits.data());
+        }else
+#endif
+        {
+            match_equal_scalar(Data, Other, Value, Size, Block.Size, Bits.data());
+        }
+
+        if(Compare == scan_compare::Changed){
+            for(auto& w:Bits){
+                w = ~w;
+            }
+        }
+    }else{
+        auto ValueBytes = reinterpret_cast<const std::byte*>(&Value);
+
+        for(std::size_t w = 0, j = 0; w < Block.Bits.size(); ++w){
+            for(auto Old = Block.Bits[w]; Old != 0; Old &= Old-1, ++j){
+                auto b = static_cast<std::size_t>(std::countr_zero(Old));
+                auto Current = Data+(w*64+b)*Size;
+                auto Previous = (Compare == scan_compare::Exact)?ValueBytes:Block.Values.data()+j*Size;
+
+                if(compare(Type, Current, Previous, Compare)){
+                    Bits[w] |= std::uint64_t(1) << b;
+                }
+            }
+        }
+    }
+
+    std::size_t Count = 0;
+    for(auto w:Bits){
+        Count += static_cast<std::size_t>(std::popcount(w));
+    }
+
+    if(Count == Slots){
+        Block.Values.assign(Data, Data+Slots*Size);
+    }else{
+        std::vector<std::byte> Values(Count*Size);
+        for(std::size_t w = 0, j = 0; w < Bits.size(); ++w){
+            for(auto New = Bits[w]; New != 0; New &= New-1, ++j){
+                auto i = w*64+static_cast<std::size_t>(std::countr_zero(New));
+                std::memcpy(Values.data()+j*Size, Data+i*Size, Size);
+            }
+        }
+
+        Block.Values = std::move(Values);
+    }
+
+    Block.Bits = std::move(Bits);
+    Block.Count = Count;
+}
+
+}
@@ -0,0 +1,74 @@
+﻿#include "scan_kernels.h"
+
+#if MMTL_X86
+
+#include <immintrin.h>
+
+namespace mmtl {
+
+namespace {
+
+// Keeps every other bit, packed together.
+std::uint32_t even_bits(std::uint32_t x){
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0F0F0F0F;
+    x = (x | (x >> 4)) & 0x00FF00FF;
+    x = (x | (x >> 8)) & 0x0000FFFF;
+    return x;
+}
+
+template <std::size_t Size>
+void match_equal(const std::byte* Data, const std::byte* Other, __m256i Value, std::size_t Bytes, std::uint64_t* Bits){
+    constexpr std::size_t Lanes = 32/Size;
+
+    std::size_t Bit = 0;
+
+    for(std::size_t i = 0; i < Bytes; i += 32){
+        auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Data+i));
+        auto b = Other?_mm256_loadu_si256(reinterpret_cast<const __m256i*>(Other+i)):Value;
+
+        std::uint32_t Mask;
+        if constexpr(Size == 1){
+            Mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+        }else if constexpr(Size == 2){
+            Mask = even_bits(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(a, b))));
+        }else if constexpr(Size == 4){
+            Mask = static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+        }else{
+            Mask = static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))));
+        }
+
+        // `Lanes` divides 64, so a mask never straddles two words.
+        Bits[Bit/64] |= std::uint64_t(Mask) << (Bit%64);
+        Bit += Lanes;
+    }
+}
+
+}
+
+void match_equal_avx2(const std::byte* Data, const std::byte* Other, std::uint64_t Value,
+        std::size_t Size, std::size_t Bytes, std::uint64_t* Bits){
+    switch(Size){
+        case 1: {
+            match_equal<1>(Data, Other, _mm256_set1_epi8(static_cast<char>(Value)), Bytes, Bits);
+            break;
+        }
+        case 2: {
+            match_equal<2>(Data, Other, _mm256_set1_epi16(static_cast<short>(Value)), Bytes, Bits);
+            break;
+        }
+        case 4: {
+            match_equal<4>(Data, Other, _mm256_set1_epi32(static_cast<int>(Value)), Bytes, Bits);
+            break;
+        }
+        case 8: {
+            match_equal<8>(Data, Other, _mm256_set1_epi64x(static_cast<long long>(Value)), Bytes, Bits);
+            break;
+        }
+    }
+}
+
+}
+
+#endif
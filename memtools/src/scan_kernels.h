@@ -0,0 +1,22 @@
+﻿#ifndef MEMTOOLS_SCAN_KERNELS_H_INCLUDED
+    #define MEMTOOLS_SCAN_KERNELS_H_INCLUDED 1
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define MMTL_X86 1
+#else
+    #define MMTL_X86 0
+#endif
+
+namespace mmtl {
+
+// Sets bit `i` of `Bits` if value `i` of `Data` equals value `i` of `Other`, or `Value` if `Other` is
+// null. `Bytes` is a multiple of 32 and of `Size`, which is 1, 2, 4 or 8.
+void match_equal_avx2(const std::byte* Data, const std::byte* Other, std::uint64_t Value,
+    std::size_t Size, std::size_t Bytes, std::uint64_t* Bits);
+
+}
+
+#endif
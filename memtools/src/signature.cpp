@@ -0,0 +1,254 @@
+﻿#include <signature.h>
+
+#include <bit>
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MMTL_SSE2 1
+
+    #include <emmintrin.h>
+#endif
+
+namespace mmtl {
+
+namespace {
+
+int hex_digit(char c){
+    if(c >= '0' && c <= '9'){
+        return c-'0';
+    }else if(c >= 'a' && c <= 'f'){
+        return c-'a'+10;
+    }else if(c >= 'A' && c <= 'F'){
+        return c-'A'+10;
+    }
+
+    return -1;
+}
+
+// Where the first two fixed bytes in a row are.
+std::optional<std::size_t> anchor(const signature& Signature){
+    for(std::size_t i = 0; i+1 < Signature.size(); ++i){
+        if(Signature.Mask[i] && Signature.Mask[i+1]){
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+// A signature found by the two bytes at its anchor.
+struct anchored {
+    std::uint16_t Key;
+    std::size_t Signature;
+    std::size_t Anchor;
+};
+
+}
+
+signature signature::parse(std::string_view Text){
+    signature r;
+
+    std::size_t i = 0;
+    while(i < Text.size()){
+        if(Text[i] == ' ' || Text[i] == '\t'){
+            ++i;
+            continue;
+        }
+
+        if(i+1 >= Text.size()){
+            throw std::invalid_argument("Signature ends with half a byte.");
+        }
+
+        if(Text[i] == '?' && Text[i+1] == '?'){
+            r.Bytes.push_back(0);
+            r.Mask.push_back(0);
+        }else{
+            auto High = hex_digit(Text[i]);
+            auto Low = hex_digit(Text[i+1]);
+            if(High < 0 || Low < 0){
+                throw std::invalid_argument("Invalid byte in signature.");
+            }
+
+            r.Bytes.push_back(static_cast<std::uint8_t>(High*16+Low));
+            r.Mask.push_back(0xFF);
+        }
+
+        i += 2;
+    }
+
+    if(!anchor(r)){
+        throw std::invalid_argument("Signature needs two fixed bytes in a row.");
+    }
+
+    return r;
+}
+
+std::string signature::to_string() const {
+    constexpr char Digits[] = "0123456789ABCDEF";
+
+    std::string r;
+    for(std::size_t i = 0; i < size(); ++i){
+        if(i != 0){
+            r += ' ';
+        }
+
+        if(Mask[i]){
+            r += Digits[Bytes[i] >> 4];
+            r += Digits[Bytes[i]&15];
+        }else{
+            r += "??";
+        }
+    }
+
+    return r;
+}
+
+bool signature::matches(const std::byte* Data) const {
+    for(std::size_t i = 0; i < size(); ++i){
+        if(((std::to_integer<std::uint8_t>(Data[i])^Bytes[i])&Mask[i]) != 0){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<signature_match> find_signatures(const std::byte* Data, std::size_t Size, const std::vector<signature>& Signatures){
+    std::vector<signature_match> r(Signatures.size());
+
+    std::vector<anchored> Anchors;
+    for(std::size_t i = 0; i < Signatures.size(); ++i){
+        auto& e = Signatures[i];
+        auto At = anchor(e);
+        if(!At){
+            throw std::invalid_argument("Signature needs two fixed bytes in a row.");
+        }
+
+        Anchors.push_back({static_cast<std::uint16_t>(e.Bytes[*At] | (e.Bytes[*At+1] << 8)), i, *At});
+    }
+
+    std::sort(Anchors.begin(), Anchors.end(), [](const anchored& a, const anchored& b){ return a.Key < b.Key; });
+
+    std::vector<std::uint16_t> Keys;
+    for(auto& e:Anchors){
+        if(Keys.empty() || Keys.back() != e.Key){
+            Keys.push_back(e.Key);
+        }
+    }
+
+    // Rejects most positions without looking at the anchors.
+    std::array<std::uint64_t, 65536/64> Filter = {};
+    for(auto Key:Keys){
+        Filter[Key/64] |= std::uint64_t(1) << (Key%64);
+    }
+
+    auto check = [&](std::size_t p, std::uint16_t Key){
+        auto [Begin, End] = std::equal_range(Anchors.begin(), Anchors.end(), anchored{Key, 0, 0},
+            [](const anchored& a, const anchored& b){ return a.Key < b.Key; });
+
+        for(auto it = Begin; it != End; ++it){
+            auto& Signature = Signatures[it->Signature];
+            auto& Match = r[it->Signature];
+
+            if(p < it->Anchor || Match.Count >= 2){
+                continue;
+            }
+
+            auto Start = p-it->Anchor;
+            if(Size-Start < Signature.size() || !Signature.matches(Data+Start)){
+                continue;
+            }
+
+            if(Match.Count++ == 0){
+                Match.Offset = Start;
+            }
+        }
+    };
+
+    auto key_at = [&](std::size_t p){
+        return static_cast<std::uint16_t>(std::to_integer<unsigned>(Data[p]) | (std::to_integer<unsigned>(Data[p+1]) << 8));
+    };
+
+    std::size_t i = 0;
+
+#ifdef MMTL_SSE2
+    // Compares 16 positions against every anchor at once while there are few enough of them,
+    // beyond that the filter is faster.
+    if(Keys.size() <= 8){
+        __m128i Low[8], High[8];
+        for(std::size_t j = 0; j < Keys.size(); ++j){
+            Low[j] = _mm_set1_epi8(static_cast<char>(Keys[j]&0xFF));
+            High[j] = _mm_set1_epi8(static_cast<char>(Keys[j] >> 8));
+        }
+
+        for(; i+17 <= Size; i += 16){
+            auto First = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data+i));
+            auto Second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Data+i+1));
+
+            unsigned Mask = 0;
+            for(std::size_t j = 0; j < Keys.size(); ++j){
+                auto Equal = _mm_and_si128(_mm_cmpeq_epi8(First, Low[j]), _mm_cmpeq_epi8(Second, High[j]));
+                Mask |= static_cast<unsigned>(_mm_movemask_epi8(Equal));
+            }
+
+            while(Mask != 0){
+                auto p = i+static_cast<std::size_t>(std::countr_zero(Mask));
+                check(p, key_at(p));
+                Mask &= Mask-1;
+            }
+        }
+    }
+#endif
+
+    for(; i+1 < Size; ++i){
+        auto Key = key_at(i);
+        if(Filter[Key/64] & (std::uint64_t(1) << (Key%64))){
+            check(i, Key);
+        }
+    }
+
+    return r;
+}
+
+std::optional<signature> make_signature(const std::byte* Data, std::size_t Size, std::size_t Offset,
+        const std::vector<bool>& Volatile, std::size_t MaxLength){
+    signature r;
+
+    // Every other position that matches so far.
+    std::vector<std::size_t> Candidates;
+    bool Started = false;
+
+    for(std::size_t i = 0; i < MaxLength && Offset+i < Size; ++i){
+        auto Fixed = !Volatile[Offset+i];
+        auto Byte = std::to_integer<std::uint8_t>(Data[Offset+i]);
+
+        r.Bytes.push_back(Fixed?Byte:0);
+        r.Mask.push_back(Fixed?0xFF:0);
+
+        if(!Fixed){
+            continue;
+        }
+
+        if(!Started){
+            Started = true;
+
+            for(std::size_t p = 0; p+i < Size; ++p){
+                if(p != Offset && Data[p+i] == Data[Offset+i]){
+                    Candidates.push_back(p);
+                }
+            }
+        }else{
+            std::erase_if(Candidates, [&](std::size_t p){ return p+i >= Size || Data[p+i] != Data[Offset+i]; });
+        }
+
+        if(Candidates.empty() && anchor(r)){
+            return r;
+        }
+    }
+
+    return std::nullopt;
+}
+
+}
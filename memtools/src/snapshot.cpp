@@ -0,0 +1,315 @@
+﻿#include <snapshot.h>
+
+#include <algorithm>
+
+namespace mmtl {
+
+namespace {
+
+bool same_region(const region& a, const region& b){
+    return a.Base == b.Base && a.Size == b.Size && a.Tracking == b.Tracking && a.Protect == b.Protect;
+}
+
+const region* find_region(const std::vector<region>& Regions, std::uintptr_t Address){
+    auto it = std::upper_bound(Regions.begin(), Regions.end(), Address,
+        [](std::uintptr_t a, const region& b){ return a < b.Base; });
+
+    if(it == Regions.begin()){
+        return nullptr;
+    }
+
+    --it;
+    return (Address < it->end())?&*it:nullptr;
+}
+
+// Builds a new snapshot from an old one, copying chunks the first time they are modified.
+struct builder {
+    builder(const snapshot* From, std::shared_ptr<page_store> Store)
+        :Result(std::make_shared<snapshot>()), Store(std::move(Store)) {
+        if(From){
+            *Result = *From;
+        }
+    }
+
+    page_store::id get(std::uintptr_t Address) const {
+        return Result->find(Address);
+    }
+
+    // Takes over the reference to `Page`.
+    void set(std::uintptr_t Address, page_store::id Page){
+        auto& Slot = chunk(Address).Pages[(Address%snapshot::ChunkSize)/PageSize];
+
+        Result->PageCount += (Slot == page_store::None)-(Page == page_store::None);
+
+        Store->release(&Slot, 1);
+        Slot = Page;
+    }
+
+    // Copies the page at `Address` into the store.
+    void copy(std::uintptr_t Address){
+        set(Address, Store->insert(reinterpret_cast<const void*>(Address)));
+    }
+
+    snapshot::chunk& chunk(std::uintptr_t Address){
+        auto Key = Address-Address%snapshot::ChunkSize;
+
+        auto it = Owned.find(Key);
+        if(it != Owned.end()){
+            return *it->second;
+        }
+
+        std::shared_ptr<snapshot::chunk> New;
+
+        auto Old = Result->Chunks.find(Key);
+        if(Old != Result->Chunks.end()){
+            New = std::make_shared<snapshot::chunk>(*Old->second);
+        }else{
+            New = std::make_shared<snapshot::chunk>(Store);
+        }
+
+        Result->Chunks[Key] = New;
+        Owned.emplace(Key, New);
+
+        return *New;
+    }
+
+    std::shared_ptr<const snapshot> finish(){
+        for(auto& [Key, Chunk]:Owned){
+            if(std::all_of(Chunk->Pages.begin(), Chunk->Pages.end(), [](auto p){ return p == page_store::None; })){
+                Result->Chunks.erase(Key);
+            }
+        }
+
+        return std::move(Result);
+    }
+
+    std::shared_ptr<snapshot> Result;
+    std::shared_ptr<page_store> Store;
+    std::map<std::uintptr_t, std::shared_ptr<snapshot::chunk>> Owned;
+};
+
+// Calls `Fn(Address, Page)` for every page that is set in `b`, but differs from `a`.
+template <typename F>
+void for_each_difference(const snapshot& a, const snapshot& b, F&& Fn){
+    auto i = a.Chunks.begin();
+
+    for(auto& [Key, Chunk]:b.Chunks){
+        while(i != a.Chunks.end() && i->first < Key){
+            ++i;
+        }
+
+        const snapshot::chunk* Other = nullptr;
+        if(i != a.Chunks.end() && i->first == Key){
+            if(i->second == Chunk){
+                continue;
+            }
+
+            Other = i->second.get();
+        }
+
+        for(std::size_t j = 0; j < snapshot::ChunkPages; ++j){
+            auto Page = Chunk->Pages[j];
+            if(Page != page_store::None && (!Other || Other->Pages[j] != Page)){
+                Fn(Key+j*PageSize, Page);
+            }
+        }
+    }
+}
+
+}
+
+snapshot::chunk::chunk(std::shared_ptr<page_store> Store):Store(std::move(Store)) {
+    Pages.fill(page_store::None);
+}
+
+snapshot::chunk::chunk(const chunk& Rhs):Store(Rhs.Store), Pages(Rhs.Pages) {
+    Store->retain(Pages.data(), Pages.size());
+}
+
+snapshot::chunk::~chunk(){
+    Store->release(Pages.data(), Pages.size());
+}
+
+page_store::id snapshot::find(std::uintptr_t Address) const {
+    auto it = Chunks.find(Address-Address%ChunkSize);
+    if(it == Chunks.end()){
+        return page_store::None;
+    }
+
+    return it->second->Pages[(Address%ChunkSize)/PageSize];
+}
+
+snapshotter::snapshotter(region_source Source, std::shared_ptr<page_store> Store)
+    :Source(std::move(Source)), Store(Store?std::move(Store):std::make_shared<page_store>()) {}
+
+std::shared_ptr<const snapshot> snapshotter::save(snapshot_stats* Stats){
+    snapshot_stats Dummy;
+    if(!Stats){
+        Stats = &Dummy;
+    }
+
+    *Stats = {};
+
+    auto NewRegions = Source();
+    std::sort(NewRegions.begin(), NewRegions.end(),
+        [](const region& a, const region& b){ return a.Base < b.Base; });
+
+    Dirty.clear();
+    Tracker.collect(Dirty);
+
+    auto Same = std::equal(NewRegions.begin(), NewRegions.end(), Regions.begin(), Regions.end(), same_region);
+
+    // Watch before copying, so writes during the copy are seen next time.
+    if(!Same || !Base){
+        Tracker.watch(NewRegions);
+    }
+
+    builder Builder(Base.get(), Store);
+
+    // Drop pages that are no longer mapped.
+    if(Base && (Stale || !Same)){
+        for(auto& [Key, Chunk]:Base->Chunks){
+            for(std::size_t j = 0; j < snapshot::ChunkPages; ++j){
+                auto Address = Key+j*PageSize;
+                if(Chunk->Pages[j] != page_store::None && !find_region(NewRegions, Address)){
+                    Builder.set(Address, page_store::None);
+                }
+            }
+        }
+    }
+
+    for(auto& e:NewRegions){
+        auto Old = find_region(Regions, e.Base);
+        auto Unchanged = Base && Old && same_region(*Old, e);
+
+        if(Unchanged && e.Tracking != tracking::Compare){
+            // Handled by the dirty pages below, apart from pages a restored snapshot did not have.
+            if(Stale){
+                for(auto Address = e.Base; Address < e.end(); Address += PageSize){
+                    if(Builder.get(Address) == page_store::None){
+                        Builder.copy(Address);
+                        ++Stats->Copied;
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        for(auto Address = e.Base; Address < e.end(); Address += PageSize){
+            auto Page = Builder.get(Address);
+            if(Page == page_store::None || !Store->equal(Page, reinterpret_cast<const void*>(Address))){
+                Builder.copy(Address);
+                ++Stats->Copied;
+            }
+        }
+    }
+
+    if(Base){
+        for(auto Address:Dirty){
+            auto Region = find_region(NewRegions, Address);
+            auto Old = find_region(Regions, Address);
+
+            if(Region && Region->Tracking != tracking::Compare && Old && same_region(*Old, *Region)){
+                Builder.copy(Address);
+                ++Stats->Copied;
+            }
+        }
+    }
+
+    Regions = std::move(NewRegions);
+    Base = Builder.finish();
+    Stale = false;
+
+    Stats->Pages = Base->PageCount;
+
+    return Base;
+}
+
+void snapshotter::restore(const std::shared_ptr<const snapshot>& Snapshot, snapshot_stats* Stats){
+    snapshot_stats Dummy;
+    if(!Stats){
+        Stats = &Dummy;
+    }
+
+    *Stats = {};
+    Stats->Pages = Snapshot->PageCount;
+
+    // Memory matches `Base` apart from the dirty pages, so only those and the pages that differ
+    // between `Base` and the snapshot need to be written.
+    std::vector<std::pair<std::uintptr_t, page_store::id>> Writes;
+
+    Dirty.clear();
+    Tracker.collect(Dirty);
+
+    for(auto Address:Dirty){
+        if(auto Page = Snapshot->find(Address); Page != page_store::None && find_region(Regions, Address)){
+            Writes.push_back({Address, Page});
+        }
+    }
+
+    auto add = [&](std::uintptr_t Address, page_store::id Page){
+        if(find_region(Regions, Address)){
+            Writes.push_back({Address, Page});
+        }else{
+            ++Stats->Missing;
+        }
+    };
+
+    if(Base){
+        for_each_difference(*Base, *Snapshot, add);
+    }else{
+        for_each_difference(snapshot{}, *Snapshot, add);
+    }
+
+    for(auto& e:Regions){
+        if(e.Tracking != tracking::Compare){
+            continue;
+        }
+
+        for(auto Address = e.Base; Address < e.end(); Address += PageSize){
+            auto Page = Snapshot->find(Address);
+            if(Page != page_store::None && !Store->equal(Page, reinterpret_cast<const void*>(Address))){
+                Writes.push_back({Address, Page});
+            }
+        }
+    }
+
+    std::sort(Writes.begin(), Writes.end());
+    Writes.erase(std::unique(Writes.begin(), Writes.end()), Writes.end());
+
+    for(std::size_t i = 0; i < Writes.size();){
+        auto j = i+1;
+        while(j < Writes.size() && Writes[j].first == Writes[j-1].first+PageSize){
+            ++j;
+        }
+
+        auto Begin = Writes[i].first;
+        auto End = Writes[j-1].first+PageSize;
+
+        Tracker.begin_write(Begin, End);
+
+        for(auto k = i; k < j; ++k){
+            Store->read(Writes[k].second, reinterpret_cast<void*>(Writes[k].first));
+        }
+
+        Tracker.end_write(Begin, End);
+
+        i = j;
+    }
+
+    Stats->Written = Writes.size();
+
+    Base = Snapshot;
+    Stale = true;
+}
+
+void snapshotter::reset(){
+    Tracker.unwatch();
+
+    Regions.clear();
+    Base = nullptr;
+    Stale = false;
+}
+
+}
@@ -0,0 +1,423 @@
+﻿#include <trace.h>
+
+#include <bit>
+#include <utility>
+#include <algorithm>
+
+namespace mmtl {
+
+static_assert(std::endian::native == std::endian::little, "The trace is written as is.");
+
+namespace {
+
+constexpr char Magic[8] = {'D', 'H', 'T', 'A', 'S', 'T', 'R', '2'};
+
+// Zero runs shorter than this are cheaper to keep in a literal run.
+constexpr std::size_t MinZeroRun = 3;
+
+template <typename T>
+void put(std::ofstream& File, const T& Value){
+    File.write(reinterpret_cast<const char*>(&Value), sizeof(Value));
+}
+
+template <typename T>
+bool get(std::ifstream& File, T& Value){
+    return static_cast<bool>(File.read(reinterpret_cast<char*>(&Value), sizeof(Value)));
+}
+
+void put_varint(std::vector<std::byte>& Out, std::size_t Value){
+    while(Value >= 0x80){
+        Out.push_back(std::byte((Value&0x7F)|0x80));
+        Value >>= 7;
+    }
+
+    Out.push_back(std::byte(Value));
+}
+
+bool get_varint(const std::byte*& p, const std::byte* End, std::size_t& Value){
+    Value = 0;
+
+    for(unsigned Shift = 0; p < End && Shift < 64; Shift += 7){
+        auto b = std::to_integer<std::size_t>(*p++);
+        Value |= (b&0x7F) << Shift;
+        if(!(b&0x80)){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Transposes `Count` deltas of `Size` bytes, and replaces zero runs. Output is pairs of a zero
+// count and a literal count, followed by the literals.
+std::vector<std::byte> pack(const std::vector<std::byte>& Deltas, std::size_t Count, std::size_t Size){
+    std::vector<std::byte> Planes(Deltas.size());
+    for(std::size_t i = 0; i < Count; ++i){
+        for(std::size_t j = 0; j < Size; ++j){
+            Planes[j*Count+i] = Deltas[i*Size+j];
+        }
+    }
+
+    std::vector<std::byte> r;
+
+    auto zero_run = [&](std::size_t i){
+        auto j = i;
+        while(j < Planes.size() && Planes[j] == std::byte(0)){
+            ++j;
+        }
+        return j-i;
+    };
+
+    for(std::size_t i = 0; i < Planes.size();){
+        auto Zeros = zero_run(i);
+        i += Zeros;
+
+        auto Begin = i;
+        while(i < Planes.size()){
+            auto Run = zero_run(i);
+            if(Run >= MinZeroRun || i+Run == Planes.size()){
+                break;
+            }
+
+            i += std::max<std::size_t>(Run, 1);
+        }
+
+        put_varint(r, Zeros);
+        put_varint(r, i-Begin);
+        r.insert(r.end(), Planes.begin()+Begin, Planes.begin()+i);
+    }
+
+    return r;
+}
+
+bool unpack(const std::vector<std::byte>& Packed, std::size_t Count, std::size_t Size, std::vector<std::byte>& Deltas){
+    std::vector<std::byte> Planes(Count*Size, std::byte(0));
+
+    auto p = Packed.data();
+    auto End = p+Packed.size();
+
+    std::size_t i = 0;
+    while(p < End){
+        std::size_t Zeros, Literals;
+        if(!get_varint(p, End, Zeros) || !get_varint(p, End, Literals)){
+            return false;
+        }
+
+        if(Zeros > Planes.size()-i || Literals > Planes.size()-i-Zeros || Literals > static_cast<std::size_t>(End-p)){
+            return false;
+        }
+
+        i += Zeros;
+        std::copy(p, p+Literals, Planes.begin()+i);
+        i += Literals;
+        p += Literals;
+    }
+
+    Deltas.resize(Planes.size());
+    for(std::size_t k = 0; k < Count; ++k){
+        for(std::size_t j = 0; j < Size; ++j){
+            Deltas[k*Size+j] = Planes[j*Count+k];
+        }
+    }
+
+    return true;
+}
+
+std::vector<std::byte> encode_frames(const std::vector<std::uint64_t>& Frames){
+    std::vector<std::byte> Deltas(Frames.size()*sizeof(std::uint64_t));
+
+    std::uint64_t Previous = 0;
+    for(std::size_t i = 0; i < Frames.size(); ++i){
+        auto Delta = Frames[i]-Previous;
+        std::memcpy(Deltas.data()+i*sizeof(Delta), &Delta, sizeof(Delta));
+        Previous = Frames[i];
+    }
+
+    return pack(Deltas, Frames.size(), sizeof(std::uint64_t));
+}
+
+std::vector<std::byte> encode_values(std::vector<std::byte> Values, std::size_t Count, std::size_t Size){
+    // Backwards, so every value is still there to XOR the next one with.
+    for(auto i = Values.size(); i-- > Size;){
+        Values[i] ^= Values[i-Size];
+    }
+
+    return pack(Values, Count, Size);
+}
+
+}
+
+trace_writer::trace_writer(const std::filesystem::path& Path, std::vector<trace_column> Columns, std::size_t BlockFrames)
+    :File(Path, std::ios::binary), Columns(std::move(Columns)), BlockFrames(std::max<std::size_t>(BlockFrames, 1)) {
+    if(!File){
+        throw std::runtime_error("Unable to create trace.");
+    }
+
+    File.write(Magic, sizeof(Magic));
+    put(File, static_cast<std::uint8_t>(sizeof(std::uintptr_t)));
+    put(File, static_cast<std::uint32_t>(this->Columns.size()));
+
+    for(auto& e:this->Columns){
+        put(File, static_cast<std::uint8_t>(e.Type));
+        put(File, static_cast<std::uint16_t>(e.Name.size()));
+        File.write(e.Name.data(), static_cast<std::streamsize>(e.Name.size()));
+    }
+
+    Current.Values.resize(this->Columns.size());
+
+    Thread = std::thread(&trace_writer::run, this);
+}
+
+trace_writer::~trace_writer(){
+    submit();
+
+    {
+        std::lock_guard Lock(Mutex);
+        Stopping = true;
+    }
+
+    Wake.notify_all();
+    Thread.join();
+}
+
+void trace_writer::write(std::uint64_t Frame, const std::byte* Row){
+    if(Failed){
+        throw std::runtime_error("Unable to write trace.");
+    }
+
+    Current.Frames.push_back(Frame);
+
+    for(std::size_t i = 0; i < Columns.size(); ++i){
+        auto Value = Row+Columns[i].Offset;
+        Current.Values[i].insert(Current.Values[i].end(), Value, Value+value_size(Columns[i].Type));
+    }
+
+    if(Current.Frames.size() >= BlockFrames){
+        submit();
+    }
+}
+
+void trace_writer::flush(){
+    submit();
+
+    std::unique_lock Lock(Mutex);
+    Idle.wait(Lock, [&]{ return Queue.empty() && !Busy; });
+}
+
+void trace_writer::submit(){
+    if(Current.Frames.empty()){
+        return;
+    }
+
+    block Next;
+    Next.Values.resize(Columns.size());
+    Next.Frames.reserve(BlockFrames);
+    for(std::size_t i = 0; i < Columns.size(); ++i){
+        Next.Values[i].reserve(BlockFrames*value_size(Columns[i].Type));
+    }
+
+    {
+        std::lock_guard Lock(Mutex);
+        Queue.push_back(std::exchange(Current, std::move(Next)));
+    }
+
+    Wake.notify_one();
+}
+
+void trace_writer::run(){
+    std::unique_lock Lock(Mutex);
+
+    while(true){
+        Wake.wait(Lock, [&]{ return Stopping || !Queue.empty(); });
+
+        if(Queue.empty()){
+            break;
+        }
+
+        auto Block = std::move(Queue.front());
+        Queue.pop_front();
+        Busy = true;
+
+        Lock.unlock();
+
+        auto Count = Block.Frames.size();
+
+        std::vector<std::vector<std::byte>> Encoded;
+        Encoded.push_back(encode_frames(Block.Frames));
+        for(std::size_t i = 0; i < Columns.size(); ++i){
+            Encoded.push_back(encode_values(std::move(Block.Values[i]), Count, value_size(Columns[i].Type)));
+        }
+
+        put(File, static_cast<std::uint32_t>(Count));
+        for(auto& e:Encoded){
+            put(File, static_cast<std::uint32_t>(e.size()));
+        }
+
+        for(auto& e:Encoded){
+            File.write(reinterpret_cast<const char*>(e.data()), static_cast<std::streamsize>(e.size()));
+        }
+
+        File.flush();
+        if(!File){
+            Failed = true;
+        }
+
+        Lock.lock();
+
+        Busy = false;
+        Idle.notify_all();
+    }
+}
+
+trace_reader::trace_reader(const std::filesystem::path& Path):File(Path, std::ios::binary) {
+    if(!File){
+        throw std::runtime_error("Unable to open trace.");
+    }
+
+    char Header[sizeof(Magic)];
+    std::uint8_t Size;
+    if(
+        !File.read(Header, sizeof(Header)) || !std::equal(Header, Header+sizeof(Header), Magic) ||
+        !get(File, Size) || (Size != 4 && Size != 8)
+    ){
+        throw std::runtime_error("Not a trace.");
+    }
+
+    PointerSize = Size;
+    std::uint64_t Position = sizeof(Magic)+sizeof(Size);
+
+    std::uint32_t ColumnCount;
+    if(!get(File, ColumnCount)){
+        throw std::runtime_error("Truncated trace.");
+    }
+
+    for(std::uint32_t i = 0; i < ColumnCount; ++i){
+        std::uint8_t Type;
+        std::uint16_t Length;
+        if(!get(File, Type) || !get(File, Length) || Type > static_cast<std::uint8_t>(value_type::Pointer)){
+            throw std::runtime_error("Truncated trace.");
+        }
+
+        std::string Name(Length, '\0');
+        if(!File.read(Name.data(), Length)){
+            throw std::runtime_error("Truncated trace.");
+        }
+
+        Columns.push_back({std::move(Name), static_cast<value_type>(Type)});
+    }
+
+    File.seekg(0, std::ios::end);
+    std::uint64_t FileSize = File.tellg();
+
+    Position += sizeof(std::uint32_t);
+    for(auto& e:Columns){
+        Position += sizeof(std::uint8_t)+sizeof(std::uint16_t)+e.Name.size();
+    }
+
+    while(true){
+        File.seekg(static_cast<std::streamoff>(Position));
+
+        block Block;
+
+        std::uint32_t Frames;
+        if(!get(File, Frames)){
+            break;
+        }
+
+        Block.Frames = Frames;
+        Block.Sizes.resize(Columns.size()+1);
+        if(!File.read(reinterpret_cast<char*>(Block.Sizes.data()), static_cast<std::streamsize>(Block.Sizes.size()*sizeof(std::uint32_t)))){
+            break;
+        }
+
+        Position += sizeof(std::uint32_t)*(Block.Sizes.size()+1);
+        for(auto Size:Block.Sizes){
+            Block.Offsets.push_back(Position);
+            Position += Size;
+        }
+
+        if(Position > FileSize){
+            break;
+        }
+
+        FrameCount += Block.Frames;
+        Blocks.push_back(std::move(Block));
+    }
+
+    File.clear();
+}
+
+std::optional<std::size_t> trace_reader::find(std::string_view Name) const {
+    for(std::size_t i = 0; i < Columns.size(); ++i){
+        if(Columns[i].Name == Name){
+            return i;
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::vector<std::byte> trace_reader::load(const block& Block, std::size_t Index){
+    std::vector<std::byte> r(Block.Sizes[Index]);
+
+    File.seekg(static_cast<std::streamoff>(Block.Offsets[Index]));
+    if(!File.read(reinterpret_cast<char*>(r.data()), static_cast<std::streamsize>(r.size()))){
+        throw std::runtime_error("Unable to read trace.");
+    }
+
+    return r;
+}
+
+std::vector<std::uint64_t> trace_reader::frames(){
+    std::vector<std::uint64_t> r;
+    r.reserve(FrameCount);
+
+    std::vector<std::byte> Deltas;
+
+    for(auto& e:Blocks){
+        if(!unpack(load(e, 0), e.Frames, sizeof(std::uint64_t), Deltas)){
+            throw std::runtime_error("Corrupt trace.");
+        }
+
+        std::uint64_t Frame = 0;
+        for(std::size_t i = 0; i < e.Frames; ++i){
+            std::uint64_t Delta;
+            std::memcpy(&Delta, Deltas.data()+i*sizeof(Delta), sizeof(Delta));
+
+            Frame += Delta;
+            r.push_back(Frame);
+        }
+    }
+
+    return r;
+}
+
+std::size_t trace_reader::column_size(std::size_t Index) const {
+    auto Type = Columns.at(Index).Type;
+    return (Type == value_type::Pointer)?PointerSize:value_size(Type);
+}
+
+std::vector<std::byte> trace_reader::column(std::size_t Index){
+    auto Size = column_size(Index);
+
+    std::vector<std::byte> r;
+    r.reserve(FrameCount*Size);
+
+    std::vector<std::byte> Deltas;
+
+    for(auto& e:Blocks){
+        if(!unpack(load(e, Index+1), e.Frames, Size, Deltas)){
+            throw std::runtime_error("Corrupt trace.");
+        }
+
+        for(std::size_t i = Size; i < Deltas.size(); ++i){
+            Deltas[i] ^= Deltas[i-Size];
+        }
+
+        r.insert(r.end(), Deltas.begin(), Deltas.end());
+    }
+
+    return r;
+}
+
+}
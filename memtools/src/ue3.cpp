@@ -0,0 +1,424 @@
+﻿#include <ue3.h>
+
+#include <array>
+#include <utility>
+#include <algorithm>
+#include <unordered_set>
+
+#include <cstring>
+
+namespace mmtl {
+
+namespace {
+
+// Longer names are cut short.
+constexpr std::size_t MaxNameLength = 1024;
+
+// Objects checked by `is_objects`.
+constexpr std::int32_t ObjectSamples = 16;
+
+constexpr std::int32_t MaxArrayCount = 1 << 24;
+
+}
+
+ue3_reflection::ue3_reflection(memory_reader Reader, const ue3_layout& Layout):Reader(std::move(Reader)), Layout(Layout) {}
+
+bool ue3_reflection::is_names(const array& Array) const {
+    if(Array.Count < 2){
+        return false;
+    }
+
+    // Reads with `NamesArray` as if this were it.
+    auto Saved = NamesArray;
+    NamesArray = Array;
+
+    std::string First, Second;
+    for(std::int32_t i = 0; i < 2; ++i){
+        std::uintptr_t Entry;
+        if(!read(Array.Data+i*sizeof(std::uintptr_t), Entry) || Entry == 0){
+            NamesArray = Saved;
+            return false;
+        }
+    }
+
+    NameRead.clear();
+    Names.clear();
+    NameIndex.clear();
+    NamesIndexed = 0;
+
+    auto Found = (name(0) == "None" && name(1) == "ByteProperty");
+
+    NamesArray = Saved;
+    NameRead.clear();
+    Names.clear();
+
+    return Found;
+}
+
+bool ue3_reflection::is_objects(const array& Array) const {
+    if(Array.Count < 1){
+        return false;
+    }
+
+    // Every object found must know its index, and a few must be found.
+    std::int32_t Found = 0;
+    for(std::int32_t n = 0; n < ObjectSamples; ++n){
+        auto i = static_cast<std::int32_t>(static_cast<std::int64_t>(Array.Count)*n/ObjectSamples);
+
+        std::uintptr_t Object;
+        if(!read(Array.Data+i*sizeof(std::uintptr_t), Object)){
+            return false;
+        }
+
+        if(Object == 0){
+            continue;
+        }
+
+        std::int32_t Index;
+        if(!read(Object+Layout.ObjectIndex, Index) || Index != i){
+            return false;
+        }
+
+        ++Found;
+    }
+
+    return Found >= std::min(Array.Count, 4);
+}
+
+bool ue3_reflection::locate(const std::vector<region>& Regions){
+    std::uintptr_t Objects = 0;
+    std::uintptr_t Names = 0;
+
+    std::vector<std::byte> Buffer;
+
+    for(auto& Region:Regions){
+        constexpr std::size_t Chunk = 64 << 10;
+
+        // Overlapping, so no array is cut in two.
+        for(std::size_t Offset = 0; Offset < Region.Size && (!Objects || !Names); Offset += Chunk){
+            auto Size = std::min(Chunk+sizeof(array), Region.Size-Offset);
+
+            Buffer.resize(Size);
+            if(!Reader(Region.Base+Offset, Buffer.data(), Size)){
+                continue;
+            }
+
+            for(std::size_t i = 0; i+sizeof(array) <= Size && i < Chunk; i += sizeof(std::uintptr_t)){
+                array Array;
+                std::memcpy(&Array, Buffer.data()+i, sizeof(Array));
+
+                if(Array.Data == 0 || Array.Data%sizeof(std::uintptr_t) != 0 || Array.Count <= 0 ||
+                        Array.Count > Array.Max || Array.Max > MaxArrayCount){
+                    continue;
+                }
+
+                auto Address = Region.Base+Offset+i;
+
+                if(!Names && is_names(Array)){
+                    Names = Address;
+                }else if(!Objects && is_objects(Array)){
+                    Objects = Address;
+                }
+            }
+        }
+    }
+
+    if(!Objects || !Names){
+        return false;
+    }
+
+    set_tables(Objects, Names);
+    return true;
+}
+
+void ue3_reflection::set_tables(std::uintptr_t Objects, std::uintptr_t Names){
+    ObjectsTable = Objects;
+    NamesTable = Names;
+
+    Slots.clear();
+    SlotOf.clear();
+    ByPath.clear();
+    Structs.clear();
+
+    NamesArray = {};
+    this->Names.clear();
+    NameRead.clear();
+    NameIndex.clear();
+    NamesIndexed = 0;
+}
+
+std::string_view ue3_reflection::name(std::int32_t Index) const {
+    if(Index < 0 || Index >= NamesArray.Count){
+        return {};
+    }
+
+    auto i = static_cast<std::size_t>(Index);
+
+    if(i >= Names.size()){
+        Names.resize(static_cast<std::size_t>(NamesArray.Count));
+        NameRead.resize(static_cast<std::size_t>(NamesArray.Count));
+    }
+
+    if(NameRead[i]){
+        return Names[i];
+    }
+
+    NameRead[i] = true;
+
+    std::uintptr_t Entry;
+    std::int32_t EntryIndex;
+    if(!read(NamesArray.Data+i*sizeof(std::uintptr_t), Entry) || Entry == 0 ||
+            !read(Entry+Layout.NameEntryIndex, EntryIndex)){
+        return {};
+    }
+
+    auto Wide = (EntryIndex&1) != 0;
+    auto Width = Wide?2:1;
+
+    // In pieces, as the entry may end right after the name.
+    std::string r;
+    for(std::uintptr_t Text = Entry+Layout.NameEntryText; r.size() < MaxNameLength;){
+        std::array<std::uint8_t, 2> c = {};
+        if(!Reader(Text, c.data(), Width)){
+            return {};
+        }
+
+        if(c[0] == 0 && (!Wide || c[1] == 0)){
+            break;
+        }
+
+        r += (Wide && c[1] != 0)?'?':static_cast<char>(c[0]);
+        Text += Width;
+    }
+
+    Names[i] = std::move(r);
+    return Names[i];
+}
+
+std::int32_t ue3_reflection::find_name(std::string_view Name) const {
+    // The names refer into `Names`, which never moves them.
+    for(; NamesIndexed < NamesArray.Count; ++NamesIndexed){
+        auto Text = name(NamesIndexed);
+        if(!Text.empty()){
+            NameIndex.try_emplace(Text, NamesIndexed);
+        }
+    }
+
+    auto it = NameIndex.find(Name);
+    return (it != NameIndex.end())?it->second:-1;
+}
+
+bool ue3_reflection::read_object(std::uintptr_t Object, slot& Out) const {
+    Out.Object = Object;
+
+    return read(Object+Layout.ObjectOuter, Out.Outer) && read(Object+Layout.ObjectClass, Out.Class) &&
+        read(Object+Layout.ObjectName, Out.Name) && read(Object+Layout.ObjectName+4, Out.Number);
+}
+
+std::string ue3_reflection::object_name(const slot& Slot) const {
+    std::string r(name(Slot.Name));
+
+    // Numbers are stored one higher, 0 being no number.
+    if(Slot.Number > 0){
+        r += '_';
+        r += std::to_string(Slot.Number-1);
+    }
+
+    return r;
+}
+
+std::size_t ue3_reflection::refresh(){
+    array Objects;
+    if(!ObjectsTable || !read(ObjectsTable, Objects) || !read(NamesTable, NamesArray)){
+        return 0;
+    }
+
+    if(Objects.Count < 0 || Objects.Count > MaxArrayCount){
+        return 0;
+    }
+
+    std::vector<std::uintptr_t> Pointers(static_cast<std::size_t>(Objects.Count));
+    if(!Reader(Objects.Data, Pointers.data(), Pointers.size()*sizeof(std::uintptr_t))){
+        return 0;
+    }
+
+    std::vector<std::uint32_t> Changed;
+    std::unordered_set<std::uintptr_t> Moved;
+
+    auto Count = std::max(Pointers.size(), Slots.size());
+    Slots.resize(Count);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        auto Pointer = (i < Pointers.size())?Pointers[i]:0;
+
+        // The same address may be a new object of the same size, so the name is read again too.
+        slot Slot;
+        if(Pointer != 0 && !read_object(Pointer, Slot)){
+            Slot = {};
+        }
+
+        auto& Old = Slots[i];
+        if(Old.Object == Slot.Object && Old.Name == Slot.Name && Old.Number == Slot.Number &&
+                Old.Outer == Slot.Outer && Old.Class == Slot.Class){
+            continue;
+        }
+
+        if(Old.Object != 0){
+            SlotOf.erase(Old.Object);
+            Structs.erase(Old.Object);
+            Moved.insert(Old.Object);
+        }
+
+        Old = Slot;
+        Changed.push_back(static_cast<std::uint32_t>(i));
+
+        if(Slot.Object != 0){
+            SlotOf[Slot.Object] = static_cast<std::uint32_t>(i);
+            Moved.insert(Slot.Object);
+        }
+    }
+
+    Slots.resize(Pointers.size());
+
+    // Objects keep their outers, so only the paths of changed slots change.
+    for(auto it = ByPath.begin(); it != ByPath.end();){
+        if(Moved.contains(it->second)){
+            it = ByPath.erase(it);
+        }else{
+            ++it;
+        }
+    }
+
+    for(auto i:Changed){
+        if(i < Slots.size() && Slots[i].Object != 0){
+            ByPath[path(Slots[i].Object)] = Slots[i].Object;
+        }
+    }
+
+    return Changed.size();
+}
+
+std::string ue3_reflection::path(std::uintptr_t Object) const {
+    std::string r;
+
+    // Bounded, in case of a cycle through a freed object.
+    for(int Depth = 0; Object != 0 && Depth < 64; ++Depth){
+        auto it = SlotOf.find(Object);
+        if(it == SlotOf.end()){
+            break;
+        }
+
+        auto& Slot = Slots[it->second];
+        r = r.empty()?object_name(Slot):object_name(Slot)+"."+r;
+        Object = Slot.Outer;
+    }
+
+    return r;
+}
+
+std::uintptr_t ue3_reflection::class_of(std::uintptr_t Object) const {
+    auto it = SlotOf.find(Object);
+    return (it != SlotOf.end())?Slots[it->second].Class:0;
+}
+
+std::uintptr_t ue3_reflection::find_object(std::string_view Path) const {
+    auto it = ByPath.find(std::string(Path));
+    return (it != ByPath.end())?it->second:0;
+}
+
+std::vector<std::uintptr_t> ue3_reflection::find_instances(std::string_view ClassName) const {
+    std::vector<std::uintptr_t> r;
+
+    // Compared by name index, classes are few so this is mostly one lookup per object.
+    std::unordered_map<std::uintptr_t, bool> Matches;
+
+    for(auto& e:Slots){
+        if(e.Object == 0 || e.Class == 0){
+            continue;
+        }
+
+        auto [it, New] = Matches.try_emplace(e.Class, false);
+        if(New){
+            auto Class = SlotOf.find(e.Class);
+            it->second = (Class != SlotOf.end() && object_name(Slots[Class->second]) == ClassName);
+        }
+
+        if(it->second && !name(e.Name).starts_with("Default__")){
+            r.push_back(e.Object);
+        }
+    }
+
+    return r;
+}
+
+const ue3_reflection::struct_info& ue3_reflection::struct_properties(std::uintptr_t Struct){
+    if(auto it = Structs.find(Struct); it != Structs.end()){
+        return it->second;
+    }
+
+    struct_info Info;
+
+    // Bounded in case of garbage.
+    std::size_t Fields = 0;
+    auto Super = Struct;
+    for(int Depth = 0; Super != 0 && Depth < 64; ++Depth){
+        std::uintptr_t Field;
+        if(!read(Super+Layout.StructChildren, Field)){
+            break;
+        }
+
+        for(; Field != 0 && Fields < 65536; ++Fields){
+            slot Slot;
+            if(!read_object(Field, Slot)){
+                break;
+            }
+
+            auto ClassSlot = SlotOf.find(Slot.Class);
+            auto Type = (ClassSlot != SlotOf.end())?object_name(Slots[ClassSlot->second]):std::string();
+
+            // Functions, enums and constants are fields too.
+            if(Type.ends_with("Property")){
+                ue3_property Property = {
+                    .Name = object_name(Slot),
+                    .Type = Type,
+                    .Offset = 0,
+                    .ElementSize = 0,
+                    .ArrayDim = 0,
+                    .Extra = 0,
+                };
+
+                if(read(Field+Layout.PropertyOffset, Property.Offset) &&
+                        read(Field+Layout.PropertyElementSize, Property.ElementSize) &&
+                        read(Field+Layout.PropertyArrayDim, Property.ArrayDim) &&
+                        read(Field+Layout.PropertyExtra, Property.Extra)){
+                    // Overridden properties don't exist in UnrealScript, the first one wins anyway.
+                    Info.ByName.try_emplace(Property.Name, Info.Properties.size());
+                    Info.Properties.push_back(std::move(Property));
+                }
+            }
+
+            if(!read(Field+Layout.FieldNext, Field)){
+                break;
+            }
+        }
+
+        if(!read(Super+Layout.StructSuper, Super)){
+            break;
+        }
+    }
+
+    return Structs.emplace(Struct, std::move(Info)).first->second;
+}
+
+const ue3_property* ue3_reflection::find_property(std::uintptr_t Struct, std::string_view Name){
+    auto& Info = struct_properties(Struct);
+
+    auto it = Info.ByName.find(std::string(Name));
+    return (it != Info.ByName.end())?&Info.Properties[it->second]:nullptr;
+}
+
+std::vector<ue3_property> ue3_reflection::properties(std::uintptr_t Struct){
+    return struct_properties(Struct).Properties;
+}
+
+}
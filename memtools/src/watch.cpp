@@ -0,0 +1,149 @@
+﻿#include <watch.h>
+
+#include <map>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cstring>
+
+namespace mmtl {
+
+std::size_t value_size(value_type Type){
+    switch(Type){
+        case value_type::I8:
+        case value_type::U8: {
+            return 1;
+        }
+        case value_type::I16:
+        case value_type::U16: {
+            return 2;
+        }
+        case value_type::I32:
+        case value_type::U32:
+        case value_type::F32: {
+            return 4;
+        }
+        case value_type::I64:
+        case value_type::U64:
+        case value_type::F64: {
+            return 8;
+        }
+        case value_type::Pointer: {
+            return sizeof(std::uintptr_t);
+        }
+    }
+
+    return 0;
+}
+
+std::optional<value_type> parse_value_type(std::string_view Name){
+    static constexpr std::pair<std::string_view, value_type> Names[] = {
+        {"i8", value_type::I8}, {"u8", value_type::U8},
+        {"i16", value_type::I16}, {"u16", value_type::U16},
+        {"i32", value_type::I32}, {"u32", value_type::U32},
+        {"i64", value_type::I64}, {"u64", value_type::U64},
+        {"f32", value_type::F32}, {"f64", value_type::F64},
+        {"ptr", value_type::Pointer},
+    };
+
+    for(auto& [Key, Type]:Names){
+        if(Key == Name){
+            return Type;
+        }
+    }
+
+    return std::nullopt;
+}
+
+watch_plan::watch_plan(const std::vector<watch>& Watches){
+    std::map<std::uintptr_t, std::size_t> Roots;
+    std::map<std::pair<std::size_t, std::ptrdiff_t>, std::size_t> Pointers;
+
+    for(auto& e:Watches){
+        if(e.Offsets.empty()){
+            throw std::invalid_argument("Watch '"+e.Name+"' has no offsets.");
+        }
+
+        auto [Root, NewRoot] = Roots.try_emplace(e.Base, Nodes.size());
+        if(NewRoot){
+            Nodes.push_back({None, e.Base, 0});
+        }
+
+        // Parents are always added before their children, so one pass in order resolves everything.
+        auto Node = Root->second;
+        for(std::size_t i = 0; i+1 < e.Offsets.size(); ++i){
+            auto [it, New] = Pointers.try_emplace({Node, e.Offsets[i]}, Nodes.size());
+            if(New){
+                Nodes.push_back({Node, 0, e.Offsets[i]});
+                ++PointerCount;
+            }
+
+            Node = it->second;
+        }
+
+        Values.push_back({Node, e.Offsets.back(), e.Type, 0});
+    }
+
+    // Largest first, so every value ends up aligned without padding.
+    std::vector<std::size_t> Order(Values.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::stable_sort(Order.begin(), Order.end(), [&](std::size_t a, std::size_t b){
+        return value_size(Values[a].Type) > value_size(Values[b].Type);
+    });
+
+    for(auto i:Order){
+        Values[i].Out = Size;
+        Size += value_size(Values[i].Type);
+    }
+
+    ValidOffset = Size;
+    Size += Values.size();
+
+    Addresses.resize(Nodes.size());
+}
+
+void watch_plan::read(std::byte* Out, const memory_reader& Reader){
+    if(!Resolved || Pending){
+        if(!Resolved){
+            std::fill(Addresses.begin(), Addresses.end(), 0);
+        }
+
+        Pending = false;
+
+        for(std::size_t i = 0; i < Nodes.size(); ++i){
+            auto& Node = Nodes[i];
+            if(Addresses[i] != 0){
+                continue;
+            }
+
+            if(Node.Parent == None){
+                Addresses[i] = Node.Base;
+            }else if(auto Parent = Addresses[Node.Parent]; Parent != 0){
+                std::uintptr_t Pointer;
+                if(Reader(Parent+Node.Offset, &Pointer, sizeof(Pointer))){
+                    Addresses[i] = Pointer;
+                }
+            }
+
+            Pending |= (Addresses[i] == 0);
+        }
+
+        Resolved = true;
+    }
+
+    for(std::size_t i = 0; i < Values.size(); ++i){
+        auto& e = Values[i];
+        auto Size = value_size(e.Type);
+        auto Address = Addresses[e.Node];
+
+        auto Valid = Address != 0 && Reader(Address+e.Offset, Out+e.Out, Size);
+        if(!Valid){
+            std::memset(Out+e.Out, 0, Size);
+        }
+
+        Out[ValidOffset+i] = std::byte(Valid);
+    }
+}
+
+}
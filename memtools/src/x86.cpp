@@ -0,0 +1,340 @@
+﻿#include <x86.h>
+
+#include <cstring>
+
+namespace mmtl {
+
+namespace {
+
+// What follows the opcode, for the one byte opcodes.
+enum operands : std::uint8_t {
+    None = 0,
+    ModRm = 1,
+    Imm8 = 2,
+    // 32 bits, or 16 with an operand size prefix.
+    ImmZ = 4,
+    Imm16 = 8,
+    Rel8 = 16,
+    RelZ = 32,
+    // An absolute address, 32 bits or 16 with an address size prefix.
+    Offset = 64,
+    Invalid = 128,
+};
+
+constexpr std::uint8_t OneByte[256] = {
+    // 00-0F, 0F is the two byte escape.
+    ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None, ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, Invalid,
+    // 10-1F
+    ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None, ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None,
+    // 20-2F
+    ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None, ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None,
+    // 30-3F
+    ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None, ModRm, ModRm, ModRm, ModRm, Imm8, ImmZ, None, None,
+    // 40-5F
+    None, None, None, None, None, None, None, None, None, None, None, None, None, None, None, None,
+    None, None, None, None, None, None, None, None, None, None, None, None, None, None, None, None,
+    // 60-6F
+    None, None, ModRm, ModRm, None, None, None, None, ImmZ, ModRm|ImmZ, Imm8, ModRm|Imm8, None, None, None, None,
+    // 70-7F
+    Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8, Rel8,
+    // 80-8F
+    ModRm|Imm8, ModRm|ImmZ, ModRm|Imm8, ModRm|Imm8, ModRm, ModRm, ModRm, ModRm,
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // 90-9F, 9A is a far call with a 48 bit pointer.
+    None, None, None, None, None, None, None, None, None, None, ImmZ|Imm16, None, None, None, None, None,
+    // A0-AF
+    Offset, Offset, Offset, Offset, None, None, None, None, Imm8, ImmZ, None, None, None, None, None, None,
+    // B0-BF
+    Imm8, Imm8, Imm8, Imm8, Imm8, Imm8, Imm8, Imm8, ImmZ, ImmZ, ImmZ, ImmZ, ImmZ, ImmZ, ImmZ, ImmZ,
+    // C0-CF
+    ModRm|Imm8, ModRm|Imm8, Imm16, None, ModRm, ModRm, ModRm|Imm8, ModRm|ImmZ,
+    Imm16|Imm8, None, Imm16, None, None, Imm8, None, None,
+    // D0-DF
+    ModRm, ModRm, ModRm, ModRm, Imm8, Imm8, None, None, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // E0-EF, EA is a far jump with a 48 bit pointer.
+    Rel8, Rel8, Rel8, Rel8, Imm8, Imm8, Imm8, Imm8, RelZ, RelZ, ImmZ|Imm16, Rel8, None, None, None, None,
+    // F0-FF, F6 and F7 have an immediate depending on ModRM.
+    None, None, None, None, None, None, ModRm, ModRm, None, None, None, None, None, None, ModRm, ModRm,
+};
+
+// The same for the two byte opcodes after 0F.
+constexpr std::uint8_t TwoByte[256] = {
+    // 00-0F, 0F is 3DNow! with the opcode as an immediate.
+    ModRm, ModRm, ModRm, ModRm, Invalid, None, None, None, None, None, Invalid, None, Invalid, ModRm, None, ModRm|Imm8,
+    // 10-1F
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // 20-2F
+    ModRm, ModRm, ModRm, ModRm, Invalid, Invalid, Invalid, Invalid, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // 30-3F, 38 and 3A are three byte opcodes.
+    None, None, None, None, None, None, Invalid, None, ModRm, Invalid, ModRm|Imm8, Invalid, Invalid, Invalid, Invalid, Invalid,
+    // 40-4F
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // 50-6F
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // 70-7F
+    ModRm|Imm8, ModRm|Imm8, ModRm|Imm8, ModRm|Imm8, ModRm, ModRm, ModRm, None,
+    ModRm, ModRm, Invalid, Invalid, ModRm, ModRm, ModRm, ModRm,
+    // 80-8F
+    RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ, RelZ,
+    // 90-9F
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // A0-AF
+    None, None, None, ModRm, ModRm|Imm8, ModRm, Invalid, Invalid, None, None, None, ModRm, ModRm|Imm8, ModRm, ModRm, ModRm,
+    // B0-BF
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm|Imm8, ModRm, ModRm, ModRm, ModRm, ModRm,
+    // C0-CF
+    ModRm, ModRm, ModRm|Imm8, ModRm, ModRm|Imm8, ModRm|Imm8, ModRm|Imm8, ModRm, None, None, None, None, None, None, None, None,
+    // D0-FF
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+    ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm, ModRm,
+};
+
+constexpr std::size_t MaxLength = 15;
+
+bool is_prefix(std::uint8_t Byte){
+    switch(Byte){
+        case 0x26: case 0x2E: case 0x36: case 0x3E: case 0x64: case 0x65: case 0x66: case 0x67:
+        case 0xF0: case 0xF2: case 0xF3: {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+}
+
+x86_instruction decode_x86(const std::byte* Code, std::size_t Size, std::uint32_t Address){
+    x86_instruction r;
+
+    if(Size > MaxLength){
+        Size = MaxLength;
+    }
+
+    std::size_t i = 0;
+    bool Valid = true;
+
+    auto byte = [&]() -> std::uint8_t {
+        if(i >= Size){
+            Valid = false;
+            return 0;
+        }
+
+        return std::to_integer<std::uint8_t>(Code[i++]);
+    };
+
+    auto read = [&](std::size_t n) -> std::uint32_t {
+        if(i > Size || Size-i < n){
+            Valid = false;
+            return 0;
+        }
+
+        std::uint32_t Value = 0;
+        std::memcpy(&Value, Code+i, n);
+        i += n;
+
+        // Sign extended, which is what displacements and most immediates are.
+        if(n == 1){
+            Value = static_cast<std::uint32_t>(static_cast<std::int8_t>(Value));
+        }else if(n == 2){
+            Value = static_cast<std::uint32_t>(static_cast<std::int16_t>(Value));
+        }
+
+        return Value;
+    };
+
+    bool OperandSize16 = false;
+    bool AddressSize16 = false;
+
+    auto Opcode = byte();
+    while(is_prefix(Opcode)){
+        if(Opcode == 0x66){
+            OperandSize16 = true;
+        }else if(Opcode == 0x67){
+            AddressSize16 = true;
+        }
+
+        Opcode = byte();
+    }
+
+    std::uint8_t Operands;
+    bool TwoBytes = (Opcode == 0x0F);
+
+    // C4 and C5 are VEX prefixes rather than `les` and `lds` when followed by what would be a
+    // register operand, which those don't allow.
+    if((Opcode == 0xC4 || Opcode == 0xC5) && i < Size && std::to_integer<std::uint8_t>(Code[i]) >= 0xC0){
+        auto Map = (Opcode == 0xC5)?1:(byte()&0x1F);
+        byte();
+
+        TwoBytes = true;
+        Opcode = byte();
+
+        switch(Map){
+            case 1: {
+                Operands = TwoByte[Opcode];
+                break;
+            }
+            case 2: {
+                Operands = ModRm;
+                break;
+            }
+            case 3: {
+                Operands = ModRm|Imm8;
+                break;
+            }
+            default: {
+                return {};
+            }
+        }
+    }else if(TwoBytes){
+        Opcode = byte();
+        Operands = TwoByte[Opcode];
+
+        // The third byte of 0F 38 and 0F 3A is the opcode, not ModRM.
+        if(Opcode == 0x38 || Opcode == 0x3A){
+            byte();
+        }
+    }else{
+        Operands = OneByte[Opcode];
+    }
+
+    if(!Valid || (Operands&Invalid)){
+        return {};
+    }
+
+    std::uint8_t Reg = 0;
+
+    if(Operands&ModRm){
+        auto Modrm = byte();
+        auto Mod = Modrm >> 6;
+        auto Rm = Modrm&7;
+        Reg = (Modrm >> 3)&7;
+
+        if(Mod != 3){
+            if(AddressSize16){
+                if(Mod == 1){
+                    read(1);
+                }else if(Mod == 2 || (Mod == 0 && Rm == 6)){
+                    read(2);
+                }
+            }else{
+                r.HasBase = true;
+
+                if(Rm == 4){
+                    auto Sib = byte();
+                    if(((Sib >> 3)&7) != 4){
+                        r.Scale = static_cast<std::uint8_t>(1 << (Sib >> 6));
+                    }
+
+                    if(Mod == 0 && (Sib&7) == 5){
+                        r.HasBase = false;
+                        Mod = 2;
+                    }
+                }else if(Mod == 0 && Rm == 5){
+                    r.HasBase = false;
+                    Mod = 2;
+                }
+
+                if(Mod == 1){
+                    read(1);
+                }else if(Mod == 2){
+                    r.HasDisplacement = true;
+                    r.Displacement = read(4);
+                }
+            }
+        }
+
+        if(!TwoBytes){
+            // Only `test` has an immediate among the F6 and F7 groups.
+            if((Opcode == 0xF6 || Opcode == 0xF7) && Reg < 2){
+                Operands |= (Opcode == 0xF6)?Imm8:ImmZ;
+            }
+
+            if(Opcode == 0xFF){
+                switch(Reg){
+                    case 2: case 3: {
+                        r.Flow = x86_flow::IndirectCall;
+                        break;
+                    }
+                    case 4: case 5: {
+                        r.Flow = x86_flow::IndirectJump;
+                        break;
+                    }
+                    default: {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if(Operands&Offset){
+        r.HasDisplacement = true;
+        r.Displacement = read(AddressSize16?2:4);
+    }
+
+    if(Operands&Imm16){
+        read(2);
+    }
+
+    if(Operands&ImmZ){
+        r.HasImmediate = !OperandSize16;
+        r.Immediate = read(OperandSize16?2:4);
+    }
+
+    if(Operands&Imm8){
+        read(1);
+    }
+
+    if(Operands&(Rel8|RelZ)){
+        auto Displacement = read((Operands&Rel8)?1:(OperandSize16?2:4));
+        r.Target = Address+static_cast<std::uint32_t>(i)+Displacement;
+
+        if(TwoBytes || (Opcode >= 0x70 && Opcode <= 0x7F) || (Opcode >= 0xE0 && Opcode <= 0xE3)){
+            r.Flow = x86_flow::Branch;
+        }else{
+            r.Flow = (Opcode == 0xE8)?x86_flow::Call:x86_flow::Jump;
+        }
+    }
+
+    if(!Valid){
+        return {};
+    }
+
+    if(!TwoBytes){
+        switch(Opcode){
+            case 0xC2: case 0xC3: case 0xCA: case 0xCB: case 0xCF: {
+                r.Flow = x86_flow::Return;
+                break;
+            }
+            case 0xCC: case 0xF4: {
+                r.Flow = x86_flow::Stop;
+                break;
+            }
+            case 0x9A: {
+                r.Flow = x86_flow::IndirectCall;
+                r.HasImmediate = false;
+                break;
+            }
+            case 0xEA: {
+                r.Flow = x86_flow::IndirectJump;
+                r.HasImmediate = false;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }else if(Opcode == 0x0B){
+        r.Flow = x86_flow::Stop;
+    }
+
+    r.Length = static_cast<std::uint8_t>(i);
+
+    return r;
+}
+
+}
@@ -0,0 +1,1848 @@
+﻿// The tests are asserts, so they are kept in release builds.
+#undef NDEBUG
+
+#include <pe.h>
+#include <x86.h>
+#include <hash.h>
+#include <scan.h>
+#include <ue3.h>
+#include <trace.h>
+#include <watch.h>
+#include <regions.h>
+#include <hash_log.h>
+#include <log_ring.h>
+#include <snapshot.h>
+#include <signature.h>
+#include <work_pool.h>
+#include <code_index.h>
+#include <page_store.h>
+#include <event_ring.h>
+#include <file_cache.h>
+#include <overlay_fs.h>
+#include <cloud_files.h>
+#include <load_profile.h>
+
+#include <map>
+#include <tuple>
+#include <thread>
+#include <random>
+#include <cstring>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace {
+
+std::byte* allocate(std::size_t Size){
+#ifdef _WIN32
+    return static_cast<std::byte*>(VirtualAlloc(nullptr, Size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE));
+#else
+    return static_cast<std::byte*>(mmap(nullptr, Size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void release(std::byte* Memory, std::size_t Size){
+#ifdef _WIN32
+    (void)Size;
+    VirtualFree(Memory, 0, MEM_RELEASE);
+#else
+    munmap(Memory, Size);
+#endif
+}
+
+mmtl::region make_region(std::byte* Memory, std::size_t Size, mmtl::tracking Tracking){
+    auto Base = reinterpret_cast<std::uintptr_t>(Memory);
+
+#ifdef _WIN32
+    std::uint32_t Protect = PAGE_READWRITE;
+#else
+    std::uint32_t Protect = PROT_READ|PROT_WRITE;
+#endif
+
+    return {Base, Size, Base, Protect, Tracking};
+}
+
+void fill(std::byte* Memory, std::size_t Page, int Value){
+    std::memset(Memory+Page*mmtl::PageSize, Value, mmtl::PageSize);
+}
+
+bool page_is(const std::byte* Memory, std::size_t Page, int Value){
+    for(std::size_t i = 0; i < mmtl::PageSize; ++i){
+        if(Memory[Page*mmtl::PageSize+i] != std::byte(Value)){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void test_query_regions(){
+    constexpr std::size_t Size = 16*mmtl::PageSize;
+
+    auto Memory = allocate(Size);
+    auto Begin = reinterpret_cast<std::uintptr_t>(Memory);
+
+    auto Regions = mmtl::query_regions();
+
+    auto Found = false;
+    for(auto& e:Regions){
+        if(e.Base <= Begin && Begin+Size <= e.end()){
+            Found = true;
+        }
+    }
+
+    assert(Found);
+
+    release(Memory, Size);
+}
+
+void test_readable_map(){
+    constexpr std::size_t Size = 16*mmtl::PageSize;
+
+    auto Memory = allocate(Size);
+    auto Begin = reinterpret_cast<std::uintptr_t>(Memory);
+
+    // A read only page in the middle splits the range.
+#ifdef _WIN32
+    DWORD Old;
+    VirtualProtect(Memory+4*mmtl::PageSize, mmtl::PageSize, PAGE_READONLY, &Old);
+#else
+    mprotect(Memory+4*mmtl::PageSize, mmtl::PageSize, PROT_READ);
+#endif
+
+    mmtl::readable_map Map;
+    Map.refresh();
+
+    assert(Map.contains(Begin, Size));
+    assert(Map.contains(Begin+3*mmtl::PageSize, 3*mmtl::PageSize));
+    assert(Map.contains(Begin, 4*mmtl::PageSize, true));
+    assert(!Map.contains(Begin+3*mmtl::PageSize, 2*mmtl::PageSize, true));
+    assert(Map.contains(Begin+5*mmtl::PageSize, 11*mmtl::PageSize, true));
+    assert(!Map.contains(Begin, 0));
+
+    release(Memory, Size);
+
+    // Still there until refreshed.
+    assert(Map.contains(Begin, Size));
+    Map.refresh();
+    assert(!Map.contains(Begin, 1));
+}
+
+// Writes to both kinds of regions, and checks that only the written pages are copied, and that
+// every snapshot comes back exactly.
+void test_save_restore(){
+    constexpr std::size_t Pages = 64;
+    constexpr std::size_t Size = Pages*mmtl::PageSize;
+
+    auto Tracked = allocate(Size);
+    auto Compared = allocate(Size);
+
+    for(std::size_t i = 0; i < Pages; ++i){
+        fill(Tracked, i, 1);
+        fill(Compared, i, 2);
+    }
+
+    mmtl::snapshotter Snapshotter([&]{
+        return std::vector<mmtl::region>{
+            make_region(Tracked, Size, mmtl::tracking::Protect),
+            make_region(Compared, Size, mmtl::tracking::Compare),
+        };
+    });
+
+    mmtl::snapshot_stats Stats;
+
+    auto First = Snapshotter.save(&Stats);
+    assert(Stats.Pages == 2*Pages);
+    assert(Stats.Copied == 2*Pages);
+
+    // Nothing written, nothing copied.
+    auto Same = Snapshotter.save(&Stats);
+    assert(Stats.Copied == 0);
+    assert(Same->Chunks == First->Chunks);
+
+    fill(Tracked, 3, 10);
+    fill(Tracked, 40, 11);
+    Tracked[7*mmtl::PageSize+100] = std::byte(12);
+    fill(Compared, 5, 13);
+
+    auto Second = Snapshotter.save(&Stats);
+    assert(Stats.Pages == 2*Pages);
+    assert(Stats.Copied == 4);
+
+    // Writing again after the save must be seen, the page was protected again.
+    fill(Tracked, 3, 20);
+
+    Snapshotter.restore(First, &Stats);
+    assert(Stats.Written == 4);
+    assert(Stats.Missing == 0);
+
+    for(std::size_t i = 0; i < Pages; ++i){
+        assert(page_is(Tracked, i, 1));
+        assert(page_is(Compared, i, 2));
+    }
+
+    Snapshotter.restore(Second, &Stats);
+    assert(Stats.Written == 4);
+    assert(page_is(Tracked, 3, 10));
+    assert(page_is(Tracked, 40, 11));
+    assert(Tracked[7*mmtl::PageSize+100] == std::byte(12));
+    assert(page_is(Compared, 5, 13));
+
+    // Restoring does not count as a write.
+    Snapshotter.save(&Stats);
+    assert(Stats.Copied == 0);
+
+    fill(Tracked, 8, 30);
+
+    Snapshotter.restore(Second, &Stats);
+    assert(Stats.Written == 1);
+    assert(page_is(Tracked, 8, 1));
+
+    Snapshotter.reset();
+
+    release(Tracked, Size);
+    release(Compared, Size);
+}
+
+// Regions appearing and disappearing between snapshots.
+void test_changing_regions(){
+    constexpr std::size_t Pages = 8;
+    constexpr std::size_t Size = Pages*mmtl::PageSize;
+
+    auto a = allocate(Size);
+    auto b = allocate(Size);
+
+    for(std::size_t i = 0; i < Pages; ++i){
+        fill(a, i, 1);
+        fill(b, i, 2);
+    }
+
+    auto UseB = false;
+
+    mmtl::snapshotter Snapshotter([&]{
+        std::vector<mmtl::region> r = {make_region(a, Size, mmtl::tracking::Protect)};
+        if(UseB){
+            r.push_back(make_region(b, Size, mmtl::tracking::Protect));
+        }
+
+        return r;
+    });
+
+    mmtl::snapshot_stats Stats;
+
+    auto First = Snapshotter.save(&Stats);
+    assert(Stats.Pages == Pages);
+
+    UseB = true;
+    fill(a, 0, 3);
+
+    auto Second = Snapshotter.save(&Stats);
+    assert(Stats.Pages == 2*Pages);
+    assert(Stats.Copied == Pages+1);
+
+    fill(b, 1, 4);
+
+    Snapshotter.restore(First, &Stats);
+    assert(page_is(a, 0, 1));
+    // Not part of the first snapshot, so left alone.
+    assert(page_is(b, 1, 4));
+
+    auto Third = Snapshotter.save(&Stats);
+    assert(Stats.Pages == 2*Pages);
+    assert(Third->find(reinterpret_cast<std::uintptr_t>(b)+mmtl::PageSize) != mmtl::page_store::None);
+
+    UseB = false;
+
+    auto Fourth = Snapshotter.save(&Stats);
+    assert(Stats.Pages == Pages);
+    assert(Fourth->find(reinterpret_cast<std::uintptr_t>(b)) == mmtl::page_store::None);
+
+    Snapshotter.restore(Second, &Stats);
+    assert(Stats.Missing == Pages);
+    assert(page_is(a, 0, 3));
+
+    Snapshotter.reset();
+
+    release(a, Size);
+    release(b, Size);
+}
+
+// Identical pages are stored once, and a page is freed with its last reference.
+void test_page_store_dedup(){
+    mmtl::page_store Store({.Compress = false, .SpillDirectory = {}});
+
+    mmtl::page a, b;
+    std::memset(a.Data, 1, mmtl::PageSize);
+    std::memset(b.Data, 1, mmtl::PageSize);
+    b.Data[4000] = std::byte(2);
+
+    assert(mmtl::hash_page(a.Data) != mmtl::hash_page(b.Data));
+
+    auto Ida = Store.insert(a.Data);
+    auto Idb = Store.insert(b.Data);
+    auto Ida2 = Store.insert(a.Data);
+
+    assert(Ida == Ida2);
+    assert(Ida != Idb);
+    assert(Store.equal(Ida, a.Data));
+    assert(!Store.equal(Ida, b.Data));
+
+    auto Stats = Store.stats();
+    assert(Stats.Pages == 2);
+    assert(Stats.References == 3);
+    assert(Stats.MemoryBytes == 2*mmtl::PageSize);
+
+    Store.release(&Ida, 1);
+    assert(Store.stats().Pages == 2);
+
+    Store.release(&Ida2, 1);
+    assert(Store.stats().Pages == 1);
+
+    // Reused once freed.
+    auto Ida3 = Store.insert(a.Data);
+    assert(Ida3 == Ida);
+
+    mmtl::page Out;
+    Store.read(Idb, Out.Data);
+    assert(std::memcmp(Out.Data, b.Data, mmtl::PageSize) == 0);
+
+    Store.release(&Ida3, 1);
+    Store.release(&Idb, 1);
+    assert(Store.stats().Pages == 0);
+    assert(Store.stats().MemoryBytes == 0);
+}
+
+// Pages unused for two passes are compressed, or spilled while over budget, and read back the same.
+void test_page_store_cold(){
+    auto Directory = std::filesystem::temp_directory_path();
+
+    mmtl::page_store Store({.MemoryBudget = 8*mmtl::PageSize, .SpillDirectory = Directory});
+
+    std::mt19937 Rng(1);
+
+    std::vector<mmtl::page> Pages(64);
+    for(std::size_t i = 0; i < Pages.size(); ++i){
+        auto Words = reinterpret_cast<std::uint32_t*>(Pages[i].Data);
+
+        // Half compressible, half random.
+        for(std::size_t j = 0; j < mmtl::PageSize/4; ++j){
+            Words[j] = (i%2 == 0)?static_cast<std::uint32_t>(j/64+i):Rng();
+        }
+    }
+
+    std::vector<mmtl::page_store::id> Ids;
+    for(auto& e:Pages){
+        Ids.push_back(Store.insert(e.Data));
+    }
+
+    Store.trim();
+    Store.trim();
+
+    auto Stats = Store.stats();
+    assert(Stats.Pages == Pages.size());
+    assert(Stats.Compressed > 0);
+    assert(Stats.Spilled > 0);
+    assert(Stats.MemoryBytes <= 8*mmtl::PageSize);
+
+    for(std::size_t i = 0; i < Pages.size(); ++i){
+        mmtl::page Out;
+        Store.read(Ids[i], Out.Data);
+        assert(std::memcmp(Out.Data, Pages[i].Data, mmtl::PageSize) == 0);
+
+        // Finds the stored copy wherever it is.
+        auto Id = Store.insert(Pages[i].Data);
+        assert(Id == Ids[i]);
+        Store.release(&Id, 1);
+    }
+
+    Store.release(Ids.data(), Ids.size());
+
+    Stats = Store.stats();
+    assert(Stats.Pages == 0);
+    assert(Stats.MemoryBytes == 0 && Stats.SpillBytes == 0);
+}
+
+// Snapshots of memory that does not change share every page.
+void test_shared_pages(){
+    constexpr std::size_t Pages = 16;
+    constexpr std::size_t Size = Pages*mmtl::PageSize;
+
+    auto Memory = allocate(Size);
+    for(std::size_t i = 0; i < Pages; ++i){
+        fill(Memory, i, static_cast<int>(i%4));
+    }
+
+    auto Store = std::make_shared<mmtl::page_store>();
+
+    mmtl::snapshotter Snapshotter([&]{
+        return std::vector<mmtl::region>{make_region(Memory, Size, mmtl::tracking::Compare)};
+    }, Store);
+
+    auto a = Snapshotter.save();
+    assert(Store->stats().Pages == 4);
+
+    fill(Memory, 0, 9);
+    auto b = Snapshotter.save();
+    assert(Store->stats().Pages == 5);
+
+    a = nullptr;
+    b = nullptr;
+    Snapshotter.reset();
+    assert(Store->stats().Pages == 0);
+
+    release(Memory, Size);
+}
+
+// Every byte counts, including a trailing partial stripe, and threads make no difference.
+void test_hash_memory(){
+    std::vector<std::byte> Data((std::size_t(3) << 20)+123);
+
+    std::mt19937 Rng(2);
+    for(auto& e:Data){
+        e = std::byte(Rng());
+    }
+
+    auto Hash = mmtl::hash_memory(Data.data(), Data.size());
+
+    work_pool Pool(4);
+    assert(mmtl::hash_memory(Data.data(), Data.size(), &Pool) == Hash);
+
+    Data.back() ^= std::byte(1);
+    assert(mmtl::hash_memory(Data.data(), Data.size(), &Pool) != Hash);
+
+    assert(mmtl::hash_bytes(Data.data(), 100) != mmtl::hash_bytes(Data.data(), 101));
+    assert(mmtl::hash_page(Data.data()) == mmtl::hash_bytes(Data.data(), mmtl::PageSize));
+}
+
+void test_hash_log(){
+    auto Path = std::filesystem::temp_directory_path()/"memtools-test.hashlog";
+    auto Path2 = std::filesystem::temp_directory_path()/"memtools-test2.hashlog";
+
+    {
+        mmtl::hash_log_writer a(Path), b(Path2);
+
+        a.set_regions({"pawn", "controller"});
+        b.set_regions({"controller", "pawn"});
+
+        for(std::uint64_t i = 0; i < 10; ++i){
+            a.write(i, {i, 100+i});
+            b.write(i, {100+i, (i == 7)?0:i});
+        }
+
+        // Flushed frames can be read while the log is still open.
+        a.flush();
+        assert(mmtl::hash_log::read(Path).Frames.size() == 10);
+
+        // Regions only in one of the logs are skipped.
+        a.set_regions({"pawn", "extra"});
+        a.write(10, {10, 1});
+    }
+
+    auto a = mmtl::hash_log::read(Path);
+    auto b = mmtl::hash_log::read(Path2);
+
+    assert(a.Frames.size() == 11);
+    assert(a.Regions.size() == 2);
+    assert(a.Frames[10].Table == 1);
+
+    auto Divergence = mmtl::first_divergence(a, b);
+    assert(Divergence);
+    assert(Divergence->Frame == 7);
+    assert(Divergence->Region == "pawn");
+    assert(Divergence->a == 7 && Divergence->b == 0);
+
+    assert(!mmtl::first_divergence(a, a));
+
+    std::filesystem::remove(Path);
+    std::filesystem::remove(Path2);
+}
+
+void test_watch_plan(){
+    // A fake address space, with reads counted.
+    std::map<std::uintptr_t, std::uint64_t> Memory;
+    std::size_t Reads = 0;
+
+    mmtl::memory_reader Reader = [&](std::uintptr_t Address, void* Out, std::size_t Size){
+        ++Reads;
+
+        auto it = Memory.find(Address);
+        if(it == Memory.end()){
+            return false;
+        }
+
+        std::memcpy(Out, &it->second, Size);
+        return true;
+    };
+
+    // Base -> +0x10 -> object, with a float and an int in it, and a path through a null pointer.
+    Memory[0x1010] = 0x2000;
+    Memory[0x2008] = 0x4048F5C3;
+    Memory[0x2010] = 42;
+    Memory[0x1020] = 0;
+
+    mmtl::watch_plan Plan({
+        {"a", 0x1000, {0x10, 0x8}, mmtl::value_type::F32},
+        {"b", 0x1000, {0x10, 0x10}, mmtl::value_type::U8},
+        {"c", 0x1000, {0x20, 0x0}, mmtl::value_type::I64},
+        {"d", 0x1010, {0x0}, mmtl::value_type::Pointer},
+    });
+
+    assert(Plan.pointer_count() == 2);
+
+    for(std::size_t i = 0; i < 4; ++i){
+        auto Size = (i == 0)?4:(i == 1)?1:8;
+        assert(Plan.value_offset(i)%Size == 0);
+        assert(Plan.valid_offset(i) < Plan.size());
+    }
+
+    std::vector<std::byte> Out(Plan.size());
+
+    auto get = [&](std::size_t i, auto Value){
+        std::memcpy(&Value, Out.data()+Plan.value_offset(i), sizeof(Value));
+        return Value;
+    };
+
+    auto valid = [&](std::size_t i){
+        return Out[Plan.valid_offset(i)] == std::byte(1);
+    };
+
+    Plan.read(Out.data(), Reader);
+
+    assert(valid(0) && get(0, 0.0f) == 3.14f);
+    assert(valid(1) && get(1, std::uint8_t()) == 42);
+    assert(!valid(2) && get(2, std::int64_t()) == 0);
+    assert(valid(3) && get(3, std::uintptr_t()) == 0x2000);
+
+    // Resolved pointers are cached, only the values and the null pointer are read again.
+    Reads = 0;
+    Plan.read(Out.data(), Reader);
+    assert(Reads == 4);
+
+    // The null pointer is picked up once it is set.
+    Memory[0x1020] = 0x3000;
+    Memory[0x3000] = 7;
+    Plan.read(Out.data(), Reader);
+    assert(valid(2) && get(2, std::int64_t()) == 7);
+
+    Reads = 0;
+    Plan.read(Out.data(), Reader);
+    assert(Reads == 4);
+
+    // A moved object is only seen after invalidating.
+    Memory[0x1010] = 0x5000;
+    Memory[0x5008] = 0;
+    Plan.read(Out.data(), Reader);
+    assert(get(0, 0.0f) == 3.14f);
+
+    Plan.invalidate();
+    Plan.read(Out.data(), Reader);
+    assert(valid(0) && get(0, 0.0f) == 0.0f);
+    assert(!valid(1));
+
+    assert(mmtl::parse_value_type("f64") == mmtl::value_type::F64);
+    assert(!mmtl::parse_value_type("f16"));
+}
+
+void test_trace(){
+    auto Path = std::filesystem::temp_directory_path()/"memtools-test.trace";
+
+    struct row {
+        double Time;
+        float Position[3];
+        std::int32_t Health;
+        std::uint8_t Flag;
+    };
+
+    std::vector<mmtl::trace_column> Columns = {
+        {"time", mmtl::value_type::F64, offsetof(row, Time)},
+        {"x", mmtl::value_type::F32, offsetof(row, Position)},
+        {"y", mmtl::value_type::F32, offsetof(row, Position)+4},
+        {"z", mmtl::value_type::F32, offsetof(row, Position)+8},
+        {"health", mmtl::value_type::I32, offsetof(row, Health)},
+        {"flag", mmtl::value_type::U8, offsetof(row, Flag)},
+    };
+
+    std::vector<row> Rows;
+    std::vector<std::uint64_t> Frames;
+
+    std::mt19937 Random(5);
+    for(std::size_t i = 0; i < 2500; ++i){
+        row r = {};
+        r.Time = i/60.0;
+        r.Position[0] = static_cast<float>(Random()%1000);
+        r.Position[1] = 12.5f;
+        r.Position[2] = (i < 1000)?0.0f:static_cast<float>(i);
+        r.Health = 100-static_cast<std::int32_t>(i/500);
+        r.Flag = (i%7 == 0);
+        Rows.push_back(r);
+
+        // A load jumps back.
+        Frames.push_back((i < 2000)?i:i-500);
+    }
+
+    {
+        mmtl::trace_writer Writer(Path, Columns, 1000);
+        for(std::size_t i = 0; i < Rows.size(); ++i){
+            Writer.write(Frames[i], reinterpret_cast<const std::byte*>(&Rows[i]));
+        }
+    }
+
+    // Constant columns cost next to nothing.
+    assert(std::filesystem::file_size(Path) < Rows.size()*sizeof(row)/2);
+
+    mmtl::trace_reader Reader(Path);
+    assert(Reader.frame_count() == Rows.size());
+    assert(Reader.columns().size() == Columns.size());
+    assert(Reader.frames() == Frames);
+
+    auto x = Reader.column_as<float>(*Reader.find("x"));
+    auto Time = Reader.column_as<double>(*Reader.find("time"));
+    auto Health = Reader.column_as<std::int32_t>(*Reader.find("health"));
+    auto Flag = Reader.column(*Reader.find("flag"));
+
+    for(std::size_t i = 0; i < Rows.size(); ++i){
+        assert(x[i] == Rows[i].Position[0]);
+        assert(Time[i] == Rows[i].Time);
+        assert(Health[i] == Rows[i].Health);
+        assert(Flag[i] == std::byte(Rows[i].Flag));
+    }
+
+    assert(!Reader.find("w"));
+
+    // Losing the end of the file loses the last block.
+    std::filesystem::resize_file(Path, std::filesystem::file_size(Path)-1);
+    assert(mmtl::trace_reader(Path).frame_count() == 2000);
+
+    // Pointers are as wide as in the writer.
+    struct pointer_row {
+        std::uintptr_t Object;
+        std::uint32_t Id;
+    };
+
+    {
+        std::vector<mmtl::trace_column> PointerColumns = {
+            {"object", mmtl::value_type::Pointer, offsetof(pointer_row, Object)},
+            {"id", mmtl::value_type::U32, offsetof(pointer_row, Id)},
+        };
+
+        mmtl::trace_writer Writer(Path, PointerColumns, 1000);
+        for(std::uint32_t i = 0; i < 10; ++i){
+            pointer_row r = {0x1000+i*0x10, i};
+            Writer.write(i, reinterpret_cast<const std::byte*>(&r));
+        }
+    }
+
+    {
+        mmtl::trace_reader PointerReader(Path);
+        assert(PointerReader.column_size(0) == sizeof(std::uintptr_t));
+
+        auto Object = PointerReader.column_as<std::uintptr_t>(0);
+        auto Id = PointerReader.column_as<std::uint32_t>(1);
+        for(std::uint32_t i = 0; i < 10; ++i){
+            assert(Object[i] == 0x1000+i*0x10);
+            assert(Id[i] == i);
+        }
+    }
+
+    // As written by the 32-bit hook, whatever the reader is.
+    {
+        std::vector<mmtl::trace_column> NarrowColumns = {
+            {"object", mmtl::value_type::U32, 0},
+            {"id", mmtl::value_type::U32, 4},
+        };
+
+        mmtl::trace_writer Writer(Path, NarrowColumns, 1000);
+        for(std::uint32_t i = 0; i < 10; ++i){
+            std::uint32_t r[2] = {0x1000+i*0x10, i};
+            Writer.write(i, reinterpret_cast<const std::byte*>(r));
+        }
+    }
+
+    {
+        // The pointer size follows the magic, the first column's type the column count.
+        std::fstream File(Path, std::ios::binary|std::ios::in|std::ios::out);
+        File.seekp(8);
+        File.put(4);
+        File.seekp(13);
+        File.put(static_cast<char>(mmtl::value_type::Pointer));
+    }
+
+    {
+        mmtl::trace_reader NarrowReader(Path);
+        assert(NarrowReader.columns()[0].Type == mmtl::value_type::Pointer);
+        assert(NarrowReader.column_size(0) == 4);
+
+        auto Object = NarrowReader.column_as<std::uint32_t>(0);
+        auto Id = NarrowReader.column_as<std::uint32_t>(1);
+        for(std::uint32_t i = 0; i < 10; ++i){
+            assert(Object[i] == 0x1000+i*0x10);
+            assert(Id[i] == i);
+        }
+    }
+
+    std::filesystem::remove(Path);
+}
+
+// Runs the same scans with and without the SIMD kernel and with and without threads, and checks
+// every one against a brute force search.
+void test_scanner(){
+    constexpr std::size_t Size = 64*mmtl::PageSize+mmtl::scanner::BlockSize;
+
+    auto Memory = allocate(Size);
+    auto Base = reinterpret_cast<std::uintptr_t>(Memory);
+
+    std::vector<mmtl::region> Regions = {{Base, Size, Base, 0}};
+
+    work_pool Pool(4);
+
+    for(auto Threads:{false, true}){
+        for(auto Simd:{false, true}){
+            std::mt19937 Random(9);
+            for(std::size_t i = 0; i < Size; ++i){
+                Memory[i] = std::byte(Random()%4);
+            }
+
+            auto Values = reinterpret_cast<std::uint32_t*>(Memory);
+            auto Count = Size/4;
+
+            auto check = [&](mmtl::scanner& Scanner, auto&& Pred){
+                std::vector<std::uintptr_t> Expected;
+                for(std::size_t i = 0; i < Count; ++i){
+                    if(Pred(i)){
+                        Expected.push_back(Base+i*4);
+                    }
+                }
+
+                auto Results = Scanner.results(Count);
+                assert(Scanner.count() == Expected.size());
+                assert(Results.size() == Expected.size());
+
+                for(std::size_t i = 0; i < Results.size(); ++i){
+                    assert(Results[i].Address == Expected[i]);
+                    assert(Results[i].Value == *reinterpret_cast<const std::uint32_t*>(Expected[i]));
+                }
+            };
+
+            mmtl::scanner Scanner(Threads?&Pool:nullptr, Simd);
+
+            // Unknown, then narrowed down while values change.
+            Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Unknown);
+            assert(Scanner.count() == Count);
+
+            std::vector<std::uint32_t> Old(Values, Values+Count);
+            for(std::size_t i = 0; i < Count; i += 3){
+                Values[i] += (i%2)?1:-1;
+            }
+
+            Scanner.next_scan(mmtl::scan_compare::Changed);
+            check(Scanner, [&](std::size_t i){ return Values[i] != Old[i]; });
+
+            Scanner.next_scan(mmtl::scan_compare::Unchanged);
+            check(Scanner, [&](std::size_t i){ return Values[i] != Old[i]; });
+
+            std::vector<std::uint32_t> Changed(Values, Values+Count);
+            for(std::size_t i = 0; i < Count; i += 2){
+                Values[i] *= 2;
+            }
+
+            Scanner.next_scan(mmtl::scan_compare::Increased);
+            check(Scanner, [&](std::size_t i){ return Changed[i] != Old[i] && Values[i] > Changed[i]; });
+
+            // Exact, on a dense block too.
+            auto Value = Values[7];
+            Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Exact, Value);
+            check(Scanner, [&](std::size_t i){ return Values[i] == Value; });
+
+            Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Unknown);
+            Scanner.next_scan(mmtl::scan_compare::Exact, Value);
+            check(Scanner, [&](std::size_t i){ return Values[i] == Value; });
+
+            Scanner.next_scan(mmtl::scan_compare::Decreased);
+            assert(Scanner.count() == 0);
+
+            // Every value size.
+            for(auto Type:{mmtl::value_type::U8, mmtl::value_type::I16, mmtl::value_type::F64}){
+                auto n = mmtl::value_size(Type);
+
+                std::uint64_t Needle = 0;
+                std::memcpy(&Needle, Memory+n*5, n);
+
+                Scanner.first_scan(Regions, Type, mmtl::scan_compare::Exact, Needle);
+
+                std::size_t Expected = 0;
+                for(std::size_t i = 0; i < Size/n; ++i){
+                    Expected += (std::memcmp(Memory+i*n, &Needle, n) == 0);
+                }
+
+                assert(Scanner.count() == Expected);
+            }
+        }
+    }
+
+    assert(mmtl::parse_scan_compare("unchanged") == mmtl::scan_compare::Unchanged);
+    assert(!mmtl::parse_scan_compare("same"));
+
+    // Regions freed after they were listed are skipped, if the map is newer.
+    {
+        auto Freed = allocate(mmtl::scanner::BlockSize);
+        auto FreedBase = reinterpret_cast<std::uintptr_t>(Freed);
+        release(Freed, mmtl::scanner::BlockSize);
+
+        std::vector<mmtl::region> Stale = {{Base, Size, Base, 0}, {FreedBase, mmtl::scanner::BlockSize, FreedBase, 0}};
+
+        mmtl::readable_map Map;
+        Map.refresh();
+
+        mmtl::scanner Scanner;
+        Scanner.first_scan(Stale, mmtl::value_type::U32, mmtl::scan_compare::Unknown, 0, &Map);
+        assert(Scanner.count() == Size/4);
+    }
+
+    // An unknown scan over the limit throws before it copies anything, and keeps the last results.
+    {
+        mmtl::scanner Scanner;
+        Scanner.set_memory_limit(Size);
+
+        Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Exact, 1);
+        auto Count = Scanner.count();
+        assert(Count != 0);
+
+        bool Thrown = false;
+        try {
+            Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Unknown);
+        }catch(std::length_error&){
+            Thrown = true;
+        }
+
+        assert(Thrown);
+        assert(Scanner.count() == Count && Scanner.memory_usage() < Size);
+
+        Scanner.set_memory_limit(2*Size);
+        Scanner.first_scan(Regions, mmtl::value_type::U32, mmtl::scan_compare::Unknown);
+        assert(Scanner.count() == Size/4);
+    }
+
+    release(Memory, Size);
+}
+
+void test_signatures(){
+    auto Sig = mmtl::signature::parse("55 8b EC ?? e8");
+    assert(Sig.size() == 5);
+    assert(Sig.to_string() == "55 8B EC ?? E8");
+
+    for(auto Bad:{"", "?? 55 ?? 8B", "55 8", "55 XY"}){
+        bool Threw = false;
+        try {
+            mmtl::signature::parse(Bad);
+        }catch(const std::invalid_argument&){
+            Threw = true;
+        }
+        assert(Threw);
+    }
+
+    std::vector<std::byte> Data(1 << 20);
+
+    std::mt19937 Random(3);
+    for(auto& e:Data){
+        e = std::byte(Random());
+    }
+
+    // Patterns taken from the data, with wildcards in between, at the very start and end too.
+    std::vector<mmtl::signature> Signatures;
+    for(std::size_t Offset:{std::size_t(0), std::size_t(12345), std::size_t(777777), Data.size()-9}){
+        mmtl::signature e;
+        for(std::size_t i = 0; i < 9; ++i){
+            e.Bytes.push_back(std::to_integer<std::uint8_t>(Data[Offset+i]));
+            e.Mask.push_back((i%3 == 2)?0:0xFF);
+        }
+        Signatures.push_back(e);
+    }
+
+    // Common enough to match twice, and one that cannot match.
+    Signatures.push_back(mmtl::signature::parse(Signatures[1].to_string().substr(0, 5)));
+    Signatures.push_back(mmtl::signature::parse("01 02 03 04 05 06 07 08 09 0A"));
+
+    auto Matches = mmtl::find_signatures(Data.data(), Data.size(), Signatures);
+    assert(Matches.size() == Signatures.size());
+    assert(Matches[0].Count == 1 && Matches[0].Offset == 0);
+    assert(Matches[1].Count == 1 && Matches[1].Offset == 12345);
+    assert(Matches[2].Count == 1 && Matches[2].Offset == 777777);
+    assert(Matches[3].Count == 1 && Matches[3].Offset == Data.size()-9);
+    assert(Matches[4].Count == 2);
+    assert(Matches[5].Count == 0);
+
+    // Made signatures find where they were made from, skipping volatile bytes.
+    std::vector<bool> Volatile(Data.size());
+    for(std::size_t i = 1000; i < 1004; ++i){
+        Volatile[i] = true;
+    }
+
+    // Needs two fixed bytes in a row, so at least up to 1006.
+    auto Made = mmtl::make_signature(Data.data(), Data.size(), 999, Volatile);
+    assert(Made && Made->size() >= 7 && Made->Mask[1] == 0 && Made->Mask[6] == 0xFF);
+
+    Matches = mmtl::find_signatures(Data.data(), Data.size(), {*Made});
+    assert(Matches[0].Count == 1 && Matches[0].Offset == 999);
+
+    // Nothing unique in a run of the same byte.
+    std::fill(Data.begin()+5000, Data.begin()+5200, std::byte(0xCC));
+    assert(!mmtl::make_signature(Data.data(), Data.size(), 5010, Volatile));
+}
+
+// Lengths checked against a disassembler.
+void test_decode_x86(){
+    struct instruction {
+        std::vector<std::uint8_t> Bytes;
+        mmtl::x86_flow Flow;
+    };
+
+    std::vector<instruction> Instructions = {
+        // push ebp; mov ebp, esp; sub esp, 0x10
+        {{0x55}, mmtl::x86_flow::None},
+        {{0x8B, 0xEC}, mmtl::x86_flow::None},
+        {{0x83, 0xEC, 0x10}, mmtl::x86_flow::None},
+        // mov eax, [esp+ecx*4+0x12345678]; mov dword [ebp-4], 1; lea eax, [eax+eax*2]
+        {{0x8B, 0x84, 0x8C, 0x78, 0x56, 0x34, 0x12}, mmtl::x86_flow::None},
+        {{0xC7, 0x45, 0xFC, 0x01, 0x00, 0x00, 0x00}, mmtl::x86_flow::None},
+        {{0x8D, 0x04, 0x40}, mmtl::x86_flow::None},
+        // mov ax, 0x1234; test byte [eax], 1; test dword [eax], 1; mov eax, fs:[0]
+        {{0x66, 0xB8, 0x34, 0x12}, mmtl::x86_flow::None},
+        {{0xF6, 0x00, 0x01}, mmtl::x86_flow::None},
+        {{0xF7, 0x00, 0x01, 0x00, 0x00, 0x00}, mmtl::x86_flow::None},
+        {{0x64, 0xA1, 0x00, 0x00, 0x00, 0x00}, mmtl::x86_flow::None},
+        // movss xmm0, [eax+8]; pshufd xmm0, xmm1, 0; vxorps ymm0, ymm0, ymm0; rep movsd
+        {{0xF3, 0x0F, 0x10, 0x40, 0x08}, mmtl::x86_flow::None},
+        {{0x66, 0x0F, 0x70, 0xC1, 0x00}, mmtl::x86_flow::None},
+        {{0xC5, 0xFC, 0x57, 0xC0}, mmtl::x86_flow::None},
+        {{0xF3, 0xA5}, mmtl::x86_flow::None},
+        // fld dword [eax]; enter 8, 0
+        {{0xD9, 0x00}, mmtl::x86_flow::None},
+        {{0xC8, 0x08, 0x00, 0x00}, mmtl::x86_flow::None},
+        // call rel32; call [eax+4]; jmp rel8; jne rel32; jmp [eax*4+table]
+        {{0xE8, 0x00, 0x01, 0x00, 0x00}, mmtl::x86_flow::Call},
+        {{0xFF, 0x50, 0x04}, mmtl::x86_flow::IndirectCall},
+        {{0xEB, 0xFE}, mmtl::x86_flow::Jump},
+        {{0x0F, 0x85, 0x10, 0x00, 0x00, 0x00}, mmtl::x86_flow::Branch},
+        {{0xFF, 0x24, 0x85, 0x00, 0x10, 0x40, 0x00}, mmtl::x86_flow::IndirectJump},
+        // ret 8; int3; ud2
+        {{0xC2, 0x08, 0x00}, mmtl::x86_flow::Return},
+        {{0xCC}, mmtl::x86_flow::Stop},
+        {{0x0F, 0x0B}, mmtl::x86_flow::Stop},
+    };
+
+    for(auto& e:Instructions){
+        auto Code = reinterpret_cast<const std::byte*>(e.Bytes.data());
+
+        auto Decoded = mmtl::decode_x86(Code, e.Bytes.size(), 0x401000);
+        assert(Decoded.Length == e.Bytes.size() && Decoded.Flow == e.Flow);
+
+        // Cut short.
+        assert(mmtl::decode_x86(Code, e.Bytes.size()-1, 0x401000).Length == 0);
+    }
+
+    auto Call = mmtl::decode_x86(reinterpret_cast<const std::byte*>(Instructions[16].Bytes.data()), 5, 0x401000);
+    assert(Call.Target == 0x401105);
+
+    auto Table = mmtl::decode_x86(reinterpret_cast<const std::byte*>(Instructions[20].Bytes.data()), 7, 0x401000);
+    assert(Table.HasDisplacement && Table.Displacement == 0x401000 && !Table.HasBase && Table.Scale == 4);
+
+    auto Indexed = mmtl::decode_x86(reinterpret_cast<const std::byte*>(Instructions[3].Bytes.data()), 7, 0x401000);
+    assert(Indexed.HasDisplacement && Indexed.Displacement == 0x12345678 && Indexed.HasBase);
+
+    auto Immediate = mmtl::decode_x86(reinterpret_cast<const std::byte*>(Instructions[4].Bytes.data()), 7, 0x401000);
+    assert(Immediate.HasImmediate && Immediate.Immediate == 1 && !Immediate.HasDisplacement);
+}
+
+// A minimal 32 bit image based at 0x400000, laid out the same on disk as in memory, with `Code` at
+// 0x1000, `Data` at 0x2000 and relocations of `Relocations` at 0x3000.
+std::vector<std::byte> make_image(const std::vector<std::uint8_t>& Code, const std::vector<std::uint8_t>& Data,
+        const std::vector<std::uint32_t>& Relocations, std::uint32_t EntryPoint){
+    std::vector<std::byte> r(0x4000);
+
+    auto put = [&](std::size_t Offset, auto Value){
+        std::memcpy(r.data()+Offset, &Value, sizeof(Value));
+    };
+
+    put(0, std::uint16_t(0x5A4D));
+    put(0x3C, std::uint32_t(0x80));
+    put(0x80, std::uint32_t(0x4550));
+
+    auto Optional = 0x80+4+20;
+    put(0x80+4+2, std::uint16_t(3));
+    put(0x80+4+4, std::uint32_t(0x12345678));
+    put(0x80+4+16, std::uint16_t(224));
+    put(Optional, std::uint16_t(0x10B));
+    put(Optional+16, EntryPoint);
+    put(Optional+28, std::uint32_t(0x400000));
+    put(Optional+56, std::uint32_t(0x4000));
+    put(Optional+92, std::uint32_t(16));
+
+    auto Section = Optional+224;
+    for(auto [Name, Rva, Flags]:{
+        std::tuple(".text", 0x1000u, 0x60000020u), std::tuple(".rdata", 0x2000u, 0x40000040u), std::tuple(".reloc", 0x3000u, 0x42000040u),
+    }){
+        std::memcpy(r.data()+Section, Name, std::strlen(Name));
+        put(Section+8, std::uint32_t(0x1000));
+        put(Section+12, Rva);
+        put(Section+16, std::uint32_t(0x1000));
+        put(Section+20, Rva);
+        put(Section+36, Flags);
+        Section += 40;
+    }
+
+    std::memcpy(r.data()+0x1000, Code.data(), Code.size());
+    std::memcpy(r.data()+0x2000, Data.data(), Data.size());
+
+    // A block for every page, padded to a multiple of 4 bytes.
+    std::size_t Offset = 0x3000;
+    for(std::uint32_t Page = 0x1000; Page < 0x3000; Page += 0x1000){
+        std::vector<std::uint16_t> Entries;
+        for(auto e:Relocations){
+            if(e/0x1000*0x1000 == Page){
+                Entries.push_back(static_cast<std::uint16_t>(0x3000|(e-Page)));
+            }
+        }
+
+        if(Entries.size()%2 != 0){
+            Entries.push_back(0);
+        }
+
+        put(Offset, Page);
+        put(Offset+4, static_cast<std::uint32_t>(8+Entries.size()*2));
+        std::memcpy(r.data()+Offset+8, Entries.data(), Entries.size()*2);
+        Offset += 8+Entries.size()*2;
+    }
+
+    put(Optional+96+5*8, std::uint32_t(0x3000));
+    put(Optional+96+5*8+4, static_cast<std::uint32_t>(Offset-0x3000));
+
+    return r;
+}
+
+void test_pe_image(){
+    auto Data = make_image({}, {}, {0x1024, 0x1010, 0x2000}, 0x1010);
+
+    for(auto Mapped:{false, true}){
+        mmtl::pe_image Image(Data.data(), Data.size(), Mapped);
+        assert(!Image.Is64 && Image.ImageBase == 0x400000 && Image.EntryPoint == 0x1010);
+        assert(Image.TimeDateStamp == 0x12345678 && Image.Sections.size() == 3);
+
+        auto Text = Image.find_section(".text");
+        assert(Text && Text->executable() && Image.section_at(0x1FFF) == Text);
+        assert(!Image.find_section(".rdata")->executable());
+        assert(Image.data(*Text) == Data.data()+0x1000 && Image.size(*Text) == 0x1000);
+        assert(Image.at(0x1FF0, 16) && !Image.at(0x1FF0, 17) && !Image.at(0x3FF0, 17) && !Image.at(0x4000, 1));
+
+        auto Relocations = Image.relocations();
+        assert(Relocations.size() == 3);
+        assert(Relocations[0].Rva == 0x1010 && Relocations[1].Rva == 0x1024 && Relocations[1].Size == 4);
+        assert(Relocations[2].Rva == 0x2000);
+    }
+
+    bool Threw = false;
+    try {
+        mmtl::pe_image(Data.data()+1, Data.size()-1, false);
+    }catch(const std::runtime_error&){
+        Threw = true;
+    }
+    assert(Threw);
+}
+
+// A few functions reached in every way the index follows: calls, a conditional branch, a switch
+// table, a thunk, and a virtual function table.
+void test_code_index(){
+    std::vector<std::uint8_t> Code(0x100, 0xCC);
+    std::vector<std::uint8_t> Data(0x100);
+
+    auto put = [](std::vector<std::uint8_t>& Out, std::uint32_t Offset, std::initializer_list<std::uint8_t> Bytes){
+        std::copy(Bytes.begin(), Bytes.end(), Out.begin()+Offset);
+    };
+
+    auto put32 = [](std::vector<std::uint8_t>& Out, std::uint32_t Offset, std::uint32_t Value){
+        std::memcpy(Out.data()+Offset, &Value, 4);
+    };
+
+    // push ebp; mov ebp, esp; push "Hello world"; call 0x1040; add esp, 4; test eax, eax; je +5;
+    // call 0x1060; pop ebp; ret
+    put(Code, 0x00, {0x55, 0x8B, 0xEC, 0x68});
+    put32(Code, 0x04, 0x402000);
+    put(Code, 0x08, {0xE8});
+    put32(Code, 0x09, 0x1040-0x100D);
+    put(Code, 0x0D, {0x83, 0xC4, 0x04, 0x85, 0xC0, 0x74, 0x05, 0xE8});
+    put32(Code, 0x15, 0x1060-0x1019);
+    put(Code, 0x19, {0x5D, 0xC3});
+
+    // jmp [eax*4+0x401048], to either mov eax, 1; ret or xor eax, eax; ret, with the table after
+    // the function as MSVC does
+    put(Code, 0x40, {0xFF, 0x24, 0x85});
+    put32(Code, 0x43, 0x401048);
+    put32(Code, 0x48, 0x401050);
+    put32(Code, 0x4C, 0x401056);
+    put(Code, 0x50, {0xB8, 0x01, 0x00, 0x00, 0x00, 0xC3, 0x33, 0xC0, 0xC3});
+
+    // jmp 0x1080
+    put(Code, 0x60, {0xE9});
+    put32(Code, 0x61, 0x1080-0x1065);
+
+    // mov eax, [0x402020]; ret
+    put(Code, 0x80, {0xA1});
+    put32(Code, 0x81, 0x402020);
+    put(Code, 0x85, {0xC3});
+
+    // push L"Wide"; call 0x1080; ret
+    put(Code, 0xA0, {0x68});
+    put32(Code, 0xA1, 0x402040);
+    put(Code, 0xA5, {0xE8});
+    put32(Code, 0xA6, 0x1080-0x10AA);
+    put(Code, 0xAA, {0xC3});
+
+    put(Data, 0x00, {'H', 'e', 'l', 'l', 'o', ' ', 'w', 'o', 'r', 'l', 'd', 0});
+    put32(Data, 0x30, 0x4010A0);
+    put(Data, 0x40, {'W', 0, 'i', 0, 'd', 0, 'e', 0, 0, 0});
+
+    auto Image = make_image(Code, Data, {0x1004, 0x1043, 0x1048, 0x104C, 0x1081, 0x10A1, 0x2030}, 0x1000);
+
+    auto Path = std::filesystem::temp_directory_path()/"memtools-test.index";
+
+    work_pool Pool(4);
+
+    for(auto Threads:{false, true}){
+        auto Stats = mmtl::build_code_index(mmtl::pe_image(Image.data(), Image.size(), false), Path, Threads?&Pool:nullptr);
+        assert(Stats.Functions == 5 && Stats.Strings == 2);
+
+        mmtl::code_index Index(Path);
+        assert(Index.timestamp() == 0x12345678 && Index.image_size() == 0x4000);
+
+        auto Functions = Index.functions();
+        assert(Functions.size() == 5);
+
+        std::uint32_t Expected[][2] = {{0x1000, 0x101B}, {0x1040, 0x1059}, {0x1060, 0x1065}, {0x1080, 0x1086}, {0x10A0, 0x10AB}};
+        for(std::size_t i = 0; i < 5; ++i){
+            assert(Functions[i].Start == Expected[i][0] && Functions[i].End == Expected[i][1]);
+        }
+
+        assert(Index.function_at(0x1057)->Start == 0x1040);
+        assert(!Index.function_at(0x1070) && !Index.function_at(0xFFF));
+
+        assert((Index.callers(0x1080) == std::vector<std::uint32_t>{0x1060, 0x10A0}));
+        assert((Index.callers(0x1040) == std::vector<std::uint32_t>{0x1000}));
+        assert(Index.callers(0x1000).empty());
+
+        auto Global = Index.references_to(0x2020);
+        assert(Global.size() == 1 && Global[0].From == 0x1080 && Global[0].Kind == mmtl::xref_kind::Data);
+
+        auto From = Index.references_from(0x1000, 0x101B);
+        assert(From.size() == 3 && From[0].To == 0x2000 && From[1].To == 0x1040 && From[2].To == 0x1060);
+
+        assert(Index.string_at(0x2000) == "Hello world" && Index.string_at(0x2040) == "Wide");
+        assert(Index.string_at(0x2030).empty());
+        assert((Index.functions_referencing("o w") == std::vector<std::uint32_t>{0x1000}));
+        assert((Index.functions_referencing("Wid") == std::vector<std::uint32_t>{0x10A0}));
+        assert(Index.functions_referencing("Nothing").empty());
+    }
+
+    std::filesystem::remove(Path);
+}
+
+void test_ue3_reflection(){
+    constexpr std::uintptr_t Base = 0x100000;
+    std::vector<std::byte> Memory(0x10000);
+
+    auto reader = [&](std::uintptr_t Address, void* Out, std::size_t Size){
+        if(Address < Base || Address-Base > Memory.size() || Size > Memory.size()-(Address-Base)){
+            return false;
+        }
+
+        std::memcpy(Out, Memory.data()+(Address-Base), Size);
+        return true;
+    };
+
+    auto put = [&]<typename T>(std::uintptr_t Address, T Value){
+        std::memcpy(Memory.data()+(Address-Base), &Value, sizeof(Value));
+    };
+
+    // Room for 64 bit pointers.
+    mmtl::ue3_layout Layout = {
+        .ObjectIndex = 0x08,
+        .ObjectOuter = 0x10,
+        .ObjectName = 0x18,
+        .ObjectClass = 0x20,
+        .FieldNext = 0x28,
+        .StructSuper = 0x30,
+        .StructChildren = 0x38,
+        .PropertyArrayDim = 0x30,
+        .PropertyElementSize = 0x34,
+        .PropertyOffset = 0x38,
+        .PropertyExtra = 0x40,
+        .NameEntryIndex = 0x08,
+        .NameEntryText = 0x10,
+    };
+
+    constexpr std::uintptr_t ObjectsTable = Base+0x40, NamesTable = Base+0x80;
+    constexpr std::uintptr_t ObjectsData = Base+0x100, NamesData = Base+0x200;
+
+    auto put_array = [&](std::uintptr_t Address, std::uintptr_t Data, std::int32_t Count){
+        put(Address, Data);
+        put(Address+sizeof(std::uintptr_t), Count);
+        put(Address+sizeof(std::uintptr_t)+4, std::int32_t(32));
+    };
+
+    const char* Names[] = {
+        "None", "ByteProperty", "Core", "Package", "Class", "Engine", "Actor", "Pawn", "FloatProperty",
+        "IntProperty", "Location", "Health", "Default__Pawn", "MyPawn",
+    };
+
+    for(std::int32_t i = 0; i < 14; ++i){
+        auto Entry = Base+0x8000+i*0x40;
+        put(NamesData+i*sizeof(std::uintptr_t), Entry);
+
+        // The last one is wide.
+        auto Wide = (i == 13);
+        put(Entry+Layout.NameEntryIndex, i*2+(Wide?1:0));
+        for(std::size_t c = 0; Names[i][c]; ++c){
+            if(Wide){
+                put(Entry+Layout.NameEntryText+c*2, static_cast<char16_t>(Names[i][c]));
+            }else{
+                put(Entry+Layout.NameEntryText+c, Names[i][c]);
+            }
+        }
+    }
+
+    put_array(NamesTable, NamesData, 14);
+
+    auto object = [&](std::int32_t Slot, std::int32_t Name, std::int32_t Number, std::int32_t Outer, std::int32_t Class){
+        auto Object = Base+0x1000+Slot*0x100;
+        put(ObjectsData+Slot*sizeof(std::uintptr_t), Object);
+        put(Object+Layout.ObjectIndex, Slot);
+        put(Object+Layout.ObjectOuter, (Outer < 0)?std::uintptr_t(0):Base+0x1000+Outer*0x100);
+        put(Object+Layout.ObjectName, Name);
+        put(Object+Layout.ObjectName+4, Number);
+        put(Object+Layout.ObjectClass, Base+0x1000+Class*0x100);
+        return Object;
+    };
+
+    auto property = [&](std::uintptr_t Property, std::uint32_t Offset, std::uint32_t ArrayDim){
+        put(Property+Layout.PropertyArrayDim, ArrayDim);
+        put(Property+Layout.PropertyElementSize, std::uint32_t(4));
+        put(Property+Layout.PropertyOffset, Offset);
+    };
+
+    object(0, 2, 0, -1, 1);
+    object(1, 3, 0, 0, 2);
+    object(2, 4, 0, 0, 2);
+    object(3, 5, 0, -1, 1);
+    auto Actor = object(4, 6, 0, 3, 2);
+    auto Pawn = object(5, 7, 0, 3, 2);
+    auto Location = object(6, 10, 0, 4, 8);
+    auto Health = object(7, 11, 0, 5, 9);
+    object(8, 8, 0, 0, 2);
+    object(9, 9, 0, 0, 2);
+    object(10, 12, 0, 3, 5);
+    auto MyPawn = object(11, 13, 2, 3, 5);
+
+    put(Actor+Layout.StructChildren, Location);
+    put(Pawn+Layout.StructChildren, Health);
+    put(Pawn+Layout.StructSuper, Actor);
+    property(Location, 0x100, 3);
+    property(Health, 0x200, 1);
+
+    put_array(ObjectsTable, ObjectsData, 12);
+
+    mmtl::ue3_reflection Reflection(reader, Layout);
+
+    std::vector<mmtl::region> Regions = {{.Base = Base, .Size = Memory.size(), .AllocationBase = Base, .Protect = 0}};
+    assert(Reflection.locate(Regions));
+    assert(Reflection.objects_table() == ObjectsTable && Reflection.names_table() == NamesTable);
+
+    assert(Reflection.refresh() == 12 && Reflection.object_count() == 12);
+    assert(Reflection.name(13) == "MyPawn" && Reflection.name(14).empty());
+    assert(Reflection.find_name("Health") == 11 && Reflection.find_name("MyPawn") == 13 && Reflection.find_name("Velocity") == -1);
+
+    assert(Reflection.path(MyPawn) == "Engine.MyPawn_1" && Reflection.path(Base).empty());
+    assert(Reflection.find_object("Engine.Pawn") == Pawn && Reflection.find_object("Core.Class") == Base+0x1200);
+    assert(Reflection.class_of(MyPawn) == Pawn);
+    assert((Reflection.find_instances("Pawn") == std::vector<std::uintptr_t>{MyPawn}));
+
+    auto Found = Reflection.find_property(Pawn, "Location");
+    assert(Found && Found->Type == "FloatProperty" && Found->Offset == 0x100 && Found->ArrayDim == 3);
+    assert(Reflection.find_property(Pawn, "Health")->Offset == 0x200);
+    assert(!Reflection.find_property(Pawn, "Velocity") && !Reflection.find_property(Actor, "Health"));
+
+    auto Properties = Reflection.properties(Pawn);
+    assert(Properties.size() == 2 && Properties[0].Name == "Health" && Properties[1].Name == "Location");
+
+    // A level load, freeing one object and putting another in its slot, and adding one more.
+    std::memset(Memory.data()+(MyPawn-Base), 0, 0x100);
+    auto NewPawn = object(16, 13, 0, 3, 5);
+    put(ObjectsData+11*sizeof(std::uintptr_t), NewPawn);
+    put(NewPawn+Layout.ObjectIndex, std::int32_t(11));
+    auto OtherPawn = object(12, 13, 3, 3, 5);
+    put_array(ObjectsTable, ObjectsData, 13);
+
+    assert(Reflection.refresh() == 2 && Reflection.object_count() == 13);
+    assert(!Reflection.find_object("Engine.MyPawn_1") && Reflection.path(MyPawn).empty());
+    assert(Reflection.find_object("Engine.MyPawn") == NewPawn && Reflection.find_object("Engine.MyPawn_2") == OtherPawn);
+    assert((Reflection.find_instances("Pawn") == std::vector<std::uintptr_t>{NewPawn, OtherPawn}));
+
+    assert(Reflection.refresh() == 0);
+}
+
+void test_key_set(){
+    std::vector<std::int32_t> Keys;
+    for(std::int32_t i = 0; i < 1000; ++i){
+        Keys.push_back(i*7919);
+    }
+    Keys.push_back(7919);
+
+    mmtl::key_set Set(Keys);
+    assert(Set.size() == 1000);
+
+    for(std::int32_t i = -10000; i < 8000000; i += 13){
+        assert(Set.contains(i) == (i >= 0 && i%7919 == 0 && i/7919 < 1000));
+    }
+
+    mmtl::key_set None;
+    assert(None.empty() && !None.contains(0));
+
+    bool Threw = false;
+    try {
+        mmtl::key_set({INT32_MIN});
+    }catch(std::invalid_argument&){
+        Threw = true;
+    }
+    assert(Threw);
+}
+
+void test_event_ring(){
+    mmtl::event_ring Ring(1000);
+    assert(Ring.capacity() == 1024);
+
+    std::vector<mmtl::traced_event> Events;
+
+    // Full, then drained and filled again past the wrap around.
+    for(std::uint64_t Round = 0; Round < 3; ++Round){
+        for(std::size_t i = 0; i < 1100; ++i){
+            Ring.push({.Frame = Round, .Object = i, .Function = 0, .Name = 0});
+        }
+
+        Events.clear();
+        assert(Ring.drain(Events) == 1024);
+        assert(Events.front().Object == 0 && Events.back().Object == 1023 && Events.back().Frame == Round);
+    }
+
+    assert(Ring.dropped() == 3*76);
+
+    // Every thread's events come out in its own order, while another drains.
+    constexpr std::size_t Threads = 4, PerThread = 20000;
+
+    std::atomic<std::size_t> Done = 0;
+    std::vector<std::thread> Pushers;
+    for(std::size_t t = 0; t < Threads; ++t){
+        Pushers.emplace_back([&, t]{
+            for(std::size_t i = 0; i < PerThread;){
+                if(Ring.push({.Frame = t, .Object = i, .Function = 0, .Name = 0})){
+                    ++i;
+                }else{
+                    std::this_thread::yield();
+                }
+            }
+
+            ++Done;
+        });
+    }
+
+    std::vector<std::size_t> Next(Threads);
+    for(;;){
+        auto Finished = (Done == Threads);
+
+        Events.clear();
+        Ring.drain(Events);
+
+        for(auto& e:Events){
+            assert(e.Object == Next[e.Frame]);
+            ++Next[e.Frame];
+        }
+
+        if(Finished && Events.empty()){
+            break;
+        }
+
+        std::this_thread::yield();
+    }
+
+    for(auto& e:Pushers){
+        e.join();
+    }
+
+    for(auto e:Next){
+        assert(e == PerThread);
+    }
+}
+
+void test_cloud_files(){
+    auto buffer = [](std::string_view Text){
+        return std::make_shared<const mmtl::cloud_data>(std::vector<unsigned char>(Text.begin(), Text.end()));
+    };
+
+    mmtl::cloud_files Files({
+        {.Name = "Profile.sav", .Data = buffer("profile"), .Timestamp = 1},
+        {.Name = "Save01.sav", .Data = buffer("first"), .Timestamp = 2},
+        {.Name = "SAVE01.SAV", .Data = buffer("second"), .Timestamp = 3},
+    });
+
+    assert(Files.size() == 2 && Files.total_size() == 13);
+    assert(Files[1].Name == "Save01.sav" && Files[1].Timestamp == 3);
+
+    auto Found = Files.find("save01.SAV");
+    assert(Found && *Found->Data == *buffer("second"));
+    assert(!Files.find("Save01") && !Files.find("Save01.sav2"));
+
+    // Buffers handed out don't change.
+    auto Held = Found->Data;
+    Files.write("SaVe01.sav", reinterpret_cast<const unsigned char*>("third!!"), 7, 4);
+    assert(*Held == *buffer("second") && *Files.find("save01.sav")->Data == *buffer("third!!"));
+    assert(Files[1].Name == "Save01.sav" && Files.total_size() == 14);
+
+    Files.write("New.sav", buffer(""), 5);
+    assert(Files.size() == 3 && Files[2].Name == "New.sav" && Files.total_size() == 14);
+
+    std::uint64_t Total = 0;
+    for(auto& e:Files){
+        Total += e.size();
+    }
+    assert(Total == Files.total_size());
+
+    // Snapshots share everything until written to, and are not changed by writes after them.
+    auto Snapshot = Files;
+    assert(Snapshot.shares(Files));
+
+    Files.write("profile.SAV", buffer("changed"), 6);
+    assert(!Snapshot.shares(Files));
+    assert(*Snapshot.find("Profile.sav")->Data == *buffer("profile") && *Files.find("Profile.sav")->Data == *buffer("changed"));
+    assert(Snapshot.find("Save01.sav")->Data == Files.find("Save01.sav")->Data);
+    assert(Snapshot.total_size() == 14 && Files.total_size() == 14);
+
+    Files = Snapshot;
+    assert(Files.shares(Snapshot) && *Files.find("Profile.sav")->Data == *buffer("profile"));
+}
+
+void test_cloud_data(){
+    auto Directory = std::filesystem::temp_directory_path()/"memtools-test-cloud-data";
+    std::filesystem::remove_all(Directory);
+    std::filesystem::create_directories(Directory);
+
+    std::ofstream(Directory/"Save.sav", std::ios::binary) << "mapped";
+    std::ofstream(Directory/"Empty.sav", std::ios::binary);
+
+    {
+        auto Mapped = mmtl::cloud_data::map(Directory/"Save.sav");
+        assert(Mapped->mapped() && Mapped->size() == 6);
+        assert(*Mapped == mmtl::cloud_data(std::vector<unsigned char>{'m', 'a', 'p', 'p', 'e', 'd'}));
+
+        auto Empty = mmtl::cloud_data::map(Directory/"Empty.sav");
+        assert(Empty->size() == 0 && *Empty == mmtl::cloud_data());
+
+        // Writing replaces the mapping with a buffer of its own, snapshots keep the mapping.
+        mmtl::cloud_files Files({{.Name = "Save.sav", .Data = Mapped, .Timestamp = 1}});
+        auto Snapshot = Files;
+        Files.write("save.sav", reinterpret_cast<const unsigned char*>("copy"), 4, 2);
+        assert(!Files.find("Save.sav")->Data->mapped() && Files.total_size() == 4);
+        assert(Snapshot.find("Save.sav")->Data == Mapped && Snapshot.total_size() == 6);
+    }
+
+    bool Threw = false;
+    try {
+        mmtl::cloud_data::map(Directory/"Missing.sav");
+    }catch(std::runtime_error&){
+        Threw = true;
+    }
+    assert(Threw);
+
+    std::filesystem::remove_all(Directory);
+}
+
+void test_cloud_writer(){
+    auto Directory = std::filesystem::temp_directory_path()/"memtools-test-cloud";
+    std::filesystem::remove_all(Directory);
+
+    auto buffer = [](std::string_view Text){
+        return std::make_shared<const mmtl::cloud_data>(std::vector<unsigned char>(Text.begin(), Text.end()));
+    };
+
+    auto read = [&](const char* Name){
+        std::ifstream File(Directory/Name, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(File), {});
+    };
+
+    mmtl::cloud_files Files;
+    Files.write("A.sav", buffer("a"), 1);
+    Files.write("B.sav", buffer("b"), 2);
+
+    mmtl::cloud_writer Writer;
+    Writer.write(Directory, Files);
+    Writer.flush();
+    assert(read("A.sav") == "a" && read("B.sav") == "b");
+    assert(Writer.written() == 2 && Writer.skipped() == 0);
+
+    // Only the changed file is written again.
+    auto Snapshot = Files;
+    Files.write("b.SAV", buffer("bb"), 3);
+    Files.write("C.sav", buffer("c"), 4);
+    Writer.write(Directory, Files);
+    Writer.flush();
+    assert(read("B.sav") == "bb" && read("C.sav") == "c");
+    assert(Writer.written() == 4 && Writer.skipped() == 1);
+
+    // Restoring an older snapshot removes the file it doesn't have.
+    Writer.write(Directory, Snapshot);
+    Writer.flush();
+    assert(read("B.sav") == "b" && !std::filesystem::exists(Directory/"C.sav"));
+    assert(Writer.written() == 5 && Writer.skipped() == 2);
+
+    // A file in the way of the directory.
+    Writer.write(Directory/"A.sav", Files);
+
+    bool Threw = false;
+    try {
+        Writer.flush();
+    }catch(std::runtime_error&){
+        Threw = true;
+    }
+    assert(Threw);
+
+    Writer.flush();
+
+    std::filesystem::remove_all(Directory);
+}
+
+
+void test_overlay_fs(){
+    auto Base = std::filesystem::temp_directory_path()/"memtools-test-overlay";
+    auto Saved = std::filesystem::temp_directory_path()/"memtools-test-overlay-saved";
+    std::filesystem::remove_all(Base);
+    std::filesystem::remove_all(Saved);
+    std::filesystem::create_directories(Base/"Config");
+
+    std::ofstream(Base/"Config"/"Engine.ini", std::ios::binary) << "[Engine]";
+    std::ofstream(Base/"Config"/"Input.ini", std::ios::binary) << "[Input]";
+
+    auto read = [](const std::filesystem::path& Path){
+        std::ifstream File(Path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(File), {});
+    };
+
+    auto contents = [](mmtl::overlay_fs& Fs, mmtl::overlay_fs::file& File){
+        std::string r(static_cast<std::size_t>(Fs.size(File)), '\0');
+        assert(Fs.read(File, 0, r.data(), r.size()) == r.size());
+        return r;
+    };
+
+    using status = mmtl::overlay_fs::status;
+    using disposition = mmtl::overlay_fs::disposition;
+
+    mmtl::overlay_fs Fs(Base);
+
+    assert(Fs.relative(Base/"Config"/"Engine.ini") == std::filesystem::path("Config")/"Engine.ini");
+    assert(Fs.relative(Base) == std::filesystem::path());
+    assert(!Fs.relative(Base.parent_path()/"other") && !Fs.relative("Config"));
+
+    // Base files are read as they are, and copied on the first write.
+    std::shared_ptr<mmtl::overlay_fs::file> Engine;
+    assert(Fs.open("Config/Engine.ini", disposition::OpenExisting, Engine) == status::Opened);
+    assert(contents(Fs, *Engine) == "[Engine]");
+
+    std::shared_ptr<mmtl::overlay_fs::file> Same;
+    assert(Fs.open("config/ENGINE.ini", disposition::OpenAlways, Same) == status::Opened && Same == Engine);
+
+    Fs.write(*Engine, 8, "\nA=1", 4);
+    assert(contents(Fs, *Same) == "[Engine]\nA=1" && read(Base/"Config"/"Engine.ini") == "[Engine]");
+
+    char Tail[16];
+    assert(Fs.read(*Engine, 9, Tail, sizeof(Tail)) == 3 && std::memcmp(Tail, "A=1", 3) == 0);
+    assert(Fs.read(*Engine, 100, Tail, sizeof(Tail)) == 0);
+
+    Fs.resize(*Engine, 3);
+    assert(contents(Fs, *Engine) == "[En" && Fs.stat("Config/Engine.ini")->Size == 3);
+
+    // New files and directories only exist in memory.
+    std::shared_ptr<mmtl::overlay_fs::file> Log;
+    assert(Fs.open("Logs/Launch.log", disposition::CreateAlways, Log) == status::PathNotFound);
+    assert(Fs.create_directory("Logs") == status::Created && Fs.create_directory("logs") == status::Exists);
+    assert(Fs.open("Logs/Launch.log", disposition::CreateNew, Log) == status::Created);
+    assert(Fs.open("Logs/Launch.log", disposition::CreateNew, Log) == status::Exists);
+    Fs.write(*Log, 0, "log", 3);
+    assert(!std::filesystem::exists(Base/"Logs"));
+
+    assert(Fs.open("Config/Missing.ini", disposition::OpenExisting, Log) == status::NotFound);
+    assert(Fs.open("Config", disposition::OpenExisting, Log) == status::IsDirectory);
+    assert(Fs.open("../escape", disposition::CreateAlways, Log) == status::PathNotFound);
+
+    // Truncating doesn't read the base.
+    std::shared_ptr<mmtl::overlay_fs::file> Input;
+    assert(Fs.open("Config/Input.ini", disposition::TruncateExisting, Input) == status::Opened);
+    assert(Fs.size(*Input) == 0);
+    Fs.write(*Input, 0, "[New]", 5);
+
+    // Listings merge both, removed files are hidden.
+    std::ofstream(Base/"Config"/"Removed.ini", std::ios::binary) << "x";
+    assert(Fs.remove("Config/removed.INI") == status::Opened && Fs.remove("Config/Removed.ini") == status::NotFound);
+    assert(Fs.remove("Config") == status::IsDirectory);
+    assert(!Fs.stat("Config/Removed.ini") && Fs.stat("Config")->Directory);
+
+    std::vector<mmtl::overlay_fs::entry> Entries;
+    assert(Fs.list("Config", Entries) && Entries.size() == 2);
+    assert(Entries[0].Name == "Engine.ini" && Entries[0].Size == 3);
+    assert(Entries[1].Name == "Input.ini" && Entries[1].Size == 5);
+
+    assert(Fs.list("", Entries) && Entries.size() == 2 && Entries[0].Name == "Config" && Entries[1].Name == "Logs");
+    assert(Entries[1].Directory && !Fs.list("Config/Engine.ini", Entries));
+
+    // Only written when asked to, with everything as seen through the overlay.
+    Fs.save(Saved);
+    assert(read(Saved/"Config"/"Engine.ini") == "[En" && read(Saved/"Config"/"Input.ini") == "[New]");
+    assert(read(Saved/"Logs"/"Launch.log") == "log" && !std::filesystem::exists(Saved/"Config"/"Removed.ini"));
+    assert(read(Base/"Config"/"Input.ini") == "[Input]" && std::filesystem::exists(Base/"Config"/"Removed.ini"));
+
+    bool Threw = false;
+    try {
+        Fs.save(Base);
+    }catch(std::runtime_error&){
+        Threw = true;
+    }
+    assert(Threw);
+
+    // Renaming moves the contents, even of base files, and keeps open files open.
+    std::ofstream(Base/"Config"/"Base.ini", std::ios::binary) << "base";
+    assert(Fs.rename("Config/Base.ini", "Logs/Moved.ini", false) == status::Opened);
+    assert(!Fs.stat("Config/Base.ini") && Fs.stat("Logs/Moved.ini")->Size == 4);
+    assert(read(Base/"Config"/"Base.ini") == "base");
+
+    std::shared_ptr<mmtl::overlay_fs::file> Moved;
+    assert(Fs.open("Logs/moved.ini", disposition::OpenExisting, Moved) == status::Opened && contents(Fs, *Moved) == "base");
+
+    assert(Fs.rename("Logs/Launch.log", "Logs/Moved.ini", false) == status::Exists);
+    assert(Fs.rename("Logs/Launch.log", "Logs/Moved.ini", true) == status::Opened);
+    assert(contents(Fs, *Log) == "log" && contents(Fs, *Moved) == "base" && !Fs.stat("Logs/Launch.log"));
+    assert(Fs.rename("Logs/Launch.log", "Logs/Other.log", false) == status::NotFound);
+    assert(Fs.rename("Config", "Other", false) == status::IsDirectory);
+    assert(Fs.rename("Logs/Moved.ini", "Missing/Moved.ini", false) == status::PathNotFound);
+
+    // Only empty directories can be removed, and their base files stay removed.
+    assert(Fs.remove_directory("Logs") == status::Exists && Fs.remove_directory("Config/Engine.ini") == status::PathNotFound);
+    assert(Fs.remove("Logs/Moved.ini") == status::Opened && Fs.remove_directory("logs") == status::Opened);
+    assert(!Fs.stat("Logs") && Fs.remove_directory("Logs") == status::NotFound);
+    assert(Fs.create_directory("Logs") == status::Created && Fs.list("Logs", Entries) && Entries.empty());
+
+    Engine = nullptr;
+    Same = nullptr;
+
+    std::filesystem::remove_all(Base);
+    std::filesystem::remove_all(Saved);
+}
+
+void test_file_cache(){
+    auto Directory = std::filesystem::temp_directory_path()/"memtools-test-file-cache";
+    std::filesystem::remove_all(Directory);
+    std::filesystem::create_directories(Directory);
+
+    auto create = [&](const char* Name, std::size_t Size){
+        std::string Contents(Size, '\0');
+        for(std::size_t i = 0; i < Size; ++i){
+            Contents[i] = static_cast<char>(i*7);
+        }
+
+        std::ofstream(Directory/Name, std::ios::binary) << Contents;
+        return Contents;
+    };
+
+    auto A = create("A.upk", 20000);
+    create("B.upk", 30000);
+    create("C.upk", 40000);
+    create("Large.upk", 70000);
+
+    mmtl::file_cache Cache(64 << 10, 8192);
+
+    auto FileA = Cache.open(Directory/"A.upk");
+    assert(FileA && Cache.open(Directory/"A.upk") == FileA);
+    assert(!Cache.open(Directory/"Missing.upk") && !Cache.open(Directory/"Large.upk"));
+
+    char Buffer[256];
+    assert(Cache.read(*FileA, 0, Buffer, 100) == 100 && std::memcmp(Buffer, A.data(), 100) == 0);
+    assert(Cache.count().Reads == 1 && Cache.count().Hits == 0);
+
+    // Sequential reads find the pages touched ahead of them.
+    Cache.wait();
+    assert(FileA->Warmed >= 8192);
+    assert(Cache.read(*FileA, 100, Buffer, 100) == 100 && std::memcmp(Buffer, A.data()+100, 100) == 0);
+    assert(Cache.count().Hits == 1);
+
+    assert(Cache.read(*FileA, 19900, Buffer, sizeof(Buffer)) == 100 && std::memcmp(Buffer, A.data()+19900, 100) == 0);
+    assert(Cache.read(*FileA, 20000, Buffer, sizeof(Buffer)) == 0);
+    assert(Cache.count().Reads == 3 && Cache.count().Bytes == 300);
+
+    Cache.prefetch(Directory/"B.upk");
+    Cache.wait();
+    auto FileB = Cache.open(Directory/"B.upk");
+    assert(FileB->Warmed == 30000);
+    assert(Cache.read(*FileB, 29000, Buffer, 10) == 10 && Cache.count().Hits == 2);
+
+    // Only files that aren't open are dropped to stay in the budget.
+    std::weak_ptr<mmtl::file_cache::file> WeakA = FileA;
+    FileA = nullptr;
+    auto FileC = Cache.open(Directory/"C.upk");
+    assert(FileC && WeakA.expired() && Cache.mapped() == 70000);
+
+    FileB = nullptr;
+    FileC = nullptr;
+    assert(Cache.open(Directory/"A.upk") && Cache.mapped() == 60000);
+
+    mmtl::load_log Log;
+    Log.read(Directory/"missing.log");
+    assert(Log.size() == 0 && !Log.find("L_Tower.upk"));
+
+    Log.record("L_Tower.upk", {"L_Tower.upk", "Core.upk"});
+    Log.record("L_Prison.upk", {"L_Prison.upk"});
+    Log.record("L_Tower.upk", {"L_Tower.upk", "Engine.upk", "Core.upk"});
+    Log.write(Directory/"loads.log");
+
+    mmtl::load_log Read;
+    Read.read(Directory/"loads.log");
+    assert(Read.size() == 2 && Read.find("L_Prison.upk")->size() == 1);
+    assert(*Read.find("L_Tower.upk") == (std::vector<std::string>{"L_Tower.upk", "Engine.upk", "Core.upk"}));
+
+    std::filesystem::remove_all(Directory);
+}
+
+void test_log_ring(){
+    mmtl::log_ring Ring(32);
+    assert(Ring.text().empty() && Ring.capacity() == 32);
+
+    Ring.write("Init: one\n", 10);
+    Ring.write("Log: two\n", 9);
+    assert(Ring.text() == "Init: one\nLog: two\n" && Ring.dropped() == 0);
+
+    // The line cut by the wrap around is left out.
+    Ring.write("Log: three\n", 11);
+    Ring.write("Log: four\n", 10);
+    assert(Ring.size() == 40 && Ring.dropped() == 8);
+    assert(Ring.text() == "Log: two\nLog: three\nLog: four\n");
+
+    auto [Old, New] = Ring.view();
+    assert(Old.size()+New.size() == 30 && !New.empty());
+
+    // A line longer than the ring is kept cut.
+    std::string Long(40, 'x');
+    Long.back() = '\n';
+    Ring.write(Long.data(), Long.size());
+    assert(Ring.text() == Long.substr(8));
+
+    Ring.clear();
+    Ring.write("Exit\n", 5);
+    assert(Ring.text() == "Exit\n" && Ring.size() == 5);
+
+    // Exactly full, with the next write wrapping around to the start.
+    mmtl::log_ring Full(8);
+    Full.write("abc\n", 4);
+    Full.write("def\n", 4);
+    assert(Full.text() == "abc\ndef\n" && Full.dropped() == 0);
+    Full.write("g\n", 2);
+    assert(Full.text() == "def\ng\n");
+
+    bool Threw = false;
+    try {
+        mmtl::log_ring Empty(0);
+    }catch(std::invalid_argument&){
+        Threw = true;
+    }
+    assert(Threw);
+}
+
+void test_load_profile(){
+    auto Path = std::filesystem::temp_directory_path()/"memtools-test-load-profile.bin";
+
+    mmtl::load_profile Profile;
+    Profile.Level = "L_Tower.upk";
+    Profile.RealTime = 123456789;
+    Profile.VirtualTime = 10000000;
+
+    auto Tower = Profile.file("L_Tower.upk");
+    auto Core = Profile.file("Core.upk");
+    assert(Profile.file("L_Tower.upk") == Tower && Profile.Files.size() == 2);
+
+    Profile.Threads = {{100, 5000000}, {204, 20000}};
+
+    // Events are in the order they ended, so starts go back and forth.
+    Profile.Events = {
+        {.Start = 10, .Duration = 50, .Bytes = 0, .File = Tower, .Thread = 100, .Kind = mmtl::load_io::Open},
+        {.Start = 500, .Duration = 3000, .Bytes = 1 << 20, .File = Core, .Thread = 204, .Kind = mmtl::load_io::Read},
+        {.Start = 70, .Duration = 400, .Bytes = 4096, .File = Tower, .Thread = 100, .Kind = mmtl::load_io::Read},
+        {.Start = 3600, .Duration = 20, .Bytes = 4096, .File = Tower, .Thread = 100, .Kind = mmtl::load_io::Read},
+    };
+
+    auto Summary = Profile.summary();
+    assert(Summary.size() == 2 && Summary[0].File == Core && Summary[0].Time == 3000);
+    assert(Summary[1].Opens == 1 && Summary[1].Reads == 2 && Summary[1].Bytes == 8192 && Summary[1].Time == 470);
+
+    Profile.write(Path);
+    assert(std::filesystem::file_size(Path) < 100);
+
+    auto Read = mmtl::load_profile::read(Path);
+    assert(Read.Level == Profile.Level && Read.RealTime == Profile.RealTime && Read.VirtualTime == Profile.VirtualTime);
+    assert(Read.Files == Profile.Files && Read.Threads.size() == 2 && Read.Threads[1].CpuTime == 20000);
+    assert(Read.Events.size() == Profile.Events.size());
+    for(std::size_t i = 0; i < Read.Events.size(); ++i){
+        auto& a = Read.Events[i];
+        auto& b = Profile.Events[i];
+        assert(a.Start == b.Start && a.Duration == b.Duration && a.Bytes == b.Bytes);
+        assert(a.File == b.File && a.Thread == b.Thread && a.Kind == b.Kind);
+    }
+
+    // Cut short.
+    std::filesystem::resize_file(Path, std::filesystem::file_size(Path)-3);
+    bool Threw = false;
+    try {
+        mmtl::load_profile::read(Path);
+    }catch(std::runtime_error&){
+        Threw = true;
+    }
+    assert(Threw);
+
+    std::filesystem::remove(Path);
+}
+}
+
+int main(){
+    test_query_regions();
+    test_readable_map();
+    test_save_restore();
+    test_changing_regions();
+    test_page_store_dedup();
+    test_page_store_cold();
+    test_shared_pages();
+    test_hash_memory();
+    test_hash_log();
+    test_watch_plan();
+    test_trace();
+    test_scanner();
+    test_signatures();
+    test_pe_image();
+    test_decode_x86();
+    test_code_index();
+    test_ue3_reflection();
+    test_key_set();
+    test_event_ring();
+    test_cloud_files();
+    test_cloud_data();
+    test_cloud_writer();
+    test_overlay_fs();
+    test_file_cache();
+    test_log_ring();
+    test_load_profile();
+}
@@ -0,0 +1,42 @@
+﻿#include <hash_log.h>
+
+#include <cstdio>
+#include <algorithm>
+#include <exception>
+
+// Compares two hash logs written by `start_hash_log`, and reports the first frame at which they
+// differ. Exits with 0 if they agree, 1 if they differ, and 2 on errors.
+int main(int Argc, char** Argv){
+    if(Argc != 3){
+        std::fprintf(stderr, "Usage: %s <log a> <log b>\n", Argv[0]);
+        return 2;
+    }
+
+    try {
+        auto a = mmtl::hash_log::read(Argv[1]);
+        auto b = mmtl::hash_log::read(Argv[2]);
+
+        auto Count = std::min(a.Frames.size(), b.Frames.size());
+
+        auto Divergence = mmtl::first_divergence(a, b);
+        if(!Divergence){
+            std::printf("No divergence in %zu frames.\n", Count);
+
+            if(a.Frames.size() != b.Frames.size()){
+                std::printf("The logs have %zu and %zu frames.\n", a.Frames.size(), b.Frames.size());
+            }
+
+            return 0;
+        }
+
+        std::printf("First divergence at frame %zu (frame count %llu) in %s: %016llx != %016llx\n",
+            Divergence->Frame, static_cast<unsigned long long>(Divergence->FrameCount),
+            Divergence->Region.c_str(),
+            static_cast<unsigned long long>(Divergence->a), static_cast<unsigned long long>(Divergence->b));
+
+        return 1;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,60 @@
+﻿#include <load_profile.h>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+double seconds(std::uint64_t Ticks){
+    return static_cast<double>(Ticks)/1e7;
+}
+
+}
+
+// Prints a load profile written with `--profile-loads`: the times, the CPU time of every thread and
+// the files by the time spent on them. With `--events`, prints every open and read as CSV instead,
+// with times in microseconds, for plotting.
+int main(int Argc, char** Argv){
+    auto Events = Argc == 3 && std::strcmp(Argv[2], "--events") == 0;
+    if(Argc != 2 && !Events){
+        std::fprintf(stderr, "Usage: %s <profile> [--events]\n", Argv[0]);
+        return 2;
+    }
+
+    try {
+        auto Profile = mmtl::load_profile::read(Argv[1]);
+
+        if(Events){
+            std::printf("start,duration,kind,bytes,thread,file\n");
+            for(auto& e:Profile.Events){
+                std::printf("%llu,%llu,%s,%llu,%lu,%s\n",
+                    static_cast<unsigned long long>(e.Start/10), static_cast<unsigned long long>(e.Duration/10),
+                    (e.Kind == mmtl::load_io::Open)?"open":"read", static_cast<unsigned long long>(e.Bytes),
+                    static_cast<unsigned long>(e.Thread), Profile.Files[e.File].c_str());
+            }
+
+            return 0;
+        }
+
+        std::printf("Level: %s\n", Profile.Level.c_str());
+        std::printf("Real time: %.3f s, virtual time: %.3f s\n", seconds(Profile.RealTime), seconds(Profile.VirtualTime));
+
+        std::printf("\nThread    CPU time\n");
+        for(auto& e:Profile.Threads){
+            std::printf("%6lu %9.3f s\n", static_cast<unsigned long>(e.Id), seconds(e.CpuTime));
+        }
+
+        std::printf("\n    Time  Opens  Reads       Bytes  File\n");
+        for(auto& e:Profile.summary()){
+            std::printf("%6.3f s %6llu %6llu %11llu  %s\n",
+                seconds(e.Time), static_cast<unsigned long long>(e.Opens), static_cast<unsigned long long>(e.Reads),
+                static_cast<unsigned long long>(e.Bytes), Profile.Files[e.File].c_str());
+        }
+
+        return 0;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
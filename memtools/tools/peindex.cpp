@@ -0,0 +1,145 @@
+﻿#include <code_index.h>
+#include <work_pool.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <exception>
+#include <string_view>
+
+namespace {
+
+const char* kind_name(mmtl::xref_kind Kind){
+    switch(Kind){
+        case mmtl::xref_kind::Call: {
+            return "call";
+        }
+        case mmtl::xref_kind::Jump: {
+            return "jump";
+        }
+        case mmtl::xref_kind::Data: {
+            return "data";
+        }
+    }
+
+    return "?";
+}
+
+void print_functions(const mmtl::code_index& Index, const std::vector<std::uint32_t>& Starts){
+    for(auto e:Starts){
+        auto Function = Index.function_at(e);
+        std::printf("%08X %08X\n", e, Function?Function->End:e);
+    }
+}
+
+void print_xref(const mmtl::code_index& Index, const mmtl::code_xref& Xref){
+    auto Function = Index.function_at(Xref.From);
+    std::printf("%08X %s %08X", Xref.From, kind_name(Xref.Kind), Xref.To);
+
+    if(Function){
+        std::printf(" in %08X", Function->Start);
+    }
+
+    auto String = Index.string_at(Xref.To);
+    if(!String.empty()){
+        std::printf(" \"%.*s\"", static_cast<int>(String.size()), String.data());
+    }
+
+    std::printf("\n");
+}
+
+int build(const char* Exe, const char* Path){
+    std::ifstream File(Exe, std::ios::binary);
+    if(!File){
+        throw std::runtime_error("Unable to open the executable.");
+    }
+
+    std::vector<char> Data{std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>()};
+
+    mmtl::pe_image Image(reinterpret_cast<const std::byte*>(Data.data()), Data.size(), false);
+
+    work_pool Pool;
+
+    auto Begin = std::chrono::steady_clock::now();
+    auto Stats = mmtl::build_code_index(Image, Path, &Pool);
+    auto Time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-Begin).count();
+
+    std::printf("%zu functions, %zu instructions, %zu references, %zu strings in %.0f ms on %u threads\n",
+        Stats.Functions, Stats.Instructions, Stats.Xrefs, Stats.Strings, Time, Pool.size());
+
+    return 0;
+}
+
+}
+
+// Builds an index of the functions of a 32 bit executable and the references between them, and
+// answers questions about it. Addresses are RVAs in hex.
+int main(int Argc, char** Argv){
+    if(Argc != 4){
+        std::fprintf(stderr,
+            "Usage: %s build <exe> <index>\n"
+            "       %s function <index> <rva>    the function containing an address\n"
+            "       %s callers <index> <rva>     functions calling or jumping to an address\n"
+            "       %s refs <index> <rva>        every reference to an address\n"
+            "       %s calls <index> <rva>       every reference made by the function containing an address\n"
+            "       %s strings <index> <text>    functions referencing a string containing the text\n",
+            Argv[0], Argv[0], Argv[0], Argv[0], Argv[0], Argv[0]);
+        return 2;
+    }
+
+    try {
+        std::string_view Command = Argv[1];
+
+        if(Command == "build"){
+            return build(Argv[2], Argv[3]);
+        }
+
+        mmtl::code_index Index(Argv[2]);
+
+        if(Command == "strings"){
+            auto Functions = Index.functions_referencing(Argv[3]);
+            print_functions(Index, Functions);
+            return Functions.empty();
+        }
+
+        auto Rva = static_cast<std::uint32_t>(std::strtoul(Argv[3], nullptr, 16));
+
+        if(Command == "function"){
+            auto Function = Index.function_at(Rva);
+            if(!Function){
+                return 1;
+            }
+
+            print_functions(Index, {Function->Start});
+        }else if(Command == "callers"){
+            auto Callers = Index.callers(Rva);
+            print_functions(Index, Callers);
+            return Callers.empty();
+        }else if(Command == "refs"){
+            for(auto& e:Index.references_to(Rva)){
+                print_xref(Index, e);
+            }
+        }else if(Command == "calls"){
+            auto Function = Index.function_at(Rva);
+            if(!Function){
+                return 1;
+            }
+
+            for(auto& e:Index.references_from(Function->Start, Function->End)){
+                print_xref(Index, e);
+            }
+        }else{
+            std::fprintf(stderr, "Unknown command '%s'.\n", Argv[1]);
+            return 2;
+        }
+
+        return 0;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,181 @@
+﻿#include <pe.h>
+#include <signature.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <exception>
+
+namespace {
+
+// Bytes that may differ in another build: addresses the loader relocates, and the displacements
+// of relative calls and jumps. Opcodes are not decoded, so a few other bytes are caught as well,
+// which only makes signatures a little longer.
+std::vector<bool> volatile_bytes(const mmtl::pe_image& Image, const mmtl::pe_section& Text){
+    auto Code = Image.data(Text);
+    auto Size = Image.size(Text);
+
+    std::vector<bool> r(Size);
+
+    auto mark = [&](std::size_t Offset, std::size_t Count){
+        for(std::size_t i = Offset; i < Offset+Count && i < Size; ++i){
+            r[i] = true;
+        }
+    };
+
+    for(auto& e:Image.relocations()){
+        if(e.Rva >= Text.Rva && e.Rva-Text.Rva < Size){
+            mark(e.Rva-Text.Rva, e.Size);
+        }
+    }
+
+    for(std::size_t i = 0; i < Size; ++i){
+        auto Byte = std::to_integer<std::uint8_t>(Code[i]);
+
+        if(Byte == 0xE8 || Byte == 0xE9){
+            mark(i+1, 4);
+        }else if(Byte == 0x0F && i+1 < Size && (std::to_integer<std::uint8_t>(Code[i+1])&0xF0) == 0x80){
+            mark(i+2, 4);
+        }
+    }
+
+    return r;
+}
+
+// The signatures of a file in the format of `signatures.txt`, lines of a name and a pattern with
+// `#` starting a comment.
+std::map<std::string, mmtl::signature> read_signatures(const char* Path){
+    std::ifstream File(Path);
+    if(!File){
+        throw std::runtime_error("Unable to open "+std::string(Path)+".");
+    }
+
+    std::map<std::string, mmtl::signature> r;
+
+    std::string Line;
+    while(std::getline(File, Line)){
+        Line = Line.substr(0, Line.find('#'));
+
+        std::istringstream Fields(Line);
+        std::string Name;
+        if(!(Fields >> Name)){
+            continue;
+        }
+
+        std::string Pattern;
+        std::getline(Fields, Pattern);
+        r.insert_or_assign(Name, mmtl::signature::parse(Pattern));
+    }
+
+    return r;
+}
+
+}
+
+// Makes signatures for functions of a game executable, in the format of `signatures.txt`. Each
+// function is given as its name and RVA in hex, like `DoFrame=5E0CB0`.
+//
+// With `--check signatures.txt` first, it instead checks that the signatures of the functions match
+// exactly once, at the RVA if one is given, so a build with known offsets tests the signatures.
+int main(int Argc, char** Argv){
+    const char* CheckPath = nullptr;
+    if(Argc >= 3 && std::strcmp(Argv[1], "--check") == 0){
+        CheckPath = Argv[2];
+        Argc -= 2;
+        Argv += 2;
+    }
+
+    if(Argc < 3){
+        std::fprintf(stderr, "Usage: %s [--check <signatures>] <exe> <name=rva>...\n", Argv[0]);
+        return 2;
+    }
+
+    try {
+        std::ifstream File(Argv[1], std::ios::binary);
+        if(!File){
+            throw std::runtime_error("Unable to open the executable.");
+        }
+
+        std::vector<char> Data{std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>()};
+
+        mmtl::pe_image Image(reinterpret_cast<const std::byte*>(Data.data()), Data.size(), false);
+
+        auto Text = Image.find_section(".text");
+        if(!Text){
+            throw std::runtime_error("The executable has no .text section.");
+        }
+
+        std::map<std::string, mmtl::signature> Signatures;
+        if(CheckPath){
+            Signatures = read_signatures(CheckPath);
+        }
+
+        auto Volatile = volatile_bytes(Image, *Text);
+
+        int Result = 0;
+
+        for(int i = 2; i < Argc; ++i){
+            std::string Arg = Argv[i];
+
+            auto Split = Arg.find('=');
+            if(Split == std::string::npos && !CheckPath){
+                throw std::invalid_argument("Expected name=rva, got '"+Arg+"'.");
+            }
+
+            auto Name = Arg.substr(0, Split);
+
+            if(CheckPath){
+                auto Signature = Signatures.find(Name);
+                if(Signature == Signatures.end()){
+                    std::fprintf(stderr, "No signature for %s.\n", Name.c_str());
+                    Result = 1;
+                    continue;
+                }
+
+                auto Match = mmtl::find_signatures(Image.data(*Text), Image.size(*Text), {Signature->second})[0];
+                auto Rva = Text->Rva+Match.Offset;
+
+                if(Match.Count != 1){
+                    std::fprintf(stderr, "%s matched %s.\n", Name.c_str(), (Match.Count == 0)?"nothing":"more than once");
+                    Result = 1;
+                }else if(auto Expected = (Split != std::string::npos)?std::strtoul(Arg.c_str()+Split+1, nullptr, 16):Rva; Rva != Expected){
+                    std::fprintf(stderr, "%s matched at %llX instead of %llX.\n", Name.c_str(), static_cast<unsigned long long>(Rva),
+                        static_cast<unsigned long long>(Expected));
+                    Result = 1;
+                }else{
+                    std::printf("%s %llX\n", Name.c_str(), static_cast<unsigned long long>(Rva));
+                }
+
+                continue;
+            }
+
+            auto Rva = std::strtoul(Arg.c_str()+Split+1, nullptr, 16);
+
+            if(Rva < Text->Rva || Rva-Text->Rva >= Image.size(*Text)){
+                std::fprintf(stderr, "%s is not in .text.\n", Name.c_str());
+                Result = 1;
+                continue;
+            }
+
+            auto Signature = mmtl::make_signature(Image.data(*Text), Image.size(*Text), Rva-Text->Rva, Volatile);
+            if(!Signature){
+                std::fprintf(stderr, "No unique signature for %s.\n", Name.c_str());
+                Result = 1;
+                continue;
+            }
+
+            std::printf("%s %s\n", Name.c_str(), Signature->to_string().c_str());
+        }
+
+        return Result;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
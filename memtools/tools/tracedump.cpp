@@ -0,0 +1,127 @@
+﻿#include <trace.h>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace {
+
+// Size is the column's, since pointers are as wide as in the process that wrote the trace.
+void print_value(mmtl::value_type Type, std::size_t Size, const std::byte* Data){
+    auto get = [&]<typename T>(T Value){
+        std::memcpy(&Value, Data, sizeof(Value));
+        return Value;
+    };
+
+    switch(Type){
+        case mmtl::value_type::I8: {
+            std::printf("%d", get(std::int8_t()));
+            break;
+        }
+        case mmtl::value_type::U8: {
+            std::printf("%u", get(std::uint8_t()));
+            break;
+        }
+        case mmtl::value_type::I16: {
+            std::printf("%d", get(std::int16_t()));
+            break;
+        }
+        case mmtl::value_type::U16: {
+            std::printf("%u", get(std::uint16_t()));
+            break;
+        }
+        case mmtl::value_type::I32: {
+            std::printf("%ld", static_cast<long>(get(std::int32_t())));
+            break;
+        }
+        case mmtl::value_type::U32: {
+            std::printf("%lu", static_cast<unsigned long>(get(std::uint32_t())));
+            break;
+        }
+        case mmtl::value_type::I64: {
+            std::printf("%lld", static_cast<long long>(get(std::int64_t())));
+            break;
+        }
+        case mmtl::value_type::U64: {
+            std::printf("%llu", static_cast<unsigned long long>(get(std::uint64_t())));
+            break;
+        }
+        case mmtl::value_type::F32: {
+            std::printf("%.9g", get(float()));
+            break;
+        }
+        case mmtl::value_type::F64: {
+            std::printf("%.17g", get(double()));
+            break;
+        }
+        case mmtl::value_type::Pointer: {
+            auto Value = (Size == 4)?get(std::uint32_t()):get(std::uint64_t());
+            std::printf("0x%llx", static_cast<unsigned long long>(Value));
+            break;
+        }
+    }
+}
+
+}
+
+// Prints columns of a trace written by `start_trace` as CSV, with the frame count first. Only the
+// columns asked for are decoded, all of them if none are given.
+int main(int Argc, char** Argv){
+    if(Argc < 2){
+        std::fprintf(stderr, "Usage: %s <trace> [column...]\n", Argv[0]);
+        return 2;
+    }
+
+    try {
+        mmtl::trace_reader Reader(Argv[1]);
+
+        std::vector<std::size_t> Indices;
+        if(Argc == 2){
+            for(std::size_t i = 0; i < Reader.columns().size(); ++i){
+                Indices.push_back(i);
+            }
+        }else{
+            for(int i = 2; i < Argc; ++i){
+                auto Index = Reader.find(Argv[i]);
+                if(!Index){
+                    std::fprintf(stderr, "Error: No column named '%s'.\n", Argv[i]);
+                    return 2;
+                }
+
+                Indices.push_back(*Index);
+            }
+        }
+
+        auto Frames = Reader.frames();
+
+        std::vector<std::vector<std::byte>> Columns;
+        for(auto i:Indices){
+            Columns.push_back(Reader.column(i));
+        }
+
+        std::printf("frame");
+        for(auto i:Indices){
+            std::printf(",%s", Reader.columns()[i].Name.c_str());
+        }
+        std::printf("\n");
+
+        for(std::size_t f = 0; f < Frames.size(); ++f){
+            std::printf("%llu", static_cast<unsigned long long>(Frames[f]));
+
+            for(std::size_t c = 0; c < Indices.size(); ++c){
+                auto Type = Reader.columns()[Indices[c]].Type;
+                auto Size = Reader.column_size(Indices[c]);
+
+                std::printf(",");
+                print_value(Type, Size, Columns[c].data()+f*Size);
+            }
+
+            std::printf("\n");
+        }
+
+        return 0;
+    }catch(std::exception& e){
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 2;
+    }
+}
@@ -0,0 +1,31 @@
+# Measures the Python `compute_turn` for comparison with movement-bench.
+#
+#     python movement/bench/compute_turn.py
+
+import sys
+import timeit
+import types
+from pathlib import Path
+
+# `utilities` imports a few functions from the embedded module, which is not available here.
+_pytas = types.ModuleType("_pytas")
+_pytas.save_state = _pytas.move_mouse = _pytas.get_mouse_pos = None
+sys.modules["_pytas"] = _pytas
+
+sys.path.insert(0, str(Path(__file__).parents[2] / "datafiles" / "scripts"))
+
+from utilities import compute_turn  # noqa: E402
+
+turns = [(i * 7919) % 65536 - 32768 for i in range(1 << 16)]
+
+
+def run():
+    for turn in turns:
+        try:
+            compute_turn(turn, 1 / 60)
+        except ValueError:
+            pass
+
+
+seconds = min(timeit.repeat(run, number=1, repeat=3))
+print(f"compute_turn {len(turns) / seconds:12.0f} calls/s")
@@ -0,0 +1,225 @@
+﻿#include <route.h>
+#include <strafe.h>
+#include <movement.h>
+#include <work_pool.h>
+
+#include <cmath>
+#include <chrono>
+#include <optional>
+#include <random>
+#include <cstdio>
+
+namespace {
+
+void bench_step(){
+    constexpr std::size_t Count = 4096;
+    constexpr int Frames = 60;
+    constexpr int Repeats = 200;
+
+    std::mt19937 Rng(1);
+    std::uniform_real_distribution<float> Value(-400.0f, 400.0f);
+    std::uniform_int_distribution<int> Turn(-32768, 32767);
+
+    mvmt::batch Start(Count);
+    std::vector<float> AccelX(Count), AccelY(Count);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        Start.set(i, {{}, {Value(Rng), Value(Rng)}});
+
+        auto Accel = mvmt::heading_accel(Turn(Rng));
+        AccelX[i] = Accel.x;
+        AccelY[i] = Accel.y;
+    }
+
+    mvmt::params Params = {1.0f/60.0f, mvmt::SprintScale};
+
+    const char* Names[] = {"scalar", "sse2", "avx"};
+
+    for(auto Level:{mvmt::simd_level::Scalar, mvmt::simd_level::Sse2, mvmt::simd_level::Avx}){
+        if(Level > mvmt::simd_support()){
+            continue;
+        }
+
+        auto Batch = Start;
+
+        auto Begin = std::chrono::steady_clock::now();
+
+        for(int r = 0; r < Repeats; ++r){
+            for(int n = 0; n < Frames; ++n){
+                mvmt::step(Batch.view(), AccelX.data(), AccelY.data(), Params, Level);
+            }
+        }
+
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now()-Begin;
+
+        auto Trajectories = static_cast<double>(Count)*Repeats;
+
+        // Print a result so the work can not be optimised away.
+        std::printf("%-6s %12.0f trajectories/s (%d frames), %12.0f steps/s, checksum %f\n",
+            Names[static_cast<int>(Level)], Trajectories/Elapsed.count(), Frames,
+            Trajectories*Frames/Elapsed.count(), Batch.PositionX[Count/2]);
+    }
+}
+
+void bench_route(){
+    std::vector<int> Headings;
+    for(int i = 0; i < 64; ++i){
+        Headings.push_back(i*1024);
+    }
+
+    mvmt::route_problem Problem = {
+        .Start = {{}, {300.0f, 0.0f}},
+        .Goal = {800.0f, 400.0f},
+        .GoalRadius = 20.0f,
+        .FrameTimes = {1.0f/250.0f, 1.0f/60.0f, 1.0f/8.0f},
+        .Headings = std::move(Headings),
+        .SpeedScale = mvmt::SprintScale,
+        .BeamWidth = 4096,
+        .MaxFrames = 256,
+    };
+
+    std::vector<unsigned> Threads = {1};
+    for(unsigned n = 2; n < std::thread::hardware_concurrency(); n *= 2){
+        Threads.push_back(n);
+    }
+
+    if(std::thread::hardware_concurrency() > 1){
+        Threads.push_back(std::thread::hardware_concurrency());
+    }
+
+    for(auto n:Threads){
+        work_pool Pool(n);
+
+        auto Begin = std::chrono::steady_clock::now();
+        auto Result = mvmt::find_route(Problem, Pool);
+        std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now()-Begin;
+
+        std::printf("route  %2u threads %12.0f nodes/s, %s in %zu frames, %.3f s\n",
+            n, static_cast<double>(Result.Nodes)/Elapsed.count(),
+            Result.Reached ? "reached" : "not reached", Result.Steps.size(), Result.Time);
+    }
+}
+
+// Line by line port of `compute_turn` in utilities.py. It raises a `ValueError` for some unreachable
+// turns, and returns a solution that moves backwards (`m < 0`) for others; both count as unreachable
+// here. See compute_turn.py for the speed of the Python version itself.
+std::optional<int> reference_turn(int Turn, double dt, double a = 2000.0/600.0){
+    double f = 8;
+
+    auto u1 = std::cos(mvmt::TurnToRad*Turn);
+    auto u2 = std::sin(mvmt::TurnToRad*Turn);
+
+    auto dtaf = dt*(a+f);
+    auto dtf1 = dt*f-1;
+    auto dtf1u2 = dtf1*u2;
+
+    auto Disc = dtaf*dtaf - dtf1u2*dtf1u2;
+    if(Disc < 0.0){
+        return std::nullopt;
+    }
+
+    auto m = std::sqrt(Disc) - dtf1*u1;
+    if(m < 0.0){
+        return std::nullopt;
+    }
+
+    auto d1 = m*u1 + dtf1;
+    auto d2 = m*u2;
+
+    return static_cast<int>(std::nearbyint(mvmt::RadToTurn*std::atan2(d2, d1)));
+}
+
+template <typename F>
+double calls_per_second(int Calls, F&& Fn){
+    auto Begin = std::chrono::steady_clock::now();
+    Fn();
+    std::chrono::duration<double> Elapsed = std::chrono::steady_clock::now()-Begin;
+
+    return Calls/Elapsed.count();
+}
+
+void bench_strafe(){
+    constexpr double FrameTimes[] = {1.0/250.0, 1.0/60.0, 1.0/30.0, 1.0/8.0, 1.0/2.5};
+
+    long Mismatches = 0, Unreachable = 0;
+
+    for(auto dt:FrameTimes){
+        mvmt::strafe_params Params = {dt};
+        auto Table = mvmt::get_turn_table(Params);
+
+        for(int Turn = -32768; Turn < 32768; ++Turn){
+            auto Expected = reference_turn(Turn, dt);
+            if(!Expected){
+                ++Unreachable;
+                continue;
+            }
+
+            if(
+                mvmt::strafe_turn(Turn, Params) != *Expected ||
+                (*Table)(Turn) != static_cast<std::int16_t>(*Expected)
+            ){
+                ++Mismatches;
+            }
+        }
+    }
+
+    std::printf("strafe accuracy: %ld mismatches against compute_turn, %ld unreachable turns\n",
+        Mismatches, Unreachable);
+
+    constexpr int Count = 1 << 16;
+
+    std::vector<int> Turns(Count), Out(Count);
+    for(int i = 0; i < Count; ++i){
+        Turns[i] = (i*7919)%65536-32768;
+    }
+
+    mvmt::strafe_params Params = {1.0/60.0};
+
+    long long Sink = 0;
+
+    auto Reference = calls_per_second(Count, [&](){
+        for(auto e:Turns){
+            Sink += reference_turn(e, Params.DeltaTime).value_or(0);
+        }
+    });
+
+    auto Direct = calls_per_second(Count, [&](){
+        for(auto e:Turns){
+            Sink += mvmt::strafe_turn(e, Params);
+        }
+    });
+
+    auto Batch = calls_per_second(Count, [&](){
+        mvmt::strafe_turns(Turns.data(), Out.data(), Count, Params);
+        Sink += Out[Count/2];
+    });
+
+    auto Build = calls_per_second(1, [&](){
+        Sink += mvmt::turn_table({1.0/61.0})(0);
+    });
+
+    auto Table = mvmt::get_turn_table(Params);
+    auto Lookup = calls_per_second(Count*100, [&](){
+        for(int r = 0; r < 100; ++r){
+            for(auto e:Turns){
+                Sink += (*Table)(e);
+            }
+        }
+    });
+
+    std::printf("strafe reference %12.0f calls/s\n", Reference);
+    std::printf("strafe direct    %12.0f calls/s\n", Direct);
+    std::printf("strafe batch     %12.0f calls/s\n", Batch);
+    std::printf("strafe table     %12.0f calls/s, %.2f ms to build, checksum %lld\n",
+        Lookup, 1000.0/Build, Sink);
+}
+
+}
+
+int main(){
+    bench_step();
+    bench_route();
+    bench_strafe();
+
+    return 0;
+}
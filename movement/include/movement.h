@@ -0,0 +1,101 @@
+﻿#ifndef MOVEMENT_H_INCLUDED
+    #define MOVEMENT_H_INCLUDED 1
+
+#include <vector>
+#include <numbers>
+
+#include <cstddef>
+
+// An implementation of the movement model described in docs/movement.pdf.
+
+namespace mvmt {
+
+constexpr float BaseSpeed = 400.0f;
+constexpr float BaseAccel = 2000.0f;
+constexpr float DefaultFriction = 8.0f;
+
+constexpr float WalkScale = 1.0f;
+constexpr float SprintScale = 1.5f;
+constexpr float AgilityScale = 1.95f;
+
+// The game measures angles in 1/65536 of a turn.
+constexpr double TurnToRad = std::numbers::pi/32768.0;
+constexpr double RadToTurn = 32768.0/std::numbers::pi;
+
+struct vec2 {
+    float x, y;
+};
+
+struct state {
+    vec2 Position;
+    vec2 Velocity;
+};
+
+struct params {
+    // Delta time in seconds.
+    float DeltaTime;
+    float SpeedScale = WalkScale;
+    float Friction = DefaultFriction;
+};
+
+// Acceleration of magnitude `Magnitude` in the direction `Turn`.
+vec2 heading_accel(int Turn, float Magnitude = BaseAccel);
+
+// Runs `Movement(Δt, s, f)` once. A zero acceleration is not covered by the paper; it is treated as
+// `d = 0`, i.e., friction slows the player down along the current velocity.
+state step(state State, vec2 Accel, const params& Params);
+
+// Mutable view of a range of trajectories in structure of arrays layout.
+struct batch_view {
+    float* PositionX;
+    float* PositionY;
+    float* VelocityX;
+    float* VelocityY;
+
+    std::size_t Size;
+
+    batch_view subview(std::size_t Begin, std::size_t End) const {
+        return {PositionX+Begin, PositionY+Begin, VelocityX+Begin, VelocityY+Begin, End-Begin};
+    }
+};
+
+struct batch {
+    std::vector<float> PositionX;
+    std::vector<float> PositionY;
+    std::vector<float> VelocityX;
+    std::vector<float> VelocityY;
+
+    explicit batch(std::size_t Size = 0);
+
+    std::size_t size() const {
+        return PositionX.size();
+    }
+
+    void resize(std::size_t Size);
+
+    state get(std::size_t i) const;
+    void set(std::size_t i, const state& State);
+
+    batch_view view(){
+        return {PositionX.data(), PositionY.data(), VelocityX.data(), VelocityY.data(), size()};
+    }
+};
+
+enum class simd_level {
+    Scalar,
+    Sse2,
+    Avx,
+};
+
+// The best level supported by the compiler and the CPU.
+simd_level simd_support();
+
+// Steps trajectory `i` with acceleration `(AccelX[i], AccelY[i])`. Every level produces the same
+// results bit for bit as the scalar `step`, so a batch can be used to search for inputs.
+void step(batch_view Batch, const float* AccelX, const float* AccelY, const params& Params);
+void step(batch_view Batch, const float* AccelX, const float* AccelY, const params& Params,
+    simd_level Level);
+
+}
+
+#endif
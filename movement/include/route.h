@@ -0,0 +1,60 @@
+﻿#ifndef ROUTE_H_INCLUDED
+    #define ROUTE_H_INCLUDED 1
+
+#include <movement.h>
+
+#include <vector>
+
+#include <cstdint>
+
+struct work_pool;
+
+namespace mvmt {
+
+// Search for the fastest sequence of frame times and headings that takes the player from `Start`
+// into the circle around `Goal`. Every frame the player picks one of `FrameTimes` and accelerates
+// with `Accel` towards one of the absolute `Headings` (in game angle units).
+struct route_problem {
+    state Start;
+
+    vec2 Goal;
+    float GoalRadius;
+
+    std::vector<float> FrameTimes;
+    std::vector<int> Headings;
+
+    float Accel = BaseAccel;
+    float SpeedScale = WalkScale;
+    float Friction = DefaultFriction;
+
+    // Number of nodes kept after every frame.
+    std::size_t BeamWidth = 4096;
+    std::size_t MaxFrames = 256;
+
+    // Nodes whose positions and velocities are this close are considered the same, only the fastest
+    // is kept. Zero disables merging.
+    float MergeDistance = 0.5f;
+};
+
+struct route_step {
+    float DeltaTime;
+    int Heading;
+};
+
+struct route_result {
+    // When the goal was not reached, this is the route that got closest.
+    bool Reached;
+    float Time;
+
+    std::vector<route_step> Steps;
+    state Final;
+
+    // Number of expanded nodes, i.e., simulated frames.
+    std::uint64_t Nodes;
+};
+
+route_result find_route(const route_problem& Problem, work_pool& Pool);
+
+}
+
+#endif
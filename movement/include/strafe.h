@@ -0,0 +1,68 @@
+﻿#ifndef STRAFE_H_INCLUDED
+    #define STRAFE_H_INCLUDED 1
+
+#include <movement.h>
+
+#include <memory>
+#include <cstdint>
+
+namespace mvmt {
+
+// Solves the inverse problem from docs/movement.pdf: which direction to accelerate in, so that
+// after one frame the player moves in a requested direction. Unlike the paper this does not assume
+// the player is at `MaxSpeed`. Computed in double precision to agree with `compute_turn` in the
+// scripts.
+struct strafe_params {
+    double DeltaTime;
+    double SpeedScale = SprintScale;
+    double Friction = DefaultFriction;
+    double Accel = BaseAccel;
+};
+
+struct strafe_solution {
+    // Direction to accelerate in.
+    vec2 Direction;
+
+    // Resulting speed before clamping to `MaxSpeed`.
+    double Speed;
+
+    // False if the requested direction is out of reach, in which case `Direction` turns as far as
+    // possible towards it.
+    bool Reachable;
+};
+
+// `Velocity` is the velocity at the start of the frame and `Target` the direction to move in.
+strafe_solution solve_strafe(vec2 Velocity, vec2 Target, const strafe_params& Params);
+
+// The `compute_turn` special case: the player moves at `MaxSpeed` and wants to turn `Turn` game
+// angle units. Returns the direction to accelerate in relative to the current velocity.
+int strafe_turn(int Turn, const strafe_params& Params);
+
+void strafe_turns(const int* Turns, int* Out, std::size_t Count, const strafe_params& Params);
+
+// Mouse delta, in game angle units, that makes a player looking in the direction `Yaw` accelerate
+// so they end up moving towards `Heading`. `KeyAngle` is the direction of the held movement keys
+// relative to the camera, e.g., 0 for forward.
+int strafe_mouse_delta(vec2 Velocity, int Heading, int Yaw, const strafe_params& Params,
+    int KeyAngle = 0);
+
+// The same for a solution already solved towards the heading.
+int strafe_mouse_delta(const strafe_solution& Solution, int Yaw, int KeyAngle = 0);
+
+// `strafe_turn` for every possible turn, making queries a single load.
+struct turn_table {
+    explicit turn_table(const strafe_params& Params);
+
+    int operator()(int Turn) const {
+        return Table[static_cast<std::uint16_t>(Turn)];
+    }
+
+    std::unique_ptr<std::int16_t[]> Table;
+};
+
+// Tables are cached by their parameters, i.e., mostly by `DeltaTime` and `SpeedScale`. Thread safe.
+std::shared_ptr<const turn_table> get_turn_table(const strafe_params& Params);
+
+}
+
+#endif
@@ -0,0 +1,22 @@
+﻿#ifndef MOVEMENT_KERNELS_H_INCLUDED
+    #define MOVEMENT_KERNELS_H_INCLUDED 1
+
+#include <movement.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define MVMT_X86 1
+#else
+    #define MVMT_X86 0
+#endif
+
+namespace mvmt {
+
+// Each kernel handles a multiple of its width and returns how many trajectories it stepped.
+std::size_t step_sse2(batch_view Batch, const float* AccelX, const float* AccelY,
+    const params& Params);
+std::size_t step_avx(batch_view Batch, const float* AccelX, const float* AccelY,
+    const params& Params);
+
+}
+
+#endif
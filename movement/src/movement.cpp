@@ -0,0 +1,163 @@
+﻿#include <movement.h>
+
+#include "kernels.h"
+
+#include <cmath>
+
+#if MVMT_X86
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #include <immintrin.h>
+    #endif
+#endif
+
+namespace mvmt {
+
+namespace {
+
+simd_level detect_simd(){
+#if MVMT_X86
+    #ifdef _MSC_VER
+        int Info[4];
+        __cpuid(Info, 1);
+
+        constexpr int Sse2 = 1 << 26;
+        constexpr int OsXSave = 1 << 27;
+        constexpr int Avx = 1 << 28;
+
+        if((Info[2]&OsXSave) && (Info[2]&Avx) && (_xgetbv(0)&6) == 6){
+            return simd_level::Avx;
+        }else if(Info[3]&Sse2){
+            return simd_level::Sse2;
+        }
+    #else
+        __builtin_cpu_init();
+
+        if(__builtin_cpu_supports("avx")){
+            return simd_level::Avx;
+        }else if(__builtin_cpu_supports("sse2")){
+            return simd_level::Sse2;
+        }
+    #endif
+#endif
+
+    return simd_level::Scalar;
+}
+
+}
+
+vec2 heading_accel(int Turn, float Magnitude){
+    auto Angle = TurnToRad*Turn;
+
+    return {
+        static_cast<float>(Magnitude*std::cos(Angle)),
+        static_cast<float>(Magnitude*std::sin(Angle)),
+    };
+}
+
+// The SIMD kernels perform exactly the same operations in the same order. Keep them in sync.
+state step(state State, vec2 Accel, const params& Params){
+    auto MaxSpeed = BaseSpeed*Params.SpeedScale;
+    auto MaxAccel = BaseAccel*Params.SpeedScale;
+
+    auto& [Position, Velocity] = State;
+
+    auto AccelLen = std::sqrt(Accel.x*Accel.x + Accel.y*Accel.y);
+
+    vec2 Dir = {0.0f, 0.0f};
+    if(AccelLen > 0.0f){
+        Dir = {Accel.x/AccelLen, Accel.y/AccelLen};
+    }
+
+    if(AccelLen > MaxAccel){
+        Accel = {MaxAccel*Dir.x, MaxAccel*Dir.y};
+    }
+
+    auto Friction = Params.DeltaTime*Params.Friction;
+    auto Speed = std::sqrt(Velocity.x*Velocity.x + Velocity.y*Velocity.y);
+
+    Velocity.x -= Friction*(Velocity.x - Speed*Dir.x);
+    Velocity.y -= Friction*(Velocity.y - Speed*Dir.y);
+
+    Velocity.x += Params.DeltaTime*Accel.x;
+    Velocity.y += Params.DeltaTime*Accel.y;
+
+    Speed = std::sqrt(Velocity.x*Velocity.x + Velocity.y*Velocity.y);
+    if(Speed > MaxSpeed){
+        Velocity = {MaxSpeed*(Velocity.x/Speed), MaxSpeed*(Velocity.y/Speed)};
+    }
+
+    Position.x += Params.DeltaTime*Velocity.x;
+    Position.y += Params.DeltaTime*Velocity.y;
+
+    return State;
+}
+
+batch::batch(std::size_t Size){
+    resize(Size);
+}
+
+void batch::resize(std::size_t Size){
+    PositionX.resize(Size);
+    PositionY.resize(Size);
+    VelocityX.resize(Size);
+    VelocityY.resize(Size);
+}
+
+state batch::get(std::size_t i) const {
+    return {{PositionX[i], PositionY[i]}, {VelocityX[i], VelocityY[i]}};
+}
+
+void batch::set(std::size_t i, const state& State){
+    PositionX[i] = State.Position.x;
+    PositionY[i] = State.Position.y;
+    VelocityX[i] = State.Velocity.x;
+    VelocityY[i] = State.Velocity.y;
+}
+
+simd_level simd_support(){
+    static const auto Level = detect_simd();
+
+    return Level;
+}
+
+void step(batch_view Batch, const float* AccelX, const float* AccelY, const params& Params){
+    step(Batch, AccelX, AccelY, Params, simd_support());
+}
+
+void step(batch_view Batch, const float* AccelX, const float* AccelY, const params& Params,
+        simd_level Level){
+    std::size_t Done = 0;
+
+#if MVMT_X86
+    switch(Level){
+        case simd_level::Avx: {
+            Done = step_avx(Batch, AccelX, AccelY, Params);
+            break;
+        }
+        case simd_level::Sse2: {
+            Done = step_sse2(Batch, AccelX, AccelY, Params);
+            break;
+        }
+        case simd_level::Scalar: {
+            break;
+        }
+    }
+#else
+    (void)Level;
+#endif
+
+    for(auto i = Done; i < Batch.Size; ++i){
+        auto State = step({
+            {Batch.PositionX[i], Batch.PositionY[i]},
+            {Batch.VelocityX[i], Batch.VelocityY[i]},
+        }, {AccelX[i], AccelY[i]}, Params);
+
+        Batch.PositionX[i] = State.Position.x;
+        Batch.PositionY[i] = State.Position.y;
+        Batch.VelocityX[i] = State.Velocity.x;
+        Batch.VelocityY[i] = State.Velocity.y;
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+﻿#include "kernels.h"
+
+#if MVMT_X86
+
+#include <immintrin.h>
+
+namespace mvmt {
+
+std::size_t step_avx(batch_view Batch, const float* AccelX, const float* AccelY,
+        const params& Params){
+    auto Zero = _mm256_setzero_ps();
+    auto MaxSpeed = _mm256_set1_ps(BaseSpeed*Params.SpeedScale);
+    auto MaxAccel = _mm256_set1_ps(BaseAccel*Params.SpeedScale);
+    auto DeltaTime = _mm256_set1_ps(Params.DeltaTime);
+    auto Friction = _mm256_set1_ps(Params.DeltaTime*Params.Friction);
+
+    auto End = Batch.Size & ~std::size_t(7);
+
+    for(std::size_t i = 0; i < End; i += 8){
+        auto Ax = _mm256_loadu_ps(AccelX+i);
+        auto Ay = _mm256_loadu_ps(AccelY+i);
+        auto Px = _mm256_loadu_ps(Batch.PositionX+i);
+        auto Py = _mm256_loadu_ps(Batch.PositionY+i);
+        auto Vx = _mm256_loadu_ps(Batch.VelocityX+i);
+        auto Vy = _mm256_loadu_ps(Batch.VelocityY+i);
+
+        auto AccelLen = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(Ax, Ax), _mm256_mul_ps(Ay, Ay)));
+
+        auto NonZero = _mm256_cmp_ps(AccelLen, Zero, _CMP_GT_OQ);
+        auto Dx = _mm256_and_ps(NonZero, _mm256_div_ps(Ax, AccelLen));
+        auto Dy = _mm256_and_ps(NonZero, _mm256_div_ps(Ay, AccelLen));
+
+        auto Clamp = _mm256_cmp_ps(AccelLen, MaxAccel, _CMP_GT_OQ);
+        Ax = _mm256_blendv_ps(Ax, _mm256_mul_ps(MaxAccel, Dx), Clamp);
+        Ay = _mm256_blendv_ps(Ay, _mm256_mul_ps(MaxAccel, Dy), Clamp);
+
+        auto Speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(Vx, Vx), _mm256_mul_ps(Vy, Vy)));
+
+        Vx = _mm256_sub_ps(Vx, _mm256_mul_ps(Friction, _mm256_sub_ps(Vx, _mm256_mul_ps(Speed, Dx))));
+        Vy = _mm256_sub_ps(Vy, _mm256_mul_ps(Friction, _mm256_sub_ps(Vy, _mm256_mul_ps(Speed, Dy))));
+
+        Vx = _mm256_add_ps(Vx, _mm256_mul_ps(DeltaTime, Ax));
+        Vy = _mm256_add_ps(Vy, _mm256_mul_ps(DeltaTime, Ay));
+
+        Speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(Vx, Vx), _mm256_mul_ps(Vy, Vy)));
+
+        auto Limit = _mm256_cmp_ps(Speed, MaxSpeed, _CMP_GT_OQ);
+        Vx = _mm256_blendv_ps(Vx, _mm256_mul_ps(MaxSpeed, _mm256_div_ps(Vx, Speed)), Limit);
+        Vy = _mm256_blendv_ps(Vy, _mm256_mul_ps(MaxSpeed, _mm256_div_ps(Vy, Speed)), Limit);
+
+        Px = _mm256_add_ps(Px, _mm256_mul_ps(DeltaTime, Vx));
+        Py = _mm256_add_ps(Py, _mm256_mul_ps(DeltaTime, Vy));
+
+        _mm256_storeu_ps(Batch.PositionX+i, Px);
+        _mm256_storeu_ps(Batch.PositionY+i, Py);
+        _mm256_storeu_ps(Batch.VelocityX+i, Vx);
+        _mm256_storeu_ps(Batch.VelocityY+i, Vy);
+    }
+
+    _mm256_zeroupper();
+
+    return End;
+}
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+﻿#include "kernels.h"
+
+#if MVMT_X86
+
+#include <emmintrin.h>
+
+namespace mvmt {
+
+std::size_t step_sse2(batch_view Batch, const float* AccelX, const float* AccelY,
+        const params& Params){
+    auto Zero = _mm_setzero_ps();
+    auto MaxSpeed = _mm_set1_ps(BaseSpeed*Params.SpeedScale);
+    auto MaxAccel = _mm_set1_ps(BaseAccel*Params.SpeedScale);
+    auto DeltaTime = _mm_set1_ps(Params.DeltaTime);
+    auto Friction = _mm_set1_ps(Params.DeltaTime*Params.Friction);
+
+    auto select = [](__m128 Mask, __m128 a, __m128 b){
+        return _mm_or_ps(_mm_and_ps(Mask, a), _mm_andnot_ps(Mask, b));
+    };
+
+    auto End = Batch.Size & ~std::size_t(3);
+
+    for(std::size_t i = 0; i < End; i += 4){
+        auto Ax = _mm_loadu_ps(AccelX+i);
+        auto Ay = _mm_loadu_ps(AccelY+i);
+        auto Px = _mm_loadu_ps(Batch.PositionX+i);
+        auto Py = _mm_loadu_ps(Batch.PositionY+i);
+        auto Vx = _mm_loadu_ps(Batch.VelocityX+i);
+        auto Vy = _mm_loadu_ps(Batch.VelocityY+i);
+
+        auto AccelLen = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(Ax, Ax), _mm_mul_ps(Ay, Ay)));
+
+        auto NonZero = _mm_cmpgt_ps(AccelLen, Zero);
+        auto Dx = _mm_and_ps(NonZero, _mm_div_ps(Ax, AccelLen));
+        auto Dy = _mm_and_ps(NonZero, _mm_div_ps(Ay, AccelLen));
+
+        auto Clamp = _mm_cmpgt_ps(AccelLen, MaxAccel);
+        Ax = select(Clamp, _mm_mul_ps(MaxAccel, Dx), Ax);
+        Ay = select(Clamp, _mm_mul_ps(MaxAccel, Dy), Ay);
+
+        auto Speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(Vx, Vx), _mm_mul_ps(Vy, Vy)));
+
+        Vx = _mm_sub_ps(Vx, _mm_mul_ps(Friction, _mm_sub_ps(Vx, _mm_mul_ps(Speed, Dx))));
+        Vy = _mm_sub_ps(Vy, _mm_mul_ps(Friction, _mm_sub_ps(Vy, _mm_mul_ps(Speed, Dy))));
+
+        Vx = _mm_add_ps(Vx, _mm_mul_ps(DeltaTime, Ax));
+        Vy = _mm_add_ps(Vy, _mm_mul_ps(DeltaTime, Ay));
+
+        Speed = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(Vx, Vx), _mm_mul_ps(Vy, Vy)));
+
+        auto Limit = _mm_cmpgt_ps(Speed, MaxSpeed);
+        Vx = select(Limit, _mm_mul_ps(MaxSpeed, _mm_div_ps(Vx, Speed)), Vx);
+        Vy = select(Limit, _mm_mul_ps(MaxSpeed, _mm_div_ps(Vy, Speed)), Vy);
+
+        Px = _mm_add_ps(Px, _mm_mul_ps(DeltaTime, Vx));
+        Py = _mm_add_ps(Py, _mm_mul_ps(DeltaTime, Vy));
+
+        _mm_storeu_ps(Batch.PositionX+i, Px);
+        _mm_storeu_ps(Batch.PositionY+i, Py);
+        _mm_storeu_ps(Batch.VelocityX+i, Vx);
+        _mm_storeu_ps(Batch.VelocityY+i, Vy);
+    }
+
+    return End;
+}
+
+}
+
+#endif
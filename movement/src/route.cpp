@@ -0,0 +1,260 @@
+﻿#include <route.h>
+
+#include <work_pool.h>
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace mvmt {
+
+namespace {
+
+constexpr auto Infinity = std::numeric_limits<float>::infinity();
+
+struct link {
+    std::uint32_t Parent;
+    std::uint32_t Choice;
+};
+
+struct found_node {
+    float Time = Infinity;
+    std::size_t Index = 0;
+};
+
+std::uint64_t merge_key(const state& State, float Scale){
+    auto q = [Scale](float x){
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+            static_cast<std::int32_t>(std::floor(x*Scale))));
+    };
+
+    // Good enough to tell nearby nodes apart, an occasional collision only drops a node.
+    auto Key = q(State.Position.x);
+    Key = Key*0x9E3779B97F4A7C15 ^ q(State.Position.y);
+    Key = Key*0x9E3779B97F4A7C15 ^ q(State.Velocity.x);
+    Key = Key*0x9E3779B97F4A7C15 ^ q(State.Velocity.y);
+    return Key;
+}
+
+}
+
+route_result find_route(const route_problem& Problem, work_pool& Pool){
+    auto FrameTimeCount = Problem.FrameTimes.size();
+    auto HeadingCount = Problem.Headings.size();
+    auto Choices = FrameTimeCount*HeadingCount;
+
+    if(Choices == 0){
+        throw std::invalid_argument("No frame times or headings to choose from.");
+    }
+
+    if(Problem.BeamWidth == 0 || Problem.BeamWidth*Choices > std::numeric_limits<std::uint32_t>::max()){
+        throw std::invalid_argument("Invalid beam width.");
+    }
+
+    std::vector<float> AccelX(HeadingCount), AccelY(HeadingCount);
+    for(std::size_t i = 0; i < HeadingCount; ++i){
+        auto Accel = heading_accel(Problem.Headings[i], Problem.Accel);
+
+        AccelX[i] = Accel.x;
+        AccelY[i] = Accel.y;
+    }
+
+    auto MaxSpeed = BaseSpeed*Problem.SpeedScale;
+
+    auto distance = [&Problem](const state& State){
+        return std::hypot(State.Position.x-Problem.Goal.x, State.Position.y-Problem.Goal.y);
+    };
+
+    batch Current(1);
+    std::vector<float> Elapsed = {0.0f};
+    Current.set(0, Problem.Start);
+
+    // `History[d][i]` links node `i` after `d+1` frames to its parent.
+    std::vector<std::vector<link>> History;
+
+    auto reconstruct = [&](std::size_t Depth, std::size_t Index){
+        std::vector<route_step> r;
+
+        for(; Depth > 0; --Depth){
+            auto Link = History[Depth-1][Index];
+            r.push_back({
+                Problem.FrameTimes[Link.Choice/HeadingCount],
+                Problem.Headings[Link.Choice%HeadingCount],
+            });
+
+            Index = Link.Parent;
+        }
+
+        std::reverse(r.begin(), r.end());
+        return r;
+    };
+
+    route_result Result = {false, 0.0f, {}, Problem.Start, 0};
+
+    auto BestTime = Infinity;
+
+    auto ClosestDistance = distance(Problem.Start);
+    std::size_t ClosestDepth = 0, ClosestIndex = 0;
+
+    batch Children;
+    std::vector<float> ChildElapsed, Score, Distance;
+    std::vector<found_node> Found(Pool.size());
+
+    std::vector<std::uint32_t> Candidates;
+    std::unordered_set<std::uint64_t> Merged;
+
+    for(std::size_t Depth = 0; Depth < Problem.MaxFrames && Current.size() > 0; ++Depth){
+        auto Parents = Current.size();
+        auto Count = Parents*Choices;
+
+        Children.resize(Count);
+        ChildElapsed.resize(Count);
+        Score.resize(Count);
+        Distance.resize(Count);
+
+        std::fill(Found.begin(), Found.end(), found_node{});
+
+        Pool.parallel_for(Parents, std::max<std::size_t>(1, 1024/Choices),
+            [&](std::size_t Begin, std::size_t End, unsigned Worker){
+                for(auto p = Begin; p < End; ++p){
+                    auto Parent = Current.get(p);
+
+                    for(std::size_t k = 0; k < FrameTimeCount; ++k){
+                        auto DeltaTime = Problem.FrameTimes[k];
+                        auto First = p*Choices+k*HeadingCount;
+
+                        for(std::size_t h = 0; h < HeadingCount; ++h){
+                            Children.set(First+h, Parent);
+                        }
+
+                        step(Children.view().subview(First, First+HeadingCount),
+                            AccelX.data(), AccelY.data(),
+                            {DeltaTime, Problem.SpeedScale, Problem.Friction});
+
+                        for(auto i = First; i < First+HeadingCount; ++i){
+                            auto Time = Elapsed[p]+DeltaTime;
+                            auto Dist = distance(Children.get(i));
+
+                            ChildElapsed[i] = Time;
+                            Distance[i] = Dist;
+
+                            if(Dist <= Problem.GoalRadius){
+                                // Reached nodes are not expanded further.
+                                Score[i] = Infinity;
+
+                                if(Time < Found[Worker].Time){
+                                    Found[Worker] = {Time, i};
+                                }
+                            }else{
+                                // A lower bound on the total time since speed is limited.
+                                Score[i] = Time+(Dist-Problem.GoalRadius)/MaxSpeed;
+                            }
+                        }
+                    }
+                }
+            }
+        );
+
+        Result.Nodes += Count;
+
+        for(auto& e:Found){
+            if(e.Time < BestTime){
+                BestTime = e.Time;
+
+                Result.Steps = reconstruct(Depth, e.Index/Choices);
+                Result.Steps.push_back({
+                    Problem.FrameTimes[(e.Index%Choices)/HeadingCount],
+                    Problem.Headings[e.Index%HeadingCount],
+                });
+                Result.Final = Children.get(e.Index);
+            }
+        }
+
+        Candidates.clear();
+        for(std::size_t i = 0; i < Count; ++i){
+            if(Score[i] < BestTime){
+                Candidates.push_back(static_cast<std::uint32_t>(i));
+            }
+        }
+
+        auto by_score = [&Score](std::uint32_t a, std::uint32_t b){
+            return Score[a] < Score[b];
+        };
+
+        // Look a bit further than the beam so merged nodes can be replaced.
+        auto Keep = std::min(Candidates.size(),
+            Problem.MergeDistance > 0.0f ? 2*Problem.BeamWidth : Problem.BeamWidth);
+
+        if(Keep < Candidates.size()){
+            std::nth_element(Candidates.begin(), Candidates.begin()+Keep, Candidates.end(), by_score);
+            Candidates.resize(Keep);
+        }
+
+        batch Next;
+        std::vector<float> NextElapsed;
+        std::vector<link> Links;
+
+        if(Problem.MergeDistance > 0.0f){
+            std::sort(Candidates.begin(), Candidates.end(), by_score);
+
+            Merged.clear();
+            for(auto i:Candidates){
+                if(Links.size() == Problem.BeamWidth){
+                    break;
+                }
+
+                if(Merged.insert(merge_key(Children.get(i), 1.0f/Problem.MergeDistance)).second){
+                    Links.push_back({static_cast<std::uint32_t>(i/Choices), static_cast<std::uint32_t>(i%Choices)});
+                }
+            }
+        }else{
+            for(auto i:Candidates){
+                Links.push_back({static_cast<std::uint32_t>(i/Choices), static_cast<std::uint32_t>(i%Choices)});
+            }
+        }
+
+        Next.resize(Links.size());
+        NextElapsed.resize(Links.size());
+
+        for(std::size_t j = 0; j < Links.size(); ++j){
+            auto i = Links[j].Parent*Choices+Links[j].Choice;
+
+            Next.set(j, Children.get(i));
+            NextElapsed[j] = ChildElapsed[i];
+
+            if(Distance[i] < ClosestDistance){
+                ClosestDistance = Distance[i];
+                ClosestDepth = Depth+1;
+                ClosestIndex = j;
+            }
+        }
+
+        History.push_back(std::move(Links));
+
+        Current = std::move(Next);
+        Elapsed = std::move(NextElapsed);
+    }
+
+    if(BestTime < Infinity){
+        Result.Reached = true;
+        Result.Time = BestTime;
+    }else{
+        Result.Steps = reconstruct(ClosestDepth, ClosestIndex);
+
+        auto State = Problem.Start;
+        for(auto& e:Result.Steps){
+            auto Accel = heading_accel(e.Heading, Problem.Accel);
+            State = step(State, Accel, {e.DeltaTime, Problem.SpeedScale, Problem.Friction});
+
+            Result.Time += e.DeltaTime;
+        }
+
+        Result.Final = State;
+    }
+
+    return Result;
+}
+
+}
@@ -0,0 +1,133 @@
+﻿#include <strafe.h>
+
+#include <map>
+#include <cmath>
+#include <mutex>
+#include <tuple>
+#include <algorithm>
+
+namespace mvmt {
+
+namespace {
+
+int to_turn(double Angle){
+    // Python's `round` rounds half to even, as does `nearbyint` in the default rounding mode.
+    return static_cast<int>(std::nearbyint(RadToTurn*Angle));
+}
+
+}
+
+strafe_solution solve_strafe(vec2 Velocity, vec2 Target, const strafe_params& Params){
+    auto MaxAccel = BaseAccel*Params.SpeedScale;
+    auto Accel = std::min(Params.Accel, MaxAccel);
+
+    auto TargetLen = std::hypot(double(Target.x), double(Target.y));
+    double u1 = Target.x/TargetLen, u2 = Target.y/TargetLen;
+
+    auto Speed = std::hypot(double(Velocity.x), double(Velocity.y));
+    if(Speed == 0.0){
+        return {{float(u1), float(u2)}, Params.DeltaTime*Accel, true};
+    }
+
+    double w1 = Velocity.x/Speed, w2 = Velocity.y/Speed;
+
+    // After friction and acceleration the velocity is `c*w + k*d`.
+    auto c = Speed*(1.0-Params.DeltaTime*Params.Friction);
+    auto k = Params.DeltaTime*(Params.Friction*Speed + Accel);
+
+    auto uw = u1*w1 + u2*w2;
+    auto uw_ = -u1*w2 + u2*w1;
+
+    auto Disc = k*k - (c*uw_)*(c*uw_);
+    auto m = std::sqrt(std::max(Disc, 0.0)) + c*uw;
+
+    if(Disc >= 0.0 && m >= 0.0){
+        return {{float((m*u1 - c*w1)/k), float((m*u2 - c*w2)/k)}, m, true};
+    }
+
+    // Only possible when `c > k`. Turn as far as possible, i.e., make the new velocity tangent to
+    // the circle of reachable velocities, where `w·d = -k/c`.
+    auto wd = -k/c;
+    auto Side = std::copysign(std::sqrt(1.0-wd*wd), uw_);
+
+    return {
+        {float(wd*w1 - Side*w2), float(wd*w2 + Side*w1)},
+        std::sqrt(c*c - k*k),
+        false,
+    };
+}
+
+// Follows `compute_turn` operation for operation so the results match exactly.
+int strafe_turn(int Turn, const strafe_params& Params){
+    auto f = Params.Friction;
+    auto a = std::min(Params.Accel, BaseAccel*Params.SpeedScale)/(BaseSpeed*Params.SpeedScale);
+    auto dt = Params.DeltaTime;
+
+    auto u1 = std::cos(TurnToRad*Turn);
+    auto u2 = std::sin(TurnToRad*Turn);
+
+    auto dtaf = dt*(a+f);
+    auto dtf1 = dt*f-1.0;
+    auto dtf1u2 = dtf1*u2;
+
+    auto Disc = dtaf*dtaf - dtf1u2*dtf1u2;
+    auto m = std::sqrt(std::max(Disc, 0.0)) - dtf1*u1;
+
+    if(Disc >= 0.0 && m >= 0.0){
+        return to_turn(std::atan2(m*u2, m*u1 + dtf1));
+    }
+
+    auto wd = dtaf/dtf1;
+    return to_turn(std::copysign(std::acos(wd), u2));
+}
+
+void strafe_turns(const int* Turns, int* Out, std::size_t Count, const strafe_params& Params){
+    for(std::size_t i = 0; i < Count; ++i){
+        Out[i] = strafe_turn(Turns[i], Params);
+    }
+}
+
+int strafe_mouse_delta(vec2 Velocity, int Heading, int Yaw, const strafe_params& Params,
+        int KeyAngle){
+    auto Target = heading_accel(Heading, 1.0f);
+    return strafe_mouse_delta(solve_strafe(Velocity, Target, Params), Yaw, KeyAngle);
+}
+
+int strafe_mouse_delta(const strafe_solution& Solution, int Yaw, int KeyAngle){
+    auto Accel = to_turn(std::atan2(double(Solution.Direction.y), double(Solution.Direction.x)));
+
+    return static_cast<std::int16_t>(Accel-KeyAngle-Yaw);
+}
+
+turn_table::turn_table(const strafe_params& Params):Table(new std::int16_t[0x10000]) {
+    for(int i = 0; i < 0x10000; ++i){
+        Table[i] = static_cast<std::int16_t>(strafe_turn(static_cast<std::int16_t>(i), Params));
+    }
+}
+
+std::shared_ptr<const turn_table> get_turn_table(const strafe_params& Params){
+    static std::mutex Mutex;
+    static std::map<std::tuple<double, double, double, double>, std::shared_ptr<const turn_table>> Tables;
+
+    // Scripts tend to use a handful of frame times, so this rarely has to start over.
+    constexpr std::size_t MaxTables = 64;
+
+    auto Key = std::make_tuple(Params.DeltaTime, Params.SpeedScale, Params.Friction, Params.Accel);
+
+    std::lock_guard Lock(Mutex);
+
+    auto it = Tables.find(Key);
+    if(it != Tables.end()){
+        return it->second;
+    }
+
+    if(Tables.size() >= MaxTables){
+        Tables.clear();
+    }
+
+    auto r = std::make_shared<const turn_table>(Params);
+    Tables.emplace(Key, r);
+    return r;
+}
+
+}
@@ -0,0 +1,374 @@
+﻿// The tests are asserts, so they are kept in release builds.
+#undef NDEBUG
+
+#include <route.h>
+#include <strafe.h>
+#include <movement.h>
+#include <work_pool.h>
+
+#include <algorithm>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <cassert>
+#include <stdexcept>
+
+namespace {
+
+bool close(double a, double b, double Epsilon = 1e-3){
+    return std::abs(a-b) <= Epsilon*std::max(1.0, std::abs(b));
+}
+
+double length(mvmt::vec2 v){
+    return std::hypot(v.x, v.y);
+}
+
+// Accelerating from rest in a straight line there is no friction, so the speed after `n` frames is
+// simply `min(n*Δt*|a|, MaxSpeed)`.
+void test_straight_line(){
+    for(auto Scale:{mvmt::WalkScale, mvmt::SprintScale, mvmt::AgilityScale}){
+        mvmt::params Params = {1.0f/60.0f, Scale};
+
+        auto Accel = mvmt::heading_accel(5000);
+
+        mvmt::state State = {};
+        double Distance = 0.0;
+
+        for(int n = 1; n <= 120; ++n){
+            State = mvmt::step(State, Accel, Params);
+
+            auto Expected = std::min(n*Params.DeltaTime*mvmt::BaseAccel, mvmt::BaseSpeed*Scale);
+            assert(close(length(State.Velocity), Expected));
+            assert(close(std::atan2(State.Velocity.y, State.Velocity.x), mvmt::TurnToRad*5000));
+
+            Distance += Params.DeltaTime*Expected;
+            assert(close(length(State.Position), Distance));
+        }
+    }
+}
+
+// At Δt = 1/f friction redirects all previous speed, so `v = |v|*d + Δt*a`.
+void test_eight_fps(){
+    mvmt::params Params = {1.0f/8.0f};
+
+    mvmt::state State = {{10.0f, 20.0f}, {100.0f, 0.0f}};
+    State = mvmt::step(State, {0.0f, 2000.0f}, Params);
+
+    assert(close(State.Velocity.x, 0.0));
+    assert(close(State.Velocity.y, 100.0 + 250.0));
+    assert(close(State.Position.x, 10.0));
+    assert(close(State.Position.y, 20.0 + 350.0/8.0));
+
+    // Over `MaxSpeed` the result is clamped in the same direction.
+    State = {{}, {400.0f, 0.0f}};
+    State = mvmt::step(State, {-2000.0f, 0.0f}, Params);
+
+    assert(close(State.Velocity.x, -400.0));
+    assert(close(State.Velocity.y, 0.0));
+}
+
+void test_accel_clamp(){
+    mvmt::params Params = {1.0f/30.0f, mvmt::SprintScale};
+
+    mvmt::state Start = {{}, {123.0f, -45.0f}};
+
+    auto a = mvmt::step(Start, mvmt::heading_accel(-12000, 50000.0f), Params);
+    auto b = mvmt::step(Start, mvmt::heading_accel(-12000, mvmt::BaseAccel*Params.SpeedScale), Params);
+
+    assert(close(a.Velocity.x, b.Velocity.x));
+    assert(close(a.Velocity.y, b.Velocity.y));
+}
+
+// With `v = MaxSpeed*w` and `|a| = 2000`, accelerating in the direction `d` from the paper moves
+// the player in the direction `u`.
+void test_inverse(){
+    std::mt19937 Rng(1);
+    std::uniform_real_distribution<double> Angle(-3.14159, 3.14159);
+
+    for(auto Scale:{mvmt::WalkScale, mvmt::SprintScale, mvmt::AgilityScale}){
+        for(auto DeltaTime:{1.0/250.0, 1.0/60.0, 1.0/30.0, 1.0/10.0, 0.4}){
+            for(int i = 0; i < 100; ++i){
+                auto WAngle = Angle(Rng);
+
+                // Only small turns are reachable at high frame rates.
+                auto Turn = Angle(Rng)*std::min(1.0, DeltaTime*8.0)/4.0;
+                auto UAngle = WAngle+Turn;
+
+                double w1 = std::cos(WAngle), w2 = std::sin(WAngle);
+                double u1 = std::cos(UAngle), u2 = std::sin(UAngle);
+
+                auto f = static_cast<double>(mvmt::DefaultFriction);
+                auto a = 5.0/Scale;
+
+                auto dtaf = DeltaTime*(a+f);
+                auto dtf1 = DeltaTime*f-1.0;
+
+                auto uw = u1*w1 + u2*w2;
+                auto uw_ = -u1*w2 + u2*w1;
+
+                auto m = std::sqrt(dtaf*dtaf - (dtf1*uw_)*(dtf1*uw_)) - dtf1*uw;
+
+                auto d1 = (m*u1 + dtf1*w1)/dtaf;
+                auto d2 = (m*u2 + dtf1*w2)/dtaf;
+
+                assert(close(std::hypot(d1, d2), 1.0));
+
+                auto MaxSpeed = mvmt::BaseSpeed*Scale;
+
+                mvmt::state State = {{}, {
+                    static_cast<float>(MaxSpeed*w1), static_cast<float>(MaxSpeed*w2),
+                }};
+
+                State = mvmt::step(State, {
+                    static_cast<float>(mvmt::BaseAccel*d1), static_cast<float>(mvmt::BaseAccel*d2),
+                }, {static_cast<float>(DeltaTime), Scale});
+
+                auto Result = std::atan2(State.Velocity.y, State.Velocity.x);
+                assert(std::abs(std::remainder(Result-UAngle, 2.0*3.14159265358979)) < 1e-4);
+                assert(close(length(State.Velocity), std::min(m*MaxSpeed, double(MaxSpeed))));
+            }
+        }
+    }
+}
+
+void test_batch(){
+    std::mt19937 Rng(2);
+    std::uniform_real_distribution<float> Value(-600.0f, 600.0f);
+    std::uniform_real_distribution<float> Accel(-3000.0f, 3000.0f);
+
+    constexpr std::size_t Count = 1003;
+
+    mvmt::batch Start(Count);
+    std::vector<float> AccelX(Count), AccelY(Count);
+
+    for(std::size_t i = 0; i < Count; ++i){
+        Start.set(i, {{Value(Rng), Value(Rng)}, {Value(Rng), Value(Rng)}});
+
+        AccelX[i] = Accel(Rng);
+        AccelY[i] = Accel(Rng);
+    }
+
+    AccelX[7] = AccelY[7] = 0.0f;
+
+    mvmt::params Params = {1.0f/47.0f, mvmt::AgilityScale};
+
+    auto Expected = Start;
+    for(std::size_t i = 0; i < Count; ++i){
+        auto State = Expected.get(i);
+        for(int n = 0; n < 10; ++n){
+            State = mvmt::step(State, {AccelX[i], AccelY[i]}, Params);
+        }
+        Expected.set(i, State);
+    }
+
+    for(auto Level:{mvmt::simd_level::Scalar, mvmt::simd_level::Sse2, mvmt::simd_level::Avx}){
+        if(Level > mvmt::simd_support()){
+            continue;
+        }
+
+        auto Batch = Start;
+        for(int n = 0; n < 10; ++n){
+            mvmt::step(Batch.view(), AccelX.data(), AccelY.data(), Params, Level);
+        }
+
+        // Bit for bit identical, including the tail that does not fill a vector.
+        assert(Batch.PositionX == Expected.PositionX);
+        assert(Batch.PositionY == Expected.PositionY);
+        assert(Batch.VelocityX == Expected.VelocityX);
+        assert(Batch.VelocityY == Expected.VelocityY);
+    }
+}
+
+// Going straight for the goal is optimal from rest, so the route should stay close to heading 0
+// and take about as long as accelerating to `MaxSpeed` and then running the rest of the way.
+void test_route(){
+    work_pool Pool(4);
+
+    mvmt::route_problem Problem = {
+        .Start = {},
+        .Goal = {1000.0f, 0.0f},
+        .GoalRadius = 10.0f,
+        .FrameTimes = {1.0f/60.0f, 1.0f/30.0f},
+        .Headings = {-16384, -2048, 0, 2048, 16384, 32768},
+        .BeamWidth = 256,
+    };
+
+    auto Result = mvmt::find_route(Problem, Pool);
+
+    assert(Result.Reached);
+
+    auto Expected = 0.2 + (990.0-40.0)/400.0;
+    assert(std::abs(Result.Time-Expected) <= 1.0/30.0);
+
+    mvmt::state State = Problem.Start;
+    float Time = 0.0f;
+    for(auto& e:Result.Steps){
+        assert(std::abs(e.Heading) <= 2048);
+
+        State = mvmt::step(State, mvmt::heading_accel(e.Heading), {e.DeltaTime});
+        Time += e.DeltaTime;
+    }
+
+    assert(State.Position.x == Result.Final.Position.x && State.Position.y == Result.Final.Position.y);
+    assert(close(Time, Result.Time));
+    assert(std::hypot(State.Position.x-1000.0f, State.Position.y) <= Problem.GoalRadius);
+
+    // Out of reach, the closest route is returned instead.
+    Problem.MaxFrames = 10;
+    Result = mvmt::find_route(Problem, Pool);
+
+    assert(!Result.Reached);
+    assert(Result.Steps.size() == 10);
+    assert(Result.Final.Position.x > 0.0f);
+}
+
+// A throw on any worker comes out of `parallel_for` once the others are done, and the pool still
+// works afterwards.
+void test_pool_exception(){
+    work_pool Pool(4);
+
+    for(std::size_t Bad:{std::size_t(0), std::size_t(999)}){
+        std::atomic<std::size_t> Done = 0;
+
+        bool Thrown = false;
+        try {
+            Pool.parallel_for(1000, 1, [&](std::size_t Begin, std::size_t End, unsigned){
+                if(Begin <= Bad && Bad < End){
+                    throw std::runtime_error("bad");
+                }
+
+                Done += End-Begin;
+            });
+        }catch(std::runtime_error&){
+            Thrown = true;
+        }
+
+        assert(Thrown);
+        assert(Done < 1000);
+    }
+
+    std::atomic<std::size_t> Sum = 0;
+    Pool.parallel_for(1000, 7, [&](std::size_t Begin, std::size_t End, unsigned){
+        for(auto i = Begin; i < End; ++i){
+            Sum += i;
+        }
+    });
+
+    assert(Sum == 999*1000/2);
+}
+
+// Values from `compute_turn` in utilities.py.
+void test_strafe_turn(){
+    struct {
+        int Turn;
+        double DeltaTime;
+        int Expected;
+    } Cases[] = {
+        {-8192, 1.0/2.5, -4539},
+        {1000, 1.0/60.0, 5743},
+        {100, 1.0/250.0, 2250},
+        {-30000, 1.0/8.0, -30000},
+        {2000, 1.0/30.0, 5953},
+    };
+
+    for(auto& e:Cases){
+        mvmt::strafe_params Params = {e.DeltaTime};
+
+        assert(mvmt::strafe_turn(e.Turn, Params) == e.Expected);
+        assert((*mvmt::get_turn_table(Params))(e.Turn) == e.Expected);
+    }
+
+    // The table agrees with the direct computation everywhere.
+    mvmt::strafe_params Params = {1.0/30.0, 1.95};
+    auto Table = mvmt::get_turn_table(Params);
+    assert(Table == mvmt::get_turn_table(Params));
+
+    for(int Turn = -32768; Turn < 32768; ++Turn){
+        assert((*Table)(Turn) == static_cast<std::int16_t>(mvmt::strafe_turn(Turn, Params)));
+    }
+}
+
+// Simulating a frame with the solution moves the player in the requested direction, at any speed
+// and velocity direction.
+void test_solve_strafe(){
+    std::mt19937 Rng(3);
+    std::uniform_real_distribution<double> Angle(-3.14159, 3.14159);
+    std::uniform_real_distribution<double> Fraction(0.0, 1.2);
+
+    int Reachable = 0;
+
+    for(auto Scale:{1.0, 1.5, 1.95}){
+        for(auto DeltaTime:{1.0/250.0, 1.0/60.0, 1.0/8.0, 0.4}){
+            for(int i = 0; i < 200; ++i){
+                auto Speed = Fraction(Rng)*mvmt::BaseSpeed*Scale;
+                auto WAngle = Angle(Rng), UAngle = Angle(Rng);
+
+                mvmt::vec2 Velocity = {float(Speed*std::cos(WAngle)), float(Speed*std::sin(WAngle))};
+                mvmt::vec2 Target = {float(std::cos(UAngle)), float(std::sin(UAngle))};
+
+                mvmt::strafe_params Params = {DeltaTime, Scale};
+                auto Solution = mvmt::solve_strafe(Velocity, Target, Params);
+
+                assert(close(std::hypot(Solution.Direction.x, Solution.Direction.y), 1.0));
+
+                auto State = mvmt::step({{}, Velocity}, {
+                    float(mvmt::BaseAccel*Solution.Direction.x), float(mvmt::BaseAccel*Solution.Direction.y),
+                }, {float(DeltaTime), float(Scale)});
+
+                auto Result = std::atan2(State.Velocity.y, State.Velocity.x);
+                auto Error = std::abs(std::remainder(Result-UAngle, 2.0*3.14159265358979));
+
+                if(Solution.Reachable){
+                    ++Reachable;
+
+                    assert(Error < 1e-3);
+                    assert(close(length(State.Velocity), std::min(Solution.Speed, mvmt::BaseSpeed*Scale)));
+                }else{
+                    // Turning as far as possible, so any other direction ends up further away.
+                    for(auto Delta:{-0.01, 0.01}){
+                        auto Angle = std::atan2(Solution.Direction.y, Solution.Direction.x)+Delta;
+
+                        auto Other = mvmt::step({{}, Velocity}, {
+                            float(mvmt::BaseAccel*std::cos(Angle)), float(mvmt::BaseAccel*std::sin(Angle)),
+                        }, {float(DeltaTime), float(Scale)});
+
+                        auto OtherResult = std::atan2(Other.Velocity.y, Other.Velocity.x);
+                        assert(std::abs(std::remainder(OtherResult-UAngle, 2.0*3.14159265358979)) >= Error-1e-4);
+                    }
+                }
+            }
+        }
+    }
+
+    assert(Reachable > 0);
+
+    // At `MaxSpeed` this is the same as `strafe_turn`.
+    mvmt::strafe_params Params = {1.0/60.0};
+    for(int Turn = -4000; Turn <= 4000; Turn += 100){
+        auto Target = mvmt::heading_accel(Turn, 1.0f);
+        auto Solution = mvmt::solve_strafe({mvmt::BaseSpeed*mvmt::SprintScale, 0.0f}, Target, Params);
+
+        auto Accel = mvmt::RadToTurn*std::atan2(Solution.Direction.y, Solution.Direction.x);
+        assert(std::abs(Accel-mvmt::strafe_turn(Turn, Params)) <= 2.0);
+    }
+}
+
+}
+
+int main(){
+    test_straight_line();
+    test_eight_fps();
+    test_accel_clamp();
+    test_inverse();
+    test_batch();
+    test_route();
+    test_pool_exception();
+    test_strafe_turn();
+    test_solve_strafe();
+
+    std::printf("All tests passed.\n");
+
+    return 0;
+}
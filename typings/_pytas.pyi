@@ -1,4 +1,4 @@
-from typing import TypedDict
+from typing import Iterable, Literal, Sequence, TypedDict, overload
 
 FREQUENCY = 10000000
 
@@ -183,12 +183,42 @@ def get_frame_time() -> int:
 def set_frame_wait(wait: bool):
     pass
 
+def set_message_interval(interval: int):
+    pass
+
+def set_movie_speed(speed: Literal["real", "fast", "skip"]):
+    pass
+
 def is_in_movie() -> bool:
     pass
 
 def save_cloud(name: str) -> bool:
     pass
 
+def save_documents(name: str) -> bool:
+    pass
+
+def game_log() -> str:
+    pass
+
+def save_game_log(name: str) -> bool:
+    pass
+
+def package_loads() -> list[tuple[str, float, int, int]]:
+    pass
+
+def flush_cloud():
+    pass
+
+def save_cloud_snapshot(name: str):
+    pass
+
+def load_cloud_snapshot(name: str):
+    pass
+
+def delete_cloud_snapshot(name: str) -> bool:
+    pass
+
 def save_state() -> __STATE:
     pass
 
@@ -203,6 +233,133 @@ def load_state(
 ):
     pass
 
+class MemoryStats(TypedDict):
+    pages: int
+    copied: int
+    written: int
+    missing: int
+
+def save_memory(name: str) -> MemoryStats:
+    pass
+
+def load_memory(name: str) -> MemoryStats:
+    pass
+
+def delete_memory(name: str) -> bool:
+    pass
+
+def set_memory_cache(budget: int, *, memory: int = 256 << 20):
+    pass
+
+class MemoryCacheStats(TypedDict):
+    snapshots: int
+    pages: int
+    references: int
+    compressed: int
+    spilled: int
+    memory_bytes: int
+    spill_bytes: int
+
+def get_memory_stats() -> MemoryCacheStats:
+    pass
+
+def memory_view(address: int, size: int, *, writable: bool = False) -> memoryview:
+    pass
+
+def start_hash_log(path: str):
+    pass
+
+def stop_hash_log():
+    pass
+
+def set_hash_region(name: str, address: int, size: int):
+    pass
+
+def remove_hash_region(name: str) -> bool:
+    pass
+
+def get_frame_hashes() -> dict[str, int]:
+    pass
+
+WatchType = Literal["i8", "u8", "i16", "u16", "i32", "u32", "i64", "u64", "f32", "f64", "ptr"]
+
+def add_watch(name: str, base: int, offsets: Sequence[int], type: WatchType, *, relative: bool = True):
+    pass
+
+def remove_watch(name: str) -> bool:
+    pass
+
+def clear_watches():
+    pass
+
+def refresh_watches():
+    pass
+
+def get_watches() -> bytearray:
+    pass
+
+def get_watch_layout() -> dict[str, tuple[int, str, int]]:
+    pass
+
+def get_watch(name: str) -> int | float | None:
+    pass
+
+def start_trace(path: str, watches: Sequence[str] | None = None):
+    pass
+
+def stop_trace():
+    pass
+
+def flush_trace():
+    pass
+
+ScanCompare = Literal["exact", "unknown", "changed", "unchanged", "increased", "decreased"]
+
+def scan_first(type: WatchType, compare: ScanCompare = "exact", value: int | float | None = None) -> int:
+    pass
+
+def scan_next(compare: ScanCompare, value: int | float | None = None) -> int:
+    pass
+
+def scan_results(max: int = 100) -> list[tuple[int, int | float]]:
+    pass
+
+def scan_reset():
+    pass
+
+def load_code_index(path: str) -> int:
+    pass
+
+def code_function(address: int) -> tuple[int, int] | None:
+    pass
+
+def code_callers(address: int) -> list[int]:
+    pass
+
+def code_references(address: int) -> list[tuple[int, Literal["call", "jump", "data"]]]:
+    pass
+
+def code_string_refs(text: str) -> list[int]:
+    pass
+
+def ue3_init(layout: dict[str, int], objects: int = 0, names: int = 0) -> int:
+    pass
+
+def ue3_find(path: str) -> int | None:
+    pass
+
+def ue3_instances(class_name: str) -> list[int]:
+    pass
+
+def ue3_path(address: int) -> str | None:
+    pass
+
+def ue3_properties(address: int) -> list[tuple[str, str, int, int, int]]:
+    pass
+
+def ue3_get(address: int, name: str) -> object:
+    pass
+
 def get_mouse_pos() -> tuple[int, int]:
     pass
 
@@ -247,3 +404,63 @@ def set_gamepad_rtrigger(value: float):
 
 def set_gamepad_button(button: int, down: bool):
     pass
+
+def get_frame_count() -> int:
+    pass
+
+def schedule_key(key: int, down: bool, *, frame: int = ..., offset: int = ...):
+    pass
+
+def schedule_mouse(x: int = ..., y: int = ..., *, frame: int = ..., offset: int = ...):
+    pass
+
+def schedule_scroll(value: float, *, frame: int = ..., offset: int = ...):
+    pass
+
+def get_scheduled_count() -> int:
+    pass
+
+def clear_schedule():
+    pass
+
+Vec2 = tuple[float, float]
+
+def simulate_movement(
+    position: Vec2, velocity: Vec2, accelerations: Iterable[Vec2], dt: float,
+    scale: float = 1.0, friction: float = 8.0,
+) -> list[tuple[Vec2, Vec2]]:
+    pass
+
+def simulate_movement_batch(
+    positions: Sequence[Vec2], velocities: Sequence[Vec2], accelerations: Sequence[Vec2],
+    dt: float, scale: float = 1.0, friction: float = 8.0, *, frames: int = 1,
+) -> list[tuple[Vec2, Vec2]]:
+    pass
+
+class Route(TypedDict):
+    reached: bool
+    time: float
+    steps: list[tuple[int, int]]
+    position: Vec2
+    velocity: Vec2
+    nodes: int
+
+def find_route(
+    position: Vec2, velocity: Vec2, goal: Vec2, radius: float,
+    frame_times: Sequence[int], headings: Sequence[int],
+    *, scale: float = 1.0, beam_width: int = 4096, max_frames: int = 256,
+) -> Route:
+    pass
+
+@overload
+def strafe_turn(turn: int, dt: float, *, scale: float = 1.5) -> int:
+    pass
+
+@overload
+def strafe_turn(turn: Sequence[int], dt: float, *, scale: float = 1.5) -> list[int]:
+    pass
+
+def strafe_delta(
+    velocity: Vec2, heading: int, yaw: int, dt: float, *, scale: float = 1.5, key_angle: int = 0,
+) -> tuple[int, bool]:
+    pass